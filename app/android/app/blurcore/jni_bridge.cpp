@@ -1,18 +1,57 @@
 #include <jni.h>
 #include <cstdint>
-#include "../../native/include/blur.h"
+#include <vector>
+#include "../../../../native/include/blur.h"
+#include "../../blurcore/jni_pixels.h"
 
 
-extern "C" JNIEXPORT jint JNICALL
-Java_com_blurapp_blurcore_BlurBridge_apply(
-JNIEnv* env, jobject /*thiz*/, jlong bufferPtr, jint w, jint h,
-jintArray rects, jint mode, jint strength){
 // rects packed as [x,y,w,h]*N
+static std::vector<BlurRect> unpackRects(JNIEnv* env, jintArray rects){
 jsize len = env->GetArrayLength(rects);
 jboolean isCopy=false;
 jint* arr = env->GetIntArrayElements(rects, &isCopy);
 int n = len/4; std::vector<BlurRect> rs(n);
 for(int i=0;i<n;++i){ rs[i]={arr[i*4+0],arr[i*4+1],arr[i*4+2],arr[i*4+3]}; }
-env->ReleaseIntArrayElements(rects, arr, 0);
-return blur_apply_regions(reinterpret_cast<uint8_t*>(bufferPtr), w, h, rs.data(), n, mode, strength);
-}
\ No newline at end of file
+env->ReleaseIntArrayElements(rects, arr, JNI_ABORT);
+return rs;
+}
+
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_blurapp_blurcore_BlurBridge_apply(
+JNIEnv* env, jobject /*thiz*/, jlong bufferPtr, jint w, jint h,
+jintArray rects, jint mode, jint strength){
+std::vector<BlurRect> rs = unpackRects(env, rects);
+return blur_apply_regions(reinterpret_cast<uint8_t*>(bufferPtr), w, h, rs.data(), (int)rs.size(), mode, strength);
+}
+
+
+// Blur an ARGB_8888 (RGBA in memory) or ALPHA_8 Bitmap in place, honouring
+// its row stride. returns -1 if the bitmap cannot be locked
+extern "C" JNIEXPORT jint JNICALL
+Java_com_blurapp_blurcore_BlurBridge_applyBitmap(
+JNIEnv* env, jobject /*thiz*/, jobject bitmap,
+jintArray rects, jint mode, jint strength){
+blurcore::LockedBitmap locked(env, bitmap);
+if(!locked.pixels()) return -1;
+std::vector<BlurRect> rs = unpackRects(env, rects);
+int format = locked.channels() == 4 ? BLUR_FORMAT_RGBA8888 : BLUR_FORMAT_GRAY8;
+return blur_apply_regions_ex(nullptr, locked.pixels(), locked.width(), locked.height(), locked.stride(),
+format, rs.data(), (int)rs.size(), mode, strength);
+}
+
+
+// Blur a direct ByteBuffer in place. format is a BlurPixelFormat, stride 0
+// means tightly packed. returns -1 for heap or undersized buffers
+extern "C" JNIEXPORT jint JNICALL
+Java_com_blurapp_blurcore_BlurBridge_applyBuffer(
+JNIEnv* env, jobject /*thiz*/, jobject buffer, jint w, jint h, jint stride, jint format,
+jintArray rects, jint mode, jint strength){
+const int bpp = format == BLUR_FORMAT_RGB888 ? 3 : (format == BLUR_FORMAT_GRAY8 || format == BLUR_FORMAT_NV21 ? 1 : 4);
+const int64_t rowBytes = stride > 0 ? stride : (int64_t)w * bpp;
+const int64_t rows = format == BLUR_FORMAT_NV21 ? h + (h + 1) / 2 : h;
+uint8_t* pixels = blurcore::DirectBufferPixels(env, buffer, rowBytes * rows);
+if(!pixels) return -1;
+std::vector<BlurRect> rs = unpackRects(env, rects);
+return blur_apply_regions_ex(nullptr, pixels, w, h, stride, format, rs.data(), (int)rs.size(), mode, strength);
+}
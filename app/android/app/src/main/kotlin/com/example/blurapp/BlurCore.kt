@@ -1,9 +1,12 @@
 package com.example.blurapp
 
+import android.content.ComponentCallbacks2
 import android.content.Context
 import android.graphics.Bitmap
 import android.util.Log
 import java.io.ByteArrayOutputStream
+import java.nio.ByteBuffer
+import java.util.concurrent.atomic.AtomicBoolean
 
 /**
  * BlurCore native library interface
@@ -17,7 +20,9 @@ class BlurCore private constructor() {
     companion object {
         private const val TAG = "BlurCore"
         private var isLibraryLoaded = false
+        @Volatile
         private var isInitialized = false
+        private val warmUpStarted = AtomicBoolean(false)
         
         // Load native library
         init {
@@ -47,6 +52,35 @@ class BlurCore private constructor() {
             }
         }
         
+        /**
+         * Start the one-time native setup on a background thread: SIMD kernel
+         * choice, the worker pool (one thread per performance core), the
+         * engines and, when given, both tflite models, then the backend
+         * governor's timings (measured once, then kept in filesDir). Later
+         * calls do nothing; work that a request needs before warm-up
+         * finishes waits for it natively instead of running twice. Timings appear under "startup"
+         * in [getPerformanceStats].
+         */
+        @JvmStatic
+        fun warmUp(context: Context, segmentationModel: String?, faceModel: String?) {
+            if (!isLibraryLoaded || !warmUpStarted.compareAndSet(false, true)) return
+            val appContext = context.applicationContext
+            Thread({
+                try {
+                    val segmentationPath = segmentationModel?.let { modelFile(appContext, it) }
+                    val facePath = faceModel?.let { modelFile(appContext, it) }
+                    val ready = nativeWarmUp(segmentationPath, facePath)
+                    if (ready and 1 != 0) isInitialized = true
+                    Log.i(TAG, "Warm-up finished (models ready: $ready)")
+                    // Backend timings: measured on the first run, read back after
+                    val status = nativeGovernorCalibrate(java.io.File(appContext.filesDir, GOVERNOR_FILE).path)
+                    if (status != 0) Log.w(TAG, "Governor timings not saved ($status)")
+                } catch (e: Exception) {
+                    Log.e(TAG, "Error during warm-up: ${e.message}")
+                }
+            }, "BlurCoreWarmUp").start()
+        }
+        
         /**
          * Initialize MediaPipe segmentation
          * Phase 1: Sets up the segmentation model
@@ -59,15 +93,7 @@ class BlurCore private constructor() {
             }
             
             try {
-                // For Phase 1, we'll prepare the model path
-                val fullPath = if (modelPath.startsWith("assets/")) {
-                    // Extract asset to cache directory for native access
-                    extractAssetToCache(context, modelPath)
-                } else {
-                    modelPath
-                }
-                
-                val result = nativeInitializeSegmentation(fullPath)
+                val result = nativeInitializeSegmentation(modelFile(context, modelPath))
                 isInitialized = result
                 
                 Log.i(TAG, "Segmentation initialization: ${if (result) "success" else "failed"}")
@@ -80,7 +106,30 @@ class BlurCore private constructor() {
         }
         
         /**
-         * Extract asset file to cache directory for native access
+         * Phase 1: Set up native face detection (face_detection_short_range.tflite)
+         * for [blurFacesInPlace].
+         */
+        @JvmStatic
+        fun initializeFaceDetection(context: Context, modelPath: String): Boolean {
+            if (!isLibraryLoaded) return false
+            return try {
+                val result = nativeInitializeFaceDetection(modelFile(context, modelPath))
+                Log.i(TAG, "Face detection initialization: ${if (result) "success" else "failed"}")
+                result
+            } catch (e: Exception) {
+                Log.e(TAG, "Error initializing face detection: ${e.message}")
+                false
+            }
+        }
+        
+        // Bundled models ("assets/...") are extracted once so native code can map them
+        private fun modelFile(context: Context, modelPath: String): String =
+            if (modelPath.startsWith("assets/")) extractAssetToCache(context, modelPath) else modelPath
+        
+        /**
+         * Extract asset file to cache directory for native access. The copy is
+         * written under a temporary name and renamed, so a concurrent warm-up
+         * never hands native code a half-written model.
          */
         private fun extractAssetToCache(context: Context, assetPath: String): String {
             val fileName = assetPath.substringAfterLast("/")
@@ -88,11 +137,13 @@ class BlurCore private constructor() {
             
             if (!cacheFile.exists()) {
                 try {
+                    val partial = java.io.File.createTempFile(fileName, ".part", context.cacheDir)
                     context.assets.open(assetPath).use { input ->
-                        cacheFile.outputStream().use { output ->
+                        partial.outputStream().use { output ->
                             input.copyTo(output)
                         }
                     }
+                    if (!partial.renameTo(cacheFile)) partial.delete()
                     Log.i(TAG, "Extracted asset $assetPath to ${cacheFile.absolutePath}")
                 } catch (e: Exception) {
                     Log.e(TAG, "Failed to extract asset $assetPath: ${e.message}")
@@ -123,30 +174,198 @@ class BlurCore private constructor() {
         /**
          * Perform image segmentation
          * Phase 1: Returns segmentation mask for background/foreground separation
+         * (one byte per pixel, 255 = person)
          */
         @JvmStatic
         fun segmentBitmap(bitmap: Bitmap): ByteArray? {
-            if (!isLibraryLoaded || !isInitialized) {
-                Log.w(TAG, "Cannot segment - library not loaded or not initialized")
-                return null
+            val mask = ByteBuffer.allocateDirect(bitmap.width * bitmap.height)
+            if (!segmentBitmapInto(bitmap, mask)) return null
+            
+            val result = ByteArray(mask.capacity())
+            mask.rewind()
+            mask.get(result)
+            return result
+        }
+        
+        /**
+         * Phase 1: Segment straight from the bitmap's pixels into a reusable mask.
+         * @param mask Direct ByteBuffer of at least width * height bytes
+         * @return true if the mask was written
+         */
+        @JvmStatic
+        fun segmentBitmapInto(bitmap: Bitmap, mask: ByteBuffer): Boolean {
+            if (!isLibraryLoaded || !isInitialized || !mask.isDirect) {
+                Log.w(TAG, "Cannot segment - library not loaded, not initialized or mask not direct")
+                return false
             }
             
-            try {
-                // Convert bitmap to byte array
-                val imageBytes = bitmapToByteArray(bitmap)
-                
-                // Call native segmentation
-                val result = nativeSegmentImage(imageBytes, bitmap.width, bitmap.height)
-                
-                Log.d(TAG, "Segmentation completed, result size: ${result.size}")
-                return if (result.isNotEmpty()) result else null
-                
+            return try {
+                val argb = if (bitmap.config == Bitmap.Config.ARGB_8888) bitmap
+                           else bitmap.copy(Bitmap.Config.ARGB_8888, false)
+                val ok = nativeSegmentBitmapInto(argb, mask)
+                Log.d(TAG, "Segmentation ${if (ok) "completed" else "failed"} for ${bitmap.width}x${bitmap.height}")
+                ok
             } catch (e: Exception) {
                 Log.e(TAG, "Error during segmentation: ${e.message}")
-                return null
+                false
+            }
+        }
+        
+        /**
+         * Phase 1: Detect faces and blur them in one native call, without
+         * passing boxes back through Kotlin or Dart.
+         * @param bitmap Mutable ARGB_8888 bitmap, blurred in place
+         * @param mode blurcore mode (0 box, 1 pixelate, 2 gaussian, 3/4 summed-area)
+         * @param padding Extra margin per side as a fraction of the face size
+         * @return number of faces blurred, or a negative blurcore status
+         */
+        @JvmStatic
+        fun blurFacesInPlace(bitmap: Bitmap, mode: Int, strength: Int, padding: Float = 0.25f): Int {
+            if (!isLibraryLoaded || !bitmap.isMutable || bitmap.config != Bitmap.Config.ARGB_8888) return -1
+            return try {
+                nativeBlurFacesBitmap(bitmap, mode, strength, padding)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error blurring faces: ${e.message}")
+                -1
+            }
+        }
+        
+        /**
+         * Batch export: decode, detect faces (if [detectFaces]), blur and encode
+         * every input on native stage threads. Outputs ending in .png are PNG,
+         * the rest JPEG at [quality].
+         * @return handle for [batchProgress], [cancelBatchExport],
+         *         [waitBatchExport] and [releaseBatchExport], or 0 if native codecs are unavailable
+         *         (API < 30) and the caller should export image by image
+         */
+        @JvmStatic
+        fun startBatchExport(inputs: Array<String>, outputs: Array<String>, mode: Int, strength: Int,
+                             detectFaces: Boolean, padding: Float = 0.25f, quality: Int = 90): Long {
+            if (!isLibraryLoaded || inputs.isEmpty() || inputs.size != outputs.size) return 0L
+            return try {
+                nativeBatchStart(inputs, outputs, mode, strength, detectFaces, padding, quality)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error starting batch export: ${e.message}")
+                0L
+            }
+        }
+        
+        /** @return {done, failed, total, finished (0/1)} */
+        @JvmStatic
+        fun batchProgress(handle: Long): IntArray =
+            if (isLibraryLoaded && handle != 0L) nativeBatchProgress(handle) else intArrayOf(0, 0, 0, 1)
+        
+        @JvmStatic
+        fun cancelBatchExport(handle: Long) {
+            if (isLibraryLoaded && handle != 0L) nativeBatchCancel(handle)
+        }
+        
+        /**
+         * Block until the job finishes; may run on any thread while
+         * [batchProgress] is polled.
+         * @return 0 if every image was written, -5 if cancelled, else the first failure
+         */
+        @JvmStatic
+        fun waitBatchExport(handle: Long): Int =
+            if (isLibraryLoaded && handle != 0L) nativeBatchWait(handle) else -1
+        
+        /** Free the job; the handle must not be used afterwards. */
+        @JvmStatic
+        fun releaseBatchExport(handle: Long) {
+            if (isLibraryLoaded && handle != 0L) nativeBatchRelease(handle)
+        }
+        
+        /**
+         * Rows of an RGBA image for [blurStrips]. [dst]/[src] hold [rows]
+         * packed rows of width * 4 bytes and are only valid during the call.
+         * Rows are requested top to bottom, each exactly once.
+         */
+        fun interface StripSource {
+            fun read(y: Int, rows: Int, dst: ByteBuffer): Boolean
+        }
+        
+        fun interface StripSink {
+            fun write(y: Int, rows: Int, src: ByteBuffer): Boolean
+        }
+        
+        /**
+         * Blur a very large image strip by strip: only [stripRows] rows plus
+         * the blur's halo are held in native memory at a time, and the output
+         * matches a whole-image blur exactly. Blocks the calling thread.
+         * @param rects x, y, w, h quadruples in image pixels
+         * @return 0, -7 if [source] failed, -8 if [sink] failed, or a negative blurcore status
+         */
+        @JvmStatic
+        fun blurStrips(width: Int, height: Int, rects: IntArray, mode: Int, strength: Int,
+                       stripRows: Int, source: StripSource, sink: StripSink): Int {
+            if (!isLibraryLoaded) return -1
+            return try {
+                nativeBlurStrips(width, height, rects, mode, strength, stripRows, source, sink)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error in strip blur: ${e.message}")
+                -1
+            }
+        }
+        
+        /** True if the library was built with libjpeg-turbo for [redactJpeg]. */
+        @JvmStatic
+        fun isJpegRedactionAvailable(): Boolean =
+            isLibraryLoaded && nativeJpegRedactAvailable()
+        
+        /**
+         * Blur [rects] of a JPEG file and write a JPEG, touching only the
+         * 8x8 blocks under the rects: the rest of the file is copied without
+         * being decoded or re-encoded. Blocks the calling thread.
+         * @param rects x, y, w, h quadruples in stored pixel coordinates
+         * @param keepMetadata keep EXIF, XMP and comments (the ICC profile is always kept)
+         * @return 0, -2 for an unsupported mode or colour space, -6 if not built in,
+         *         -7 if the input is not a readable JPEG, -8 if the output failed
+         */
+        @JvmStatic
+        fun redactJpeg(inputPath: String, outputPath: String, rects: IntArray, mode: Int, strength: Int,
+                       keepMetadata: Boolean = false): Int {
+            if (!isLibraryLoaded) return -1
+            return try {
+                nativeRedactJpeg(inputPath, outputPath, rects, mode, strength, keepMetadata)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error in JPEG redaction: ${e.message}")
+                -1
             }
         }
         
+        /**
+         * Phase 1: Create a live blur stream for camera preview or video frames.
+         * Segmentation only runs every [keyframeInterval] frames or on a scene
+         * change; unchanged tiles keep their previous result.
+         * @return handle for [processStreamFrame], 0 on failure
+         */
+        @JvmStatic
+        fun createBlurStream(width: Int, height: Int, keyframeInterval: Int, backgroundSigma: Int): Long {
+            if (!isLibraryLoaded) return 0L
+            return try {
+                nativeStreamCreate(width, height, keyframeInterval, backgroundSigma)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error creating blur stream: ${e.message}")
+                0L
+            }
+        }
+        
+        /**
+         * Phase 1: Blur the next RGBA frame in place.
+         * @param frame Direct ByteBuffer with [height] rows of [rowStride] bytes
+         * @return 0 on success, negative blurcore status otherwise
+         */
+        @JvmStatic
+        fun processStreamFrame(handle: Long, frame: ByteBuffer, height: Int, rowStride: Int): Int {
+            if (!isLibraryLoaded || handle == 0L || !frame.isDirect) return -1
+            return nativeStreamProcess(handle, frame, height, rowStride)
+        }
+        
+        @JvmStatic
+        fun destroyBlurStream(handle: Long) {
+            if (isLibraryLoaded && handle != 0L) nativeStreamDestroy(handle)
+        }
+        
         /**
          * Apply basic image processing
          * Phase 2: Enhanced with OpenCV blur operations
@@ -236,6 +455,67 @@ class BlurCore private constructor() {
             }
         }
         
+        /**
+         * Phase 2: Apply advanced blur directly to the bitmap's pixels (zero-copy).
+         * The bitmap must be mutable and ARGB_8888 or ALPHA_8.
+         * @return true if the bitmap was blurred
+         */
+        @JvmStatic
+        fun applyAdvancedBlurInPlace(bitmap: Bitmap, sigma: Double, blurType: Int): Boolean {
+            if (!isLibraryLoaded || !bitmap.isMutable) {
+                Log.w(TAG, "Cannot apply in-place blur - library not loaded or bitmap immutable")
+                return false
+            }
+            
+            return try {
+                nativeApplyAdvancedBlurBitmap(bitmap, sigma, blurType)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error applying in-place blur: ${e.message}")
+                false
+            }
+        }
+        
+        /**
+         * Phase 2: Apply advanced blur to packed pixels in a direct ByteBuffer (zero-copy)
+         * @return true if the buffer was blurred
+         */
+        @JvmStatic
+        fun applyAdvancedBlurInPlace(buffer: ByteBuffer, width: Int, height: Int, channels: Int,
+                                     sigma: Double, blurType: Int): Boolean {
+            if (!isLibraryLoaded || !buffer.isDirect) {
+                Log.w(TAG, "Cannot apply in-place blur - library not loaded or buffer not direct")
+                return false
+            }
+            
+            return try {
+                nativeApplyAdvancedBlurBuffer(buffer, width, height, channels, sigma, blurType)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error applying in-place blur: ${e.message}")
+                false
+            }
+        }
+        
+        /**
+         * Phase 2: Apply selective blur directly to the bitmap's pixels (zero-copy).
+         * @param mask Direct ByteBuffer with one byte per pixel (width * height)
+         * @return true if the bitmap was blurred
+         */
+        @JvmStatic
+        fun applySelectiveBlurInPlace(bitmap: Bitmap, mask: ByteBuffer,
+                                      foregroundSigma: Double, backgroundSigma: Double): Boolean {
+            if (!isLibraryLoaded || !bitmap.isMutable || !mask.isDirect) {
+                Log.w(TAG, "Cannot apply in-place selective blur - needs a mutable bitmap and direct mask buffer")
+                return false
+            }
+            
+            return try {
+                nativeApplySelectiveBlurBitmap(bitmap, mask, foregroundSigma, backgroundSigma)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error applying in-place selective blur: ${e.message}")
+                false
+            }
+        }
+        
         /**
          * Phase 2: Check if OpenCV is available
          */
@@ -270,6 +550,195 @@ class BlurCore private constructor() {
             }
         }
         
+        /**
+         * Phase 2: Upload [bitmap] (ARGB_8888) once into a resident GPU image.
+         * Blur it repeatedly with [applyGpuBlur] and read it back with
+         * [readGpuImage] only when the pixels are needed.
+         * @return handle, or 0 if the GPU backend is unavailable
+         */
+        @JvmStatic
+        fun createGpuImage(bitmap: Bitmap): Long {
+            if (!isLibraryLoaded) return 0L
+            return try {
+                nativeGpuImageCreate(bitmap)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error creating GPU image: ${e.message}")
+                0L
+            }
+        }
+        
+        /**
+         * Phase 2: Blur the GPU image's original source; nothing is transferred.
+         * @param rects Packed x, y, w, h quadruples
+         * @param mode 0 = box, 1 = pixelate, 2 = gaussian
+         */
+        @JvmStatic
+        fun applyGpuBlur(handle: Long, rects: IntArray, mode: Int, strength: Int): Boolean {
+            if (!isLibraryLoaded || handle == 0L) return false
+            return nativeGpuApply(handle, rects, mode, strength) == 0
+        }
+        
+        /**
+         * Phase 2: Copy the GPU result into a mutable ARGB_8888 bitmap of the same size
+         */
+        @JvmStatic
+        fun readGpuImage(handle: Long, bitmap: Bitmap): Boolean {
+            if (!isLibraryLoaded || handle == 0L || !bitmap.isMutable) return false
+            return nativeGpuRead(handle, bitmap) == 0
+        }
+        
+        @JvmStatic
+        fun destroyGpuImage(handle: Long) {
+            if (isLibraryLoaded && handle != 0L) nativeGpuImageDestroy(handle)
+        }
+        
+        /**
+         * Open a resident editing session: [bitmap] (ARGB_8888 or ALPHA_8) is copied
+         * into native memory once. Masks, renders and the blurred layers behind them
+         * stay there; only [exportSession] copies pixels back out. Cached layers are
+         * dropped first under memory pressure (see [onTrimMemory]).
+         * @return handle, or 0 on failure
+         */
+        @JvmStatic
+        fun openSession(bitmap: Bitmap): Long {
+            if (!isLibraryLoaded) return 0L
+            return try {
+                nativeSessionOpen(bitmap)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error opening session: ${e.message}")
+                0L
+            }
+        }
+        
+        /**
+         * Add a width * height mask (255 = foreground) to the session; null starts an
+         * empty one.
+         * @return mask id (> 0), or a negative status
+         */
+        @JvmStatic
+        fun addSessionMask(handle: Long, mask: ByteArray?): Int {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionAddMask(handle, mask)
+        }
+        
+        @JvmStatic
+        fun removeSessionMask(handle: Long, maskId: Int): Boolean {
+            if (!isLibraryLoaded || handle == 0L) return false
+            return nativeSessionRemoveMask(handle, maskId) == 0
+        }
+        
+        /**
+         * Run a mask pipeline on a session mask in place.
+         * @param steps op, radius, param triples (BlurMaskStep in blur.h)
+         * @return the blur_mask_process status
+         */
+        @JvmStatic
+        fun processSessionMask(handle: Long, maskId: Int, steps: IntArray): Int {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionProcessMask(handle, maskId, steps)
+        }
+        
+        /**
+         * Paint or erase a round brush stroke into a session mask. The next
+         * [renderSessionMasked] with unchanged parameters re-blends only the
+         * tiles the stroke touched.
+         * @param points x, y pairs in image pixels; one point paints a dab
+         * @return 0 on success, -1 on bad arguments
+         */
+        @JvmStatic
+        fun paintSessionMask(handle: Long, maskId: Int, points: FloatArray, radius: Float, erase: Boolean): Int {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionPaintMask(handle, maskId, points, radius, erase)
+        }
+        
+        /**
+         * Render the portrait blend: [fgStrength] where the mask is set, [bgStrength]
+         * elsewhere, from cached full-frame layers.
+         * @param mode 0 = box, 2 = gaussian
+         * @return 0 on success, -5 if cancelled
+         */
+        @JvmStatic
+        fun renderSessionMasked(handle: Long, maskId: Int, mode: Int, fgStrength: Int, bgStrength: Int): Int {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionRenderMasked(handle, maskId, mode, fgStrength, bgStrength)
+        }
+        
+        /**
+         * Render the whole frame at [strength] from cached layers. With [interpolate]
+         * a strength without its own layer blends the two nearest cached levels,
+         * which keeps slider scrubbing cheap; release the slider with it off for
+         * the exact result.
+         * @return 0 on success, -5 if cancelled
+         */
+        @JvmStatic
+        fun renderSessionBlurred(handle: Long, mode: Int, strength: Int, interpolate: Boolean): Int {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionRenderBlurred(handle, mode, strength, interpolate)
+        }
+        
+        /**
+         * Render the original with [rects] blurred; an empty array renders it unchanged.
+         * @param rects Packed x, y, w, h quadruples
+         */
+        @JvmStatic
+        fun renderSessionRegions(handle: Long, rects: IntArray, mode: Int, strength: Int): Int {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionRenderRegions(handle, rects, mode, strength)
+        }
+        
+        /**
+         * Copy the latest render into a mutable bitmap of the session's size and format
+         */
+        @JvmStatic
+        fun exportSession(handle: Long, bitmap: Bitmap): Boolean {
+            if (!isLibraryLoaded || handle == 0L || !bitmap.isMutable) return false
+            return nativeSessionExport(handle, bitmap) == 0
+        }
+        
+        /** Completion of a submitted render, called on a native worker thread */
+        fun interface JobListener {
+            fun onJobDone(job: Long, status: Int)
+        }
+        
+        /**
+         * [renderSessionMasked] on the native worker pool without blocking.
+         * Previews run ahead of queued exports; with [supersede] the session's
+         * unfinished renders are cancelled first.
+         * @return the job id for [cancelJob], or a negative status (the listener is not called)
+         */
+        @JvmStatic
+        fun submitSessionMasked(handle: Long, maskId: Int, mode: Int, fgStrength: Int, bgStrength: Int,
+                                preview: Boolean, supersede: Boolean, listener: JobListener): Long {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionSubmitRenderMasked(handle, maskId, mode, fgStrength, bgStrength,
+                                                   preview, supersede, listener)
+        }
+        
+        /** [renderSessionBlurred] as a job, as [submitSessionMasked] */
+        @JvmStatic
+        fun submitSessionBlurred(handle: Long, mode: Int, strength: Int, interpolate: Boolean,
+                                 preview: Boolean, supersede: Boolean, listener: JobListener): Long {
+            if (!isLibraryLoaded || handle == 0L) return -1
+            return nativeSessionSubmitRenderBlurred(handle, mode, strength, interpolate,
+                                                    preview, supersede, listener)
+        }
+        
+        /** Stop a submitted job; its listener still fires, with status -5 */
+        @JvmStatic
+        fun cancelJob(job: Long): Boolean {
+            return isLibraryLoaded && job > 0L && nativeJobCancel(job) == 0
+        }
+        
+        @JvmStatic
+        fun cancelSession(handle: Long) {
+            if (isLibraryLoaded && handle != 0L) nativeSessionCancel(handle)
+        }
+        
+        @JvmStatic
+        fun closeSession(handle: Long) {
+            if (isLibraryLoaded && handle != 0L) nativeSessionClose(handle)
+        }
+        
         // ================================================================================
         // Phase 3: Advanced Mask Processing Methods
         // ================================================================================
@@ -302,6 +771,48 @@ class BlurCore private constructor() {
             }
         }
         
+        /**
+         * Phase 3: Refine a mask held in a direct ByteBuffer, in place (zero-copy)
+         * @return true if the mask was refined
+         */
+        @JvmStatic
+        fun refineMaskInPlace(mask: ByteBuffer, width: Int, height: Int,
+                              operation: String, kernelSize: Int): Boolean {
+            if (!isLibraryLoaded || !mask.isDirect) {
+                Log.w(TAG, "Cannot refine mask in place - library not loaded or buffer not direct")
+                return false
+            }
+            
+            return try {
+                nativeRefineMaskBuffer(mask, width, height, operation, kernelSize)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error refining mask in place: ${e.message}")
+                false
+            }
+        }
+        
+        /**
+         * Phase 3: Run a whole mask pipeline in place on a direct ByteBuffer, in one
+         * native call. Only the mask's non-zero bounding box is processed; the buffer
+         * can go straight to [applySelectiveBlurInPlace] afterwards.
+         * @param steps op, radius, param triples (BlurMaskStep in blur.h)
+         * @return the blur_mask_process status (0 on success)
+         */
+        @JvmStatic
+        fun processMaskInPlace(mask: ByteBuffer, width: Int, height: Int, steps: IntArray): Int {
+            if (!isLibraryLoaded || !mask.isDirect) {
+                Log.w(TAG, "Cannot process mask in place - library not loaded or buffer not direct")
+                return -1
+            }
+            
+            return try {
+                nativeProcessMaskBuffer(mask, width, height, steps)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error processing mask in place: ${e.message}")
+                -1
+            }
+        }
+        
         /**
          * Phase 3: Smooth mask edges using Gaussian blur and distance transforms
          * @param maskBytes Raw mask data as byte array
@@ -330,7 +841,8 @@ class BlurCore private constructor() {
         }
         
         /**
-         * Phase 3: Optimize mask using connected components analysis
+         * Phase 3: Optimize mask: drop small blobs, then an edge-preserving
+         * guided-filter cleanup, binarize and close
          * @param maskBytes Raw mask data as byte array
          * @param width Image width
          * @param height Image height
@@ -356,6 +868,32 @@ class BlurCore private constructor() {
             }
         }
         
+        /**
+         * Phase 3: Snap a coarse mask to the photo's edges (guided filter)
+         * @param imageBytes RGBA pixels of the photo, width x height
+         * @param maskBytes Raw mask data as byte array
+         * @param radius Window half-size in pixels
+         * @param eps Regularisation on the [0, 1] scale; smaller follows edges more closely
+         * @param minArea Blobs under this many pixels are dropped first (0 keeps them)
+         * @return The soft refined mask, or null on failure
+         */
+        @JvmStatic
+        fun refineMaskGuided(imageBytes: ByteArray, maskBytes: ByteArray, width: Int, height: Int,
+                             radius: Int, eps: Float, minArea: Int): ByteArray? {
+            if (!isLibraryLoaded) {
+                Log.w(TAG, "Cannot refine mask - library not loaded")
+                return null
+            }
+            
+            try {
+                val result = nativeRefineMaskGuided(imageBytes, maskBytes, width, height, radius, eps, minArea)
+                return if (result.isNotEmpty()) result else null
+            } catch (e: Exception) {
+                Log.e(TAG, "Error refining mask: ${e.message}")
+                return null
+            }
+        }
+        
         /**
          * Phase 3: Create feathered mask using dual distance transforms
          * @param maskBytes Raw mask data as byte array
@@ -399,6 +937,81 @@ class BlurCore private constructor() {
             }
         }
         
+        /**
+         * Per-stage timings (count, total, max, p50/p90/p99 in ns, bytes
+         * copied) and buffer pool hit rates as JSON; see blur_stats_json in
+         * native/include/blur.h for the layout of the "core" object. The
+         * "startup" object holds the one-time setup costs in ms (null until
+         * paid) and whether the engines were built by [warmUp] or on demand.
+         */
+        @JvmStatic
+        fun getPerformanceStats(): String? {
+            if (!isLibraryLoaded) return null
+            return try {
+                nativeGetPerformanceReport()
+            } catch (e: Exception) {
+                Log.e(TAG, "Error reading performance stats: ${e.message}")
+                null
+            }
+        }
+        
+        @JvmStatic
+        fun resetPerformanceStats() {
+            if (isLibraryLoaded) nativeResetPerformanceStats()
+        }
+        
+        /**
+         * Give pooled native buffers and cached session layers back under memory
+         * pressure. Call from ComponentCallbacks2.onTrimMemory; severe levels drop
+         * every idle buffer and layer, milder ones keep a small working set.
+         * @return bytes released
+         */
+        @JvmStatic
+        fun onTrimMemory(level: Int): Long {
+            if (!isLibraryLoaded) return 0
+            val keepBytes = if (level >= ComponentCallbacks2.TRIM_MEMORY_RUNNING_LOW) 0L else TRIM_KEEP_BYTES
+            return try {
+                nativeTrimMemory(keepBytes)
+            } catch (e: Exception) {
+                Log.e(TAG, "Error trimming memory: ${e.message}")
+                0
+            }
+        }
+        
+        private const val TRIM_KEEP_BYTES = 16L shl 20
+        
+        // BlurPressure levels for [setPerformancePressure]
+        const val PRESSURE_NONE = 0
+        const val PRESSURE_MODERATE = 1
+        const val PRESSURE_SEVERE = 2
+        
+        private const val GOVERNOR_FILE = "blur_governor.txt"
+        
+        /**
+         * Thermal / battery-saver level from [DevicePressure]. Moderate halves
+         * the native worker threads and scales previews to 3/4; severe runs on
+         * one thread, keeps off the GPU and halves previews.
+         */
+        @JvmStatic
+        fun setPerformancePressure(level: Int) {
+            if (isLibraryLoaded) nativeSetPerformancePressure(level)
+        }
+        
+        /**
+         * The governor's backend timings, routes and current pressure as JSON;
+         * see blur_governor_json in native/include/blur.h.
+         */
+        @JvmStatic
+        fun getGovernorReport(): String? {
+            if (!isLibraryLoaded) return null
+            return try {
+                nativeGetGovernorReport()
+            } catch (e: Exception) {
+                Log.e(TAG, "Error reading governor report: ${e.message}")
+                null
+            }
+        }
+        
         // Utility functions
         private fun bitmapToByteArray(bitmap: Bitmap): ByteArray {
             val stream = ByteArrayOutputStream()
@@ -422,10 +1035,51 @@ class BlurCore private constructor() {
         @JvmStatic
         private external fun nativeIsMediaPipeAvailable(): Boolean
         @JvmStatic
+        private external fun nativeWarmUp(segmentationModel: String?, faceModel: String?): Int
+        @JvmStatic
+        private external fun nativeGovernorCalibrate(cachePath: String): Int
+        @JvmStatic
+        private external fun nativeSetPerformancePressure(level: Int): Int
+        @JvmStatic
+        private external fun nativeGetGovernorReport(): String
+        @JvmStatic
         private external fun nativeInitializeSegmentation(modelPath: String): Boolean
         @JvmStatic
         private external fun nativeSegmentImage(imageBytes: ByteArray, width: Int, height: Int): ByteArray
         @JvmStatic
+        private external fun nativeSegmentBitmapInto(bitmap: Bitmap, mask: ByteBuffer): Boolean
+        @JvmStatic
+        private external fun nativeInitializeFaceDetection(modelPath: String): Boolean
+        @JvmStatic
+        private external fun nativeBlurFacesBitmap(bitmap: Bitmap, mode: Int, strength: Int, padding: Float): Int
+        @JvmStatic
+        private external fun nativeBatchStart(inputs: Array<String>, outputs: Array<String>, mode: Int,
+                                              strength: Int, detectFaces: Boolean, padding: Float,
+                                              quality: Int): Long
+        @JvmStatic
+        private external fun nativeBatchProgress(handle: Long): IntArray
+        @JvmStatic
+        private external fun nativeBatchCancel(handle: Long)
+        @JvmStatic
+        private external fun nativeBatchWait(handle: Long): Int
+        @JvmStatic
+        private external fun nativeBatchRelease(handle: Long)
+        @JvmStatic
+        private external fun nativeBlurStrips(width: Int, height: Int, rects: IntArray, mode: Int, strength: Int,
+                                              stripRows: Int, source: StripSource, sink: StripSink): Int
+        @JvmStatic
+        private external fun nativeJpegRedactAvailable(): Boolean
+        @JvmStatic
+        private external fun nativeRedactJpeg(input: String, output: String, rects: IntArray, mode: Int,
+                                              strength: Int, keepMetadata: Boolean): Int
+        @JvmStatic
+        private external fun nativeStreamCreate(width: Int, height: Int, keyframeInterval: Int,
+                                                backgroundSigma: Int): Long
+        @JvmStatic
+        private external fun nativeStreamProcess(handle: Long, frame: ByteBuffer, height: Int, rowStride: Int): Int
+        @JvmStatic
+        private external fun nativeStreamDestroy(handle: Long)
+        @JvmStatic
         private external fun nativeProcessImageBasic(imageBytes: ByteArray, blurStrength: Int): ByteArray
         
         // Phase 2: OpenCV blur functions
@@ -437,26 +1091,96 @@ class BlurCore private constructor() {
                                                      width: Int, height: Int, channels: Int,
                                                      foregroundSigma: Double, backgroundSigma: Double): ByteArray
         @JvmStatic
+        private external fun nativeApplyAdvancedBlurBitmap(bitmap: Bitmap, sigma: Double, blurType: Int): Boolean
+        @JvmStatic
+        private external fun nativeApplyAdvancedBlurBuffer(buffer: ByteBuffer, width: Int, height: Int,
+                                                          channels: Int, sigma: Double, blurType: Int): Boolean
+        @JvmStatic
+        private external fun nativeApplySelectiveBlurBitmap(bitmap: Bitmap, maskBuffer: ByteBuffer,
+                                                           foregroundSigma: Double, backgroundSigma: Double): Boolean
+        @JvmStatic
         private external fun nativeIsOpenCVAvailable(): Boolean
         @JvmStatic
         private external fun nativeIsGPUAvailable(): Boolean
         
+        @JvmStatic
+        private external fun nativeGpuImageCreate(bitmap: Bitmap): Long
+        @JvmStatic
+        private external fun nativeGpuApply(handle: Long, rects: IntArray, mode: Int, strength: Int): Int
+        @JvmStatic
+        private external fun nativeGpuRead(handle: Long, bitmap: Bitmap): Int
+        @JvmStatic
+        private external fun nativeGpuImageDestroy(handle: Long)
+        
+        @JvmStatic
+        private external fun nativeSessionOpen(bitmap: Bitmap): Long
+        @JvmStatic
+        private external fun nativeSessionAddMask(handle: Long, maskBytes: ByteArray?): Int
+        @JvmStatic
+        private external fun nativeSessionRemoveMask(handle: Long, maskId: Int): Int
+        @JvmStatic
+        private external fun nativeSessionProcessMask(handle: Long, maskId: Int, steps: IntArray): Int
+        @JvmStatic
+        private external fun nativeSessionPaintMask(handle: Long, maskId: Int, points: FloatArray,
+                                                    radius: Float, erase: Boolean): Int
+        @JvmStatic
+        private external fun nativeSessionRenderMasked(handle: Long, maskId: Int, mode: Int,
+                                                       fgStrength: Int, bgStrength: Int): Int
+        @JvmStatic
+        private external fun nativeSessionRenderBlurred(handle: Long, mode: Int, strength: Int,
+                                                        interpolate: Boolean): Int
+        @JvmStatic
+        private external fun nativeSessionRenderRegions(handle: Long, rects: IntArray, mode: Int, strength: Int): Int
+        @JvmStatic
+        private external fun nativeSessionExport(handle: Long, bitmap: Bitmap): Int
+        @JvmStatic
+        private external fun nativeSessionCancel(handle: Long)
+        @JvmStatic
+        private external fun nativeSessionSubmitRenderMasked(handle: Long, maskId: Int, mode: Int, fgStrength: Int,
+                                                             bgStrength: Int, preview: Boolean, supersede: Boolean,
+                                                             listener: JobListener): Long
+        @JvmStatic
+        private external fun nativeSessionSubmitRenderBlurred(handle: Long, mode: Int, strength: Int,
+                                                              interpolate: Boolean, preview: Boolean,
+                                                              supersede: Boolean, listener: JobListener): Long
+        @JvmStatic
+        private external fun nativeJobCancel(job: Long): Int
+        @JvmStatic
+        private external fun nativeSessionClose(handle: Long)
+        
         // Phase 3: Advanced mask processing functions
         @JvmStatic
         private external fun nativeRefineMask(maskBytes: ByteArray, width: Int, height: Int, 
                                              operation: String, kernelSize: Int): ByteArray
         @JvmStatic
+        private external fun nativeRefineMaskBuffer(maskBuffer: ByteBuffer, width: Int, height: Int,
+                                                   operation: String, kernelSize: Int): Boolean
+        @JvmStatic
+        private external fun nativeProcessMaskBuffer(maskBuffer: ByteBuffer, width: Int, height: Int,
+                                                    steps: IntArray): Int
+        @JvmStatic
         private external fun nativeSmoothMaskEdges(maskBytes: ByteArray, width: Int, height: Int, 
                                                   blurSigma: Double): ByteArray
         @JvmStatic
         private external fun nativeOptimizeMask(maskBytes: ByteArray, width: Int, height: Int, 
                                                minArea: Int): ByteArray
         @JvmStatic
+        private external fun nativeRefineMaskGuided(imageBytes: ByteArray, maskBytes: ByteArray, width: Int,
+                                                   height: Int, radius: Int, eps: Float, minArea: Int): ByteArray
+        @JvmStatic
         private external fun nativeCreateFeatheredMask(maskBytes: ByteArray, width: Int, height: Int, 
                                                       featherRadius: Int): ByteArray
         
         // Cleanup
         @JvmStatic
         private external fun nativeCleanup()
+        @JvmStatic
+        private external fun nativeTrimMemory(keepBytes: Long): Long
+        
+        // Instrumentation
+        @JvmStatic
+        private external fun nativeGetPerformanceReport(): String
+        @JvmStatic
+        private external fun nativeResetPerformanceStats()
     }
 }
\ No newline at end of file
@@ -3,12 +3,15 @@ package com.example.blurapp
 import android.content.Context
 import android.graphics.Bitmap
 import android.graphics.BitmapFactory
+import android.os.Handler
+import android.os.Looper
 import io.flutter.embedding.engine.plugins.FlutterPlugin
 import io.flutter.plugin.common.MethodCall
 import io.flutter.plugin.common.MethodChannel
 import io.flutter.plugin.common.MethodChannel.MethodCallHandler
 import io.flutter.plugin.common.MethodChannel.Result
 import java.io.ByteArrayOutputStream
+import java.nio.ByteBuffer
 
 /**
  * BlurCorePlugin - Flutter platform channel for native blur operations
@@ -21,6 +24,15 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
     private lateinit var channel: MethodChannel
     private lateinit var context: Context
 
+    // Last mask from processMaskPipeline with keepNative, reused by
+    // applySelectiveBlur without another copy across the channel
+    private var processedMask: ByteBuffer? = null
+    private var processedMaskWidth = 0
+    private var processedMaskHeight = 0
+
+    // Open editing sessions and their sizes, for export
+    private val sessionSizes = HashMap<Long, Pair<Int, Int>>()
+
     companion object {
         private const val CHANNEL_NAME = "blur_core"
         private const val TAG = "BlurCorePlugin"
@@ -39,12 +51,25 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
         when (call.method) {
             // Phase 1: MediaPipe methods
             "getVersion" -> handleGetVersion(result)
+            "warmUp" -> handleWarmUp(call, result)
             "isMediaPipeAvailable" -> handleIsMediaPipeAvailable(result)
             "initializeSegmentation" -> handleInitializeSegmentation(call, result)
             "segmentImage" -> handleSegmentImage(call, result)
+            "initializeFaceDetection" -> handleInitializeFaceDetection(call, result)
+            "blurFaces" -> handleBlurFaces(call, result)
+            "startBatchExport" -> handleStartBatchExport(call, result)
+            "batchProgress" -> handleBatchProgress(call, result)
+            "cancelBatchExport" -> handleCancelBatchExport(call, result)
+            "finishBatchExport" -> handleFinishBatchExport(call, result)
+            "exportLargeImage" -> handleExportLargeImage(call, result)
             "processImageBasic" -> handleProcessImageBasic(call, result)
             "getProcessingCapabilities" -> handleGetProcessingCapabilities(result)
             "cleanup" -> handleCleanup(result)
+            "getPerformanceStats" -> result.success(BlurCore.getPerformanceStats())
+            "resetPerformanceStats" -> {
+                BlurCore.resetPerformanceStats()
+                result.success(true)
+            }
             
             // Phase 2: OpenCV blur methods
             "isOpenCVAvailable" -> handleIsOpenCVAvailable(result)
@@ -56,7 +81,96 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
             "refineMask" -> handleRefineMask(call, result)
             "smoothMaskEdges" -> handleSmoothMaskEdges(call, result)
             "optimizeMask" -> handleOptimizeMask(call, result)
+            "refineMaskGuided" -> handleRefineMaskGuided(call, result)
             "createFeatheredMask" -> handleCreateFeatheredMask(call, result)
+            "processMaskPipeline" -> handleProcessMaskPipeline(call, result)
+            "releaseProcessedMask" -> {
+                processedMask = null
+                result.success(true)
+            }
+            
+            // Resident editing sessions
+            "sessionOpen" -> handleSessionOpen(call, result)
+            "sessionAddMask" -> result.success(
+                BlurCore.addSessionMask(sessionHandle(call), call.argument<ByteArray>("maskBytes"))
+            )
+            "sessionRemoveMask" -> result.success(
+                BlurCore.removeSessionMask(sessionHandle(call), call.argument<Int>("maskId") ?: 0)
+            )
+            "sessionProcessMask" -> result.success(
+                BlurCore.processSessionMask(
+                    sessionHandle(call), call.argument<Int>("maskId") ?: 0,
+                    (call.argument<List<Int>>("steps") ?: emptyList()).toIntArray(),
+                )
+            )
+            "sessionPaintMask" -> result.success(
+                BlurCore.paintSessionMask(
+                    sessionHandle(call), call.argument<Int>("maskId") ?: 0,
+                    (call.argument<List<Double>>("points") ?: emptyList()).map { it.toFloat() }.toFloatArray(),
+                    (call.argument<Double>("radius") ?: 0.0).toFloat(),
+                    call.argument<Boolean>("erase") ?: false,
+                )
+            )
+            "sessionRenderMasked" -> result.success(
+                BlurCore.renderSessionMasked(
+                    sessionHandle(call), call.argument<Int>("maskId") ?: 0,
+                    call.argument<Int>("mode") ?: 2,
+                    call.argument<Int>("fgStrength") ?: 0,
+                    call.argument<Int>("bgStrength") ?: 0,
+                )
+            )
+            "sessionRenderBlurred" -> result.success(
+                BlurCore.renderSessionBlurred(
+                    sessionHandle(call),
+                    call.argument<Int>("mode") ?: 2,
+                    call.argument<Int>("strength") ?: 12,
+                    call.argument<Boolean>("interpolate") ?: false,
+                )
+            )
+            "sessionRenderRegions" -> result.success(
+                BlurCore.renderSessionRegions(
+                    sessionHandle(call),
+                    (call.argument<List<Int>>("rects") ?: emptyList()).toIntArray(),
+                    call.argument<Int>("mode") ?: 2,
+                    call.argument<Int>("strength") ?: 12,
+                )
+            )
+            "sessionSubmitRenderMasked" -> result.success(
+                BlurCore.submitSessionMasked(
+                    sessionHandle(call), call.argument<Int>("maskId") ?: 0,
+                    call.argument<Int>("mode") ?: 2,
+                    call.argument<Int>("fgStrength") ?: 0,
+                    call.argument<Int>("bgStrength") ?: 0,
+                    call.argument<Boolean>("preview") ?: true,
+                    call.argument<Boolean>("supersede") ?: true,
+                    jobListener,
+                )
+            )
+            "sessionSubmitRenderBlurred" -> result.success(
+                BlurCore.submitSessionBlurred(
+                    sessionHandle(call),
+                    call.argument<Int>("mode") ?: 2,
+                    call.argument<Int>("strength") ?: 12,
+                    call.argument<Boolean>("interpolate") ?: false,
+                    call.argument<Boolean>("preview") ?: true,
+                    call.argument<Boolean>("supersede") ?: true,
+                    jobListener,
+                )
+            )
+            "jobCancel" -> result.success(
+                BlurCore.cancelJob(call.argument<Number>("job")?.toLong() ?: 0L)
+            )
+            "sessionExport" -> handleSessionExport(call, result)
+            "sessionCancel" -> {
+                BlurCore.cancelSession(sessionHandle(call))
+                result.success(null)
+            }
+            "sessionClose" -> {
+                val handle = sessionHandle(call)
+                sessionSizes.remove(handle)
+                BlurCore.closeSession(handle)
+                result.success(null)
+            }
             
             else -> result.notImplemented()
         }
@@ -97,6 +211,108 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
         }
     }
 
+    // Returns at once; the setup runs on BlurCore's warm-up thread
+    private fun handleWarmUp(call: MethodCall, result: Result) {
+        BlurCore.warmUp(context, call.argument<String>("segmentationModel"), call.argument<String>("faceModel"))
+        result.success(BlurCore.isAvailable())
+    }
+
+    private fun handleInitializeFaceDetection(call: MethodCall, result: Result) {
+        try {
+            val modelPath = call.argument<String>("modelPath")
+                ?: return result.error("INVALID_ARGS", "Model path is required", null)
+            result.success(BlurCore.initializeFaceDetection(context, modelPath))
+        } catch (e: Exception) {
+            result.error("INIT_ERROR", "Failed to initialize face detection: ${e.message}", null)
+        }
+    }
+
+    // Detect and blur in one native pass; the boxes never come back here
+    private fun handleBlurFaces(call: MethodCall, result: Result) {
+        try {
+            val imageBytes = call.argument<ByteArray>("imageBytes")
+                ?: return result.error("INVALID_ARGS", "Missing imageBytes", null)
+            val mode = call.argument<Int>("mode") ?: 2
+            val strength = call.argument<Int>("strength") ?: 12
+            val padding = call.argument<Double>("padding") ?: 0.25
+            
+            val options = BitmapFactory.Options().apply { inMutable = true }
+            val bitmap = BitmapFactory.decodeByteArray(imageBytes, 0, imageBytes.size, options)
+                ?: return result.error("DECODE_ERROR", "Failed to decode image", null)
+            
+            val faces = BlurCore.blurFacesInPlace(bitmap, mode, strength, padding.toFloat())
+            if (faces < 0) {
+                return result.error("BLUR_ERROR", "Face blur failed with status $faces", null)
+            }
+            val outputStream = ByteArrayOutputStream()
+            bitmap.compress(Bitmap.CompressFormat.JPEG, 90, outputStream)
+            result.success(mapOf("faces" to faces, "imageBytes" to outputStream.toByteArray()))
+        } catch (e: Exception) {
+            result.error("FACE_BLUR_ERROR", "Face blur failed: ${e.message}", null)
+        }
+    }
+
+    private fun handleStartBatchExport(call: MethodCall, result: Result) {
+        try {
+            val inputs = call.argument<List<String>>("inputs")
+                ?: return result.error("INVALID_ARGS", "Missing inputs", null)
+            val outputs = call.argument<List<String>>("outputs")
+                ?: return result.error("INVALID_ARGS", "Missing outputs", null)
+            val handle = BlurCore.startBatchExport(
+                inputs.toTypedArray(), outputs.toTypedArray(),
+                call.argument<Int>("mode") ?: 2,
+                call.argument<Int>("strength") ?: 12,
+                call.argument<Boolean>("detectFaces") ?: false,
+                (call.argument<Double>("padding") ?: 0.25).toFloat(),
+                call.argument<Int>("quality") ?: 90,
+            )
+            result.success(handle)
+        } catch (e: Exception) {
+            result.error("BATCH_ERROR", "Failed to start batch export: ${e.message}", null)
+        }
+    }
+
+    private fun handleBatchProgress(call: MethodCall, result: Result) {
+        val handle = call.argument<Number>("handle")?.toLong() ?: 0L
+        val p = BlurCore.batchProgress(handle)
+        result.success(mapOf("done" to p[0], "failed" to p[1], "total" to p[2], "finished" to (p[3] == 1)))
+    }
+
+    private fun handleCancelBatchExport(call: MethodCall, result: Result) {
+        BlurCore.cancelBatchExport(call.argument<Number>("handle")?.toLong() ?: 0L)
+        result.success(null)
+    }
+
+    // Waiting blocks, so it runs off the platform thread; the release goes
+    // back to it so it can never overlap a batchProgress call
+    private fun handleFinishBatchExport(call: MethodCall, result: Result) {
+        val handle = call.argument<Number>("handle")?.toLong() ?: 0L
+        Thread {
+            val status = BlurCore.waitBatchExport(handle)
+            Handler(Looper.getMainLooper()).post {
+                BlurCore.releaseBatchExport(handle)
+                result.success(status)
+            }
+        }.start()
+    }
+
+    // Strip export of a huge photo takes seconds, so it runs off the
+    // platform thread and answers on the main looper
+    private fun handleExportLargeImage(call: MethodCall, result: Result) {
+        val input = call.argument<String>("input")
+            ?: return result.error("INVALID_ARGS", "Missing input", null)
+        val output = call.argument<String>("output")
+            ?: return result.error("INVALID_ARGS", "Missing output", null)
+        val rects = call.argument<List<Int>>("rects")?.toIntArray() ?: IntArray(0)
+        val mode = call.argument<Int>("mode") ?: 2
+        val strength = call.argument<Int>("strength") ?: 12
+        val stripRows = call.argument<Int>("stripRows") ?: StripExport.DEFAULT_STRIP_ROWS
+        Thread {
+            val status = StripExport.export(input, output, rects, mode, strength, stripRows)
+            Handler(Looper.getMainLooper()).post { result.success(status) }
+        }.start()
+    }
+
     private fun handleSegmentImage(call: MethodCall, result: Result) {
         try {
             val imageBytes = call.argument<ByteArray>("imageBytes")
@@ -172,6 +388,9 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
             capabilities["openCVAvailable"] = BlurCore.isOpenCVAvailable()
             capabilities["gpuAvailable"] = BlurCore.isGPUAvailable()
             capabilities["version"] = BlurCore.getVersionInfo()
+            // Measured backend timings, routes and thermal / battery pressure
+            // (JSON, see blur_governor_json)
+            BlurCore.getGovernorReport()?.let { capabilities["governor"] = it }
             
             // Phase 2: Enhanced capabilities
             capabilities["supportedBlurTypes"] = listOf("gaussian", "box", "motion")
@@ -246,12 +465,15 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
             val imageBytes = call.argument<ByteArray>("imageBytes")
                 ?: return result.error("INVALID_ARGS", "Missing imageBytes", null)
             
-            val maskBytes = call.argument<ByteArray>("maskBytes")
-                ?: return result.error("INVALID_ARGS", "Missing maskBytes", null)
-            
             val foregroundSigma = call.argument<Double>("foregroundSigma") ?: 0.0
             val backgroundSigma = call.argument<Double>("backgroundSigma") ?: 5.0
             
+            val maskBytes = call.argument<ByteArray>("maskBytes")
+            if (maskBytes == null && call.argument<Boolean>("useProcessedMask") == true) {
+                return applySelectiveBlurWithProcessedMask(imageBytes, foregroundSigma, backgroundSigma, result)
+            }
+            if (maskBytes == null) return result.error("INVALID_ARGS", "Missing maskBytes", null)
+            
             // Convert bytes to bitmap
             val bitmap = BitmapFactory.decodeByteArray(imageBytes, 0, imageBytes.size)
                 ?: return result.error("DECODE_ERROR", "Failed to decode image", null)
@@ -275,6 +497,88 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
         }
     }
     
+    // Blurs a mutable copy of the decoded image in place with the mask kept
+    // by processMaskPipeline
+    private fun applySelectiveBlurWithProcessedMask(imageBytes: ByteArray, foregroundSigma: Double,
+                                                    backgroundSigma: Double, result: Result) {
+        val mask = processedMask
+            ?: return result.error("INVALID_ARGS", "No processed mask kept", null)
+        val options = BitmapFactory.Options().apply {
+            inMutable = true
+            inPreferredConfig = Bitmap.Config.ARGB_8888
+        }
+        val bitmap = BitmapFactory.decodeByteArray(imageBytes, 0, imageBytes.size, options)
+            ?: return result.error("DECODE_ERROR", "Failed to decode image", null)
+        if (bitmap.width != processedMaskWidth || bitmap.height != processedMaskHeight) {
+            return result.error("INVALID_ARGS", "Processed mask is ${processedMaskWidth}x$processedMaskHeight, " +
+                "image is ${bitmap.width}x${bitmap.height}", null)
+        }
+        
+        if (!BlurCore.applySelectiveBlurInPlace(bitmap, mask, foregroundSigma, backgroundSigma)) {
+            return result.error("SELECTIVE_BLUR_ERROR", "Selective blur failed", null)
+        }
+        val outputStream = ByteArrayOutputStream()
+        bitmap.compress(Bitmap.CompressFormat.JPEG, 90, outputStream)
+        result.success(outputStream.toByteArray())
+    }
+    
+    private fun sessionHandle(call: MethodCall): Long = call.argument<Number>("handle")?.toLong() ?: 0L
+    
+    // Submitted renders reply with their job id at once; completion comes back
+    // to Dart as a "jobDone" call on the main thread
+    private val jobListener = BlurCore.JobListener { job, status ->
+        Handler(Looper.getMainLooper()).post {
+            channel.invokeMethod("jobDone", mapOf("job" to job, "status" to status))
+        }
+    }
+    
+    // The image crosses the channel once; later calls pass only the handle
+    private fun handleSessionOpen(call: MethodCall, result: Result) {
+        try {
+            val imageBytes = call.argument<ByteArray>("imageBytes")
+                ?: return result.error("INVALID_ARGS", "Missing imageBytes", null)
+            val options = BitmapFactory.Options().apply { inPreferredConfig = Bitmap.Config.ARGB_8888 }
+            val bitmap = BitmapFactory.decodeByteArray(imageBytes, 0, imageBytes.size, options)
+                ?: return result.error("DECODE_ERROR", "Failed to decode image", null)
+            
+            val handle = BlurCore.openSession(bitmap)
+            val width = bitmap.width
+            val height = bitmap.height
+            bitmap.recycle()
+            if (handle == 0L) return result.error("SESSION_ERROR", "Failed to open session", null)
+            
+            sessionSizes[handle] = Pair(width, height)
+            result.success(mapOf("handle" to handle, "width" to width, "height" to height))
+        } catch (e: Exception) {
+            result.error("SESSION_ERROR", "Failed to open session: ${e.message}", null)
+        }
+    }
+    
+    private fun handleSessionExport(call: MethodCall, result: Result) {
+        try {
+            val handle = sessionHandle(call)
+            val (width, height) = sessionSizes[handle]
+                ?: return result.error("INVALID_ARGS", "Unknown session", null)
+            val bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+            if (!BlurCore.exportSession(handle, bitmap)) {
+                bitmap.recycle()
+                return result.error("SESSION_ERROR", "Session export failed", null)
+            }
+            
+            val png = call.argument<String>("format") == "png"
+            val outputStream = ByteArrayOutputStream()
+            bitmap.compress(
+                if (png) Bitmap.CompressFormat.PNG else Bitmap.CompressFormat.JPEG,
+                call.argument<Int>("quality") ?: 90,
+                outputStream,
+            )
+            bitmap.recycle()
+            result.success(outputStream.toByteArray())
+        } catch (e: Exception) {
+            result.error("SESSION_ERROR", "Session export failed: ${e.message}", null)
+        }
+    }
+    
     // ================================================================================
     // Phase 3: Advanced Mask Processing Method Handlers
     // ================================================================================
@@ -361,6 +665,74 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
         }
     }
     
+    private fun handleRefineMaskGuided(call: MethodCall, result: Result) {
+        try {
+            val imageBytes = call.argument<ByteArray>("imageBytes")
+                ?: return result.error("INVALID_ARGS", "Missing imageBytes", null)
+            val maskBytes = call.argument<ByteArray>("maskBytes")
+                ?: return result.error("INVALID_ARGS", "Missing maskBytes", null)
+            val width = call.argument<Int>("width")
+                ?: return result.error("INVALID_ARGS", "Missing width", null)
+            val height = call.argument<Int>("height")
+                ?: return result.error("INVALID_ARGS", "Missing height", null)
+            val radius = call.argument<Int>("radius") ?: 8
+            val eps = call.argument<Double>("eps") ?: 1e-3
+            val minArea = call.argument<Int>("minArea") ?: 0
+            
+            val refined = BlurCore.refineMaskGuided(imageBytes, maskBytes, width, height,
+                                                    radius, eps.toFloat(), minArea)
+            if (refined != null) {
+                result.success(refined)
+            } else {
+                result.error("REFINE_MASK_ERROR", "Guided mask refinement failed", null)
+            }
+        } catch (e: Exception) {
+            result.error("REFINE_MASK_ERROR", "Guided mask refinement failed: ${e.message}", null)
+        }
+    }
+    
+    // One copy in, every step in place natively, one copy out
+    private fun handleProcessMaskPipeline(call: MethodCall, result: Result) {
+        try {
+            val maskBytes = call.argument<ByteArray>("maskBytes")
+                ?: return result.error("INVALID_ARGS", "Missing maskBytes", null)
+            val width = call.argument<Int>("width")
+                ?: return result.error("INVALID_ARGS", "Missing width", null)
+            val height = call.argument<Int>("height")
+                ?: return result.error("INVALID_ARGS", "Missing height", null)
+            val steps = call.argument<List<Int>>("steps")
+                ?: return result.error("INVALID_ARGS", "Missing steps", null)
+            if (width <= 0 || height <= 0 || maskBytes.size < width * height) {
+                return result.error("INVALID_ARGS", "Mask must hold ${width}x$height bytes", null)
+            }
+            
+            // A kept buffer is only reused for the next kept mask
+            val size = width * height
+            val keepNative = call.argument<Boolean>("keepNative") == true
+            val mask = processedMask?.takeIf { keepNative && it.capacity() == size }
+                ?: ByteBuffer.allocateDirect(size)
+            mask.clear()
+            mask.put(maskBytes, 0, size)
+            
+            val status = BlurCore.processMaskInPlace(mask, width, height, steps.toIntArray())
+            if (status != 0) {
+                return result.error("MASK_PIPELINE_ERROR", "Mask pipeline failed ($status)", null)
+            }
+            
+            val output = ByteArray(size)
+            mask.rewind()
+            mask.get(output)
+            if (keepNative) {
+                processedMask = mask
+                processedMaskWidth = width
+                processedMaskHeight = height
+            }
+            result.success(output)
+        } catch (e: Exception) {
+            result.error("MASK_PIPELINE_ERROR", "Mask pipeline failed: ${e.message}", null)
+        }
+    }
+    
     private fun handleCreateFeatheredMask(call: MethodCall, result: Result) {
         try {
             val maskBytes = call.argument<ByteArray>("maskBytes")
@@ -399,6 +771,9 @@ class BlurCorePlugin: FlutterPlugin, MethodCallHandler {
 
     override fun onDetachedFromEngine(binding: FlutterPlugin.FlutterPluginBinding) {
         channel.setMethodCallHandler(null)
+        processedMask = null
+        sessionSizes.keys.forEach { BlurCore.closeSession(it) }
+        sessionSizes.clear()
         
         // Cleanup native resources
         try {
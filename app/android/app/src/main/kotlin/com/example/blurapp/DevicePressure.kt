@@ -0,0 +1,67 @@
+package com.example.blurapp
+
+import android.content.BroadcastReceiver
+import android.content.Context
+import android.content.Intent
+import android.content.IntentFilter
+import android.os.Build
+import android.os.PowerManager
+
+/**
+ * Feeds the thermal status and battery saver into the native governor
+ * ([BlurCore.setPerformancePressure]), which caps worker threads and preview
+ * sizes while either is raised. Started and stopped with the activity.
+ */
+object DevicePressure {
+    private var context: Context? = null
+    private var powerManager: PowerManager? = null
+    private var thermalListener: PowerManager.OnThermalStatusChangedListener? = null
+    @Volatile
+    private var thermalStatus = 0 // PowerManager.THERMAL_STATUS_NONE
+
+    private val powerSaveReceiver = object : BroadcastReceiver() {
+        override fun onReceive(context: Context, intent: Intent) = update()
+    }
+
+    @JvmStatic
+    fun start(context: Context) {
+        if (this.context != null) return
+        val appContext = context.applicationContext
+        val pm = appContext.getSystemService(Context.POWER_SERVICE) as? PowerManager ?: return
+        this.context = appContext
+        powerManager = pm
+        appContext.registerReceiver(powerSaveReceiver, IntentFilter(PowerManager.ACTION_POWER_SAVE_MODE_CHANGED))
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+            thermalStatus = pm.currentThermalStatus
+            val listener = PowerManager.OnThermalStatusChangedListener { status ->
+                thermalStatus = status
+                update()
+            }
+            pm.addThermalStatusListener(listener)
+            thermalListener = listener
+        }
+        update()
+    }
+
+    @JvmStatic
+    fun stop() {
+        val appContext = context ?: return
+        appContext.unregisterReceiver(powerSaveReceiver)
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+            thermalListener?.let { powerManager?.removeThermalStatusListener(it) }
+        }
+        thermalListener = null
+        powerManager = null
+        context = null
+    }
+
+    private fun update() {
+        val pm = powerManager ?: return
+        val level = when {
+            thermalStatus >= PowerManager.THERMAL_STATUS_SEVERE -> BlurCore.PRESSURE_SEVERE
+            thermalStatus >= PowerManager.THERMAL_STATUS_MODERATE || pm.isPowerSaveMode -> BlurCore.PRESSURE_MODERATE
+            else -> BlurCore.PRESSURE_NONE
+        }
+        BlurCore.setPerformancePressure(level)
+    }
+}
@@ -11,4 +11,19 @@ class MainActivity: FlutterActivity() {
         // Register BlurCore plugin for native processing
         flutterEngine.plugins.add(BlurCorePlugin())
     }
+    
+    override fun onStart() {
+        super.onStart()
+        DevicePressure.start(this)
+    }
+    
+    override fun onStop() {
+        DevicePressure.stop()
+        super.onStop()
+    }
+    
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        BlurCore.onTrimMemory(level)
+    }
 }
\ No newline at end of file
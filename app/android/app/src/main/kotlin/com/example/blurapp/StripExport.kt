@@ -0,0 +1,192 @@
+package com.example.blurapp
+
+import android.graphics.Bitmap
+import android.graphics.BitmapFactory
+import android.graphics.BitmapRegionDecoder
+import android.graphics.Rect
+import android.os.Build
+import android.util.Log
+import java.io.BufferedOutputStream
+import java.io.DataOutputStream
+import java.io.File
+import java.io.FileOutputStream
+import java.io.OutputStream
+import java.nio.ByteBuffer
+import java.util.zip.CRC32
+import java.util.zip.Deflater
+import java.util.zip.DeflaterOutputStream
+
+/**
+ * Out-of-core export for 50-200 MP photos. A JPEG exported to a .jpg path
+ * goes through [BlurCore.redactJpeg] when it is built in, which only
+ * decodes and re-encodes the blocks under the rects. Everything else (HEIF,
+ * PNG, or no libjpeg-turbo) is decoded in strips with BitmapRegionDecoder,
+ * blurred natively ([BlurCore.blurStrips]) and written to a streaming PNG,
+ * so peak memory follows the strip size rather than the image size.
+ * Android has no row-wise JPEG encoder, so that output is PNG.
+ */
+object StripExport {
+    private const val TAG = "StripExport"
+    const val DEFAULT_STRIP_ROWS = 256
+
+    /**
+     * @param rects x, y, w, h quadruples in image pixels
+     * @return 0 on success, or the [BlurCore.blurStrips] status; on failure
+     *         no file is left at [outputPath]
+     */
+    @JvmStatic
+    fun export(inputPath: String, outputPath: String, rects: IntArray, mode: Int, strength: Int,
+               stripRows: Int = DEFAULT_STRIP_ROWS): Int {
+        if (isJpegPath(outputPath) && BlurCore.isJpegRedactionAvailable()) {
+            val status = BlurCore.redactJpeg(inputPath, outputPath, rects, mode, strength)
+            // -7: not a JPEG (e.g. HEIF), -2: CMYK and the like
+            if (status != -7 && status != -2) return status
+        }
+        val decoder = try {
+            newDecoder(inputPath)
+        } catch (e: Exception) {
+            Log.e(TAG, "Cannot open $inputPath: ${e.message}")
+            return -7
+        }
+        val temp = File("$outputPath.part")
+        try {
+            val width = decoder.width
+            val height = decoder.height
+            val source = RegionSource(decoder)
+            var status = -8
+            PngStripWriter(FileOutputStream(temp), width, height).use { png ->
+                status = BlurCore.blurStrips(width, height, rects, mode, strength, stripRows, source) { _, rows, src ->
+                    png.writeRows(rows, src)
+                }
+                source.recycle()
+                if (status == 0) png.finish()
+            }
+            if (status == 0 && !temp.renameTo(File(outputPath))) status = -8
+            return status
+        } catch (e: Exception) {
+            Log.e(TAG, "Strip export failed: ${e.message}")
+            return -8
+        } finally {
+            decoder.recycle()
+            temp.delete()
+        }
+    }
+
+    private fun isJpegPath(path: String): Boolean =
+        path.endsWith(".jpg", ignoreCase = true) || path.endsWith(".jpeg", ignoreCase = true)
+
+    @Suppress("DEPRECATION")
+    private fun newDecoder(path: String): BitmapRegionDecoder =
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.S) {
+            BitmapRegionDecoder.newInstance(path)
+        } else {
+            BitmapRegionDecoder.newInstance(path, false)
+        } ?: throw IllegalArgumentException("unsupported image")
+
+    /** Decodes the requested rows into one reused bitmap. */
+    private class RegionSource(private val decoder: BitmapRegionDecoder) : BlurCore.StripSource {
+        private var bitmap: Bitmap? = null
+        private val options = BitmapFactory.Options().apply {
+            inPreferredConfig = Bitmap.Config.ARGB_8888
+            inMutable = true
+        }
+
+        override fun read(y: Int, rows: Int, dst: ByteBuffer): Boolean {
+            // Strips are all the same height except around the edges
+            if (bitmap?.height != rows) {
+                bitmap?.recycle()
+                bitmap = null
+            }
+            options.inBitmap = bitmap
+            val decoded = decoder.decodeRegion(Rect(0, y, decoder.width, y + rows), options) ?: return false
+            bitmap = decoded
+            dst.rewind()
+            decoded.copyPixelsToBuffer(dst)
+            return true
+        }
+
+        fun recycle() {
+            bitmap?.recycle()
+            bitmap = null
+        }
+    }
+}
+
+/**
+ * Minimal streaming PNG encoder: 8-bit RGB, no filtering, IDAT chunks
+ * flushed as the deflater fills them. Alpha is dropped because the source
+ * photos are opaque.
+ */
+class PngStripWriter(output: OutputStream, private val width: Int, height: Int) : AutoCloseable {
+    private val file = BufferedOutputStream(output, 1 shl 16)
+    private val idat = DeflaterOutputStream(ChunkStream(file), Deflater(Deflater.DEFAULT_COMPRESSION), 1 shl 16)
+    private val row = ByteArray(1 + width * 3)
+
+    init {
+        file.write(byteArrayOf(0x89.toByte(), 'P'.code.toByte(), 'N'.code.toByte(), 'G'.code.toByte(),
+                               0x0D, 0x0A, 0x1A, 0x0A))
+        val header = java.io.ByteArrayOutputStream(13)
+        DataOutputStream(header).apply {
+            writeInt(width)
+            writeInt(height)
+            writeByte(8) // bit depth
+            writeByte(2) // colour type RGB
+            writeByte(0) // deflate
+            writeByte(0) // adaptive filtering (every row uses filter 0)
+            writeByte(0) // no interlace
+        }
+        writeChunk(file, "IHDR", header.toByteArray(), header.size())
+    }
+
+    /** [rows] packed RGBA rows of width * 4 bytes. */
+    fun writeRows(rows: Int, src: ByteBuffer): Boolean {
+        src.rewind()
+        for (r in 0 until rows) {
+            row[0] = 0
+            var o = 1
+            for (x in 0 until width) {
+                row[o++] = src.get()
+                row[o++] = src.get()
+                row[o++] = src.get()
+                src.get()
+            }
+            idat.write(row)
+        }
+        return true
+    }
+
+    /** Flush the image data and write IEND; without it the file is incomplete. */
+    fun finish() {
+        idat.finish()
+        idat.flush()
+        writeChunk(file, "IEND", ByteArray(0), 0)
+        file.flush()
+    }
+
+    override fun close() {
+        file.close()
+    }
+
+    /** Turns every write from the deflater into one IDAT chunk. */
+    private class ChunkStream(private val out: OutputStream) : OutputStream() {
+        override fun write(b: Int) = write(byteArrayOf(b.toByte()), 0, 1)
+
+        override fun write(b: ByteArray, off: Int, len: Int) {
+            if (len > 0) writeChunk(out, "IDAT", b.copyOfRange(off, off + len), len)
+        }
+    }
+
+    companion object {
+        private fun writeChunk(out: OutputStream, type: String, data: ByteArray, length: Int) {
+            val typeBytes = type.toByteArray(Charsets.US_ASCII)
+            val crc = CRC32()
+            crc.update(typeBytes)
+            crc.update(data, 0, length)
+            val stream = DataOutputStream(out)
+            stream.writeInt(length)
+            stream.write(typeBytes)
+            stream.write(data, 0, length)
+            stream.writeInt(crc.value.toInt())
+        }
+    }
+}
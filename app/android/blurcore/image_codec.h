@@ -0,0 +1,127 @@
+// NDK image codecs for native batch export: AImageDecoder to decode a file
+// straight into RGBA and AndroidBitmap_compress to write JPEG/PNG, both
+// from libjnigraphics on API 30+. They are resolved at runtime because the
+// app still supports API 26; older devices report the codecs unavailable
+// and export goes through the Kotlin path instead.
+#pragma once
+#include <dlfcn.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <android/bitmap.h>
+
+namespace blurcore {
+
+class ImageCodecs {
+public:
+    enum Format { kJpeg = 0, kPng = 1 }; // ANDROID_BITMAP_COMPRESS_FORMAT_*
+
+    // Loaded once per process; nullptr below API 30.
+    static const ImageCodecs* Get() {
+        static const ImageCodecs* codecs = Load();
+        return codecs;
+    }
+
+    // Decode the file at path into a malloc'd RGBA8888 buffer (free with
+    // std::free). Does not apply EXIF orientation.
+    bool Decode(const char* path, uint8_t** pixels, int* width, int* height, int* stride) const {
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        AImageDecoder* decoder = nullptr;
+        bool ok = createFromFd_(fd, &decoder) == 0;
+        if (ok) {
+            const AImageDecoderHeaderInfo* info = getHeaderInfo_(decoder);
+            *width = headerWidth_(info);
+            *height = headerHeight_(info);
+            ok = setFormat_(decoder, ANDROID_BITMAP_FORMAT_RGBA_8888) == 0 && *width > 0 && *height > 0;
+        }
+        if (ok) {
+            const size_t rowBytes = getMinimumStride_(decoder);
+            const size_t size = rowBytes * static_cast<size_t>(*height);
+            *pixels = static_cast<uint8_t*>(std::malloc(size));
+            ok = *pixels && decodeImage_(decoder, *pixels, rowBytes, size) == 0;
+            if (!ok) {
+                std::free(*pixels);
+                *pixels = nullptr;
+            }
+            *stride = static_cast<int>(rowBytes);
+        }
+        if (decoder) delete_(decoder);
+        close(fd);
+        return ok;
+    }
+
+    // quality 0-100 (JPEG only); writes through a temporary file so a
+    // failed export never leaves a truncated image at path
+    bool Encode(const char* path, Format format, int quality,
+                const uint8_t* pixels, int width, int height, int stride) const {
+        char temp[4096];
+        if (std::snprintf(temp, sizeof(temp), "%s.part", path) >= static_cast<int>(sizeof(temp))) return false;
+        FILE* file = std::fopen(temp, "wb");
+        if (!file) return false;
+
+        AndroidBitmapInfo info = {};
+        info.width = static_cast<uint32_t>(width);
+        info.height = static_cast<uint32_t>(height);
+        info.stride = static_cast<uint32_t>(stride);
+        info.format = ANDROID_BITMAP_FORMAT_RGBA_8888;
+        info.flags = ANDROID_BITMAP_FLAGS_ALPHA_PREMUL;
+        const bool ok = compress_(&info, kDataSpaceSrgb, pixels, format, quality, file, WriteToFile) == 0;
+        const bool closed = std::fclose(file) == 0;
+        if (!ok || !closed || std::rename(temp, path) != 0) {
+            std::remove(temp);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct AImageDecoder;
+    struct AImageDecoderHeaderInfo;
+    static constexpr int32_t kDataSpaceSrgb = 142671872; // ADATASPACE_SRGB
+
+    using CompressWriteFn = bool (*)(void* user, const void* data, size_t size);
+
+    int (*createFromFd_)(int fd, AImageDecoder** out);
+    const AImageDecoderHeaderInfo* (*getHeaderInfo_)(const AImageDecoder* decoder);
+    int32_t (*headerWidth_)(const AImageDecoderHeaderInfo* info);
+    int32_t (*headerHeight_)(const AImageDecoderHeaderInfo* info);
+    int (*setFormat_)(AImageDecoder* decoder, int32_t format);
+    size_t (*getMinimumStride_)(AImageDecoder* decoder);
+    int (*decodeImage_)(AImageDecoder* decoder, void* pixels, size_t stride, size_t size);
+    void (*delete_)(AImageDecoder* decoder);
+    int (*compress_)(const AndroidBitmapInfo* info, int32_t dataspace, const void* pixels,
+                     int32_t format, int32_t quality, void* user, CompressWriteFn write);
+
+    static bool WriteToFile(void* user, const void* data, size_t size) {
+        return std::fwrite(data, 1, size, static_cast<FILE*>(user)) == size;
+    }
+
+    template <typename Fn>
+    static bool Resolve(void* lib, const char* name, Fn& fn) {
+        fn = reinterpret_cast<Fn>(dlsym(lib, name));
+        return fn != nullptr;
+    }
+
+    static const ImageCodecs* Load() {
+        void* lib = dlopen("libjnigraphics.so", RTLD_NOW | RTLD_LOCAL);
+        if (!lib) return nullptr;
+        static ImageCodecs codecs;
+        const bool ok =
+            Resolve(lib, "AImageDecoder_createFromFd", codecs.createFromFd_) &&
+            Resolve(lib, "AImageDecoder_getHeaderInfo", codecs.getHeaderInfo_) &&
+            Resolve(lib, "AImageDecoderHeaderInfo_getWidth", codecs.headerWidth_) &&
+            Resolve(lib, "AImageDecoderHeaderInfo_getHeight", codecs.headerHeight_) &&
+            Resolve(lib, "AImageDecoder_setAndroidBitmapFormat", codecs.setFormat_) &&
+            Resolve(lib, "AImageDecoder_getMinimumStride", codecs.getMinimumStride_) &&
+            Resolve(lib, "AImageDecoder_decodeImage", codecs.decodeImage_) &&
+            Resolve(lib, "AImageDecoder_delete", codecs.delete_) &&
+            Resolve(lib, "AndroidBitmap_compress", codecs.compress_);
+        return ok ? &codecs : nullptr;
+    }
+};
+
+} // namespace blurcore
@@ -0,0 +1,76 @@
+// Zero-copy access to pixel memory owned by Java objects. LockedBitmap and
+// DirectBufferPixels hand back a raw pointer into the Java-side storage, so
+// native code can work on a Bitmap or a direct ByteBuffer in place. byte[]
+// arguments, which cannot be shared, are copied through pooled buffers.
+#pragma once
+#include <jni.h>
+#include <android/bitmap.h>
+#include <cstdint>
+#include "buffer_pool.h"
+#include "trace.h"
+
+namespace blurcore {
+
+// Locks an android.graphics.Bitmap for the lifetime of the object. Only
+// RGBA_8888 and ALPHA_8 bitmaps are accepted; pixels() is nullptr otherwise.
+class LockedBitmap {
+public:
+    LockedBitmap(JNIEnv* env, jobject bitmap) : env_(env), bitmap_(bitmap) {
+        if (!bitmap || AndroidBitmap_getInfo(env, bitmap, &info_) != ANDROID_BITMAP_RESULT_SUCCESS) return;
+        if (info_.format != ANDROID_BITMAP_FORMAT_RGBA_8888 && info_.format != ANDROID_BITMAP_FORMAT_A_8) return;
+        void* pixels = nullptr;
+        if (AndroidBitmap_lockPixels(env, bitmap, &pixels) == ANDROID_BITMAP_RESULT_SUCCESS) {
+            pixels_ = static_cast<uint8_t*>(pixels);
+        }
+    }
+
+    ~LockedBitmap() {
+        if (pixels_) AndroidBitmap_unlockPixels(env_, bitmap_);
+    }
+
+    LockedBitmap(const LockedBitmap&) = delete;
+    LockedBitmap& operator=(const LockedBitmap&) = delete;
+
+    uint8_t* pixels() const { return pixels_; }
+    int width() const { return static_cast<int>(info_.width); }
+    int height() const { return static_cast<int>(info_.height); }
+    int stride() const { return static_cast<int>(info_.stride); } // bytes per row
+    int channels() const { return info_.format == ANDROID_BITMAP_FORMAT_A_8 ? 1 : 4; }
+
+private:
+    JNIEnv* env_;
+    jobject bitmap_;
+    AndroidBitmapInfo info_ = {};
+    uint8_t* pixels_ = nullptr;
+};
+
+// Address of a direct ByteBuffer holding at least min_bytes, or nullptr for
+// heap buffers and buffers that are too small.
+inline uint8_t* DirectBufferPixels(JNIEnv* env, jobject buffer, int64_t min_bytes) {
+    if (!buffer) return nullptr;
+    void* address = env->GetDirectBufferAddress(buffer);
+    if (!address || env->GetDirectBufferCapacity(buffer) < min_bytes) return nullptr;
+    return static_cast<uint8_t*>(address);
+}
+
+// Copy of a Java byte[] in a pooled buffer; empty if the array is null or
+// memory runs out.
+inline PooledBuffer CopyByteArray(JNIEnv* env, jbyteArray array) {
+    if (!array) return PooledBuffer();
+    const jsize length = env->GetArrayLength(array);
+    StageScope stage(BLUR_STAGE_COPY_IN, length);
+    PooledBuffer buffer = acquireBuffer(static_cast<size_t>(length));
+    if (buffer && length > 0) env->GetByteArrayRegion(array, 0, length, reinterpret_cast<jbyte*>(buffer.data()));
+    return buffer;
+}
+
+inline jbyteArray ToByteArray(JNIEnv* env, const uint8_t* data, size_t size) {
+    StageScope stage(BLUR_STAGE_COPY_OUT, static_cast<int64_t>(size));
+    jbyteArray result = env->NewByteArray(static_cast<jsize>(size));
+    if (result && size > 0) {
+        env->SetByteArrayRegion(result, 0, static_cast<jsize>(size), reinterpret_cast<const jbyte*>(data));
+    }
+    return result;
+}
+
+} // namespace blurcore
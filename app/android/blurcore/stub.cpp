@@ -8,6 +8,8 @@
 #include <jni.h>
 #include <android/log.h>
 #include <vector>
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <chrono>
@@ -21,17 +23,27 @@
 #include <iomanip>
 #include <condition_variable>
 
+#include "blur.h"
+#include "thread_pool.h"
+#include "tile_scheduler.h"
+#include "jni_pixels.h"
+
 #define LOG_TAG "BlurCore"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-
-// Phase 1: MediaPipe integration flags
-#ifdef ENABLE_MEDIAPIPE
-#include "mediapipe/framework/api2/builder.h"
-#include "mediapipe/framework/formats/image_frame.h"
-#include "mediapipe/tasks/cc/vision/image_segmenter/image_segmenter.h"
+// Per-frame logs, Debug builds only
+#ifdef DEBUG
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGD(...) ((void)0)
 #endif
 
+// Phase 1: the segmentation model runs on the TFLite C API, loaded at runtime
+#include "tflite_runtime.h"
+
+// Batch export decodes and encodes files natively when the NDK codecs exist
+#include "image_codec.h"
+
 // Phase 2: OpenCV integration for blur operations
 #ifdef ENABLE_OPENCV
 #include <opencv2/opencv.hpp>
@@ -43,6 +55,26 @@
 
 namespace blurcore {
 
+// Tiled processing for the engines below. A kernel reads the source only
+// inside the tile's halo and writes only the tile's own pixels to a
+// separate output, so neighbourhood filters join without seams and tiles
+// may run in any order. Returns false if any tile failed.
+using TileKernel = std::function<bool(const Tile& tile, int worker)>;
+
+static constexpr int kEngineTileSize = 256;
+
+static TileGrid EngineTileGrid(int width, int height, int halo) {
+    return {width, height, kEngineTileSize, kEngineTileSize, halo};
+}
+
+static bool RunTiles(int width, int height, int halo, const TileKernel& kernel) {
+    std::atomic<bool> ok{true};
+    forEachTile(EngineTileGrid(width, height, halo), [&](const Tile& tile, int worker) {
+        if (ok.load() && !kernel(tile, worker)) ok.store(false);
+    });
+    return ok.load();
+}
+
 // Phase 2: OpenCV blur engine for high-performance image processing
 class OpenCVBlurEngine {
 private:
@@ -84,186 +116,165 @@ public:
 #endif
     }
     
-    // Phase 2: High-performance Gaussian blur with multiple algorithms
-    std::vector<uint8_t> ApplyGaussianBlur(const std::vector<uint8_t>& image_data, 
-                                          int width, int height, int channels,
-                                          double sigma, int blur_type) {
-        if (!initialized_) {
-            LOGI("OpenCVBlurEngine: Not initialized, returning original");
-            return image_data;
+    // Phase 2: High-performance Gaussian blur with multiple algorithms. CPU
+    // filters run tile by tile on the shared scheduler with a halo of the
+    // kernel radius; the result is built in one output buffer that is moved
+    // out, and the input is handed back untouched on failure.
+    PooledBuffer ApplyGaussianBlur(const uint8_t* image_data, size_t image_size,
+                                   int width, int height, int channels,
+                                   double sigma, int blur_type) {
+        if (!image_data || width <= 0 || height <= 0 ||
+            image_size < static_cast<size_t>(width) * height * channels) {
+            return PooledBuffer();
         }
+        PooledBuffer result = acquireBuffer(image_size);
+        if (!result) return result;
         
 #ifdef ENABLE_OPENCV
-        try {
+        if (initialized_ && !(gpu_available_ && blur_type == 0)) {
             auto start_time = std::chrono::high_resolution_clock::now();
-            
-            // Convert input data to OpenCV Mat
-            cv::Mat input_mat;
-            if (channels == 3) {
-                input_mat = cv::Mat(height, width, CV_8UC3, (void*)image_data.data()).clone();
-            } else if (channels == 4) {
-                input_mat = cv::Mat(height, width, CV_8UC4, (void*)image_data.data()).clone();
-            } else {
-                input_mat = cv::Mat(height, width, CV_8UC1, (void*)image_data.data()).clone();
-            }
-            
-            cv::Mat output_mat;
-            
-            // Calculate kernel size from sigma
-            int kernel_size = static_cast<int>(2 * std::ceil(3 * sigma) + 1);
-            if (kernel_size % 2 == 0) kernel_size++; // Ensure odd kernel size
-            
-            // Apply blur based on type and capabilities
-            switch (blur_type) {
-                case 0: // Fast Gaussian (separable)
-                    if (gpu_available_) {
-                        ApplyGPUBlur(input_mat, output_mat, kernel_size, sigma);
-                    } else {
-                        cv::GaussianBlur(input_mat, output_mat, cv::Size(kernel_size, kernel_size), sigma);
-                    }
-                    break;
-                    
-                case 1: // Box blur (fastest)
-                    cv::boxFilter(input_mat, output_mat, -1, cv::Size(kernel_size, kernel_size));
-                    break;
-                    
-                case 2: // Motion blur
-                    ApplyMotionBlur(input_mat, output_mat, kernel_size);
-                    break;
-                    
-                default: // Standard Gaussian
-                    cv::GaussianBlur(input_mat, output_mat, cv::Size(kernel_size, kernel_size), sigma);
-                    break;
-            }
-            
-            // Convert result back to byte vector
-            std::vector<uint8_t> result(output_mat.total() * output_mat.elemSize());
-            std::memcpy(result.data(), output_mat.data, result.size());
+            const int kernel_size = KernelSizeForSigma(sigma);
+            const int type = MatTypeForChannels(channels);
+            const cv::Mat source(height, width, type, const_cast<uint8_t*>(image_data));
+            cv::Mat target(height, width, type, result.data());
+            std::vector<cv::Mat> scratch(tileWorkerCount(EngineTileGrid(width, height, kernel_size / 2)));
+            
+            const bool ok = RunTiles(width, height, kernel_size / 2, [&](const Tile& t, int worker) {
+                try {
+                    const cv::Rect halo(t.hx0, t.hy0, t.hx1 - t.hx0, t.hy1 - t.hy0);
+                    FilterMat(source(halo), scratch[worker], kernel_size, sigma, blur_type);
+                    const cv::Rect own(t.x0 - t.hx0, t.y0 - t.hy0, t.x1 - t.x0, t.y1 - t.y0);
+                    scratch[worker](own).copyTo(target(cv::Rect(t.x0, t.y0, own.width, own.height)));
+                    return true;
+                } catch (const std::exception& e) {
+                    LOGE("OpenCVBlurEngine: Tile %d failed: %s", t.index, e.what());
+                    return false;
+                }
+            });
             
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-            
-            LOGI("OpenCVBlurEngine: Blur completed in %lld ms (GPU: %s, Type: %d)", 
-                 duration.count(), gpu_available_ ? "yes" : "no", blur_type);
-            
+            LOGI("OpenCVBlurEngine: Tiled blur completed in %lld ms (Type: %d)", duration.count(), blur_type);
+            if (!ok) result.reset();
             return result;
-            
-        } catch (const std::exception& e) {
-            LOGE("OpenCVBlurEngine: Blur operation failed: %s", e.what());
-            return image_data; // Return original on error
         }
-#else
-        LOGI("OpenCVBlurEngine: OpenCV disabled, returning original");
-        return image_data;
 #endif
-    }
-    
-    // Phase 2: Selective blur using mask
-    std::vector<uint8_t> ApplySelectiveBlur(const std::vector<uint8_t>& image_data,
-                                           const std::vector<uint8_t>& mask_data,
-                                           int width, int height, int channels,
-                                           double foreground_sigma, double background_sigma) {
+        
+        // GPU blur works on the whole frame, in place on the copy
+        std::memcpy(result.data(), image_data, image_size);
+        ApplyGaussianBlurInPlace(result.data(), width, height, width * channels,
+                                 channels, sigma, blur_type);
+        return result;
+    }
+    
+    // Phase 2: Gaussian blur on caller-owned pixels (a locked Bitmap or a
+    // direct ByteBuffer). The cv::Mat only wraps the memory, so nothing is
+    // copied in or out.
+    bool ApplyGaussianBlurInPlace(uint8_t* pixels, int width, int height, int stride,
+                                  int channels, double sigma, int blur_type) {
         if (!initialized_) {
-            return image_data;
+            LOGI("OpenCVBlurEngine: Not initialized, leaving pixels unchanged");
+            return false;
         }
         
 #ifdef ENABLE_OPENCV
         try {
             auto start_time = std::chrono::high_resolution_clock::now();
             
-            // Convert image to OpenCV Mat
-            cv::Mat image_mat;
-            if (channels == 3) {
-                image_mat = cv::Mat(height, width, CV_8UC3, (void*)image_data.data()).clone();
-            } else if (channels == 4) {
-                image_mat = cv::Mat(height, width, CV_8UC4, (void*)image_data.data()).clone();
-            } else {
-                image_mat = cv::Mat(height, width, CV_8UC1, (void*)image_data.data()).clone();
-            }
-            
-            // Convert mask to OpenCV Mat
-            cv::Mat mask_mat = cv::Mat(height, width, CV_8UC1, (void*)mask_data.data()).clone();
-            
-            // Create blurred versions
-            cv::Mat fg_blurred, bg_blurred;
-            
-            // Calculate kernel sizes
-            int fg_kernel = static_cast<int>(2 * std::ceil(3 * foreground_sigma) + 1);
-            int bg_kernel = static_cast<int>(2 * std::ceil(3 * background_sigma) + 1);
-            if (fg_kernel % 2 == 0) fg_kernel++;
-            if (bg_kernel % 2 == 0) bg_kernel++;
-            
-            // Apply different blur amounts
-            if (foreground_sigma > 0.1) {
-                cv::GaussianBlur(image_mat, fg_blurred, cv::Size(fg_kernel, fg_kernel), foreground_sigma);
-            } else {
-                fg_blurred = image_mat.clone();
-            }
-            
-            if (background_sigma > 0.1) {
-                cv::GaussianBlur(image_mat, bg_blurred, cv::Size(bg_kernel, bg_kernel), background_sigma);
-            } else {
-                bg_blurred = image_mat.clone();
-            }
-            
-            // Blend based on mask
-            cv::Mat result_mat;
-            cv::Mat mask_normalized;
-            mask_mat.convertTo(mask_normalized, CV_32F, 1.0/255.0);
+            // Wrap the pixels without cloning them
+            cv::Mat image_mat(height, width, MatTypeForChannels(channels), pixels, stride);
             
-            // Convert images to float for blending
-            cv::Mat fg_float, bg_float;
-            fg_blurred.convertTo(fg_float, CV_32F);
-            bg_blurred.convertTo(bg_float, CV_32F);
+            const int kernel_size = KernelSizeForSigma(sigma);
             
-            // Blend: result = foreground * mask + background * (1 - mask)
-            cv::Mat result_float;
-            std::vector<cv::Mat> fg_channels, bg_channels, result_channels;
-            
-            if (channels > 1) {
-                cv::split(fg_float, fg_channels);
-                cv::split(bg_float, bg_channels);
-                
-                for (int i = 0; i < channels; i++) {
-                    cv::Mat channel_result;
-                    cv::multiply(fg_channels[i], mask_normalized, channel_result);
-                    cv::Mat bg_contribution;
-                    cv::multiply(bg_channels[i], cv::Scalar::all(1.0) - mask_normalized, bg_contribution);
-                    cv::add(channel_result, bg_contribution, channel_result);
-                    result_channels.push_back(channel_result);
-                }
-                
-                cv::merge(result_channels, result_float);
+            // Apply blur based on type and capabilities (all filters run in place)
+            if (blur_type == 0 && gpu_available_) {
+                ApplyGPUBlur(image_mat, image_mat, kernel_size, sigma);
             } else {
-                cv::multiply(fg_float, mask_normalized, result_float);
-                cv::Mat bg_contribution;
-                cv::multiply(bg_float, cv::Scalar::all(1.0) - mask_normalized, bg_contribution);
-                cv::add(result_float, bg_contribution, result_float);
+                FilterMat(image_mat, image_mat, kernel_size, sigma, blur_type);
             }
             
-            // Convert back to uint8
-            result_float.convertTo(result_mat, CV_8U);
-            
-            // Convert result back to byte vector
-            std::vector<uint8_t> result(result_mat.total() * result_mat.elemSize());
-            std::memcpy(result.data(), result_mat.data, result.size());
-            
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
             
-            LOGI("OpenCVBlurEngine: Selective blur completed in %lld ms", duration.count());
+            LOGI("OpenCVBlurEngine: Blur completed in %lld ms (GPU: %s, Type: %d)", 
+                 duration.count(), gpu_available_ ? "yes" : "no", blur_type);
             
-            return result;
+            return true;
             
         } catch (const std::exception& e) {
-            LOGE("OpenCVBlurEngine: Selective blur failed: %s", e.what());
-            return image_data;
+            LOGE("OpenCVBlurEngine: Blur operation failed: %s", e.what());
+            return false;
         }
 #else
-        return image_data;
+        LOGI("OpenCVBlurEngine: OpenCV disabled, leaving pixels unchanged");
+        return false;
 #endif
     }
     
+    // Phase 2: Selective blur using mask, into a pooled copy of the image;
+    // empty on failure
+    PooledBuffer ApplySelectiveBlur(const uint8_t* image_data, size_t image_size,
+                                    const uint8_t* mask_data, size_t mask_size,
+                                    int width, int height, int channels,
+                                    double foreground_sigma, double background_sigma) {
+        if (!image_data || !mask_data || width <= 0 || height <= 0 ||
+            image_size < static_cast<size_t>(width) * height * channels ||
+            mask_size < static_cast<size_t>(width) * height) {
+            return PooledBuffer();
+        }
+        
+        PooledBuffer result = acquireBuffer(image_size);
+        if (!result) return result;
+        std::memcpy(result.data(), image_data, image_size);
+        if (!ApplySelectiveBlurInPlace(result.data(), width * channels, mask_data, width,
+                                       width, height, channels, foreground_sigma, background_sigma)) {
+            result.reset();
+        }
+        return result;
+    }
+    
+    // Phase 2: Selective blur written straight back into caller-owned pixels.
+    // Runs on the portable core: one fused 8-bit blend, and tiles where the
+    // mask is uniform only blur the layer they show.
+    bool ApplySelectiveBlurInPlace(uint8_t* pixels, int stride,
+                                   const uint8_t* mask, int mask_stride,
+                                   int width, int height, int channels,
+                                   double foreground_sigma, double background_sigma) {
+        if (!initialized_) {
+            return false;
+        }
+        
+        int format;
+        switch (channels) {
+            case 4: format = BLUR_FORMAT_RGBA8888; break;
+            case 3: format = BLUR_FORMAT_RGB888; break;
+            case 1: format = BLUR_FORMAT_GRAY8; break;
+            default:
+                LOGE("OpenCVBlurEngine: Selective blur does not support %d channels", channels);
+                return false;
+        }
+        
+        auto start_time = std::chrono::high_resolution_clock::now();
+        
+        // Gaussian mode takes sigma in whole pixels; below 0.5 the layer is
+        // left sharp, as before
+        const int fg_strength = static_cast<int>(std::lround(foreground_sigma));
+        const int bg_strength = static_cast<int>(std::lround(background_sigma));
+        const int rc = blur_apply_masked(nullptr, pixels, width, height, stride, format,
+                                         mask, mask_stride, 2, fg_strength, bg_strength);
+        if (rc != 0) {
+            LOGE("OpenCVBlurEngine: Selective blur failed (%d)", rc);
+            return false;
+        }
+        
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        
+        LOGI("OpenCVBlurEngine: Selective blur completed in %lld ms", duration.count());
+        
+        return true;
+    }
+    
     bool IsInitialized() const { return initialized_; }
     bool IsGPUAvailable() const { return gpu_available_; }
     
@@ -277,6 +288,34 @@ public:
 
 private:
 #ifdef ENABLE_OPENCV
+    static int MatTypeForChannels(int channels) {
+        return channels == 3 ? CV_8UC3 : (channels == 4 ? CV_8UC4 : CV_8UC1);
+    }
+    
+    // Odd kernel covering +-3 sigma; its radius is the tile halo
+    static int KernelSizeForSigma(double sigma) {
+        int kernel_size = static_cast<int>(2 * std::ceil(3 * sigma) + 1);
+        if (kernel_size % 2 == 0) kernel_size++;
+        return kernel_size;
+    }
+    
+    // CPU filters by blur type; output may be the input
+    void FilterMat(const cv::Mat& input, cv::Mat& output, int kernel_size, double sigma, int blur_type) {
+        switch (blur_type) {
+            case 1: // Box blur (fastest)
+                cv::boxFilter(input, output, -1, cv::Size(kernel_size, kernel_size));
+                break;
+                
+            case 2: // Motion blur
+                ApplyMotionBlur(input, output, kernel_size);
+                break;
+                
+            default: // Gaussian (separable)
+                cv::GaussianBlur(input, output, cv::Size(kernel_size, kernel_size), sigma);
+                break;
+        }
+    }
+    
 #ifdef ENABLE_OPENCV_GPU
     void ApplyGPUBlur(const cv::Mat& input, cv::Mat& output, int kernel_size, double sigma) {
         try {
@@ -328,59 +367,73 @@ public:
 #endif
     }
     
-    // Phase 3: Morphological operations for mask refinement
-    std::vector<uint8_t> RefineMask(const std::vector<uint8_t>& mask_data,
-                                   int width, int height,
-                                   int operation_type, int kernel_size,
-                                   int iterations = 1) {
+    // Phase 3: Morphological operations for mask refinement, tile by tile
+    // on the shared scheduler. Opening and closing chain two passes, so
+    // their halo is twice the element radius per iteration.
+    PooledBuffer RefineMask(const uint8_t* mask_data, size_t mask_size,
+                            int width, int height,
+                            int operation_type, int kernel_size,
+                            int iterations = 1) {
+        if (!mask_data || width <= 0 || height <= 0 ||
+            mask_size < static_cast<size_t>(width) * height || !initialized_) {
+            return PooledBuffer();
+        }
+        
+#ifdef ENABLE_OPENCV
+        if (operation_type < 0 || operation_type > 4) return PooledBuffer(); // unknown operation
+        auto start_time = std::chrono::high_resolution_clock::now();
+        const int passes = (operation_type == 2 || operation_type == 3) ? 2 : 1;
+        const int halo = std::max(kernel_size / 2, 0) * std::max(iterations, 1) * passes;
+        const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(kernel_size, kernel_size));
+        const cv::Mat source(height, width, CV_8UC1, const_cast<uint8_t*>(mask_data));
+        PooledBuffer result = acquireBuffer(mask_size);
+        if (!result) return result;
+        cv::Mat target(height, width, CV_8UC1, result.data());
+        std::vector<cv::Mat> scratch(tileWorkerCount(EngineTileGrid(width, height, halo)));
+        
+        const bool ok = RunTiles(width, height, halo, [&](const Tile& t, int worker) {
+            try {
+                // A copy, so the halo edge is a real border for every pass
+                cv::Mat& tile = scratch[worker];
+                source(cv::Rect(t.hx0, t.hy0, t.hx1 - t.hx0, t.hy1 - t.hy0)).copyTo(tile);
+                Morph(tile, operation_type, kernel, iterations);
+                const cv::Rect own(t.x0 - t.hx0, t.y0 - t.hy0, t.x1 - t.x0, t.y1 - t.y0);
+                tile(own).copyTo(target(cv::Rect(t.x0, t.y0, own.width, own.height)));
+                return true;
+            } catch (const std::exception& e) {
+                LOGE("AdvancedMaskProcessor: Tile %d failed: %s", t.index, e.what());
+                return false;
+            }
+        });
+        
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        LOGI("AdvancedMaskProcessor: Tiled morphology %d completed in %lld ms", operation_type, duration.count());
+        if (!ok) result.reset();
+        return result;
+#else
+        return PooledBuffer();
+#endif
+    }
+    
+    // Phase 3: Morphology on a caller-owned mask; erode/dilate and
+    // morphologyEx all accept the same Mat as source and destination.
+    bool RefineMaskInPlace(uint8_t* mask, int stride, int width, int height,
+                           int operation_type, int kernel_size, int iterations = 1) {
         if (!initialized_) {
-            return mask_data;
+            return false;
         }
         
 #ifdef ENABLE_OPENCV
         try {
             auto start_time = std::chrono::high_resolution_clock::now();
             
-            // Convert mask to OpenCV Mat
-            cv::Mat mask_mat = cv::Mat(height, width, CV_8UC1, (void*)mask_data.data()).clone();
+            // Wrap the mask without cloning it
+            cv::Mat mask_mat(height, width, CV_8UC1, mask, stride);
             
             // Create morphological kernel
-            cv::Mat kernel;
-            int morph_type = cv::MORPH_ELLIPSE; // Default to elliptical kernel
-            kernel = cv::getStructuringElement(morph_type, cv::Size(kernel_size, kernel_size));
-            
-            cv::Mat result_mat;
-            
-            // Apply morphological operation
-            switch (operation_type) {
-                case 0: // Dilate - expand mask areas
-                    cv::dilate(mask_mat, result_mat, kernel, cv::Point(-1, -1), iterations);
-                    break;
-                    
-                case 1: // Erode - shrink mask areas
-                    cv::erode(mask_mat, result_mat, kernel, cv::Point(-1, -1), iterations);
-                    break;
-                    
-                case 2: // Opening - erode then dilate (remove noise)
-                    cv::morphologyEx(mask_mat, result_mat, cv::MORPH_OPEN, kernel, cv::Point(-1, -1), iterations);
-                    break;
-                    
-                case 3: // Closing - dilate then erode (fill gaps)
-                    cv::morphologyEx(mask_mat, result_mat, cv::MORPH_CLOSE, kernel, cv::Point(-1, -1), iterations);
-                    break;
-                    
-                case 4: // Gradient - difference between dilation and erosion (edges)
-                    cv::morphologyEx(mask_mat, result_mat, cv::MORPH_GRADIENT, kernel, cv::Point(-1, -1), iterations);
-                    break;
-                    
-                default:
-                    result_mat = mask_mat.clone();
-                    break;
-            }
-            
-            // Convert result back to byte vector
-            std::vector<uint8_t> result(result_mat.total());
-            std::memcpy(result.data(), result_mat.data, result.size());
+            cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(kernel_size, kernel_size));
+            Morph(mask_mat, operation_type, kernel, iterations);
             
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -388,33 +441,47 @@ public:
             LOGI("AdvancedMaskProcessor: Morphological operation %d completed in %lld ms", 
                  operation_type, duration.count());
             
-            return result;
+            return true;
             
         } catch (const std::exception& e) {
             LOGE("AdvancedMaskProcessor: Morphological operation failed: %s", e.what());
-            return mask_data;
+            return false;
         }
 #else
-        return mask_data;
+        return false;
 #endif
     }
     
-    // Phase 3: Edge smoothing for natural mask transitions
-    std::vector<uint8_t> SmoothMaskEdges(const std::vector<uint8_t>& mask_data,
-                                        int width, int height,
-                                        double sigma = 2.0,
-                                        int feather_radius = 5) {
-        if (!initialized_) {
-            return mask_data;
+    // Maps the Kotlin operation names onto RefineMask operation codes
+    static int MorphOperationFromName(const std::string& name) {
+        if (name == "dilate") return 0;
+        if (name == "erode") return 1;
+        if (name == "opening") return 2;
+        if (name == "closing") return 3;
+        if (name == "gradient") return 4;
+        return -1;
+    }
+    
+    // Phase 3: Edge smoothing for natural mask transitions. The result and
+    // the distance-transform scratch are pooled Mats, so OpenCV allocates
+    // nothing; empty on failure.
+    PooledBuffer SmoothMaskEdges(const uint8_t* mask_data, size_t mask_size,
+                                 int width, int height,
+                                 double sigma = 2.0,
+                                 int feather_radius = 5) {
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (!initialized_ || !mask_data || width <= 0 || height <= 0 || mask_size < pixels) {
+            return PooledBuffer();
         }
         
 #ifdef ENABLE_OPENCV
         try {
             auto start_time = std::chrono::high_resolution_clock::now();
             
-            // Convert mask to OpenCV Mat
-            cv::Mat mask_mat = cv::Mat(height, width, CV_8UC1, (void*)mask_data.data()).clone();
-            cv::Mat result_mat;
+            PooledBuffer result = acquireBuffer(pixels);
+            if (!result) return result;
+            const cv::Mat mask_mat(height, width, CV_8UC1, const_cast<uint8_t*>(mask_data));
+            cv::Mat result_mat(height, width, CV_8UC1, result.data());
             
             // Apply Gaussian blur for soft edges
             int kernel_size = 2 * feather_radius + 1;
@@ -422,7 +489,11 @@ public:
             
             // Optional: Apply distance transform for more natural falloff
             if (feather_radius > 3) {
-                cv::Mat dist_transform, normalized_dist;
+                PooledBuffer dist = acquireBuffer(pixels * sizeof(float));
+                PooledBuffer normalized = acquireBuffer(pixels);
+                if (!dist || !normalized) return PooledBuffer();
+                cv::Mat dist_transform(height, width, CV_32FC1, dist.data());
+                cv::Mat normalized_dist(height, width, CV_8UC1, normalized.data());
                 cv::distanceTransform(mask_mat, dist_transform, cv::DIST_L2, 3);
                 
                 // Normalize and apply falloff
@@ -437,10 +508,6 @@ public:
                 }
             }
             
-            // Convert result back to byte vector
-            std::vector<uint8_t> result(result_mat.total());
-            std::memcpy(result.data(), result_mat.data, result.size());
-            
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
             
@@ -450,94 +517,96 @@ public:
             
         } catch (const std::exception& e) {
             LOGE("AdvancedMaskProcessor: Edge smoothing failed: %s", e.what());
-            return mask_data;
+            return PooledBuffer();
         }
 #else
-        return mask_data;
+        return PooledBuffer();
 #endif
     }
     
-    // Phase 3: Intelligent mask cleanup and optimization
-    std::vector<uint8_t> OptimizeMask(const std::vector<uint8_t>& mask_data,
-                                     int width, int height,
-                                     double noise_threshold = 0.1,
-                                     int min_component_size = 100) {
-        if (!initialized_) {
-            return mask_data;
+    // Phase 3: Intelligent mask cleanup and optimization: drop small blobs,
+    // snap the edge with a self-guided filter, binarize and close 5x5, as
+    // one blur_mask_refine_guided call between two blur_mask_process runs
+    // in the portable core (no bilateral filter or per-label passes); the
+    // result and the guide copy are pooled, empty on failure
+    PooledBuffer OptimizeMask(const uint8_t* mask_data, size_t mask_size,
+                              int width, int height,
+                              int min_component_size = 100) {
+        // Needs no OpenCV, so it works before or without Initialize()
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (!mask_data || width <= 0 || height <= 0 || mask_size != pixels) {
+            LOGE("AdvancedMaskProcessor: Mask optimization expects a %dx%d mask", width, height);
+            return PooledBuffer();
         }
         
-#ifdef ENABLE_OPENCV
-        try {
-            auto start_time = std::chrono::high_resolution_clock::now();
-            
-            // Convert mask to OpenCV Mat
-            cv::Mat mask_mat = cv::Mat(height, width, CV_8UC1, (void*)mask_data.data()).clone();
-            cv::Mat result_mat = mask_mat.clone();
-            
-            // Step 1: Remove small noise components
-            cv::Mat labels, stats, centroids;
-            int num_labels = cv::connectedComponentsWithStats(mask_mat, labels, stats, centroids);
-            
-            // Filter out small components
-            for (int i = 1; i < num_labels; i++) {
-                int area = stats.at<int>(i, cv::CC_STAT_AREA);
-                if (area < min_component_size) {
-                    // Remove small component
-                    cv::Mat component_mask = (labels == i);
-                    result_mat.setTo(0, component_mask);
-                }
+        auto start_time = std::chrono::high_resolution_clock::now();
+        PooledBuffer result = acquireBuffer(pixels);
+        if (!result) return result;
+        std::memcpy(result.data(), mask_data, pixels);
+        const BlurMaskStep clean[] = {{BLUR_MASK_REMOVE_SMALL, 0, min_component_size}};
+        const BlurMaskStep finish[] = {{BLUR_MASK_THRESHOLD, 0, 127}, {BLUR_MASK_CLOSE, 2, 0}};
+        int rc = blur_mask_process(nullptr, result.data(), width, height, width, clean, 1);
+        if (rc == 0) {
+            // The cleaned mask is its own guide: steps stay where it has edges
+            PooledBuffer guide = acquireBuffer(pixels);
+            if (guide) {
+                std::memcpy(guide.data(), result.data(), pixels);
+                rc = blur_mask_refine_guided(result.data(), width, height, width, guide.data(), width,
+                                             BLUR_FORMAT_GRAY8, 4, 1e-2f);
+            } else {
+                rc = -3;
             }
-            
-            // Step 2: Apply bilateral filter for edge-preserving smoothing
-            cv::Mat bilateral_result;
-            cv::bilateralFilter(result_mat, bilateral_result, 9, 75, 75);
-            
-            // Step 3: Threshold to maintain binary mask
-            cv::threshold(bilateral_result, result_mat, 127, 255, cv::THRESH_BINARY);
-            
-            // Step 4: Final morphological closing to smooth boundaries
-            cv::Mat close_kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(5, 5));
-            cv::morphologyEx(result_mat, result_mat, cv::MORPH_CLOSE, close_kernel);
-            
-            // Convert result back to byte vector
-            std::vector<uint8_t> result(result_mat.total());
-            std::memcpy(result.data(), result_mat.data, result.size());
-            
-            auto end_time = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-            
-            LOGI("AdvancedMaskProcessor: Mask optimization completed in %lld ms", duration.count());
-            
-            return result;
-            
-        } catch (const std::exception& e) {
-            LOGE("AdvancedMaskProcessor: Mask optimization failed: %s", e.what());
-            return mask_data;
         }
-#else
-        return mask_data;
-#endif
-    }
-    
-    // Phase 3: Advanced mask blending and feathering
-    std::vector<uint8_t> CreateFeatheredMask(const std::vector<uint8_t>& mask_data,
-                                            int width, int height,
-                                            int inner_feather = 10,
-                                            int outer_feather = 15) {
-        if (!initialized_) {
-            return mask_data;
+        if (rc == 0) rc = blur_mask_process(nullptr, result.data(), width, height, width, finish, 2);
+        if (rc != 0) {
+            LOGE("AdvancedMaskProcessor: Mask optimization failed (%d)", rc);
+            return PooledBuffer();
+        }
+        
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+        LOGI("AdvancedMaskProcessor: Mask optimization completed in %lld ms",
+             static_cast<long long>(duration.count()));
+        return result;
+    }
+    
+    // Edge-aware refinement of a coarse mask against the photo
+    // (blur_mask_refine_guided); the soft result stays in the mask
+    bool RefineMaskGuided(uint8_t* mask, const uint8_t* rgba, int width, int height,
+                          int radius, float eps) {
+        const int rc = blur_mask_refine_guided(mask, width, height, width, rgba, width * 4,
+                                               BLUR_FORMAT_RGBA8888, radius, eps);
+        if (rc != 0) LOGE("AdvancedMaskProcessor: Guided mask refinement failed (%d)", rc);
+        return rc == 0;
+    }
+    
+    // Phase 3: Advanced mask blending and feathering. The inverted mask,
+    // both distance maps and the result are pooled Mats; empty on failure.
+    PooledBuffer CreateFeatheredMask(const uint8_t* mask_data, size_t mask_size,
+                                     int width, int height,
+                                     int inner_feather = 10,
+                                     int outer_feather = 15) {
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (!initialized_ || !mask_data || width <= 0 || height <= 0 || mask_size < pixels) {
+            return PooledBuffer();
         }
         
 #ifdef ENABLE_OPENCV
         try {
             auto start_time = std::chrono::high_resolution_clock::now();
             
-            // Convert mask to OpenCV Mat
-            cv::Mat mask_mat = cv::Mat(height, width, CV_8UC1, (void*)mask_data.data()).clone();
+            PooledBuffer result = acquireBuffer(pixels);
+            PooledBuffer inverted = acquireBuffer(pixels);
+            PooledBuffer inner = acquireBuffer(pixels * sizeof(float));
+            PooledBuffer outer = acquireBuffer(pixels * sizeof(float));
+            if (!result || !inverted || !inner || !outer) return PooledBuffer();
+            const cv::Mat mask_mat(height, width, CV_8UC1, const_cast<uint8_t*>(mask_data));
             
             // Create distance transforms for inner and outer feathering
-            cv::Mat dist_inner, dist_outer;
-            cv::Mat inverted_mask = 255 - mask_mat;
+            cv::Mat dist_inner(height, width, CV_32FC1, inner.data());
+            cv::Mat dist_outer(height, width, CV_32FC1, outer.data());
+            cv::Mat inverted_mask(height, width, CV_8UC1, inverted.data());
+            cv::bitwise_not(mask_mat, inverted_mask);
             
             // Inner feathering (from edge inward)
             cv::distanceTransform(mask_mat, dist_inner, cv::DIST_L2, 3);
@@ -545,8 +614,8 @@ public:
             // Outer feathering (from edge outward)
             cv::distanceTransform(inverted_mask, dist_outer, cv::DIST_L2, 3);
             
-            // Create feathered mask
-            cv::Mat result_mat = cv::Mat::zeros(height, width, CV_8UC1);
+            // Create feathered mask (every pixel is written below)
+            cv::Mat result_mat(height, width, CV_8UC1, result.data());
             
             for (int y = 0; y < height; y++) {
                 for (int x = 0; x < width; x++) {
@@ -574,10 +643,6 @@ public:
                 }
             }
             
-            // Convert result back to byte vector
-            std::vector<uint8_t> result(result_mat.total());
-            std::memcpy(result.data(), result_mat.data, result.size());
-            
             auto end_time = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
             
@@ -587,10 +652,10 @@ public:
             
         } catch (const std::exception& e) {
             LOGE("AdvancedMaskProcessor: Feathered mask creation failed: %s", e.what());
-            return mask_data;
+            return PooledBuffer();
         }
 #else
-        return mask_data;
+        return PooledBuffer();
 #endif
     }
     
@@ -602,424 +667,539 @@ public:
             initialized_ = false;
         }
     }
+
+private:
+#ifdef ENABLE_OPENCV
+    // RefineMask operation codes, applied in place
+    static void Morph(cv::Mat& mask, int operation_type, const cv::Mat& kernel, int iterations) {
+        switch (operation_type) {
+            case 0: // Dilate - expand mask areas
+                cv::dilate(mask, mask, kernel, cv::Point(-1, -1), iterations);
+                break;
+
+            case 1: // Erode - shrink mask areas
+                cv::erode(mask, mask, kernel, cv::Point(-1, -1), iterations);
+                break;
+
+            case 2: // Opening - erode then dilate (remove noise)
+                cv::morphologyEx(mask, mask, cv::MORPH_OPEN, kernel, cv::Point(-1, -1), iterations);
+                break;
+
+            case 3: // Closing - dilate then erode (fill gaps)
+                cv::morphologyEx(mask, mask, cv::MORPH_CLOSE, kernel, cv::Point(-1, -1), iterations);
+                break;
+
+            case 4: // Gradient - difference between dilation and erosion (edges)
+                cv::morphologyEx(mask, mask, cv::MORPH_GRADIENT, kernel, cv::Point(-1, -1), iterations);
+                break;
+
+            default:
+                break; // Unknown operation leaves the mask as is
+        }
+    }
+#endif
 };
 
-// Phase 1: MediaPipe segmenter wrapper
+// Phase 1: Selfie segmentation (selfie_segmentation.tflite) on a persistent
+// TFLite interpreter. The interpreter, its tensors and the optional GPU
+// delegate are created once in Initialize and reused for every frame: a
+// frame is one fused resize/normalize pass into the input tensor, Invoke,
+// and one resize of the scores into the caller's mask.
 class MediaPipeSegmenter {
 private:
-    bool initialized_ = false;
-    
-#ifdef ENABLE_MEDIAPIPE
-    std::unique_ptr<mediapipe::tasks::vision::ImageSegmenter> segmenter_;
-#endif
+    // Written under mutex_, read lock-free by IsInitialized and Segment
+    std::atomic<bool> initialized_{false};
+    TfLiteSession session_;
+    
+    // Tensor buffers stay put once allocated (inputs are never resized)
+    float* input_ = nullptr;
+    int input_width_ = 0;
+    int input_height_ = 0;
+    const float* output_ = nullptr;
+    int output_width_ = 0;
+    int output_height_ = 0;
+    int output_channels_ = 0;
+    
+    // One interpreter, so frames from different threads take turns
+    std::mutex mutex_;
 
 public:
-    bool Initialize(const std::string& model_path) {
+    ~MediaPipeSegmenter() { Cleanup(); }
+    
+    bool Initialize(const std::string& model_path, bool use_gpu = true) {
         LOGI("MediaPipeSegmenter: Initializing with model: %s", model_path.c_str());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (initialized_) return true;
         
-#ifdef ENABLE_MEDIAPIPE
-        // TODO Phase 1: MediaPipe initialization
-        auto options = std::make_unique<mediapipe::tasks::vision::ImageSegmenterOptions>();
-        options->base_options.model_asset_path = model_path;
+        if (!TfLiteApi::Get()) {
+            LOGI("MediaPipeSegmenter: TFLite runtime not found, using fallback");
+            return false;
+        }
+        if (!session_.Open(model_path.c_str(), use_gpu, blur_get_thread_count())) {
+            LOGE("MediaPipeSegmenter: Failed to load model");
+            return false;
+        }
         
-        auto result = mediapipe::tasks::vision::ImageSegmenter::Create(std::move(options));
-        if (result.ok()) {
-            segmenter_ = std::move(result.value());
-            initialized_ = true;
-            LOGI("MediaPipeSegmenter: Successfully initialized");
-            return true;
-        } else {
-            LOGE("MediaPipeSegmenter: Failed to initialize: %s", result.status().message().data());
+        // Float NHWC in and out
+        int in_dims[4], out_dims[4];
+        const TfLiteTensor* input = session_.Input(0);
+        const TfLiteTensor* output = session_.Output(0);
+        if (!session_.FloatShape(input, 4, in_dims) || in_dims[3] != 3 ||
+            !session_.FloatShape(output, 4, out_dims)) {
+            LOGE("MediaPipeSegmenter: Unsupported model");
+            ReleaseLocked();
             return false;
         }
-#else
-        LOGI("MediaPipeSegmenter: MediaPipe not enabled, using fallback");
-        initialized_ = false;
-        return false;
+        input_height_ = in_dims[1];
+        input_width_ = in_dims[2];
+        output_height_ = out_dims[1];
+        output_width_ = out_dims[2];
+        output_channels_ = out_dims[3];
+        input_ = session_.Data(input);
+        output_ = session_.Data(output);
+        
+        // Warm-up run, so delegate setup is not paid by the first real frame
+        std::fill(input_, input_ + static_cast<size_t>(input_width_) * input_height_ * 3, 0.0f);
+        if (!session_.Invoke()) {
+            LOGE("MediaPipeSegmenter: Warm-up inference failed");
+            ReleaseLocked();
+            return false;
+        }
+        
+        initialized_ = true;
+        LOGI("MediaPipeSegmenter: Ready (%dx%d input, %s)", input_width_, input_height_,
+             session_.OnGpu() ? "GPU delegate" : "CPU");
+        return true;
+    }
+    
+    // Person mask (255 = person) for an RGBA/BGRA/RGB image, written into
+    // mask at the image size. Allocation-free.
+    bool SegmentInto(const uint8_t* pixels, int width, int height, int stride, int format,
+                     uint8_t* mask, int mask_stride) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!initialized_) return false;
+        
+#ifdef DEBUG
+        auto start_time = std::chrono::steady_clock::now();
+#endif
+        
+        // selfie_segmentation expects RGB in [0, 1]
+        if (blur_image_to_tensor(pixels, width, height, stride, format,
+                                 input_, input_width_, input_height_, 1.0f / 255.0f, 0.0f) != 0) {
+            return false;
+        }
+        if (!session_.Invoke()) {
+            LOGE("MediaPipeSegmenter: Inference failed");
+            return false;
+        }
+        // Single-channel models give the person score; two-class ones list
+        // background first
+        if (blur_tensor_to_mask(output_, output_width_, output_height_, output_channels_,
+                                output_channels_ - 1, mask, width, height, mask_stride) != 0) {
+            return false;
+        }
+        
+#ifdef DEBUG
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                              start_time);
+        LOGD("MediaPipeSegmenter: %dx%d frame segmented in %lld us", width, height,
+             static_cast<long long>(duration.count()));
 #endif
+        return true;
     }
     
-    std::vector<uint8_t> Segment(const std::vector<uint8_t>& image_data, int width, int height) {
+    // image_data: tightly packed RGBA of width x height; the mask is pooled
+    PooledBuffer Segment(const uint8_t* image_data, size_t image_size, int width, int height) {
         if (!initialized_) {
             LOGI("MediaPipeSegmenter: Not initialized, returning empty mask");
-            return std::vector<uint8_t>();
+            return PooledBuffer();
+        }
+        if (!image_data || width <= 0 || height <= 0 || image_size < static_cast<size_t>(width) * height * 4) {
+            LOGE("MediaPipeSegmenter: Expected %dx%d RGBA pixels, got %zu bytes", width, height, image_size);
+            return PooledBuffer();
         }
         
-#ifdef ENABLE_MEDIAPIPE
-        // TODO Phase 1: Actual segmentation implementation
-        LOGI("MediaPipeSegmenter: Processing %dx%d image", width, height);
-        // Placeholder: return empty for now
-        return std::vector<uint8_t>();
-#else
-        LOGI("MediaPipeSegmenter: MediaPipe disabled, using fallback");
-        return std::vector<uint8_t>();
-#endif
+        PooledBuffer mask = acquireBuffer(static_cast<size_t>(width) * height);
+        if (mask && !SegmentInto(image_data, width, height, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0)) {
+            mask.reset();
+        }
+        return mask;
     }
     
     bool IsInitialized() const { return initialized_; }
     
     void Cleanup() {
+        std::lock_guard<std::mutex> lock(mutex_);
         if (initialized_) {
             LOGI("MediaPipeSegmenter: Cleaning up");
-#ifdef ENABLE_MEDIAPIPE
-            segmenter_.reset();
-#endif
-            initialized_ = false;
         }
+        ReleaseLocked();
     }
-};
 
-// ================================================================================
-// Phase 4: Smart Compositing Engine
-// ================================================================================
+private:
+    void ReleaseLocked() {
+        session_.Close();
+        input_ = nullptr;
+        output_ = nullptr;
+        initialized_ = false;
+    }
+};
 
-class SmartCompositingEngine {
+// Phase 1: Face detection (face_detection_short_range.tflite) on the same
+// kind of persistent interpreter. Boxes are decoded, padded and merged in
+// native code (blur_decode_faces) into a fixed BlurRect buffer, so a frame
+// goes from pixels to blurred faces without leaving C++.
+class FaceDetector {
+public:
+    static constexpr int kMaxFaces = 32;
+    
 private:
     bool initialized_ = false;
+    TfLiteSession session_;
     
-    // Color space conversion matrices (OpenCV-dependent)
-    struct ColorSpaceConverter {
-        // RGB to HSV conversion for better hue/saturation preservation
-        static void RGBtoHSV(const std::vector<uint8_t>& rgb, std::vector<uint8_t>& hsv, int width, int height) {
-#ifdef ENABLE_OPENCV
-            cv::Mat rgb_mat(height, width, CV_8UC3, (void*)rgb.data());
-            cv::Mat hsv_mat;
-            cv::cvtColor(rgb_mat, hsv_mat, cv::COLOR_RGB2HSV);
-            hsv.resize(hsv_mat.total() * hsv_mat.elemSize());
-            std::memcpy(hsv.data(), hsv_mat.data, hsv.size());
-#else
-            // Fallback: copy input to output
-            hsv = rgb;
-#endif
-        }
+    float* input_ = nullptr;
+    int input_width_ = 0;
+    int input_height_ = 0;
+    const float* regressors_ = nullptr;
+    int regressor_stride_ = 0;
+    const float* scores_ = nullptr;
+    BlurRect rects_[kMaxFaces];
+    BlurContext* blur_ctx_ = nullptr; // scratch kept across frames
+    
+    std::mutex mutex_;
+
+public:
+    ~FaceDetector() { Cleanup(); }
+    
+    bool Initialize(const std::string& model_path, bool use_gpu = true) {
+        LOGI("FaceDetector: Initializing with model: %s", model_path.c_str());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (initialized_) return true;
         
-        // RGB to LAB for perceptual uniformity
-        static void RGBtoLAB(const std::vector<uint8_t>& rgb, std::vector<uint8_t>& lab, int width, int height) {
-#ifdef ENABLE_OPENCV
-            cv::Mat rgb_mat(height, width, CV_8UC3, (void*)rgb.data());
-            cv::Mat lab_mat;
-            cv::cvtColor(rgb_mat, lab_mat, cv::COLOR_RGB2Lab);
-            lab.resize(lab_mat.total() * lab_mat.elemSize());
-            std::memcpy(lab.data(), lab_mat.data, lab.size());
-#else
-            // Fallback: copy input to output
-            lab = rgb;
-#endif
+        if (!session_.Open(model_path.c_str(), use_gpu, blur_get_thread_count())) {
+            LOGE("FaceDetector: TFLite runtime missing or model failed to load");
+            return false;
         }
         
-        // Convert back to RGB
-        static void HSVtoRGB(const std::vector<uint8_t>& hsv, std::vector<uint8_t>& rgb, int width, int height) {
-#ifdef ENABLE_OPENCV
-            cv::Mat hsv_mat(height, width, CV_8UC3, (void*)hsv.data());
-            cv::Mat rgb_mat;
-            cv::cvtColor(hsv_mat, rgb_mat, cv::COLOR_HSV2RGB);
-            rgb.resize(rgb_mat.total() * rgb_mat.elemSize());
-            std::memcpy(rgb.data(), rgb_mat.data, rgb.size());
-#else
-            // Fallback: copy input to output
-            rgb = hsv;
-#endif
+        // Input NHWC RGB; outputs [1, anchors, 16] boxes and [1, anchors, 1]
+        // scores, in either order
+        int in_dims[4];
+        const TfLiteTensor* input = session_.Input(0);
+        if (!session_.FloatShape(input, 4, in_dims) || in_dims[3] != 3) {
+            LOGE("FaceDetector: Unsupported model input");
+            ReleaseLocked();
+            return false;
         }
-        
-        static void LABtoRGB(const std::vector<uint8_t>& lab, std::vector<uint8_t>& rgb, int width, int height) {
-#ifdef ENABLE_OPENCV
-            cv::Mat lab_mat(height, width, CV_8UC3, (void*)lab.data());
-            cv::Mat rgb_mat;
-            cv::cvtColor(lab_mat, rgb_mat, cv::COLOR_Lab2RGB);
-            rgb.resize(rgb_mat.total() * rgb_mat.elemSize());
-            std::memcpy(rgb.data(), rgb_mat.data, rgb.size());
-#else
-            // Fallback: copy input to output
-            rgb = lab;
-#endif
+        input_height_ = in_dims[1];
+        input_width_ = in_dims[2];
+        input_ = session_.Data(input);
+        for (int i = 0; i < session_.OutputCount(); ++i) {
+            int dims[3];
+            const TfLiteTensor* output = session_.Output(i);
+            if (!session_.FloatShape(output, 3, dims) || dims[1] != blur_face_anchor_count()) continue;
+            if (dims[2] == 1) {
+                scores_ = session_.Data(output);
+            } else if (dims[2] >= 4) {
+                regressors_ = session_.Data(output);
+                regressor_stride_ = dims[2];
+            }
         }
-    };
-
-public:
-    SmartCompositingEngine() = default;
-    ~SmartCompositingEngine() = default;
-
-    bool Initialize() {
-        if (initialized_) return true;
-        
-        auto start = std::chrono::high_resolution_clock::now();
-        LOGI("SmartCompositingEngine: Initializing intelligent compositing...");
-
-#ifdef ENABLE_OPENCV
-        if (!cv::getBuildInformation().empty()) {
-            initialized_ = true;
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            LOGI("SmartCompositingEngine: Initialized successfully (%ldms)", duration.count());
-            return true;
+        blur_ctx_ = blur_context_create();
+        std::fill(input_, input_ + static_cast<size_t>(input_width_) * input_height_ * 3, 0.0f);
+        if (!regressors_ || !scores_ || !blur_ctx_ || !session_.Invoke()) {
+            LOGE("FaceDetector: Unsupported model outputs or warm-up failed");
+            ReleaseLocked();
+            return false;
         }
-#endif
         
-        LOGE("SmartCompositingEngine: OpenCV not available");
-        return false;
+        initialized_ = true;
+        LOGI("FaceDetector: Ready (%dx%d input, %s)", input_width_, input_height_,
+             session_.OnGpu() ? "GPU delegate" : "CPU");
+        return true;
     }
-
+    
+    // Padded, merged face rects of an RGBA/BGRA/RGB image (at most
+    // max_rects). Returns the count, or -1/-6 for bad input / no detector.
+    int DetectInto(const uint8_t* pixels, int width, int height, int stride, int format, float padding,
+                   BlurRect* rects, int max_rects) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return DetectLocked(pixels, width, height, stride, format, padding, rects, max_rects);
+    }
+    
+    // Detect faces and blur them in place on the governor's backend for the
+    // size (blur_governor_apply).
+    // padding grows each face by that fraction of its size per side.
+    // Returns the number of faces blurred, or a blur status (< 0); -6 if the
+    // detector is not ready.
+    int BlurFacesInPlace(uint8_t* pixels, int width, int height, int stride, int format,
+                         int mode, int strength, float padding) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const int faces = DetectLocked(pixels, width, height, stride, format, padding, rects_, kMaxFaces);
+        if (faces <= 0) return faces;
+        const int rc = blur_governor_apply(blur_ctx_, pixels, width, height, stride, format, rects_, faces,
+                                           mode, strength, nullptr);
+        return rc == 0 ? faces : rc;
+    }
+    
     bool IsInitialized() const { return initialized_; }
+    
+    void Cleanup() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReleaseLocked();
+    }
 
-    // Multi-layer alpha blending with smart edge preservation
-    std::vector<uint8_t> BlendLayers(
-        const std::vector<uint8_t>& base_image,
-        const std::vector<uint8_t>& overlay_image, 
-        const std::vector<uint8_t>& mask,
-        int width, int height,
-        double blend_strength = 1.0) {
+private:
+    int DetectLocked(const uint8_t* pixels, int width, int height, int stride, int format, float padding,
+                     BlurRect* rects, int max_rects) {
+        if (!initialized_) return -6;
         
-        if (!initialized_) {
-            LOGE("SmartCompositingEngine: Not initialized");
-            return {};
+        // BlazeFace expects RGB in [-1, 1]
+        if (blur_image_to_tensor(pixels, width, height, stride, format,
+                                 input_, input_width_, input_height_, 2.0f / 255.0f, -1.0f) != 0) {
+            return -1;
+        }
+        if (!session_.Invoke()) {
+            LOGE("FaceDetector: Inference failed");
+            return -6;
         }
+        return blur_decode_faces(regressors_, regressor_stride_, scores_, width, height,
+                                 0.5f, 0.3f, padding, rects, max_rects);
+    }
+    
+    void ReleaseLocked() {
+        session_.Close();
+        blur_context_destroy(blur_ctx_);
+        blur_ctx_ = nullptr;
+        input_ = nullptr;
+        regressors_ = nullptr;
+        scores_ = nullptr;
+        initialized_ = false;
+    }
+};
+
+// ================================================================================
+// Phase 4: Smart Compositing Engine
+// ================================================================================
+
+class SmartCompositingEngine {
+private:
+    bool initialized_ = false;
 
 #ifdef ENABLE_OPENCV
-        auto start = std::chrono::high_resolution_clock::now();
+    static constexpr int kBlendHalo = 8;
+
+    // Edge-aware alpha blend of one region; every input is a view of the
+    // same halo rectangle
+    static cv::Mat BlendTile(const cv::Mat& base, const cv::Mat& overlay, const cv::Mat& alpha_mask,
+                             double blend_strength) {
+        // Normalize mask to [0,1] range for blending
+        cv::Mat normalized_mask;
+        alpha_mask.convertTo(normalized_mask, CV_32F, 1.0/255.0);
         
-        try {
-            // Convert input data to OpenCV matrices
-            cv::Mat base(height, width, CV_8UC3, (void*)base_image.data());
-            cv::Mat overlay(height, width, CV_8UC3, (void*)overlay_image.data());
-            cv::Mat alpha_mask(height, width, CV_8UC1, (void*)mask.data());
-            
-            // Normalize mask to [0,1] range for blending
-            cv::Mat normalized_mask;
-            alpha_mask.convertTo(normalized_mask, CV_32F, 1.0/255.0);
-            
-            // Apply blend strength
-            normalized_mask *= blend_strength;
-            
-            // Smart edge preservation - detect edges in base image
-            cv::Mat base_gray, edges;
-            cv::cvtColor(base, base_gray, cv::COLOR_BGR2GRAY);
-            cv::Canny(base_gray, edges, 50, 150);
-            
-            // Reduce blending near edges to preserve detail
-            cv::Mat edge_mask;
-            edges.convertTo(edge_mask, CV_32F, 1.0/255.0);
-            cv::GaussianBlur(edge_mask, edge_mask, cv::Size(5, 5), 1.0);
-            normalized_mask = normalized_mask.mul(1.0 - edge_mask * 0.3);
-            
-            // Convert to floating point for precise blending
-            cv::Mat base_f, overlay_f;
-            base.convertTo(base_f, CV_32FC3, 1.0/255.0);
-            overlay.convertTo(overlay_f, CV_32FC3, 1.0/255.0);
-            
-            // Multi-channel alpha blending
-            cv::Mat result_f = cv::Mat::zeros(base.size(), CV_32FC3);
-            std::vector<cv::Mat> base_channels, overlay_channels, result_channels(3);
-            cv::split(base_f, base_channels);
-            cv::split(overlay_f, overlay_channels);
-            
-            for (int c = 0; c < 3; c++) {
-                result_channels[c] = base_channels[c].mul(1.0 - normalized_mask) + 
-                                   overlay_channels[c].mul(normalized_mask);
-            }
-            
-            cv::merge(result_channels, result_f);
-            
-            // Convert back to 8-bit
-            cv::Mat result;
-            result_f.convertTo(result, CV_8UC3, 255.0);
-            
-            // Copy result to output vector
-            std::vector<uint8_t> output(result.total() * result.elemSize());
-            std::memcpy(output.data(), result.data, output.size());
-            
+        // Apply blend strength
+        normalized_mask *= blend_strength;
+        
+        // Smart edge preservation - detect edges in base image
+        cv::Mat base_gray, edges;
+        cv::cvtColor(base, base_gray, cv::COLOR_BGR2GRAY);
+        cv::Canny(base_gray, edges, 50, 150);
+        
+        // Reduce blending near edges to preserve detail
+        cv::Mat edge_mask;
+        edges.convertTo(edge_mask, CV_32F, 1.0/255.0);
+        cv::GaussianBlur(edge_mask, edge_mask, cv::Size(5, 5), 1.0);
+        normalized_mask = normalized_mask.mul(1.0 - edge_mask * 0.3);
+        
+        // Convert to floating point for precise blending
+        cv::Mat base_f, overlay_f;
+        base.convertTo(base_f, CV_32FC3, 1.0/255.0);
+        overlay.convertTo(overlay_f, CV_32FC3, 1.0/255.0);
+        
+        // Multi-channel alpha blending
+        std::vector<cv::Mat> base_channels, overlay_channels, result_channels(3);
+        cv::split(base_f, base_channels);
+        cv::split(overlay_f, overlay_channels);
+        
+        for (int c = 0; c < 3; c++) {
+            result_channels[c] = base_channels[c].mul(1.0 - normalized_mask) + 
+                               overlay_channels[c].mul(normalized_mask);
+        }
+        
+        cv::Mat result_f, result;
+        cv::merge(result_channels, result_f);
+        result_f.convertTo(result, CV_8UC3, 255.0);
+        return result;
+    }
+#endif
+
+public:
+    SmartCompositingEngine() = default;
+    ~SmartCompositingEngine() = default;
+
+    bool Initialize() {
+        if (initialized_) return true;
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        LOGI("SmartCompositingEngine: Initializing intelligent compositing...");
+
+#ifdef ENABLE_OPENCV
+        if (!cv::getBuildInformation().empty()) {
+            initialized_ = true;
             auto end = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            LOGI("SmartCompositingEngine: Blend completed (%ldms)", duration.count());
-            
-            return output;
-            
-        } catch (const std::exception& e) {
-            LOGE("SmartCompositingEngine: Blending failed: %s", e.what());
-            return {};
+            LOGI("SmartCompositingEngine: Initialized successfully (%ldms)", duration.count());
+            return true;
         }
-#else
-        LOGE("SmartCompositingEngine: OpenCV not available");
-        return {};
 #endif
+        
+        LOGE("SmartCompositingEngine: OpenCV not available");
+        return false;
     }
 
-    // Advanced color space blending for natural transitions
-    std::vector<uint8_t> AdvancedColorBlend(
-        const std::vector<uint8_t>& base_image,
-        const std::vector<uint8_t>& overlay_image,
-        const std::vector<uint8_t>& mask,
+    bool IsInitialized() const { return initialized_; }
+
+    // Multi-layer alpha blending with smart edge preservation, tile by tile
+    // on the shared scheduler. Tiles the mask leaves untouched are copied
+    // from the base without any filtering, and idle workers steal the
+    // expensive ones. The halo covers Canny's gradient and suppression
+    // windows plus the 5x5 edge blur; hysteresis links edges through the
+    // halo only, which only matters for faint edges tracing a strong one
+    // many pixels away.
+    // Layers are packed RGB (mask: one byte per pixel); sizes are in bytes.
+    PooledBuffer BlendLayers(
+        const uint8_t* base_image, size_t base_size,
+        const uint8_t* overlay_image, size_t overlay_size,
+        const uint8_t* mask, size_t mask_size,
         int width, int height,
-        const std::string& color_space = "HSV") {
+        double blend_strength = 1.0) {
         
         if (!initialized_) {
             LOGE("SmartCompositingEngine: Not initialized");
-            return {};
+            return PooledBuffer();
         }
 
 #ifdef ENABLE_OPENCV
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (!base_image || !overlay_image || !mask || width <= 0 || height <= 0 ||
+            base_size < pixels * 3 || overlay_size < pixels * 3 || mask_size < pixels) {
+            LOGE("SmartCompositingEngine: Layer sizes do not match %dx%d", width, height);
+            return PooledBuffer();
+        }
+        PooledBuffer output = acquireBuffer(pixels * 3);
+        if (!output) return output;
         auto start = std::chrono::high_resolution_clock::now();
         
-        try {
-            cv::Mat base(height, width, CV_8UC3, (void*)base_image.data());
-            cv::Mat overlay(height, width, CV_8UC3, (void*)overlay_image.data());
-            cv::Mat alpha_mask(height, width, CV_8UC1, (void*)mask.data());
-            
-            cv::Mat base_converted, overlay_converted, result_converted;
-            
-            if (color_space == "HSV") {
-                ColorSpaceConverter::RGBtoHSV(base, base_converted);
-                ColorSpaceConverter::RGBtoHSV(overlay, overlay_converted);
-            } else if (color_space == "LAB") {
-                ColorSpaceConverter::RGBtoLAB(base, base_converted);
-                ColorSpaceConverter::RGBtoLAB(overlay, overlay_converted);
-            } else {
-                base_converted = base.clone();
-                overlay_converted = overlay.clone();
-            }
-            
-            // Normalize mask
-            cv::Mat normalized_mask;
-            alpha_mask.convertTo(normalized_mask, CV_32F, 1.0/255.0);
-            
-            // Blend in converted color space
-            cv::Mat base_f, overlay_f;
-            base_converted.convertTo(base_f, CV_32FC3, 1.0/255.0);
-            overlay_converted.convertTo(overlay_f, CV_32FC3, 1.0/255.0);
-            
-            cv::Mat result_f = cv::Mat::zeros(base.size(), CV_32FC3);
-            std::vector<cv::Mat> base_channels, overlay_channels, result_channels(3);
-            cv::split(base_f, base_channels);
-            cv::split(overlay_f, overlay_channels);
-            
-            for (int c = 0; c < 3; c++) {
-                result_channels[c] = base_channels[c].mul(1.0 - normalized_mask) + 
-                                   overlay_channels[c].mul(normalized_mask);
+        const cv::Mat base(height, width, CV_8UC3, const_cast<uint8_t*>(base_image));
+        const cv::Mat overlay(height, width, CV_8UC3, const_cast<uint8_t*>(overlay_image));
+        const cv::Mat alpha_mask(height, width, CV_8UC1, const_cast<uint8_t*>(mask));
+        cv::Mat target(height, width, CV_8UC3, output.data());
+        
+        StageScope stage(BLUR_STAGE_BLEND);
+        const bool ok = RunTiles(width, height, kBlendHalo, [&](const Tile& t, int) {
+            const cv::Rect own(t.x0, t.y0, t.x1 - t.x0, t.y1 - t.y0);
+            if (blend_strength <= 0.0 || cv::countNonZero(alpha_mask(own)) == 0) {
+                base(own).copyTo(target(own));
+                return true;
             }
-            
-            cv::merge(result_channels, result_f);
-            
-            // Convert back to 8-bit in converted space
-            result_f.convertTo(result_converted, CV_8UC3, 255.0);
-            
-            // Convert back to RGB
-            cv::Mat final_result;
-            if (color_space == "HSV") {
-                ColorSpaceConverter::HSVtoRGB(result_converted, final_result);
-            } else if (color_space == "LAB") {
-                ColorSpaceConverter::LABtoRGB(result_converted, final_result);
-            } else {
-                final_result = result_converted.clone();
+            try {
+                const cv::Rect halo(t.hx0, t.hy0, t.hx1 - t.hx0, t.hy1 - t.hy0);
+                cv::Mat blended = BlendTile(base(halo), overlay(halo), alpha_mask(halo), blend_strength);
+                blended(cv::Rect(t.x0 - t.hx0, t.y0 - t.hy0, own.width, own.height)).copyTo(target(own));
+                return true;
+            } catch (const std::exception& e) {
+                LOGE("SmartCompositingEngine: Blending tile %d failed: %s", t.index, e.what());
+                return false;
             }
-            
-            std::vector<uint8_t> output(final_result.total() * final_result.elemSize());
-            std::memcpy(output.data(), final_result.data, output.size());
-            
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            LOGI("SmartCompositingEngine: Advanced color blend completed (%ldms)", duration.count());
-            
-            return output;
-            
-        } catch (const std::exception& e) {
-            LOGE("SmartCompositingEngine: Advanced color blending failed: %s", e.what());
-            return {};
-        }
+        });
+        if (!ok) return PooledBuffer();
+        
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        LOGI("SmartCompositingEngine: Blend completed (%ldms)", duration.count());
+        return output;
 #else
         LOGE("SmartCompositingEngine: OpenCV not available");
-        return {};
+        return PooledBuffer();
 #endif
     }
 
-    // Gradient domain compositing for seamless transitions
-    std::vector<uint8_t> GradientDomainComposite(
-        const std::vector<uint8_t>& base_image,
-        const std::vector<uint8_t>& overlay_image,
-        const std::vector<uint8_t>& mask,
-        int width, int height) {
+    // Advanced color space blending for natural transitions: one fused pass
+    // in the portable core (blur_blend_colorspace) that only converts the
+    // mask's soft edge, instead of converting both images to HSV/LAB and back.
+    // Sizes are in bytes; the output is pooled, empty on failure.
+    PooledBuffer AdvancedColorBlend(
+        const uint8_t* base_image, size_t base_size,
+        const uint8_t* overlay_image, size_t overlay_size,
+        const uint8_t* mask, size_t mask_size,
+        int width, int height,
+        const std::string& color_space = "HSV") {
         
-        if (!initialized_) {
-            LOGE("SmartCompositingEngine: Not initialized");
-            return {};
+        // Needs no OpenCV, so it works before or without Initialize()
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (!base_image || !overlay_image || !mask || width <= 0 || height <= 0 ||
+            base_size != pixels * 3 || overlay_size != pixels * 3 || mask_size != pixels) {
+            LOGE("SmartCompositingEngine: Color blend expects %dx%d RGB images and mask", width, height);
+            return PooledBuffer();
         }
-
-#ifdef ENABLE_OPENCV
+        
+        int space = BLUR_BLEND_SRGB;
+        if (color_space == "HSV") space = BLUR_BLEND_HSV;
+        else if (color_space == "LAB" || color_space == "OKLAB") space = BLUR_BLEND_OKLAB;
+        else if (color_space == "LINEAR") space = BLUR_BLEND_LINEAR;
+        
         auto start = std::chrono::high_resolution_clock::now();
+        PooledBuffer output = acquireBuffer(base_size);
+        if (!output) return output;
+        std::memcpy(output.data(), base_image, base_size);
+        const int rc = blur_blend_colorspace(output.data(), overlay_image, width, height, 0,
+                                             BLUR_FORMAT_RGB888, mask, 0, space);
+        if (rc != 0) {
+            LOGE("SmartCompositingEngine: Advanced color blending failed (%d)", rc);
+            return PooledBuffer();
+        }
         
-        try {
-            cv::Mat base(height, width, CV_8UC3, (void*)base_image.data());
-            cv::Mat overlay(height, width, CV_8UC3, (void*)overlay_image.data());
-            cv::Mat alpha_mask(height, width, CV_8UC1, (void*)mask.data());
-            
-            // Compute gradients for both images
-            cv::Mat base_gray, overlay_gray;
-            cv::cvtColor(base, base_gray, cv::COLOR_BGR2GRAY);
-            cv::cvtColor(overlay, overlay_gray, cv::COLOR_BGR2GRAY);
-            
-            cv::Mat grad_x_base, grad_y_base, grad_x_overlay, grad_y_overlay;
-            cv::Sobel(base_gray, grad_x_base, CV_32F, 1, 0, 3);
-            cv::Sobel(base_gray, grad_y_base, CV_32F, 0, 1, 3);
-            cv::Sobel(overlay_gray, grad_x_overlay, CV_32F, 1, 0, 3);
-            cv::Sobel(overlay_gray, grad_y_overlay, CV_32F, 0, 1, 3);
-            
-            // Blend gradients based on mask
-            cv::Mat mask_f;
-            alpha_mask.convertTo(mask_f, CV_32F, 1.0/255.0);
-            
-            cv::Mat blended_grad_x = grad_x_base.mul(1.0 - mask_f) + grad_x_overlay.mul(mask_f);
-            cv::Mat blended_grad_y = grad_y_base.mul(1.0 - mask_f) + grad_y_overlay.mul(mask_f);
-            
-            // Reconstruct image from blended gradients (simplified Poisson reconstruction)
-            cv::Mat magnitude;
-            cv::magnitude(blended_grad_x, blended_grad_y, magnitude);
-            
-            // Use bilateral filter to smooth while preserving edges
-            cv::Mat base_f, result_f;
-            base.convertTo(base_f, CV_32FC3, 1.0/255.0);
-            cv::bilateralFilter(base_f, result_f, 9, 75, 75);
-            
-            // Blend based on gradient magnitude and mask
-            cv::Mat gradient_weight;
-            cv::normalize(magnitude, gradient_weight, 0, 1, cv::NORM_MINMAX);
-            gradient_weight = gradient_weight.mul(mask_f);
-            
-            cv::Mat overlay_f;
-            overlay.convertTo(overlay_f, CV_32FC3, 1.0/255.0);
-            
-            // Apply gradient-weighted blending
-            std::vector<cv::Mat> base_channels, overlay_channels, result_channels(3);
-            cv::split(base_f, base_channels);
-            cv::split(overlay_f, overlay_channels);
-            
-            for (int c = 0; c < 3; c++) {
-                result_channels.push_back(
-                    base_channels[c].mul(1.0 - gradient_weight) + 
-                    overlay_channels[c].mul(gradient_weight)
-                );
-            }
-            
-            cv::Mat final_result_f;
-            cv::merge(result_channels, final_result_f);
-            
-            cv::Mat final_result;
-            final_result_f.convertTo(final_result, CV_8UC3, 255.0);
-            
-            std::vector<uint8_t> output(final_result.total() * final_result.elemSize());
-            std::memcpy(output.data(), final_result.data, output.size());
-            
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            LOGI("SmartCompositingEngine: Gradient domain composite completed (%ldms)", duration.count());
-            
-            return output;
-            
-        } catch (const std::exception& e) {
-            LOGE("SmartCompositingEngine: Gradient domain compositing failed: %s", e.what());
-            return {};
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        LOGI("SmartCompositingEngine: Advanced color blend completed (%lldms)",
+             static_cast<long long>(duration.count()));
+        return output;
+    }
+
+    // Gradient domain compositing for seamless transitions: a multigrid
+    // Poisson solve over the mask's bounding box in the portable core
+    // (blur_composite_poisson), on the shared worker pool. Sizes are in
+    // bytes; the output is pooled, empty on failure.
+    PooledBuffer GradientDomainComposite(
+        const uint8_t* base_image, size_t base_size,
+        const uint8_t* overlay_image, size_t overlay_size,
+        const uint8_t* mask, size_t mask_size,
+        int width, int height) {
+        
+        // Needs no OpenCV, so it works before or without Initialize()
+        const size_t pixels = static_cast<size_t>(width) * height;
+        if (!base_image || !overlay_image || !mask || width <= 0 || height <= 0 ||
+            base_size != pixels * 3 || overlay_size != pixels * 3 || mask_size != pixels) {
+            LOGE("SmartCompositingEngine: Gradient domain composite expects %dx%d RGB images and mask",
+                 width, height);
+            return PooledBuffer();
         }
-#else
-        LOGE("SmartCompositingEngine: OpenCV not available");
-        return {};
-#endif
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        PooledBuffer output = acquireBuffer(base_size);
+        if (!output) return output;
+        std::memcpy(output.data(), base_image, base_size);
+        const int rc = blur_composite_poisson(output.data(), overlay_image, width, height, 0,
+                                              BLUR_FORMAT_RGB888, mask, 0, 0);
+        if (rc != 0) {
+            LOGE("SmartCompositingEngine: Gradient domain compositing failed (%d)", rc);
+            return PooledBuffer();
+        }
+        
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        LOGI("SmartCompositingEngine: Gradient domain composite completed (%lldms)",
+             static_cast<long long>(duration.count()));
+        return output;
     }
 
     void Cleanup() {
@@ -1034,147 +1214,52 @@ public:
 // Phase 5: Performance Optimization Engine
 // ================================================================================
 
+// Startup timings, in nanoseconds, -1 until the step has run. The first run
+// of a step is the one recorded: later calls find the work already done.
+struct StartupMetrics {
+    std::atomic<int64_t> engines_ns{-1};
+    std::atomic<int64_t> core_ns{-1};
+    std::atomic<int64_t> segmentation_ns{-1};
+    std::atomic<int64_t> face_detection_ns{-1};
+    std::atomic<int64_t> warm_up_ns{-1};
+    // The engines were built by the first request rather than by warmUp
+    std::atomic<bool> engines_on_demand{false};
+
+    static void Record(std::atomic<int64_t>& slot, int64_t ns) {
+        int64_t unset = -1;
+        slot.compare_exchange_strong(unset, ns);
+    }
+};
+
+static StartupMetrics g_startup;
+
+static int64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
 class PerformanceOptimizationEngine {
 private:
     bool initialized_ = false;
     std::atomic<bool> should_stop_{false};
     
-    // Thread pool for parallel processing
-    class ThreadPool {
-    private:
-        std::vector<std::thread> workers;
-        std::queue<std::function<void()>> tasks;
-        std::mutex queue_mutex;
-        std::condition_variable condition;
-        bool stop = false;
-        
-    public:
-        explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency()) {
-            for (size_t i = 0; i < num_threads; ++i) {
-                workers.emplace_back([this] {
-                    for (;;) {
-                        std::function<void()> task;
-                        {
-                            std::unique_lock<std::mutex> lock(this->queue_mutex);
-                            this->condition.wait(lock, [this] { return this->stop || !this->tasks.empty(); });
-                            if (this->stop && this->tasks.empty()) return;
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                        }
-                        task();
-                    }
-                });
-            }
-        }
-        
-        template<class F, class... Args>
-        auto enqueue(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
-            using return_type = decltype(f(args...));
-            
-            auto task = std::make_shared<std::packaged_task<return_type()>>(
-                std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-            );
-            
-            std::future<return_type> res = task->get_future();
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                if (stop) {
-                    LOGE("ThreadPool: Cannot enqueue on stopped pool");
-                    return std::future<return_type>();
-                }
-                tasks.emplace([task]() { (*task)(); });
-            }
-            condition.notify_one();
-            return res;
-        }
-        
-        ~ThreadPool() {
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                stop = true;
-            }
-            condition.notify_all();
-            for (std::thread &worker : workers) worker.join();
-        }
-    };
-    
-    std::unique_ptr<ThreadPool> thread_pool_;
-    
-    // Memory pool for efficient allocation
-    class MemoryPool {
-    private:
-        struct Block {
-            std::vector<uint8_t> data;
-            bool in_use = false;
-            size_t size = 0;
-        };
-        
-        std::vector<Block> pool_;
-        mutable std::mutex pool_mutex_;
-        static constexpr size_t MAX_POOL_SIZE = 32;
-        static constexpr size_t BLOCK_SIZE = 1024 * 1024 * 4; // 4MB blocks
-        
-    public:
-        std::vector<uint8_t>* acquireBuffer(size_t required_size) {
-            std::lock_guard<std::mutex> lock(pool_mutex_);
-            
-            // Find an available block of sufficient size
-            for (auto& block : pool_) {
-                if (!block.in_use && block.data.size() >= required_size) {
-                    block.in_use = true;
-                    return &block.data;
-                }
-            }
-            
-            // Create new block if pool isn't full
-            if (pool_.size() < MAX_POOL_SIZE) {
-                pool_.emplace_back();
-                auto& new_block = pool_.back();
-                new_block.data.resize(std::max(required_size, BLOCK_SIZE));
-                new_block.in_use = true;
-                new_block.size = required_size;
-                return &new_block.data;
-            }
-            
-            // Pool is full, return nullptr to indicate fallback to direct allocation
-            return nullptr;
-        }
-        
-        void releaseBuffer(std::vector<uint8_t>* buffer) {
-            std::lock_guard<std::mutex> lock(pool_mutex_);
-            
-            for (auto& block : pool_) {
-                if (&block.data == buffer) {
-                    block.in_use = false;
-                    break;
-                }
-            }
-        }
-        
-        void cleanup() {
-            std::lock_guard<std::mutex> lock(pool_mutex_);
-            pool_.clear();
-        }
-        
-        size_t getPoolSize() const {
-            std::lock_guard<std::mutex> lock(pool_mutex_);
-            return pool_.size();
-        }
-    };
+    // Shared worker pool from the portable core (native/src/thread_pool.h)
+    std::shared_ptr<ThreadPool> thread_pool_;
     
-    std::unique_ptr<MemoryPool> memory_pool_;
+    // Scratch and result buffers come from the process-wide buffer pool
+    // (native/src/buffer_pool.h), shared with the core.
     
     // Performance profiler
     struct PerformanceMetrics {
+        // Per-stage histograms live in the core (native/src/trace.h); these
+        // only count what the engine itself does.
         std::atomic<uint64_t> total_operations{0};
-        std::atomic<uint64_t> total_processing_time{0};
+        std::atomic<uint64_t> total_processing_ns{0};
         std::atomic<uint64_t> memory_allocations{0};
         std::atomic<uint64_t> gpu_operations{0};
-        std::mutex metrics_mutex;
         
-        void recordOperation(uint64_t duration_ms) {
+        void recordOperation(uint64_t duration_ns) {
             total_operations.fetch_add(1);
-            total_processing_time.fetch_add(duration_ms);
+            total_processing_ns.fetch_add(duration_ns);
         }
         
         void recordMemoryAllocation() {
@@ -1185,10 +1270,10 @@ private:
             gpu_operations.fetch_add(1);
         }
         
-        double getAverageProcessingTime() const {
+        double getAverageProcessingMs() const {
             uint64_t ops = total_operations.load();
             if (ops == 0) return 0.0;
-            return static_cast<double>(total_processing_time.load()) / ops;
+            return static_cast<double>(total_processing_ns.load()) / ops / 1e6;
         }
     };
     
@@ -1204,141 +1289,113 @@ public:
         auto start = std::chrono::high_resolution_clock::now();
         LOGI("PerformanceOptimizationEngine: Initializing optimization systems...");
 
-        // Initialize thread pool
-        thread_pool_ = std::make_unique<ThreadPool>();
-        
-        // Initialize memory pool
-        memory_pool_ = std::make_unique<MemoryPool>();
+        // Attach to the shared thread pool (nullptr when running single-threaded)
+        thread_pool_ = sharedThreadPool();
         
         initialized_ = true;
         
         auto end = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
         LOGI("PerformanceOptimizationEngine: Initialized successfully (%lldms)", (long long)duration.count());
-        LOGI("PerformanceOptimizationEngine: Thread pool with %d threads, memory pool ready", 
-             std::thread::hardware_concurrency());
+        LOGI("PerformanceOptimizationEngine: Thread pool with %d threads, buffer pool ready", 
+             configuredThreadCount());
         
         return true;
     }
 
     bool IsInitialized() const { return initialized_; }
 
-    // Parallel image processing with thread pool
-    std::vector<uint8_t> ProcessImageParallel(
-        const std::vector<uint8_t>& image_data,
-        int width, int height,
-        std::function<void(uint8_t*, int, int, int, int)> processor) {
+    // Generic tiled processing on the 2D tile scheduler: kernel(src, dst,
+    // stride, tile, worker) reads src inside the tile's halo and writes the
+    // tile's own pixels of dst. The source is never written, so any
+    // neighbourhood filter joins without seams. The result is a pooled
+    // buffer, empty on failure.
+    using BufferTileKernel = std::function<bool(const uint8_t* src, uint8_t* dst, int stride,
+                                                const Tile& tile, int worker)>;
+    
+    PooledBuffer ProcessImageTiled(
+        const uint8_t* image_data, size_t image_size,
+        int width, int height, int channels, int halo,
+        const BufferTileKernel& kernel) {
         
         if (!initialized_) {
             LOGE("PerformanceOptimizationEngine: Not initialized");
-            return {};
+            return PooledBuffer();
+        }
+        const int stride = width * channels;
+        if (!image_data || width <= 0 || height <= 0 || image_size < static_cast<size_t>(stride) * height) {
+            return PooledBuffer();
         }
 
         auto start = std::chrono::high_resolution_clock::now();
         
-        // Acquire buffer from memory pool
-        auto* output_buffer = memory_pool_->acquireBuffer(image_data.size());
-        std::vector<uint8_t> result;
-        
-        if (output_buffer) {
-            output_buffer->resize(image_data.size());
-            std::memcpy(output_buffer->data(), image_data.data(), image_data.size());
-            metrics_.recordMemoryAllocation();
-        } else {
-            // Fallback to direct allocation
-            result = image_data;
-            output_buffer = &result;
-        }
-        
-        // Determine optimal tile size for parallel processing
-        const int num_threads = std::thread::hardware_concurrency();
-        const int tile_height = height / num_threads;
-        
-        // Process image in parallel tiles
-        std::vector<std::future<void>> futures;
-        
-        for (int i = 0; i < num_threads; ++i) {
-            int start_y = i * tile_height;
-            int end_y = (i == num_threads - 1) ? height : (i + 1) * tile_height;
-            
-            futures.push_back(thread_pool_->enqueue([&, start_y, end_y]() {
-                processor(output_buffer->data(), width, height, start_y, end_y);
-            }));
-        }
-        
-        // Wait for all tiles to complete
-        for (auto& future : futures) {
-            future.wait();
-        }
-        
-        // Prepare result
-        std::vector<uint8_t> final_result;
-        if (output_buffer == &result) {
-            final_result = std::move(result);
-        } else {
-            final_result = *output_buffer;
-            memory_pool_->releaseBuffer(output_buffer);
-        }
+        PooledBuffer result = acquireBuffer(image_size);
+        if (!result) return result;
+        metrics_.recordMemoryAllocation();
+        const uint8_t* src = image_data;
+        uint8_t* dst = result.data();
+        const bool ok = RunTiles(width, height, halo, [&](const Tile& tile, int worker) {
+            return kernel(src, dst, stride, tile, worker);
+        });
         
         auto end = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
         metrics_.recordOperation(duration.count());
         
-        LOGI("PerformanceOptimizationEngine: Parallel processing completed (%lldms)", (long long)duration.count());
-        return final_result;
+        LOGI("PerformanceOptimizationEngine: Tiled processing completed (%lldus)", (long long)duration.count() / 1000);
+        if (!ok) result.reset();
+        return result;
     }
 
-    // GPU memory optimization for OpenCV operations
-    bool OptimizeGPUMemory() {
-        if (!initialized_) return false;
-
-#ifdef ENABLE_OPENCV
-        // Clear GPU memory cache
-        cv::cuda::DeviceInfo device_info;
-        if (device_info.isCompatible()) {
-            cv::cuda::resetDevice();
-            metrics_.recordGPUOperation();
-            LOGI("PerformanceOptimizationEngine: GPU memory optimized");
-            return true;
-        }
-#endif
-        return false;
+    static std::string GovernorJson() {
+        std::string json(static_cast<size_t>(blur_governor_json(nullptr, 0)) + 1, '\0');
+        json.resize(static_cast<size_t>(blur_governor_json(&json[0], static_cast<int>(json.size()))));
+        return json;
     }
 
-    // Get performance metrics
+    // Engine counters plus the core's stage histograms and pool counters
+    // (blur_stats_json) and the governor's table, as one JSON object
     std::string GetPerformanceReport() const {
-        if (!initialized_) return "Performance engine not initialized";
-        
         std::ostringstream report;
-        report << "Performance Report:\\n";
-        report << "Total Operations: " << metrics_.total_operations.load() << "\\n";
-        report << "Average Processing Time: " << std::fixed << std::setprecision(2) 
-               << metrics_.getAverageProcessingTime() << "ms\\n";
-        report << "Memory Pool Size: " << memory_pool_->getPoolSize() << "\\n";
-        report << "GPU Operations: " << metrics_.gpu_operations.load() << "\\n";
-        report << "Memory Allocations: " << metrics_.memory_allocations.load();
-        
+        report << "{\"engine\":{\"initialized\":" << (initialized_ ? "true" : "false")
+               << ",\"operations\":" << metrics_.total_operations.load()
+               << ",\"avg_ms\":" << std::fixed << std::setprecision(3) << metrics_.getAverageProcessingMs()
+               << ",\"gpu_operations\":" << metrics_.gpu_operations.load()
+               << ",\"allocations\":" << metrics_.memory_allocations.load() << "},\"startup\":{";
+        const std::pair<const char*, const std::atomic<int64_t>*> steps[] = {
+            {"engines_ms", &g_startup.engines_ns},
+            {"core_ms", &g_startup.core_ns},
+            {"segmentation_ms", &g_startup.segmentation_ns},
+            {"face_detection_ms", &g_startup.face_detection_ns},
+            {"warm_up_ms", &g_startup.warm_up_ns},
+        };
+        for (const auto& step : steps) {
+            const int64_t ns = step.second->load();
+            report << "\"" << step.first << "\":";
+            if (ns < 0) report << "null,";
+            else report << static_cast<double>(ns) / 1e6 << ",";
+        }
+        report << "\"on_demand\":" << (g_startup.engines_on_demand.load() ? "true" : "false")
+               << ",\"threads\":" << blur_get_thread_count() << "},\"core\":";
+        std::string core(static_cast<size_t>(blur_stats_json(nullptr, 0)) + 1, '\0');
+        core.resize(static_cast<size_t>(blur_stats_json(&core[0], static_cast<int>(core.size()))));
+        report << core << ",\"governor\":" << GovernorJson() << "}";
         return report.str();
     }
 
-    // Optimize processing pipeline for specific image sizes
-    void OptimizePipelineForSize(int width, int height) {
-        if (!initialized_) return;
-        
-        // Adjust thread pool size based on image size
-        const size_t image_pixels = width * height;
-        const size_t threshold_hd = 1920 * 1080;
-        const size_t threshold_4k = 3840 * 2160;
-        
-        if (image_pixels > threshold_4k) {
-            LOGI("PerformanceOptimizationEngine: Optimizing for 4K+ images");
-            // Increase GPU usage for large images
-            OptimizeGPUMemory();
-        } else if (image_pixels > threshold_hd) {
-            LOGI("PerformanceOptimizationEngine: Optimizing for HD images");
-        } else {
-            LOGI("PerformanceOptimizationEngine: Optimizing for standard images");
+    // Where a blur over an image of this size runs: the fastest backend the
+    // governor measured for it (blur_governor_route), under the current
+    // thermal / battery pressure
+    BlurRoute OptimizePipelineForSize(int width, int height, int mode = 2, int strength = 8) {
+        BlurRoute route = {BLUR_BACKEND_SIMD, 1, -1};
+        if (!initialized_ || blur_governor_route(width, height, BLUR_FORMAT_RGBA8888, mode, strength, &route) != 0) {
+            return route;
         }
+        static const char* const kBackends[] = {"scalar", "simd", "threaded", "gpu"};
+        LOGI("PerformanceOptimizationEngine: %dx%d runs on %s (%d threads, estimate %.1fms, pressure %d)",
+             width, height, kBackends[route.backend], route.threads, route.estimate_ns / 1e6,
+             blur_governor_pressure());
+        return route;
     }
 
     void Cleanup() {
@@ -1347,16 +1404,13 @@ public:
             
             should_stop_.store(true);
             
-            if (memory_pool_) {
-                memory_pool_->cleanup();
-                memory_pool_.reset();
-            }
+            blur_memory_trim(0);
             
             if (thread_pool_) {
                 thread_pool_.reset();
             }
             
-            LOGI("PerformanceOptimizationEngine: Performance Report:\\n%s", 
+            LOGI("PerformanceOptimizationEngine: Performance Report: %s", 
                  GetPerformanceReport().c_str());
             
             initialized_ = false;
@@ -1366,11 +1420,51 @@ public:
 
 // Global instances
 static std::unique_ptr<MediaPipeSegmenter> g_segmenter = nullptr;
+static std::unique_ptr<FaceDetector> g_face_detector = nullptr;
 static std::unique_ptr<OpenCVBlurEngine> g_blur_engine = nullptr;
 static std::unique_ptr<AdvancedMaskProcessor> g_mask_processor = nullptr;
 static std::unique_ptr<SmartCompositingEngine> g_compositing_engine = nullptr;
 static std::unique_ptr<PerformanceOptimizationEngine> g_performance_engine = nullptr;
 
+// The engines are built exactly once, by warmUp on a background thread or
+// else by the first request. Cleanup only releases what they hold; the next
+// call initializes them again in place, so the pointers never change once set.
+static std::once_flag g_engines_once;
+static std::mutex g_engines_mutex;
+static std::atomic<bool> g_engines_ready{false};
+
+static void EnsureEngines(bool warm_up = false) {
+    std::call_once(g_engines_once, [] {
+        g_segmenter = std::make_unique<MediaPipeSegmenter>();
+        g_face_detector = std::make_unique<FaceDetector>();
+        g_blur_engine = std::make_unique<OpenCVBlurEngine>();
+        g_mask_processor = std::make_unique<AdvancedMaskProcessor>();
+        g_compositing_engine = std::make_unique<SmartCompositingEngine>();
+        g_performance_engine = std::make_unique<PerformanceOptimizationEngine>();
+    });
+    if (g_engines_ready.load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(g_engines_mutex);
+    if (g_engines_ready.load(std::memory_order_relaxed)) return;
+    const auto start = std::chrono::steady_clock::now();
+    g_blur_engine->Initialize();
+    g_compositing_engine->Initialize();
+    g_performance_engine->Initialize();
+    if (g_startup.engines_ns.load() < 0) g_startup.engines_on_demand.store(!warm_up);
+    StartupMetrics::Record(g_startup.engines_ns, ElapsedNs(start));
+    g_engines_ready.store(true, std::memory_order_release);
+}
+
+// Loads a model once and records how long the first load took
+template <typename Model>
+static bool LoadModelTimed(Model& model, const std::string& path, std::atomic<int64_t>& slot) {
+    if (model.IsInitialized()) return true;
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = model.Initialize(path);
+    if (ok) StartupMetrics::Record(slot, ElapsedNs(start));
+    return ok;
+}
+
 } // namespace blurcore
 
 extern "C" {
@@ -1400,69 +1494,422 @@ Java_com_example_blurapp_BlurCore_nativeGetVersion(JNIEnv *env, jobject) {
     version += " (OpenCV disabled - fallback mode)";
 #endif
 
-    return env->NewStringUTF(version.c_str());
+    return env->NewStringUTF(version.c_str());
+}
+
+// Phase 1: Check MediaPipe availability
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeIsMediaPipeAvailable(JNIEnv *env, jobject) {
+    LOGI("BlurCore: Checking MediaPipe availability");
+    
+    // Segmentation only needs the TFLite runtime that ships with the app
+    return blurcore::TfLiteApi::Get() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Startup: SIMD dispatch, worker pool, engines and (when given) both models,
+// once, on the caller's background thread. Either model path may be null.
+// Returns which models are ready: 1 segmentation, 2 face detection.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeWarmUp(JNIEnv *env, jobject, jstring segmentation_model,
+                                               jstring face_model) {
+    const auto start = std::chrono::steady_clock::now();
+    blurcore::StartupMetrics::Record(blurcore::g_startup.core_ns, blur_warm_up());
+    blurcore::EnsureEngines(true);
+    
+    auto load = [env](jstring model_path, auto& model, std::atomic<int64_t>& slot) {
+        if (model_path == nullptr) return model.IsInitialized();
+        const char* path_chars = env->GetStringUTFChars(model_path, nullptr);
+        std::string path(path_chars);
+        env->ReleaseStringUTFChars(model_path, path_chars);
+        return blurcore::LoadModelTimed(model, path, slot);
+    };
+    const bool segmentation = load(segmentation_model, *blurcore::g_segmenter, blurcore::g_startup.segmentation_ns);
+    const bool faces = load(face_model, *blurcore::g_face_detector, blurcore::g_startup.face_detection_ns);
+    
+    const int64_t elapsed = blurcore::ElapsedNs(start);
+    blurcore::StartupMetrics::Record(blurcore::g_startup.warm_up_ns, elapsed);
+    LOGI("BlurCore: Warm-up took %.1fms on %d threads (segmentation %s, faces %s)", elapsed / 1e6,
+         blur_get_thread_count(), segmentation ? "ready" : "not loaded", faces ? "ready" : "not loaded");
+    return (segmentation ? 1 : 0) | (faces ? 2 : 0);
+}
+
+// Phase 1: Initialize MediaPipe segmentation
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeInitializeSegmentation(JNIEnv *env, jobject, jstring model_path) {
+    LOGI("BlurCore: Initializing segmentation");
+    
+    blurcore::EnsureEngines();
+    
+    const char* path_chars = env->GetStringUTFChars(model_path, nullptr);
+    std::string path(path_chars);
+    env->ReleaseStringUTFChars(model_path, path_chars);
+    
+    bool success = blurcore::LoadModelTimed(*blurcore::g_segmenter, path, blurcore::g_startup.segmentation_ns);
+    LOGI("BlurCore: Segmentation initialization %s", success ? "succeeded" : "failed");
+    
+    return success ? JNI_TRUE : JNI_FALSE;
+}
+
+// Phase 1: Perform image segmentation
+JNIEXPORT jbyteArray JNICALL
+Java_com_example_blurapp_BlurCore_nativeSegmentImage(JNIEnv *env, jobject, jbyteArray image_bytes, jint width, jint height) {
+    LOGI("BlurCore: segmentImage called for %dx%d image", width, height);
+    
+    blurcore::EnsureEngines();
+    if (!blurcore::g_segmenter->IsInitialized()) {
+        LOGI("BlurCore: Segmenter not initialized, returning empty result");
+        return env->NewByteArray(0);
+    }
+    
+    const blurcore::PooledBuffer image_data = blurcore::CopyByteArray(env, image_bytes);
+    
+    // Perform segmentation
+    const blurcore::PooledBuffer mask_data = blurcore::g_segmenter->Segment(
+        image_data.data(), image_data.size(), width, height);
+    
+    // Convert result back to Java byte array
+    jbyteArray result = blurcore::ToByteArray(env, mask_data.data(), mask_data.size());
+    
+    LOGI("BlurCore: Segmentation returned %zu bytes", mask_data.size());
+    return result;
+}
+
+// Phase 1: Segment an ARGB_8888 Bitmap in place of a byte-array round trip.
+// The person mask (255 = person) lands in a direct ByteBuffer of at least
+// width*height bytes, so a caller can reuse one buffer for every frame.
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeSegmentBitmapInto(JNIEnv *env, jobject, jobject bitmap, jobject mask_buffer) {
+    blurcore::EnsureEngines();
+    if (!blurcore::g_segmenter->IsInitialized()) {
+        return JNI_FALSE;
+    }
+    
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!locked.pixels() || locked.channels() != 4) {
+        LOGE("BlurCore: Segmentation needs a lockable ARGB_8888 bitmap");
+        return JNI_FALSE;
+    }
+    uint8_t* mask = blurcore::DirectBufferPixels(env, mask_buffer,
+                                                 static_cast<int64_t>(locked.width()) * locked.height());
+    if (!mask) {
+        LOGE("BlurCore: Mask buffer must be direct and hold width*height bytes");
+        return JNI_FALSE;
+    }
+    
+    return blurcore::g_segmenter->SegmentInto(locked.pixels(), locked.width(), locked.height(), locked.stride(),
+                                              BLUR_FORMAT_RGBA8888, mask, locked.width())
+               ? JNI_TRUE : JNI_FALSE;
+}
+
+// Phase 1: Initialize native face detection
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeInitializeFaceDetection(JNIEnv *env, jobject, jstring model_path) {
+    blurcore::EnsureEngines();
+    
+    const char* path_chars = env->GetStringUTFChars(model_path, nullptr);
+    std::string path(path_chars);
+    env->ReleaseStringUTFChars(model_path, path_chars);
+    
+    return blurcore::LoadModelTimed(*blurcore::g_face_detector, path, blurcore::g_startup.face_detection_ns)
+               ? JNI_TRUE : JNI_FALSE;
+}
+
+// Phase 1: Detect faces in an ARGB_8888 Bitmap and blur them in place, one
+// call per frame. Returns the number of faces blurred or a negative status.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeBlurFacesBitmap(JNIEnv *env, jobject, jobject bitmap,
+                                                        jint mode, jint strength, jfloat padding) {
+    blurcore::EnsureEngines();
+    if (!blurcore::g_face_detector->IsInitialized()) {
+        return -6;
+    }
+    
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!locked.pixels() || locked.channels() != 4) {
+        LOGE("BlurCore: Face blur needs a lockable ARGB_8888 bitmap");
+        return -1;
+    }
+    return blurcore::g_face_detector->BlurFacesInPlace(locked.pixels(), locked.width(), locked.height(),
+                                                       locked.stride(), BLUR_FORMAT_RGBA8888,
+                                                       mode, strength, padding);
+}
+
+// Phase 1: Live preview / video. A stream runs the segmenter only on
+// keyframes and reuses unchanged tiles between frames (blur_stream_*).
+static int SegmenterDetect(void*, const uint8_t* pixels, int width, int height, int stride, int format,
+                           uint8_t* mask, int mask_stride) {
+    if (!blurcore::g_segmenter->SegmentInto(pixels, width, height, stride, format, mask, mask_stride)) {
+        return -6; // no mask for this frame
+    }
+    return 0;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeStreamCreate(JNIEnv *env, jobject, jint width, jint height,
+                                                     jint keyframe_interval, jint background_sigma) {
+    // Portrait preview: sharp person, gaussian background
+    blurcore::EnsureEngines();
+    const BlurStreamConfig config = {keyframe_interval, 24, 4, 160, 2, 0, background_sigma};
+    BlurStream* stream = blur_stream_create(width, height, BLUR_FORMAT_RGBA8888, &config);
+    LOGI("BlurCore: Blur stream %dx%d %s", width, height, stream ? "created" : "failed");
+    return reinterpret_cast<jlong>(stream);
+}
+
+// frame: direct ByteBuffer of RGBA rows (row_stride bytes each), blurred in place
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeStreamProcess(JNIEnv *env, jobject, jlong handle,
+                                                      jobject frame, jint height, jint row_stride) {
+    BlurStream* stream = reinterpret_cast<BlurStream*>(handle);
+    uint8_t* pixels = blurcore::DirectBufferPixels(env, frame, static_cast<int64_t>(row_stride) * height);
+    if (!stream || !pixels) return -1;
+    return blur_stream_process(stream, pixels, row_stride, SegmenterDetect, nullptr);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeStreamDestroy(JNIEnv *env, jobject, jlong handle) {
+    blur_stream_destroy(reinterpret_cast<BlurStream*>(handle));
+}
+
+// Batch export: decode -> detect faces -> blur -> encode over a list of
+// files on native stage threads (blur_batch_*). Kotlin polls progress.
+struct BatchExportJob {
+    std::vector<std::string> outputs;
+    std::vector<blurcore::ImageCodecs::Format> formats;
+    int quality = 90;
+    float padding = 0.25f;
+    BlurBatch* batch = nullptr;
+};
+
+static int BatchDecode(void*, int, const char* path, BlurBatchImage* image) {
+    uint8_t* pixels = nullptr;
+    int width = 0, height = 0, stride = 0;
+    if (!blurcore::ImageCodecs::Get()->Decode(path, &pixels, &width, &height, &stride)) {
+        LOGE("BlurCore: Batch could not decode %s", path);
+        return -7;
+    }
+    *image = {pixels, width, height, stride, BLUR_FORMAT_RGBA8888, nullptr};
+    return 0;
+}
+
+static int BatchDetectFaces(void* user, int, const BlurBatchImage* image, BlurRect* rects, int max_rects) {
+    const BatchExportJob* job = static_cast<const BatchExportJob*>(user);
+    return blurcore::g_face_detector->DetectInto(image->pixels, image->width, image->height, image->stride,
+                                                 image->format, job->padding, rects, max_rects);
+}
+
+static int BatchEncode(void* user, int index, const BlurBatchImage* image) {
+    const BatchExportJob* job = static_cast<const BatchExportJob*>(user);
+    if (!blurcore::ImageCodecs::Get()->Encode(job->outputs[index].c_str(), job->formats[index], job->quality,
+                                              image->pixels, image->width, image->height, image->stride)) {
+        LOGE("BlurCore: Batch could not write %s", job->outputs[index].c_str());
+        return -8;
+    }
+    return 0;
+}
+
+static void BatchRelease(void*, int, BlurBatchImage* image) {
+    std::free(image->pixels);
+}
+
+// inputs/outputs: parallel String arrays of file paths; outputs ending in
+// .png are written as PNG, everything else as JPEG at quality. Faces are
+// detected per image when detect_faces is set (needs
+// nativeInitializeFaceDetection), otherwise whole images are blurred.
+// Returns a handle for nativeBatchProgress/Cancel/Wait/Release, or 0 if native
+// codecs are unavailable (API < 30) or the arguments are bad.
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeBatchStart(JNIEnv *env, jobject, jobjectArray inputs, jobjectArray outputs,
+                                                   jint mode, jint strength, jboolean detect_faces,
+                                                   jfloat padding, jint quality) {
+    if (!blurcore::ImageCodecs::Get()) {
+        LOGI("BlurCore: Native codecs unavailable, batch export not started");
+        return 0;
+    }
+    const jsize count = inputs ? env->GetArrayLength(inputs) : 0;
+    if (count <= 0 || !outputs || env->GetArrayLength(outputs) != count) return 0;
+    blurcore::EnsureEngines();
+    if (detect_faces && !blurcore::g_face_detector->IsInitialized()) {
+        return 0;
+    }
+    
+    auto job = std::make_unique<BatchExportJob>();
+    job->quality = std::min(std::max(static_cast<int>(quality), 0), 100);
+    job->padding = padding;
+    std::vector<std::string> input_paths;
+    for (jsize i = 0; i < count; ++i) {
+        for (int side = 0; side < 2; ++side) {
+            jstring str = static_cast<jstring>(env->GetObjectArrayElement(side == 0 ? inputs : outputs, i));
+            if (!str) return 0;
+            const char* chars = env->GetStringUTFChars(str, nullptr);
+            std::string path(chars);
+            env->ReleaseStringUTFChars(str, chars);
+            env->DeleteLocalRef(str);
+            if (side == 0) {
+                input_paths.push_back(std::move(path));
+            } else {
+                const bool png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+                job->formats.push_back(png ? blurcore::ImageCodecs::kPng : blurcore::ImageCodecs::kJpeg);
+                job->outputs.push_back(std::move(path));
+            }
+        }
+    }
+    std::vector<const char*> paths;
+    for (const std::string& path : input_paths) paths.push_back(path.c_str());
+    
+    // Three photos in flight bounds memory to a few full-size decodes
+    const BlurBatchSpec spec = {mode, strength, nullptr, 0, 3, static_cast<int64_t>(192) << 20};
+    const BlurBatchCallbacks callbacks = {BatchDecode, detect_faces ? BatchDetectFaces : nullptr,
+                                          BatchEncode, BatchRelease, nullptr, job.get()};
+    job->batch = blur_batch_start(paths.data(), count, &spec, &callbacks);
+    if (!job->batch) return 0;
+    LOGI("BlurCore: Batch export of %d images started", count);
+    return reinterpret_cast<jlong>(job.release());
+}
+
+// returns {done, failed, total, finished (0/1)}
+JNIEXPORT jintArray JNICALL
+Java_com_example_blurapp_BlurCore_nativeBatchProgress(JNIEnv *env, jobject, jlong handle) {
+    const BatchExportJob* job = reinterpret_cast<const BatchExportJob*>(handle);
+    jint values[4] = {0, 0, 0, 1};
+    if (job) {
+        values[3] = blur_batch_progress(job->batch, &values[0], &values[1]);
+        values[2] = static_cast<jint>(job->outputs.size());
+    }
+    jintArray result = env->NewIntArray(4);
+    if (result) env->SetIntArrayRegion(result, 0, 4, values);
+    return result;
 }
 
-// Phase 1: Check MediaPipe availability
-JNIEXPORT jboolean JNICALL
-Java_com_example_blurapp_BlurCore_nativeIsMediaPipeAvailable(JNIEnv *env, jobject) {
-    LOGI("BlurCore: Checking MediaPipe availability");
-    
-#ifdef ENABLE_MEDIAPIPE
-    return JNI_TRUE;
-#else
-    return JNI_FALSE;
-#endif
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeBatchCancel(JNIEnv *env, jobject, jlong handle) {
+    const BatchExportJob* job = reinterpret_cast<const BatchExportJob*>(handle);
+    if (job) blur_batch_cancel(job->batch);
 }
 
-// Phase 1: Initialize MediaPipe segmentation
-JNIEXPORT jboolean JNICALL
-Java_com_example_blurapp_BlurCore_nativeInitializeSegmentation(JNIEnv *env, jobject, jstring model_path) {
-    LOGI("BlurCore: Initializing segmentation");
-    
-    if (blurcore::g_segmenter == nullptr) {
-        blurcore::g_segmenter = std::make_unique<blurcore::MediaPipeSegmenter>();
+// Block until the job finishes; safe off the calling thread while progress
+// is polled. Returns the blur_batch_wait status.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeBatchWait(JNIEnv *env, jobject, jlong handle) {
+    BatchExportJob* job = reinterpret_cast<BatchExportJob*>(handle);
+    return job ? blur_batch_wait(job->batch) : -1;
+}
+
+// Free the job (cancelling it if still running). The handle is invalid after.
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeBatchRelease(JNIEnv *env, jobject, jlong handle) {
+    std::unique_ptr<BatchExportJob> job(reinterpret_cast<BatchExportJob*>(handle));
+    if (job) blur_batch_destroy(job->batch);
+}
+
+// Large photo export: blur_apply_strips pulls RGBA rows from a Kotlin
+// StripSource and pushes finished rows to a StripSink, so a 100+ MP image
+// never has to be decoded whole. The rows are lent to Kotlin as direct
+// ByteBuffers that are only valid during the callback.
+struct StripBridge {
+    JNIEnv* env;
+    jobject source;
+    jmethodID read;
+    jobject sink;
+    jmethodID write;
+};
+
+static int StripCall(JNIEnv* env, jobject target, jmethodID method, int y, int rows,
+                     const uint8_t* data, int stride, int failure) {
+    jobject buffer = env->NewDirectByteBuffer(const_cast<uint8_t*>(data), static_cast<jlong>(stride) * rows);
+    if (!buffer) {
+        if (env->ExceptionCheck()) env->ExceptionClear();
+        return -3;
     }
-    
-    const char* path_chars = env->GetStringUTFChars(model_path, nullptr);
-    std::string path(path_chars);
-    env->ReleaseStringUTFChars(model_path, path_chars);
-    
-    bool success = blurcore::g_segmenter->Initialize(path);
-    LOGI("BlurCore: Segmentation initialization %s", success ? "succeeded" : "failed");
-    
-    return success ? JNI_TRUE : JNI_FALSE;
+    const jboolean ok = env->CallBooleanMethod(target, method, y, rows, buffer);
+    env->DeleteLocalRef(buffer);
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        return failure;
+    }
+    return ok ? 0 : failure;
 }
 
-// Phase 1: Perform image segmentation
-JNIEXPORT jbyteArray JNICALL
-Java_com_example_blurapp_BlurCore_nativeSegmentImage(JNIEnv *env, jobject, jbyteArray image_bytes, jint width, jint height) {
-    LOGI("BlurCore: segmentImage called for %dx%d image", width, height);
-    
-    if (blurcore::g_segmenter == nullptr || !blurcore::g_segmenter->IsInitialized()) {
-        LOGI("BlurCore: Segmenter not initialized, returning empty result");
-        return env->NewByteArray(0);
+static int StripRead(void* user, int y, int rows, uint8_t* dst, int stride) {
+    const StripBridge* bridge = static_cast<const StripBridge*>(user);
+    return StripCall(bridge->env, bridge->source, bridge->read, y, rows, dst, stride, -7);
+}
+
+static int StripWrite(void* user, int y, int rows, const uint8_t* src, int stride) {
+    const StripBridge* bridge = static_cast<const StripBridge*>(user);
+    return StripCall(bridge->env, bridge->sink, bridge->write, y, rows, src, stride, -8);
+}
+
+// rects: x, y, w, h quadruples in image pixels. Blocks the calling thread.
+// Returns 0, -7 if the source failed, -8 if the sink failed, or a
+// blur_apply_strips status.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeBlurStrips(JNIEnv *env, jobject, jint width, jint height,
+                                                   jintArray rects, jint mode, jint strength, jint strip_rows,
+                                                   jobject source, jobject sink) {
+    if (!source || !sink) return -1;
+    std::vector<BlurRect> regions;
+    if (rects) {
+        const jsize n = env->GetArrayLength(rects) / 4;
+        std::vector<jint> values(static_cast<size_t>(n) * 4);
+        if (n > 0) env->GetIntArrayRegion(rects, 0, n * 4, values.data());
+        for (jsize i = 0; i < n; ++i) {
+            regions.push_back({values[i * 4], values[i * 4 + 1], values[i * 4 + 2], values[i * 4 + 3]});
+        }
     }
-    
-    // Convert Java byte array to C++ vector
-    jsize input_length = env->GetArrayLength(image_bytes);
-    jbyte* input_data = env->GetByteArrayElements(image_bytes, nullptr);
-    
-    std::vector<uint8_t> image_data(input_data, input_data + input_length);
-    env->ReleaseByteArrayElements(image_bytes, input_data, JNI_ABORT);
-    
-    // Perform segmentation
-    auto mask_data = blurcore::g_segmenter->Segment(image_data, width, height);
-    
-    // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(mask_data.size());
-    if (!mask_data.empty()) {
-        env->SetByteArrayRegion(result, 0, mask_data.size(), 
-                               reinterpret_cast<const jbyte*>(mask_data.data()));
+    jclass source_class = env->GetObjectClass(source);
+    jclass sink_class = env->GetObjectClass(sink);
+    StripBridge bridge = {env, source, env->GetMethodID(source_class, "read", "(IILjava/nio/ByteBuffer;)Z"),
+                          sink, env->GetMethodID(sink_class, "write", "(IILjava/nio/ByteBuffer;)Z")};
+    env->DeleteLocalRef(source_class);
+    env->DeleteLocalRef(sink_class);
+    if (!bridge.read || !bridge.write) {
+        if (env->ExceptionCheck()) env->ExceptionClear();
+        return -1;
+    }
+
+    const int status = blur_apply_strips(nullptr, width, height, BLUR_FORMAT_RGBA8888,
+                                         regions.data(), static_cast<int>(regions.size()), mode, strength,
+                                         strip_rows, StripRead, StripWrite, &bridge);
+    LOGI("BlurCore: Strip blur %dx%d finished with status %d", width, height, status);
+    return status;
+}
+
+// JPEG export without a full decode: blur_jpeg_redact rewrites only the
+// 8x8 blocks under the rects and copies the rest of the file's blocks.
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeJpegRedactAvailable(JNIEnv *, jobject) {
+    return blur_jpeg_available() ? JNI_TRUE : JNI_FALSE;
+}
+
+// rects: x, y, w, h quadruples in image pixels. Blocks the calling thread.
+// Returns the blur_jpeg_redact status.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeRedactJpeg(JNIEnv *env, jobject, jstring input, jstring output,
+                                                   jintArray rects, jint mode, jint strength, jboolean keep_metadata) {
+    if (!input || !output) return -1;
+    std::vector<BlurRect> regions;
+    if (rects) {
+        const jsize n = env->GetArrayLength(rects) / 4;
+        std::vector<jint> values(static_cast<size_t>(n) * 4);
+        if (n > 0) env->GetIntArrayRegion(rects, 0, n * 4, values.data());
+        for (jsize i = 0; i < n; ++i) {
+            regions.push_back({values[i * 4], values[i * 4 + 1], values[i * 4 + 2], values[i * 4 + 3]});
+        }
     }
-    
-    LOGI("BlurCore: Segmentation returned %zu bytes", mask_data.size());
-    return result;
+    const char* in_path = env->GetStringUTFChars(input, nullptr);
+    const char* out_path = env->GetStringUTFChars(output, nullptr);
+    BlurJpegStats stats = {};
+    int status = -1;
+    if (in_path && out_path) {
+        status = blur_jpeg_redact(in_path, out_path, regions.data(), static_cast<int>(regions.size()), mode, strength,
+                                  keep_metadata ? BLUR_JPEG_COPY_METADATA : 0, &stats);
+    }
+    if (in_path) env->ReleaseStringUTFChars(input, in_path);
+    if (out_path) env->ReleaseStringUTFChars(output, out_path);
+    LOGI("BlurCore: JPEG redaction finished with status %d (%d rows decoded, %lld/%lld blocks rewritten)",
+         status, stats.rows_decoded, static_cast<long long>(stats.blocks_rewritten),
+         static_cast<long long>(stats.blocks_total));
+    return status;
 }
 
 // Phase 2: Enhanced image processing with OpenCV blur engine
@@ -1470,20 +1917,13 @@ JNIEXPORT jbyteArray JNICALL
 Java_com_example_blurapp_BlurCore_nativeProcessImageBasic(JNIEnv *env, jobject, jbyteArray input_bytes, jint blur_strength) {
     LOGI("BlurCore: Enhanced processing with strength %d", blur_strength);
     
-    // Initialize blur engine if needed
-    if (blurcore::g_blur_engine == nullptr) {
-        blurcore::g_blur_engine = std::make_unique<blurcore::OpenCVBlurEngine>();
-        blurcore::g_blur_engine->Initialize();
-    }
-    
-    jsize input_length = env->GetArrayLength(input_bytes);
-    jbyte* input_data = env->GetByteArrayElements(input_bytes, nullptr);
+    blurcore::EnsureEngines();
     
-    // Convert to std::vector for processing
-    std::vector<uint8_t> image_data(input_data, input_data + input_length);
-    env->ReleaseByteArrayElements(input_bytes, input_data, JNI_ABORT);
+    blurcore::PooledBuffer image_data = blurcore::CopyByteArray(env, input_bytes);
+    if (!image_data) return env->NewByteArray(0);
+    const size_t input_length = image_data.size();
     
-    std::vector<uint8_t> processed_data;
+    blurcore::PooledBuffer processed_data;
     
     if (blurcore::g_blur_engine && blurcore::g_blur_engine->IsInitialized() && blur_strength > 0) {
         // Phase 2: Use OpenCV for high-quality blur
@@ -1498,20 +1938,19 @@ Java_com_example_blurapp_BlurCore_nativeProcessImageBasic(JNIEnv *env, jobject,
         // For Phase 2, we'll use estimated dimensions
         // In Phase 3, we'll add proper image format detection
         processed_data = blurcore::g_blur_engine->ApplyGaussianBlur(
-            image_data, estimated_width, estimated_height, 4, sigma, 0);
+            image_data.data(), input_length, estimated_width, estimated_height, 4, sigma, 0);
             
         LOGI("BlurCore: OpenCV blur applied (sigma: %.2f, GPU: %s)", 
              sigma, blurcore::g_blur_engine->IsGPUAvailable() ? "yes" : "no");
-    } else {
+    }
+    if (!processed_data) {
         // Fallback: return original data
-        processed_data = image_data;
+        processed_data = std::move(image_data);
         LOGI("BlurCore: Using fallback mode");
     }
     
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(processed_data.size());
-    env->SetByteArrayRegion(result, 0, processed_data.size(), 
-                           reinterpret_cast<const jbyte*>(processed_data.data()));
+    jbyteArray result = blurcore::ToByteArray(env, processed_data.data(), processed_data.size());
     
     LOGI("BlurCore: Enhanced processing completed (%zu bytes)", processed_data.size());
     return result;
@@ -1525,33 +1964,23 @@ Java_com_example_blurapp_BlurCore_nativeApplyAdvancedBlur(JNIEnv *env, jobject,
                                                          jdouble sigma, jint blur_type) {
     LOGI("BlurCore: Advanced blur (%dx%d, sigma=%.2f, type=%d)", width, height, sigma, blur_type);
     
-    // Initialize blur engine if needed
-    if (blurcore::g_blur_engine == nullptr) {
-        blurcore::g_blur_engine = std::make_unique<blurcore::OpenCVBlurEngine>();
-        blurcore::g_blur_engine->Initialize();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_blur_engine || !blurcore::g_blur_engine->IsInitialized()) {
         LOGE("BlurCore: Blur engine not available");
         return env->NewByteArray(0);
     }
     
-    jsize input_length = env->GetArrayLength(input_bytes);
-    jbyte* input_data = env->GetByteArrayElements(input_bytes, nullptr);
+    blurcore::PooledBuffer image_data = blurcore::CopyByteArray(env, input_bytes);
+    if (!image_data) return env->NewByteArray(0);
     
-    std::vector<uint8_t> image_data(input_data, input_data + input_length);
-    env->ReleaseByteArrayElements(input_bytes, input_data, JNI_ABORT);
-    
-    // Apply advanced blur
-    auto result_data = blurcore::g_blur_engine->ApplyGaussianBlur(
-        image_data, width, height, channels, sigma, blur_type);
+    // Apply advanced blur; the input goes back unchanged if it fails
+    blurcore::PooledBuffer result_data = blurcore::g_blur_engine->ApplyGaussianBlur(
+        image_data.data(), image_data.size(), width, height, channels, sigma, blur_type);
+    if (!result_data) result_data = std::move(image_data);
     
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(result_data.size());
-    env->SetByteArrayRegion(result, 0, result_data.size(), 
-                           reinterpret_cast<const jbyte*>(result_data.data()));
-    
-    return result;
+    return blurcore::ToByteArray(env, result_data.data(), result_data.size());
 }
 
 // Phase 2: Selective blur using segmentation mask
@@ -1563,39 +1992,109 @@ Java_com_example_blurapp_BlurCore_nativeApplySelectiveBlur(JNIEnv *env, jobject,
                                                           jdouble fg_sigma, jdouble bg_sigma) {
     LOGI("BlurCore: Selective blur (%dx%d, fg=%.2f, bg=%.2f)", width, height, fg_sigma, bg_sigma);
     
-    // Initialize blur engine if needed
-    if (blurcore::g_blur_engine == nullptr) {
-        blurcore::g_blur_engine = std::make_unique<blurcore::OpenCVBlurEngine>();
-        blurcore::g_blur_engine->Initialize();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_blur_engine || !blurcore::g_blur_engine->IsInitialized()) {
         LOGE("BlurCore: Blur engine not available");
         return env->NewByteArray(0);
     }
     
-    // Get image data
-    jsize input_length = env->GetArrayLength(input_bytes);
-    jbyte* input_data = env->GetByteArrayElements(input_bytes, nullptr);
-    std::vector<uint8_t> image_data(input_data, input_data + input_length);
-    env->ReleaseByteArrayElements(input_bytes, input_data, JNI_ABORT);
+    blurcore::PooledBuffer image_data = blurcore::CopyByteArray(env, input_bytes);
+    const blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
     
-    // Get mask data
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_data = env->GetByteArrayElements(mask_bytes, nullptr);
-    std::vector<uint8_t> mask_vector(mask_data, mask_data + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_data, JNI_ABORT);
-    
-    // Apply selective blur
-    auto result_data = blurcore::g_blur_engine->ApplySelectiveBlur(
-        image_data, mask_vector, width, height, channels, fg_sigma, bg_sigma);
+    // Apply selective blur; the input goes back unchanged if it fails
+    blurcore::PooledBuffer result_data = blurcore::g_blur_engine->ApplySelectiveBlur(
+        image_data.data(), image_data.size(), mask_data.data(), mask_data.size(),
+        width, height, channels, fg_sigma, bg_sigma);
+    if (!result_data) result_data = std::move(image_data);
     
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(result_data.size());
-    env->SetByteArrayRegion(result, 0, result_data.size(), 
-                           reinterpret_cast<const jbyte*>(result_data.data()));
+    return blurcore::ToByteArray(env, result_data.data(), result_data.size());
+}
+
+// Phase 2: Zero-copy advanced blur on an ARGB_8888 or ALPHA_8 Bitmap,
+// written back into the Bitmap's own pixels
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeApplyAdvancedBlurBitmap(JNIEnv *env, jobject,
+                                                               jobject bitmap,
+                                                               jdouble sigma, jint blur_type) {
+    blurcore::EnsureEngines();
     
-    return result;
+    if (!blurcore::g_blur_engine || !blurcore::g_blur_engine->IsInitialized()) {
+        LOGE("BlurCore: Blur engine not available");
+        return JNI_FALSE;
+    }
+    
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!locked.pixels()) {
+        LOGE("BlurCore: Bitmap must be ARGB_8888 or ALPHA_8 and lockable");
+        return JNI_FALSE;
+    }
+    
+    LOGI("BlurCore: Advanced blur in place (%dx%d, sigma=%.2f, type=%d)",
+         locked.width(), locked.height(), sigma, blur_type);
+    
+    return blurcore::g_blur_engine->ApplyGaussianBlurInPlace(
+        locked.pixels(), locked.width(), locked.height(), locked.stride(),
+        locked.channels(), sigma, blur_type) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Phase 2: Zero-copy advanced blur on a direct ByteBuffer of packed pixels
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeApplyAdvancedBlurBuffer(JNIEnv *env, jobject,
+                                                               jobject buffer,
+                                                               jint width, jint height, jint channels,
+                                                               jdouble sigma, jint blur_type) {
+    blurcore::EnsureEngines();
+    
+    if (!blurcore::g_blur_engine || !blurcore::g_blur_engine->IsInitialized()) {
+        LOGE("BlurCore: Blur engine not available");
+        return JNI_FALSE;
+    }
+    
+    uint8_t* pixels = blurcore::DirectBufferPixels(
+        env, buffer, static_cast<int64_t>(width) * height * channels);
+    if (!pixels || width <= 0 || height <= 0) {
+        LOGE("BlurCore: Expected a direct ByteBuffer of %dx%dx%d bytes", width, height, channels);
+        return JNI_FALSE;
+    }
+    
+    return blurcore::g_blur_engine->ApplyGaussianBlurInPlace(
+        pixels, width, height, width * channels, channels, sigma, blur_type) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Phase 2: Zero-copy selective blur on a Bitmap, mask in a direct ByteBuffer
+// (one byte per pixel, tightly packed)
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeApplySelectiveBlurBitmap(JNIEnv *env, jobject,
+                                                                jobject bitmap, jobject mask_buffer,
+                                                                jdouble fg_sigma, jdouble bg_sigma) {
+    blurcore::EnsureEngines();
+    
+    if (!blurcore::g_blur_engine || !blurcore::g_blur_engine->IsInitialized()) {
+        LOGE("BlurCore: Blur engine not available");
+        return JNI_FALSE;
+    }
+    
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!locked.pixels()) {
+        LOGE("BlurCore: Bitmap must be ARGB_8888 or ALPHA_8 and lockable");
+        return JNI_FALSE;
+    }
+    
+    const uint8_t* mask = blurcore::DirectBufferPixels(
+        env, mask_buffer, static_cast<int64_t>(locked.width()) * locked.height());
+    if (!mask) {
+        LOGE("BlurCore: Mask must be a direct ByteBuffer of %dx%d bytes", locked.width(), locked.height());
+        return JNI_FALSE;
+    }
+    
+    LOGI("BlurCore: Selective blur in place (%dx%d, fg=%.2f, bg=%.2f)",
+         locked.width(), locked.height(), fg_sigma, bg_sigma);
+    
+    return blurcore::g_blur_engine->ApplySelectiveBlurInPlace(
+        locked.pixels(), locked.stride(), mask, locked.width(),
+        locked.width(), locked.height(), locked.channels(), fg_sigma, bg_sigma) ? JNI_TRUE : JNI_FALSE;
 }
 
 // Phase 2: Check OpenCV availability
@@ -1615,46 +2114,284 @@ JNIEXPORT jboolean JNICALL
 Java_com_example_blurapp_BlurCore_nativeIsGPUAvailable(JNIEnv *env, jobject) {
     LOGI("BlurCore: Checking GPU availability");
     
-    if (blurcore::g_blur_engine == nullptr) {
-        blurcore::g_blur_engine = std::make_unique<blurcore::OpenCVBlurEngine>();
-        blurcore::g_blur_engine->Initialize();
-    }
+    blurcore::EnsureEngines();
     
+    if (blur_gpu_available()) {
+        return JNI_TRUE; // resident GLES compute backend
+    }
     return (blurcore::g_blur_engine && blurcore::g_blur_engine->IsGPUAvailable()) ? JNI_TRUE : JNI_FALSE;
 }
 
+// Phase 2: Upload an ARGB_8888 Bitmap once into a resident GPU image.
+// Returns an opaque handle, 0 if the GPU backend is unavailable.
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeGpuImageCreate(JNIEnv *env, jobject, jobject bitmap) {
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!locked.pixels() || locked.channels() != 4) {
+        LOGE("BlurCore: GPU image needs a lockable ARGB_8888 bitmap");
+        return 0;
+    }
+    
+    BlurGpuImage* image = blur_gpu_image_create(locked.pixels(), locked.width(), locked.height(), locked.stride());
+    LOGI("BlurCore: GPU image %dx%d %s", locked.width(), locked.height(), image ? "created" : "unavailable");
+    return reinterpret_cast<jlong>(image);
+}
+
+// Phase 2: Re-blur the resident source on the GPU; nothing is transferred
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeGpuApply(JNIEnv *env, jobject, jlong handle,
+                                                 jintArray rects, jint mode, jint strength) {
+    BlurGpuImage* image = reinterpret_cast<BlurGpuImage*>(handle);
+    if (!image || !rects) return -1;
+    
+    // rects packed as [x,y,w,h]*N
+    const jsize len = env->GetArrayLength(rects);
+    std::vector<BlurRect> rs(len / 4);
+    jint* arr = env->GetIntArrayElements(rects, nullptr);
+    for (size_t i = 0; i < rs.size(); ++i) {
+        rs[i] = {arr[i * 4 + 0], arr[i * 4 + 1], arr[i * 4 + 2], arr[i * 4 + 3]};
+    }
+    env->ReleaseIntArrayElements(rects, arr, JNI_ABORT);
+    
+    return blur_gpu_apply_regions(image, rs.data(), static_cast<int>(rs.size()), mode, strength);
+}
+
+// Phase 2: Read the GPU result back into an ARGB_8888 Bitmap (export path)
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeGpuRead(JNIEnv *env, jobject, jlong handle, jobject bitmap) {
+    BlurGpuImage* image = reinterpret_cast<BlurGpuImage*>(handle);
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!image || !locked.pixels() || locked.channels() != 4) return -1;
+    return blur_gpu_image_read(image, locked.pixels(), locked.stride());
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeGpuImageDestroy(JNIEnv *env, jobject, jlong handle) {
+    blur_gpu_image_destroy(reinterpret_cast<BlurGpuImage*>(handle));
+}
+
+// Editing session: the bitmap is copied into native memory once; masks,
+// renders and blurred layers stay there until nativeSessionExport
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionOpen(JNIEnv *env, jobject, jobject bitmap) {
+    blurcore::LockedBitmap locked(env, bitmap);
+    if (!locked.pixels()) {
+        LOGE("BlurCore: Session needs a lockable ARGB_8888 or ALPHA_8 bitmap");
+        return 0;
+    }
+    
+    BlurSession* session = blur_session_open(locked.pixels(), locked.width(), locked.height(), locked.stride(),
+                                             locked.channels() == 4 ? BLUR_FORMAT_RGBA8888 : BLUR_FORMAT_GRAY8);
+    LOGI("BlurCore: Session %dx%d %s", locked.width(), locked.height(), session ? "opened" : "failed");
+    return reinterpret_cast<jlong>(session);
+}
+
+// Copies the mask straight into the session; null starts an empty mask.
+// Returns the mask id, or a negative status
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionAddMask(JNIEnv *env, jobject, jlong handle, jbyteArray mask_bytes) {
+    BlurSession* session = reinterpret_cast<BlurSession*>(handle);
+    int width = 0, height = 0;
+    if (blur_session_size(session, &width, &height) != 0) return -1;
+    const jsize size = width * height;
+    if (mask_bytes && env->GetArrayLength(mask_bytes) < size) return -1;
+    
+    const int id = blur_session_add_mask(session, nullptr, 0);
+    if (id > 0 && mask_bytes) {
+        blurcore::StageScope stage(BLUR_STAGE_COPY_IN, size);
+        env->GetByteArrayRegion(mask_bytes, 0, size, reinterpret_cast<jbyte*>(blur_session_mask(session, id)));
+    }
+    return id;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionRemoveMask(JNIEnv *env, jobject, jlong handle, jint mask_id) {
+    return blur_session_remove_mask(reinterpret_cast<BlurSession*>(handle), mask_id);
+}
+
+// steps holds op, radius, param triples (BlurMaskStep)
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionProcessMask(JNIEnv *env, jobject, jlong handle, jint mask_id,
+                                                           jintArray steps) {
+    if (!steps) return -1;
+    const jsize count = env->GetArrayLength(steps) / 3;
+    std::vector<BlurMaskStep> list(static_cast<size_t>(count));
+    if (count > 0) env->GetIntArrayRegion(steps, 0, count * 3, reinterpret_cast<jint*>(list.data()));
+    return blur_session_process_mask(reinterpret_cast<BlurSession*>(handle), mask_id, list.data(), count);
+}
+
+// points packed as [x,y]*N in image pixels
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionPaintMask(JNIEnv *env, jobject, jlong handle, jint mask_id,
+                                                         jfloatArray points, jfloat radius, jboolean erase) {
+    if (!points) return -1;
+    const jsize count = env->GetArrayLength(points) / 2;
+    std::vector<float> xy(static_cast<size_t>(count) * 2);
+    if (count > 0) env->GetFloatArrayRegion(points, 0, count * 2, xy.data());
+    return blur_session_paint_mask(reinterpret_cast<BlurSession*>(handle), mask_id, xy.data(), count, radius,
+                                   erase ? 1 : 0);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionRenderMasked(JNIEnv *env, jobject, jlong handle, jint mask_id,
+                                                            jint mode, jint fg_strength, jint bg_strength) {
+    return blur_session_render_masked(reinterpret_cast<BlurSession*>(handle), mask_id, mode, fg_strength,
+                                      bg_strength);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionRenderBlurred(JNIEnv *env, jobject, jlong handle, jint mode,
+                                                             jint strength, jboolean interpolate) {
+    return blur_session_render_blurred(reinterpret_cast<BlurSession*>(handle), mode, strength,
+                                       interpolate ? BLUR_SESSION_INTERPOLATE : 0);
+}
+
+// rects packed as [x,y,w,h]*N; none renders the original
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionRenderRegions(JNIEnv *env, jobject, jlong handle,
+                                                             jintArray rects, jint mode, jint strength) {
+    std::vector<BlurRect> rs(rects ? env->GetArrayLength(rects) / 4 : 0);
+    if (!rs.empty()) env->GetIntArrayRegion(rects, 0, static_cast<jsize>(rs.size() * 4), reinterpret_cast<jint*>(rs.data()));
+    return blur_session_render_regions(reinterpret_cast<BlurSession*>(handle), rs.data(),
+                                       static_cast<int>(rs.size()), mode, strength);
+}
+
+// Latest render into a bitmap of the session's size and format
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionExport(JNIEnv *env, jobject, jlong handle, jobject bitmap) {
+    BlurSession* session = reinterpret_cast<BlurSession*>(handle);
+    blurcore::LockedBitmap locked(env, bitmap);
+    int width = 0, height = 0;
+    if (!locked.pixels() || blur_session_size(session, &width, &height) != 0 ||
+        locked.width() != width || locked.height() != height) {
+        return -1;
+    }
+    return blur_session_export(session, locked.pixels(), locked.stride());
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionCancel(JNIEnv *env, jobject, jlong handle) {
+    blur_session_cancel(reinterpret_cast<BlurSession*>(handle));
+}
+
+// Asynchronous renders: blur_job_submit on the worker pool, finished through
+// JobListener.onJobDone(job, status) on a worker thread. Jobs tagged with
+// the session handle supersede the session's unfinished ones (a newer
+// slider position cancels the older render).
+struct JobListenerRef {
+    JavaVM* vm;
+    jobject listener; // global ref, dropped after the callback
+};
+
+static void JobDone(void* user, int64_t job, int status) {
+    JobListenerRef* ref = static_cast<JobListenerRef*>(user);
+    JNIEnv* env = nullptr;
+    const bool attached = ref->vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_EDETACHED;
+    if (attached && ref->vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        LOGE("BlurCore: Job %lld finished but no JVM thread to report on", static_cast<long long>(job));
+        delete ref;
+        return;
+    }
+    jclass cls = env->GetObjectClass(ref->listener);
+    jmethodID method = env->GetMethodID(cls, "onJobDone", "(JI)V");
+    if (method) env->CallVoidMethod(ref->listener, method, static_cast<jlong>(job), static_cast<jint>(status));
+    if (env->ExceptionCheck()) env->ExceptionClear();
+    env->DeleteLocalRef(cls);
+    env->DeleteGlobalRef(ref->listener);
+    if (attached) ref->vm->DetachCurrentThread();
+    delete ref;
+}
+
+static jlong SubmitSessionJob(JNIEnv* env, BlurJobSpec& spec, jboolean preview, jboolean supersede,
+                              jobject listener) {
+    if (!spec.session) return -1;
+    spec.priority = preview ? BLUR_JOB_PREVIEW : BLUR_JOB_EXPORT;
+    spec.tag = supersede ? reinterpret_cast<int64_t>(spec.session) : 0;
+    JobListenerRef* ref = nullptr;
+    if (listener) {
+        ref = new JobListenerRef{nullptr, env->NewGlobalRef(listener)};
+        env->GetJavaVM(&ref->vm);
+    }
+    const int64_t job = blur_job_submit(&spec, ref ? JobDone : nullptr, ref);
+    if (job <= 0 && ref) {
+        env->DeleteGlobalRef(ref->listener);
+        delete ref;
+    }
+    return job;
+}
+
+// Returns the job id, or a negative status if it could not be queued
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionSubmitRenderMasked(JNIEnv *env, jobject, jlong handle,
+                                                                  jint mask_id, jint mode, jint fg_strength,
+                                                                  jint bg_strength, jboolean preview,
+                                                                  jboolean supersede, jobject listener) {
+    BlurJobSpec spec = {};
+    spec.kind = BLUR_JOB_SESSION_MASKED;
+    spec.session = reinterpret_cast<BlurSession*>(handle);
+    spec.mask_id = mask_id;
+    spec.mode = mode;
+    spec.fg_strength = fg_strength;
+    spec.bg_strength = bg_strength;
+    return SubmitSessionJob(env, spec, preview, supersede, listener);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionSubmitRenderBlurred(JNIEnv *env, jobject, jlong handle, jint mode,
+                                                                   jint strength, jboolean interpolate,
+                                                                   jboolean preview, jboolean supersede,
+                                                                   jobject listener) {
+    BlurJobSpec spec = {};
+    spec.kind = BLUR_JOB_SESSION_BLURRED;
+    spec.session = reinterpret_cast<BlurSession*>(handle);
+    spec.mode = mode;
+    spec.strength = strength;
+    spec.flags = interpolate ? BLUR_SESSION_INTERPOLATE : 0;
+    return SubmitSessionJob(env, spec, preview, supersede, listener);
+}
+
+// The listener still hears about the job, with status -5
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeJobCancel(JNIEnv *env, jobject, jlong job) {
+    return blur_job_cancel(job);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeSessionClose(JNIEnv *env, jobject, jlong handle) {
+    blur_session_close(reinterpret_cast<BlurSession*>(handle));
+}
+
 // Phase 2: Enhanced cleanup with blur engine
 JNIEXPORT void JNICALL
 Java_com_example_blurapp_BlurCore_nativeCleanup(JNIEnv *env, jobject) {
     LOGI("BlurCore: Enhanced cleanup called");
     
-    if (blurcore::g_segmenter != nullptr) {
+    // The engines stay allocated (see EnsureEngines); the models and pools go
+    std::lock_guard<std::mutex> lock(blurcore::g_engines_mutex);
+    if (blurcore::g_engines_ready.exchange(false)) {
         blurcore::g_segmenter->Cleanup();
-        blurcore::g_segmenter.reset();
-    }
-    
-    if (blurcore::g_blur_engine != nullptr) {
+        blurcore::g_face_detector->Cleanup();
         blurcore::g_blur_engine->Cleanup();
-        blurcore::g_blur_engine.reset();
-    }
-    
-    if (blurcore::g_mask_processor != nullptr) {
-        blurcore::g_mask_processor.reset();
-    }
-    
-    if (blurcore::g_compositing_engine != nullptr) {
         blurcore::g_compositing_engine->Cleanup();
-        blurcore::g_compositing_engine.reset();
-    }
-    
-    if (blurcore::g_performance_engine != nullptr) {
         blurcore::g_performance_engine->Cleanup();
-        blurcore::g_performance_engine.reset();
     }
     
+    blur_memory_trim(0);
     LOGI("BlurCore: Enhanced cleanup completed");
 }
 
+// Memory pressure: frees idle pooled buffers down to keep_bytes and returns
+// the number of bytes released
+JNIEXPORT jlong JNICALL
+Java_com_example_blurapp_BlurCore_nativeTrimMemory(JNIEnv *env, jobject, jlong keep_bytes) {
+    // Cached session layers go first, so the pool trim also returns them
+    const int64_t layers = blur_session_trim(keep_bytes);
+    const int64_t freed = blur_memory_trim(keep_bytes);
+    LOGI("BlurCore: Dropped %lld bytes of cached layers, trimmed %lld bytes of pooled memory",
+         (long long)layers, (long long)freed);
+    return freed;
+}
+
 // ================================================================================
 // Phase 3: Advanced Mask Processing JNI Functions
 // ================================================================================
@@ -1668,10 +2405,7 @@ Java_com_example_blurapp_BlurCore_nativeRefineMask(JNIEnv *env, jobject,
                                                    jint kernel_size) {
     LOGI("BlurCore: Refining mask (%dx%d, kernel=%d)", width, height, kernel_size);
     
-    // Initialize mask processor if needed
-    if (blurcore::g_mask_processor == nullptr) {
-        blurcore::g_mask_processor = std::make_unique<blurcore::AdvancedMaskProcessor>();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_mask_processor) {
         LOGE("BlurCore: Mask processor not available");
@@ -1684,30 +2418,74 @@ Java_com_example_blurapp_BlurCore_nativeRefineMask(JNIEnv *env, jobject,
     env->ReleaseStringUTFChars(operation_type, op_str);
     
     // Extract mask data
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
-    
-    // Process mask
-    std::vector<uint8_t> refined_mask = blurcore::g_mask_processor->RefineMask(
-        mask_data, width, height, operation, kernel_size);
-    
-    if (refined_mask.empty()) {
+    blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
+    if (!mask_data) {
         LOGE("BlurCore: Mask refinement failed");
         return env->NewByteArray(0);
     }
     
+    // Process mask; the input goes back unchanged if it fails
+    blurcore::PooledBuffer refined_mask = blurcore::g_mask_processor->RefineMask(
+        mask_data.data(), mask_data.size(), width, height,
+        blurcore::AdvancedMaskProcessor::MorphOperationFromName(operation), kernel_size);
+    if (!refined_mask) refined_mask = std::move(mask_data);
+    
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(refined_mask.size());
-    env->SetByteArrayRegion(result, 0, refined_mask.size(), 
-                           reinterpret_cast<const jbyte*>(refined_mask.data()));
+    jbyteArray result = blurcore::ToByteArray(env, refined_mask.data(), refined_mask.size());
     
     LOGI("BlurCore: Mask refinement completed (%zu bytes)", refined_mask.size());
     return result;
 }
 
+// Phase 3: Zero-copy mask refinement on a direct ByteBuffer, in place
+JNIEXPORT jboolean JNICALL
+Java_com_example_blurapp_BlurCore_nativeRefineMaskBuffer(JNIEnv *env, jobject,
+                                                         jobject mask_buffer,
+                                                         jint width, jint height,
+                                                         jstring operation_type,
+                                                         jint kernel_size) {
+    blurcore::EnsureEngines();
+    
+    uint8_t* mask = blurcore::DirectBufferPixels(env, mask_buffer, static_cast<int64_t>(width) * height);
+    if (!mask || width <= 0 || height <= 0) {
+        LOGE("BlurCore: Mask must be a direct ByteBuffer of %dx%d bytes", width, height);
+        return JNI_FALSE;
+    }
+    
+    const char* op_str = env->GetStringUTFChars(operation_type, nullptr);
+    const int operation = blurcore::AdvancedMaskProcessor::MorphOperationFromName(op_str);
+    env->ReleaseStringUTFChars(operation_type, op_str);
+    
+    return blurcore::g_mask_processor->RefineMaskInPlace(
+        mask, width, width, height, operation, kernel_size) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Phase 3: Whole mask pipeline in one call, in place on a direct ByteBuffer.
+// steps holds op, radius, param triples (BlurMaskStep). The buffer can go
+// straight to nativeApplySelectiveBlurBitmap afterwards.
+// Returns the blur_mask_process status.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeProcessMaskBuffer(JNIEnv *env, jobject,
+                                                          jobject mask_buffer,
+                                                          jint width, jint height,
+                                                          jintArray steps) {
+    static_assert(sizeof(BlurMaskStep) == 3 * sizeof(jint), "BlurMaskStep must be three ints");
+
+    uint8_t* mask = blurcore::DirectBufferPixels(env, mask_buffer, static_cast<int64_t>(width) * height);
+    if (!mask || width <= 0 || height <= 0 || !steps) {
+        LOGE("BlurCore: Mask must be a direct ByteBuffer of %dx%d bytes", width, height);
+        return -1;
+    }
+
+    const jsize count = env->GetArrayLength(steps) / 3;
+    std::vector<BlurMaskStep> list(static_cast<size_t>(count));
+    if (count > 0) env->GetIntArrayRegion(steps, 0, count * 3, reinterpret_cast<jint*>(list.data()));
+
+    const int rc = blur_mask_process(nullptr, mask, width, height, width, list.data(), count);
+    if (rc != 0) LOGE("BlurCore: Mask pipeline failed (%d)", rc);
+    return rc;
+}
+
 // Phase 3: Smooth mask edges
 JNIEXPORT jbyteArray JNICALL
 Java_com_example_blurapp_BlurCore_nativeSmoothMaskEdges(JNIEnv *env, jobject, 
@@ -1716,10 +2494,7 @@ Java_com_example_blurapp_BlurCore_nativeSmoothMaskEdges(JNIEnv *env, jobject,
                                                        jdouble blur_sigma) {
     LOGI("BlurCore: Smoothing mask edges (%dx%d, sigma=%.2f)", width, height, blur_sigma);
     
-    // Initialize mask processor if needed
-    if (blurcore::g_mask_processor == nullptr) {
-        blurcore::g_mask_processor = std::make_unique<blurcore::AdvancedMaskProcessor>();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_mask_processor) {
         LOGE("BlurCore: Mask processor not available");
@@ -1727,25 +2502,19 @@ Java_com_example_blurapp_BlurCore_nativeSmoothMaskEdges(JNIEnv *env, jobject,
     }
     
     // Extract mask data
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
-    
-    // Process mask
-    std::vector<uint8_t> smoothed_mask = blurcore::g_mask_processor->SmoothMaskEdges(
-        mask_data, width, height, blur_sigma);
-    
-    if (smoothed_mask.empty()) {
+    blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
+    if (!mask_data) {
         LOGE("BlurCore: Mask edge smoothing failed");
         return env->NewByteArray(0);
     }
     
+    // Process mask; the input goes back unchanged if it fails
+    blurcore::PooledBuffer smoothed_mask = blurcore::g_mask_processor->SmoothMaskEdges(
+        mask_data.data(), mask_data.size(), width, height, blur_sigma);
+    if (!smoothed_mask) smoothed_mask = std::move(mask_data);
+    
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(smoothed_mask.size());
-    env->SetByteArrayRegion(result, 0, smoothed_mask.size(), 
-                           reinterpret_cast<const jbyte*>(smoothed_mask.data()));
+    jbyteArray result = blurcore::ToByteArray(env, smoothed_mask.data(), smoothed_mask.size());
     
     LOGI("BlurCore: Mask edge smoothing completed (%zu bytes)", smoothed_mask.size());
     return result;
@@ -1759,10 +2528,7 @@ Java_com_example_blurapp_BlurCore_nativeOptimizeMask(JNIEnv *env, jobject,
                                                      jint min_area) {
     LOGI("BlurCore: Optimizing mask (%dx%d, min_area=%d)", width, height, min_area);
     
-    // Initialize mask processor if needed
-    if (blurcore::g_mask_processor == nullptr) {
-        blurcore::g_mask_processor = std::make_unique<blurcore::AdvancedMaskProcessor>();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_mask_processor) {
         LOGE("BlurCore: Mask processor not available");
@@ -1770,30 +2536,60 @@ Java_com_example_blurapp_BlurCore_nativeOptimizeMask(JNIEnv *env, jobject,
     }
     
     // Extract mask data
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
-    
-    // Process mask
-    std::vector<uint8_t> optimized_mask = blurcore::g_mask_processor->OptimizeMask(
-        mask_data, width, height, min_area);
-    
-    if (optimized_mask.empty()) {
+    blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
+    if (!mask_data) {
         LOGE("BlurCore: Mask optimization failed");
         return env->NewByteArray(0);
     }
     
+    // Process mask; the input goes back unchanged if it fails
+    blurcore::PooledBuffer optimized_mask = blurcore::g_mask_processor->OptimizeMask(
+        mask_data.data(), mask_data.size(), width, height, min_area);
+    if (!optimized_mask) optimized_mask = std::move(mask_data);
+    
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(optimized_mask.size());
-    env->SetByteArrayRegion(result, 0, optimized_mask.size(), 
-                           reinterpret_cast<const jbyte*>(optimized_mask.data()));
+    jbyteArray result = blurcore::ToByteArray(env, optimized_mask.data(), optimized_mask.size());
     
     LOGI("BlurCore: Mask optimization completed (%zu bytes)", optimized_mask.size());
     return result;
 }
 
+// Phase 3: Snap a coarse mask to the photo's edges (guided filter), after
+// dropping blobs under min_area pixels (0 keeps them). image_bytes are
+// width x height RGBA; the soft refined mask is returned.
+JNIEXPORT jbyteArray JNICALL
+Java_com_example_blurapp_BlurCore_nativeRefineMaskGuided(JNIEnv *env, jobject,
+                                                         jbyteArray image_bytes,
+                                                         jbyteArray mask_bytes,
+                                                         jint width, jint height,
+                                                         jint radius, jfloat eps,
+                                                         jint min_area) {
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+    if (width <= 0 || height <= 0 || !image_bytes || !mask_bytes ||
+        env->GetArrayLength(image_bytes) != pixels * 4 || env->GetArrayLength(mask_bytes) != pixels) {
+        LOGE("BlurCore: Guided refinement expects a %dx%d RGBA image and mask", width, height);
+        return env->NewByteArray(0);
+    }
+    
+    blurcore::EnsureEngines();
+    
+    blurcore::PooledBuffer mask = blurcore::CopyByteArray(env, mask_bytes);
+    if (!mask) return env->NewByteArray(0);
+    if (min_area > 0) {
+        const BlurMaskStep clean[] = {{BLUR_MASK_REMOVE_SMALL, 0, min_area}};
+        blur_mask_process(nullptr, mask.data(), width, height, width, clean, 1);
+    }
+    
+    jbyte* image = env->GetByteArrayElements(image_bytes, nullptr);
+    if (!image) return env->NewByteArray(0);
+    const bool ok = blurcore::g_mask_processor->RefineMaskGuided(
+        mask.data(), reinterpret_cast<const uint8_t*>(image), width, height, radius, eps);
+    env->ReleaseByteArrayElements(image_bytes, image, JNI_ABORT);
+    if (!ok) return env->NewByteArray(0);
+    
+    return blurcore::ToByteArray(env, mask.data(), mask.size());
+}
+
 // Phase 3: Create feathered mask
 JNIEXPORT jbyteArray JNICALL
 Java_com_example_blurapp_BlurCore_nativeCreateFeatheredMask(JNIEnv *env, jobject, 
@@ -1802,10 +2598,7 @@ Java_com_example_blurapp_BlurCore_nativeCreateFeatheredMask(JNIEnv *env, jobject
                                                            jint feather_radius) {
     LOGI("BlurCore: Creating feathered mask (%dx%d, radius=%d)", width, height, feather_radius);
     
-    // Initialize mask processor if needed
-    if (blurcore::g_mask_processor == nullptr) {
-        blurcore::g_mask_processor = std::make_unique<blurcore::AdvancedMaskProcessor>();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_mask_processor) {
         LOGE("BlurCore: Mask processor not available");
@@ -1813,25 +2606,19 @@ Java_com_example_blurapp_BlurCore_nativeCreateFeatheredMask(JNIEnv *env, jobject
     }
     
     // Extract mask data
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
-    
-    // Process mask
-    std::vector<uint8_t> feathered_mask = blurcore::g_mask_processor->CreateFeatheredMask(
-        mask_data, width, height, feather_radius);
-    
-    if (feathered_mask.empty()) {
+    blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
+    if (!mask_data) {
         LOGE("BlurCore: Mask feathering failed");
         return env->NewByteArray(0);
     }
     
+    // Process mask; the input goes back unchanged if it fails
+    blurcore::PooledBuffer feathered_mask = blurcore::g_mask_processor->CreateFeatheredMask(
+        mask_data.data(), mask_data.size(), width, height, feather_radius);
+    if (!feathered_mask) feathered_mask = std::move(mask_data);
+    
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(feathered_mask.size());
-    env->SetByteArrayRegion(result, 0, feathered_mask.size(), 
-                           reinterpret_cast<const jbyte*>(feathered_mask.data()));
+    jbyteArray result = blurcore::ToByteArray(env, feathered_mask.data(), feathered_mask.size());
     
     LOGI("BlurCore: Mask feathering completed (%zu bytes)", feathered_mask.size());
     return result;
@@ -1851,11 +2638,7 @@ Java_com_example_blurapp_BlurCore_nativeBlendLayers(JNIEnv *env, jobject,
                                                     jdouble blend_strength) {
     LOGI("BlurCore: Blending layers (%dx%d, strength=%.2f)", width, height, blend_strength);
     
-    // Initialize compositing engine if needed
-    if (blurcore::g_compositing_engine == nullptr) {
-        blurcore::g_compositing_engine = std::make_unique<blurcore::SmartCompositingEngine>();
-        blurcore::g_compositing_engine->Initialize();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_compositing_engine || !blurcore::g_compositing_engine->IsInitialized()) {
         LOGE("BlurCore: Compositing engine not available");
@@ -1863,34 +2646,22 @@ Java_com_example_blurapp_BlurCore_nativeBlendLayers(JNIEnv *env, jobject,
     }
     
     // Extract image data
-    jsize base_length = env->GetArrayLength(base_bytes);
-    jbyte* base_ptr = env->GetByteArrayElements(base_bytes, nullptr);
-    std::vector<uint8_t> base_data(base_ptr, base_ptr + base_length);
-    env->ReleaseByteArrayElements(base_bytes, base_ptr, JNI_ABORT);
-    
-    jsize overlay_length = env->GetArrayLength(overlay_bytes);
-    jbyte* overlay_ptr = env->GetByteArrayElements(overlay_bytes, nullptr);
-    std::vector<uint8_t> overlay_data(overlay_ptr, overlay_ptr + overlay_length);
-    env->ReleaseByteArrayElements(overlay_bytes, overlay_ptr, JNI_ABORT);
-    
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
+    const blurcore::PooledBuffer base_data = blurcore::CopyByteArray(env, base_bytes);
+    const blurcore::PooledBuffer overlay_data = blurcore::CopyByteArray(env, overlay_bytes);
+    const blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
     
     // Blend layers
-    std::vector<uint8_t> blended_result = blurcore::g_compositing_engine->BlendLayers(
-        base_data, overlay_data, mask_data, width, height, blend_strength);
+    blurcore::PooledBuffer blended_result = blurcore::g_compositing_engine->BlendLayers(
+        base_data.data(), base_data.size(), overlay_data.data(), overlay_data.size(),
+        mask_data.data(), mask_data.size(), width, height, blend_strength);
     
-    if (blended_result.empty()) {
+    if (!blended_result) {
         LOGE("BlurCore: Layer blending failed");
         return env->NewByteArray(0);
     }
     
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(blended_result.size());
-    env->SetByteArrayRegion(result, 0, blended_result.size(), 
-                           reinterpret_cast<const jbyte*>(blended_result.data()));
+    jbyteArray result = blurcore::ToByteArray(env, blended_result.data(), blended_result.size());
     
     LOGI("BlurCore: Layer blending completed (%zu bytes)", blended_result.size());
     return result;
@@ -1906,16 +2677,7 @@ Java_com_example_blurapp_BlurCore_nativeAdvancedColorBlend(JNIEnv *env, jobject,
                                                           jstring color_space) {
     LOGI("BlurCore: Advanced color blending (%dx%d)", width, height);
     
-    // Initialize compositing engine if needed
-    if (blurcore::g_compositing_engine == nullptr) {
-        blurcore::g_compositing_engine = std::make_unique<blurcore::SmartCompositingEngine>();
-        blurcore::g_compositing_engine->Initialize();
-    }
-    
-    if (!blurcore::g_compositing_engine || !blurcore::g_compositing_engine->IsInitialized()) {
-        LOGE("BlurCore: Compositing engine not available");
-        return env->NewByteArray(0);
-    }
+    blurcore::EnsureEngines();
     
     // Convert color space from Java string
     const char* cs_str = env->GetStringUTFChars(color_space, nullptr);
@@ -1923,34 +2685,22 @@ Java_com_example_blurapp_BlurCore_nativeAdvancedColorBlend(JNIEnv *env, jobject,
     env->ReleaseStringUTFChars(color_space, cs_str);
     
     // Extract image data
-    jsize base_length = env->GetArrayLength(base_bytes);
-    jbyte* base_ptr = env->GetByteArrayElements(base_bytes, nullptr);
-    std::vector<uint8_t> base_data(base_ptr, base_ptr + base_length);
-    env->ReleaseByteArrayElements(base_bytes, base_ptr, JNI_ABORT);
-    
-    jsize overlay_length = env->GetArrayLength(overlay_bytes);
-    jbyte* overlay_ptr = env->GetByteArrayElements(overlay_bytes, nullptr);
-    std::vector<uint8_t> overlay_data(overlay_ptr, overlay_ptr + overlay_length);
-    env->ReleaseByteArrayElements(overlay_bytes, overlay_ptr, JNI_ABORT);
-    
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
+    const blurcore::PooledBuffer base_data = blurcore::CopyByteArray(env, base_bytes);
+    const blurcore::PooledBuffer overlay_data = blurcore::CopyByteArray(env, overlay_bytes);
+    const blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
     
     // Apply advanced color blending
-    std::vector<uint8_t> blended_result = blurcore::g_compositing_engine->AdvancedColorBlend(
-        base_data, overlay_data, mask_data, width, height, cs_string);
+    const blurcore::PooledBuffer blended_result = blurcore::g_compositing_engine->AdvancedColorBlend(
+        base_data.data(), base_data.size(), overlay_data.data(), overlay_data.size(),
+        mask_data.data(), mask_data.size(), width, height, cs_string);
     
-    if (blended_result.empty()) {
+    if (!blended_result) {
         LOGE("BlurCore: Advanced color blending failed");
         return env->NewByteArray(0);
     }
     
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(blended_result.size());
-    env->SetByteArrayRegion(result, 0, blended_result.size(), 
-                           reinterpret_cast<const jbyte*>(blended_result.data()));
+    jbyteArray result = blurcore::ToByteArray(env, blended_result.data(), blended_result.size());
     
     LOGI("BlurCore: Advanced color blending completed (%zu bytes)", blended_result.size());
     return result;
@@ -1965,46 +2715,25 @@ Java_com_example_blurapp_BlurCore_nativeGradientDomainComposite(JNIEnv *env, job
                                                                jint width, jint height) {
     LOGI("BlurCore: Gradient domain compositing (%dx%d)", width, height);
     
-    // Initialize compositing engine if needed
-    if (blurcore::g_compositing_engine == nullptr) {
-        blurcore::g_compositing_engine = std::make_unique<blurcore::SmartCompositingEngine>();
-        blurcore::g_compositing_engine->Initialize();
-    }
-    
-    if (!blurcore::g_compositing_engine || !blurcore::g_compositing_engine->IsInitialized()) {
-        LOGE("BlurCore: Compositing engine not available");
-        return env->NewByteArray(0);
-    }
+    blurcore::EnsureEngines();
     
     // Extract image data
-    jsize base_length = env->GetArrayLength(base_bytes);
-    jbyte* base_ptr = env->GetByteArrayElements(base_bytes, nullptr);
-    std::vector<uint8_t> base_data(base_ptr, base_ptr + base_length);
-    env->ReleaseByteArrayElements(base_bytes, base_ptr, JNI_ABORT);
-    
-    jsize overlay_length = env->GetArrayLength(overlay_bytes);
-    jbyte* overlay_ptr = env->GetByteArrayElements(overlay_bytes, nullptr);
-    std::vector<uint8_t> overlay_data(overlay_ptr, overlay_ptr + overlay_length);
-    env->ReleaseByteArrayElements(overlay_bytes, overlay_ptr, JNI_ABORT);
-    
-    jsize mask_length = env->GetArrayLength(mask_bytes);
-    jbyte* mask_ptr = env->GetByteArrayElements(mask_bytes, nullptr);
-    std::vector<uint8_t> mask_data(mask_ptr, mask_ptr + mask_length);
-    env->ReleaseByteArrayElements(mask_bytes, mask_ptr, JNI_ABORT);
+    const blurcore::PooledBuffer base_data = blurcore::CopyByteArray(env, base_bytes);
+    const blurcore::PooledBuffer overlay_data = blurcore::CopyByteArray(env, overlay_bytes);
+    const blurcore::PooledBuffer mask_data = blurcore::CopyByteArray(env, mask_bytes);
     
     // Apply gradient domain compositing
-    std::vector<uint8_t> composite_result = blurcore::g_compositing_engine->GradientDomainComposite(
-        base_data, overlay_data, mask_data, width, height);
+    const blurcore::PooledBuffer composite_result = blurcore::g_compositing_engine->GradientDomainComposite(
+        base_data.data(), base_data.size(), overlay_data.data(), overlay_data.size(),
+        mask_data.data(), mask_data.size(), width, height);
     
-    if (composite_result.empty()) {
+    if (!composite_result) {
         LOGE("BlurCore: Gradient domain compositing failed");
         return env->NewByteArray(0);
     }
     
     // Convert result back to Java byte array
-    jbyteArray result = env->NewByteArray(composite_result.size());
-    env->SetByteArrayRegion(result, 0, composite_result.size(), 
-                           reinterpret_cast<const jbyte*>(composite_result.data()));
+    jbyteArray result = blurcore::ToByteArray(env, composite_result.data(), composite_result.size());
     
     LOGI("BlurCore: Gradient domain compositing completed (%zu bytes)", composite_result.size());
     return result;
@@ -2019,11 +2748,7 @@ JNIEXPORT jstring JNICALL
 Java_com_example_blurapp_BlurCore_nativeGetPerformanceReport(JNIEnv *env, jobject) {
     LOGI("BlurCore: Getting performance report");
     
-    // Initialize performance engine if needed
-    if (blurcore::g_performance_engine == nullptr) {
-        blurcore::g_performance_engine = std::make_unique<blurcore::PerformanceOptimizationEngine>();
-        blurcore::g_performance_engine->Initialize();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_performance_engine || !blurcore::g_performance_engine->IsInitialized()) {
         return env->NewStringUTF("Performance engine not available");
@@ -2033,17 +2758,19 @@ Java_com_example_blurapp_BlurCore_nativeGetPerformanceReport(JNIEnv *env, jobjec
     return env->NewStringUTF(report.c_str());
 }
 
+// Phase 5: Clear the stage histograms and pool counters behind the report
+JNIEXPORT void JNICALL
+Java_com_example_blurapp_BlurCore_nativeResetPerformanceStats(JNIEnv *env, jobject) {
+    blur_stats_reset();
+}
+
 // Phase 5: Optimize processing pipeline for specific image dimensions
 JNIEXPORT jboolean JNICALL
 Java_com_example_blurapp_BlurCore_nativeOptimizePipeline(JNIEnv *env, jobject, 
                                                         jint width, jint height) {
     LOGI("BlurCore: Optimizing pipeline for %dx%d", width, height);
     
-    // Initialize performance engine if needed
-    if (blurcore::g_performance_engine == nullptr) {
-        blurcore::g_performance_engine = std::make_unique<blurcore::PerformanceOptimizationEngine>();
-        blurcore::g_performance_engine->Initialize();
-    }
+    blurcore::EnsureEngines();
     
     if (!blurcore::g_performance_engine || !blurcore::g_performance_engine->IsInitialized()) {
         LOGE("BlurCore: Performance engine not available");
@@ -2051,10 +2778,30 @@ Java_com_example_blurapp_BlurCore_nativeOptimizePipeline(JNIEnv *env, jobject,
     }
     
     blurcore::g_performance_engine->OptimizePipelineForSize(width, height);
-    blurcore::g_performance_engine->OptimizeGPUMemory();
-    
-    LOGI("BlurCore: Pipeline optimization completed");
     return JNI_TRUE;
 }
 
+// Phase 5: Time each backend once, or load the timings saved by an earlier
+// run at cache_path. Returns 0, or -8 if the timings could not be saved.
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeGovernorCalibrate(JNIEnv *env, jobject, jstring cache_path) {
+    const char* path = env->GetStringUTFChars(cache_path, nullptr);
+    const auto start = std::chrono::steady_clock::now();
+    const int rc = blur_governor_calibrate(path);
+    LOGI("BlurCore: Governor calibrated in %.1fms (%d)", blurcore::ElapsedNs(start) / 1e6, rc);
+    env->ReleaseStringUTFChars(cache_path, path);
+    return rc;
+}
+
+// Phase 5: Thermal / battery-saver level (BlurPressure)
+JNIEXPORT jint JNICALL
+Java_com_example_blurapp_BlurCore_nativeSetPerformancePressure(JNIEnv *env, jobject, jint level) {
+    return blur_governor_set_pressure(level);
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_example_blurapp_BlurCore_nativeGetGovernorReport(JNIEnv *env, jobject) {
+    return env->NewStringUTF(blurcore::PerformanceOptimizationEngine::GovernorJson().c_str());
+}
+
 } // extern "C"
\ No newline at end of file
@@ -0,0 +1,184 @@
+// TensorFlow Lite C API, resolved at runtime from the libtensorflowlite_c.so
+// that tflite_flutter already ships in the APK. Nothing links against it at
+// build time, so the library builds without TFLite headers and segmentation
+// simply reports unavailable when the runtime is missing.
+#pragma once
+#include <dlfcn.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace blurcore {
+
+// Opaque C API handles and the few enum values used here (c_api_types.h)
+struct TfLiteModel;
+struct TfLiteInterpreterOptions;
+struct TfLiteInterpreter;
+struct TfLiteTensor;
+struct TfLiteDelegate;
+constexpr int kTfLiteOk = 0;
+constexpr int kTfLiteFloat32 = 1;
+
+struct TfLiteApi {
+    TfLiteModel* (*ModelCreateFromFile)(const char* path);
+    void (*ModelDelete)(TfLiteModel* model);
+    TfLiteInterpreterOptions* (*InterpreterOptionsCreate)();
+    void (*InterpreterOptionsDelete)(TfLiteInterpreterOptions* options);
+    void (*InterpreterOptionsSetNumThreads)(TfLiteInterpreterOptions* options, int32_t threads);
+    void (*InterpreterOptionsAddDelegate)(TfLiteInterpreterOptions* options, TfLiteDelegate* delegate);
+    TfLiteInterpreter* (*InterpreterCreate)(const TfLiteModel* model, const TfLiteInterpreterOptions* options);
+    void (*InterpreterDelete)(TfLiteInterpreter* interpreter);
+    int (*InterpreterAllocateTensors)(TfLiteInterpreter* interpreter);
+    int (*InterpreterInvoke)(TfLiteInterpreter* interpreter);
+    TfLiteTensor* (*InterpreterGetInputTensor)(const TfLiteInterpreter* interpreter, int32_t index);
+    const TfLiteTensor* (*InterpreterGetOutputTensor)(const TfLiteInterpreter* interpreter, int32_t index);
+    int32_t (*InterpreterGetOutputTensorCount)(const TfLiteInterpreter* interpreter);
+    int (*TensorType)(const TfLiteTensor* tensor);
+    int32_t (*TensorNumDims)(const TfLiteTensor* tensor);
+    int32_t (*TensorDim)(const TfLiteTensor* tensor, int32_t index);
+    void* (*TensorData)(const TfLiteTensor* tensor);
+
+    // Optional GPU delegate (NULL options = defaults); null when not shipped
+    TfLiteDelegate* (*GpuDelegateCreate)(const void* options);
+    void (*GpuDelegateDelete)(TfLiteDelegate* delegate);
+
+    // Loaded once per process; nullptr if the runtime is missing or incomplete.
+    static const TfLiteApi* Get() {
+        static const TfLiteApi* api = Load();
+        return api;
+    }
+
+private:
+    template <typename Fn>
+    static bool Resolve(void* lib, const char* name, Fn& fn) {
+        fn = reinterpret_cast<Fn>(dlsym(lib, name));
+        return fn != nullptr;
+    }
+
+    static const TfLiteApi* Load() {
+        void* lib = dlopen("libtensorflowlite_c.so", RTLD_NOW | RTLD_LOCAL);
+        if (!lib) return nullptr;
+        static TfLiteApi api;
+        const bool ok =
+            Resolve(lib, "TfLiteModelCreateFromFile", api.ModelCreateFromFile) &&
+            Resolve(lib, "TfLiteModelDelete", api.ModelDelete) &&
+            Resolve(lib, "TfLiteInterpreterOptionsCreate", api.InterpreterOptionsCreate) &&
+            Resolve(lib, "TfLiteInterpreterOptionsDelete", api.InterpreterOptionsDelete) &&
+            Resolve(lib, "TfLiteInterpreterOptionsSetNumThreads", api.InterpreterOptionsSetNumThreads) &&
+            Resolve(lib, "TfLiteInterpreterOptionsAddDelegate", api.InterpreterOptionsAddDelegate) &&
+            Resolve(lib, "TfLiteInterpreterCreate", api.InterpreterCreate) &&
+            Resolve(lib, "TfLiteInterpreterDelete", api.InterpreterDelete) &&
+            Resolve(lib, "TfLiteInterpreterAllocateTensors", api.InterpreterAllocateTensors) &&
+            Resolve(lib, "TfLiteInterpreterInvoke", api.InterpreterInvoke) &&
+            Resolve(lib, "TfLiteInterpreterGetInputTensor", api.InterpreterGetInputTensor) &&
+            Resolve(lib, "TfLiteInterpreterGetOutputTensor", api.InterpreterGetOutputTensor) &&
+            Resolve(lib, "TfLiteInterpreterGetOutputTensorCount", api.InterpreterGetOutputTensorCount) &&
+            Resolve(lib, "TfLiteTensorType", api.TensorType) &&
+            Resolve(lib, "TfLiteTensorNumDims", api.TensorNumDims) &&
+            Resolve(lib, "TfLiteTensorDim", api.TensorDim) &&
+            Resolve(lib, "TfLiteTensorData", api.TensorData);
+        if (!ok) return nullptr;
+
+        // The GPU delegate lives in the core library or in its own one
+        void* gpu = lib;
+        if (!Resolve(gpu, "TfLiteGpuDelegateV2Create", api.GpuDelegateCreate)) {
+            gpu = dlopen("libtensorflowlite_gpu_jni.so", RTLD_NOW | RTLD_LOCAL);
+            if (gpu) Resolve(gpu, "TfLiteGpuDelegateV2Create", api.GpuDelegateCreate);
+        }
+        if (!api.GpuDelegateCreate || !Resolve(gpu, "TfLiteGpuDelegateV2Delete", api.GpuDelegateDelete)) {
+            api.GpuDelegateCreate = nullptr;
+            api.GpuDelegateDelete = nullptr;
+        }
+        return &api;
+    }
+};
+
+// One model on one interpreter with its tensors allocated, on the GPU
+// delegate when asked for and available, otherwise on CPU threads. Tensor
+// data pointers stay valid until Close as long as inputs are not resized.
+// Not thread-safe; owners serialize Invoke themselves.
+class TfLiteSession {
+public:
+    ~TfLiteSession() { Close(); }
+
+    bool Open(const char* model_path, bool use_gpu, int threads) {
+        Close();
+        api_ = TfLiteApi::Get();
+        if (!api_) return false;
+        model_ = api_->ModelCreateFromFile(model_path);
+        if (!model_) return false;
+
+        // Try the GPU delegate first, then fall back to CPU threads
+        for (int attempt = use_gpu && api_->GpuDelegateCreate ? 0 : 1; attempt < 2 && !interpreter_; ++attempt) {
+            options_ = api_->InterpreterOptionsCreate();
+            api_->InterpreterOptionsSetNumThreads(options_, threads);
+            if (attempt == 0) {
+                delegate_ = api_->GpuDelegateCreate(nullptr);
+                if (delegate_) api_->InterpreterOptionsAddDelegate(options_, delegate_);
+            }
+            interpreter_ = api_->InterpreterCreate(model_, options_);
+            if (interpreter_ && api_->InterpreterAllocateTensors(interpreter_) != kTfLiteOk) {
+                api_->InterpreterDelete(interpreter_);
+                interpreter_ = nullptr;
+            }
+            if (!interpreter_) {
+                api_->InterpreterOptionsDelete(options_);
+                options_ = nullptr;
+                if (delegate_) api_->GpuDelegateDelete(delegate_);
+                delegate_ = nullptr;
+            }
+        }
+        if (!interpreter_) Close();
+        return interpreter_ != nullptr;
+    }
+
+    void Close() {
+        if (api_) {
+            // The delegate must outlive the interpreter that uses it
+            if (interpreter_) api_->InterpreterDelete(interpreter_);
+            if (delegate_) api_->GpuDelegateDelete(delegate_);
+            if (options_) api_->InterpreterOptionsDelete(options_);
+            if (model_) api_->ModelDelete(model_);
+        }
+        interpreter_ = nullptr;
+        delegate_ = nullptr;
+        options_ = nullptr;
+        model_ = nullptr;
+    }
+
+    bool Invoke() { return interpreter_ && api_->InterpreterInvoke(interpreter_) == kTfLiteOk; }
+
+    TfLiteTensor* Input(int index) const {
+        return interpreter_ ? api_->InterpreterGetInputTensor(interpreter_, index) : nullptr;
+    }
+
+    const TfLiteTensor* Output(int index) const {
+        return interpreter_ ? api_->InterpreterGetOutputTensor(interpreter_, index) : nullptr;
+    }
+
+    int OutputCount() const { return interpreter_ ? api_->InterpreterGetOutputTensorCount(interpreter_) : 0; }
+
+    // Dims of a float tensor of the given rank, or false for anything else
+    bool FloatShape(const TfLiteTensor* tensor, int rank, int* dims) const {
+        if (!tensor || api_->TensorType(tensor) != kTfLiteFloat32 || api_->TensorNumDims(tensor) != rank) {
+            return false;
+        }
+        for (int i = 0; i < rank; ++i) {
+            dims[i] = api_->TensorDim(tensor, i);
+            if (dims[i] <= 0) return false;
+        }
+        return true;
+    }
+
+    float* Data(const TfLiteTensor* tensor) const { return static_cast<float*>(api_->TensorData(tensor)); }
+
+    bool OnGpu() const { return delegate_ != nullptr; }
+
+private:
+    const TfLiteApi* api_ = nullptr;
+    TfLiteModel* model_ = nullptr;
+    TfLiteInterpreterOptions* options_ = nullptr;
+    TfLiteDelegate* delegate_ = nullptr;
+    TfLiteInterpreter* interpreter_ = nullptr;
+};
+
+} // namespace blurcore
@@ -1 +1,165 @@
+import 'dart:async';
 
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart';
+
+import '../../native/blur_bindings.dart';
+
+/// One rendered result. [pixels] belongs to the controller and is only valid
+/// until the next notification.
+class PreviewFrame {
+  const PreviewFrame(this.pixels, this.level);
+
+  final NativePixelBuffer pixels;
+
+  /// Pyramid level the frame was rendered at; 0 is full resolution.
+  final int level;
+
+  bool get isFinal => level == 0;
+}
+
+/// Progressive blur preview for the editor.
+///
+/// While the slider moves, [update] blurs the smallest pyramid level that
+/// still fills the viewport on the calling isolate, which costs roughly the
+/// screen size rather than the photo size. Once updates stop for [settle],
+/// the full-resolution image is blurred on a background isolate; a newer
+/// update cancels that refinement through the native context.
+class PreviewController extends ChangeNotifier {
+  PreviewController(
+    this.source, {
+    this.settle = const Duration(milliseconds: 250),
+  }) : _pyramid = NativePyramid.build(source);
+
+  /// Full-resolution RGBA source. It is never modified, and must outlive
+  /// the controller.
+  final NativePixelBuffer source;
+  final Duration settle;
+
+  final NativePyramid? _pyramid;
+  final FfiBlur _previewBlur = FfiBlur();
+  final FfiBlur _refineBlur = FfiBlur();
+  final Map<int, NativePixelBuffer> _levelBuffers = {};
+  NativePixelBuffer? _fullBuffer;
+
+  PreviewFrame? _frame;
+  Timer? _settleTimer;
+  Future<int>? _refining;
+  int _generation = 0;
+  // Mirror of [_generation] that the refine isolate can read
+  final Pointer<Int64> _generationCell = calloc<Int64>();
+  bool _disposed = false;
+
+  List<int> _rects = const [];
+  int _mode = 0;
+  int _strength = 0;
+
+  PreviewFrame? get frame => _frame;
+
+  /// Whether a full-resolution pass is pending or running.
+  bool get isRefining => _settleTimer != null || _refining != null;
+
+  /// Show the blur of [rects] (source coordinates, flattened x,y,w,h; empty
+  /// for the whole image) for a [viewportWidth] x [viewportHeight] view.
+  void update(
+    List<int> rects,
+    int mode,
+    int strength, {
+    required int viewportWidth,
+    required int viewportHeight,
+  }) {
+    if (_disposed) return;
+    _rects = List<int>.of(rects);
+    _mode = mode;
+    _strength = strength;
+    _generationCell.value = ++_generation;
+    _refineBlur.cancel();
+    _settleTimer?.cancel();
+
+    final level = _pyramid?.levelFor(viewportWidth, viewportHeight) ?? 0;
+    if (level == 0) {
+      // The viewport needs every source pixel: go straight to full res
+      _settleTimer = null;
+      unawaited(_refine(_generation));
+      return;
+    }
+
+    final dst = _levelBuffers.putIfAbsent(level, () {
+      final (w, h) = _pyramid!.levelSize(level)!;
+      return NativePixelBuffer(w, h);
+    });
+    if (_pyramid!.preview(_previewBlur, level, dst, _rects, mode, strength) ==
+        0) {
+      _frame = PreviewFrame(dst, level);
+      notifyListeners();
+    }
+    _settleTimer = Timer(settle, () {
+      _settleTimer = null;
+      unawaited(_refine(_generation));
+    });
+  }
+
+  Future<void> _refine(int generation) async {
+    // The previous pass still owns the full-res buffer and the context
+    final previous = _refining;
+    if (previous != null) await previous;
+    if (_disposed || generation != _generation) return;
+
+    final full = _fullBuffer ??= NativePixelBuffer(
+      source.width,
+      source.height,
+    );
+    for (var y = 0; y < source.height; ++y) {
+      full.bytes.setRange(
+        y * full.stride,
+        y * full.stride + source.width * 4,
+        source.bytes,
+        y * source.stride,
+      );
+    }
+
+    final pass = FfiBlur.applyInBackground(
+      full,
+      _rects,
+      _mode,
+      _strength,
+      contextAddress: _refineBlur.contextAddress,
+      generationAddress: _generationCell.address,
+      generation: generation,
+    );
+    _refining = pass;
+    final rc = await pass;
+    if (identical(_refining, pass)) _refining = null;
+
+    if (_disposed || generation != _generation || rc != 0) return;
+    _frame = PreviewFrame(full, 0);
+    notifyListeners();
+  }
+
+  @override
+  void dispose() {
+    _disposed = true;
+    _settleTimer?.cancel();
+    _settleTimer = null;
+    _generationCell.value = ++_generation;
+    _refineBlur.cancel();
+    super.dispose();
+
+    // Native memory is freed once a running pass has let go of it
+    final running = _refining ?? Future<int>.value(0);
+    unawaited(
+      running.whenComplete(() {
+        _refineBlur.dispose();
+        _previewBlur.dispose();
+        _pyramid?.dispose();
+        for (final buffer in _levelBuffers.values) {
+          buffer.dispose();
+        }
+        _fullBuffer?.dispose();
+        calloc.free(_generationCell);
+      }),
+    );
+  }
+}
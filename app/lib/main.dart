@@ -1,4 +1,5 @@
 import 'package:flutter/material.dart';
+import 'dart:async';
 import 'dart:io';
 
 import 'app.dart';
@@ -10,6 +11,7 @@ import 'app.dart';
 import 'package:gal/gal.dart' as gal;
 import 'package:path_provider/path_provider.dart' as path_provider;
 
+import 'native/hybrid_blur_bindings.dart';
 import 'services/gallery_provider.dart';
 
 void main() async {
@@ -30,6 +32,10 @@ void main() async {
     // ignore - path_provider not available in this environment
   }
 
+  // Native engines and models load in the background while the first frame
+  // renders; not awaited
+  unawaited(NativeBlurBindings.warmUp());
+
   runApp(const BlurApp());
 }
 
@@ -1,28 +1,578 @@
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
 import 'dart:typed_data';
 
-// Stub implementation for native blur bindings
-// NOTE: This file provides a lightweight, safe stub to be used until
-// a proper native/FFI implementation is available.
+import 'package:ffi/ffi.dart';
+
+// dart:ffi bindings to the portable blur core (native/include/blur.h).
 //
-// When the native blur implementation is ready, replace this class with
-// real FFI bindings (using `dart:ffi` and a shared library). Keep the
-// same public API so the rest of the app can switch to native code with
-// minimal changes.
+// Pixels live in malloc'd native memory ([NativePixelBuffer]) and Dart sees
+// them through a Uint8List view, so a blur call passes a pointer and copies
+// nothing. The C calls are synchronous and thread-safe, which makes them
+// suitable for a background isolate: only the buffer address crosses the
+// isolate boundary (see [FfiBlur.applyInBackground]).
+
+/// Mirrors `BlurRect` in blur.h.
+final class BlurRectNative extends Struct {
+  @Int32()
+  external int x;
+  @Int32()
+  external int y;
+  @Int32()
+  external int w;
+  @Int32()
+  external int h;
+}
+
+/// Mirrors `BlurJobSpec` in blur.h.
+final class BlurJobSpecNative extends Struct {
+  @Int32()
+  external int kind;
+  @Int32()
+  external int priority;
+  @Int64()
+  external int tag;
+  external Pointer<Uint8> pixels;
+  @Int32()
+  external int width;
+  @Int32()
+  external int height;
+  @Int32()
+  external int stride;
+  @Int32()
+  external int format;
+  external Pointer<BlurRectNative> rects;
+  @Int32()
+  external int rectCount;
+  external Pointer<Uint8> mask;
+  @Int32()
+  external int maskStride;
+  external Pointer<Void> session;
+  @Int32()
+  external int maskId;
+  @Int32()
+  external int flags;
+  @Int32()
+  external int mode;
+  @Int32()
+  external int strength;
+  @Int32()
+  external int fgStrength;
+  @Int32()
+  external int bgStrength;
+}
+
+/// Mirrors `BlurStageStats` in blur.h.
+final class BlurStageStatsNative extends Struct {
+  @Int64()
+  external int count;
+  @Int64()
+  external int totalNs;
+  @Int64()
+  external int maxNs;
+  @Int64()
+  external int p50Ns;
+  @Int64()
+  external int p90Ns;
+  @Int64()
+  external int p99Ns;
+  @Int64()
+  external int bytes;
+}
+
+/// Mirrors `BlurStats` in blur.h.
+final class BlurStatsNative extends Struct {
+  @Array(8)
+  external Array<BlurStageStatsNative> stages;
+  @Int64()
+  external int poolHits;
+  @Int64()
+  external int poolMisses;
+  @Int64()
+  external int poolIdleBytes;
+  @Int64()
+  external int poolInUseBytes;
+  @Int64()
+  external int layerCacheHits;
+  @Int64()
+  external int layerCacheMisses;
+  @Int64()
+  external int layerCacheInterpolated;
+  @Int64()
+  external int layerCacheBytes;
+  @Int64()
+  external int layerCacheLimitBytes;
+  @Int64()
+  external int layerCacheLayers;
+}
+
+/// Mirrors `BlurPixelFormat` in blur.h.
+class BlurPixelFormat {
+  static const int rgba8888 = 0;
+  static const int bgra8888 = 1;
+  static const int rgb888 = 2;
+  static const int gray8 = 3;
+  static const int nv21 = 4;
+}
+
+/// Mirrors `BlurMaskStep` in blur.h.
+final class BlurMaskStepNative extends Struct {
+  @Int32()
+  external int op;
+  @Int32()
+  external int radius;
+  @Int32()
+  external int param;
+}
+
+/// Mirrors `BlurMaskOp` in blur.h.
+class BlurMaskOp {
+  static const int dilate = 0;
+  static const int erode = 1;
+  static const int open = 2;
+  static const int close = 3;
+  static const int removeSmall = 4;
+  static const int smooth = 5;
+  static const int feather = 6;
+  static const int threshold = 7;
+  static const int gradient = 8;
+}
+
+/// One step of a native mask pipeline (blur_mask_process). Steps run in
+/// order, in place, on one mask buffer.
+class MaskStep {
+  const MaskStep(this.op, {this.radius = 0, this.param = 0});
+
+  /// Square window of 2 * [radius] + 1.
+  const MaskStep.dilate(int radius) : this(BlurMaskOp.dilate, radius: radius);
+  const MaskStep.erode(int radius) : this(BlurMaskOp.erode, radius: radius);
+  const MaskStep.open(int radius) : this(BlurMaskOp.open, radius: radius);
+  const MaskStep.close(int radius) : this(BlurMaskOp.close, radius: radius);
+  const MaskStep.gradient(int radius)
+    : this(BlurMaskOp.gradient, radius: radius);
+
+  /// Clears foreground blobs of fewer than [minArea] pixels.
+  const MaskStep.removeSmall(int minArea)
+    : this(BlurMaskOp.removeSmall, param: minArea);
+
+  /// Gaussian with [sigma] in whole pixels.
+  const MaskStep.smooth(int sigma) : this(BlurMaskOp.smooth, radius: sigma);
+
+  /// Ramps of [inner] pixels inside the edge and [outer] outside it.
+  const MaskStep.feather(int inner, int outer)
+    : this(BlurMaskOp.feather, radius: inner, param: outer);
+
+  const MaskStep.threshold(int level)
+    : this(BlurMaskOp.threshold, param: level);
+
+  final int op;
+  final int radius;
+  final int param;
+
+  /// Flattened op, radius, param triples, as the method channel takes them.
+  static List<int> flatten(List<MaskStep> steps) => [
+    for (final s in steps) ...[s.op, s.radius, s.param],
+  ];
+}
+
+typedef _ApplyExNative =
+    Int32 Function(
+      Pointer<Void> ctx,
+      Pointer<Uint8> pixels,
+      Int32 width,
+      Int32 height,
+      Int32 stride,
+      Int32 format,
+      Pointer<BlurRectNative> rects,
+      Int32 rectCount,
+      Int32 mode,
+      Int32 strength,
+    );
+typedef _ApplyExDart =
+    int Function(
+      Pointer<Void> ctx,
+      Pointer<Uint8> pixels,
+      int width,
+      int height,
+      int stride,
+      int format,
+      Pointer<BlurRectNative> rects,
+      int rectCount,
+      int mode,
+      int strength,
+    );
+typedef _ContextCreateNative = Pointer<Void> Function();
+typedef _ContextDestroyNative = Void Function(Pointer<Void>);
+typedef _ContextDestroyDart = void Function(Pointer<Void>);
+typedef _SetIntNative = Int32 Function(Int32);
+typedef _SetIntDart = int Function(int);
+typedef _PyramidCreateNative =
+    Pointer<Void> Function(
+      Pointer<Uint8> pixels,
+      Int32 width,
+      Int32 height,
+      Int32 stride,
+      Int32 levels,
+    );
+typedef _PyramidCreateDart =
+    Pointer<Void> Function(
+      Pointer<Uint8> pixels,
+      int width,
+      int height,
+      int stride,
+      int levels,
+    );
+typedef _PyramidLevelForNative =
+    Int32 Function(Pointer<Void> pyramid, Int32 width, Int32 height);
+typedef _PyramidLevelForDart =
+    int Function(Pointer<Void> pyramid, int width, int height);
+typedef _PyramidLevelSizeNative =
+    Int32 Function(
+      Pointer<Void> pyramid,
+      Int32 level,
+      Pointer<Int32> width,
+      Pointer<Int32> height,
+    );
+typedef _PyramidLevelSizeDart =
+    int Function(
+      Pointer<Void> pyramid,
+      int level,
+      Pointer<Int32> width,
+      Pointer<Int32> height,
+    );
+typedef _PyramidPreviewNative =
+    Int32 Function(
+      Pointer<Void> pyramid,
+      Pointer<Void> ctx,
+      Int32 level,
+      Pointer<Uint8> dst,
+      Int32 dstStride,
+      Pointer<BlurRectNative> rects,
+      Int32 rectCount,
+      Int32 mode,
+      Int32 strength,
+    );
+typedef _PyramidPreviewDart =
+    int Function(
+      Pointer<Void> pyramid,
+      Pointer<Void> ctx,
+      int level,
+      Pointer<Uint8> dst,
+      int dstStride,
+      Pointer<BlurRectNative> rects,
+      int rectCount,
+      int mode,
+      int strength,
+    );
+typedef _MaskProcessNative =
+    Int32 Function(
+      Pointer<Void> ctx,
+      Pointer<Uint8> mask,
+      Int32 width,
+      Int32 height,
+      Int32 maskStride,
+      Pointer<BlurMaskStepNative> steps,
+      Int32 stepCount,
+    );
+typedef _MaskProcessDart =
+    int Function(
+      Pointer<Void> ctx,
+      Pointer<Uint8> mask,
+      int width,
+      int height,
+      int maskStride,
+      Pointer<BlurMaskStepNative> steps,
+      int stepCount,
+    );
+typedef _ApplyMaskedNative =
+    Int32 Function(
+      Pointer<Void> ctx,
+      Pointer<Uint8> pixels,
+      Int32 width,
+      Int32 height,
+      Int32 stride,
+      Int32 format,
+      Pointer<Uint8> mask,
+      Int32 maskStride,
+      Int32 mode,
+      Int32 fgStrength,
+      Int32 bgStrength,
+    );
+typedef _ApplyMaskedDart =
+    int Function(
+      Pointer<Void> ctx,
+      Pointer<Uint8> pixels,
+      int width,
+      int height,
+      int stride,
+      int format,
+      Pointer<Uint8> mask,
+      int maskStride,
+      int mode,
+      int fgStrength,
+      int bgStrength,
+    );
+typedef _JobDoneNative = Void Function(Pointer<Void>, Int64, Int32);
+typedef _JobSubmitNative =
+    Int64 Function(
+      Pointer<BlurJobSpecNative> spec,
+      Pointer<NativeFunction<_JobDoneNative>> done,
+      Pointer<Void> user,
+    );
+typedef _JobSubmitDart =
+    int Function(
+      Pointer<BlurJobSpecNative> spec,
+      Pointer<NativeFunction<_JobDoneNative>> done,
+      Pointer<Void> user,
+    );
+typedef _JobCancelNative = Int32 Function(Int64);
+typedef _JobCancelDart = int Function(int);
+typedef _StatsReadNative = Int32 Function(Pointer<BlurStatsNative>);
+typedef _StatsReadDart = int Function(Pointer<BlurStatsNative>);
+typedef _StatsResetNative = Void Function();
+typedef _StatsResetDart = void Function();
+
+/// Resolved C entry points. Loaded lazily once per isolate.
+class _BlurCoreLibrary {
+  _BlurCoreLibrary(DynamicLibrary lib)
+    : applyEx = lib.lookupFunction<_ApplyExNative, _ApplyExDart>(
+        'blur_apply_regions_ex',
+      ),
+      contextCreate = lib
+          .lookupFunction<_ContextCreateNative, _ContextCreateNative>(
+            'blur_context_create',
+          ),
+      contextDestroy = lib
+          .lookupFunction<_ContextDestroyNative, _ContextDestroyDart>(
+            'blur_context_destroy',
+          ),
+      contextDestroyPtr = lib
+          .lookup<NativeFunction<_ContextDestroyNative>>(
+            'blur_context_destroy',
+          ),
+      contextCancel = lib
+          .lookupFunction<_ContextDestroyNative, _ContextDestroyDart>(
+            'blur_context_cancel',
+          ),
+      setThreadCount = lib.lookupFunction<_SetIntNative, _SetIntDart>(
+        'blur_set_thread_count',
+      ),
+      pyramidCreate = lib
+          .lookupFunction<_PyramidCreateNative, _PyramidCreateDart>(
+            'blur_pyramid_create',
+          ),
+      pyramidDestroyPtr = lib
+          .lookup<NativeFunction<_ContextDestroyNative>>(
+            'blur_pyramid_destroy',
+          ),
+      pyramidLevelFor = lib
+          .lookupFunction<_PyramidLevelForNative, _PyramidLevelForDart>(
+            'blur_pyramid_level_for',
+          ),
+      pyramidLevelSize = lib
+          .lookupFunction<_PyramidLevelSizeNative, _PyramidLevelSizeDart>(
+            'blur_pyramid_level_size',
+          ),
+      pyramidPreview = lib
+          .lookupFunction<_PyramidPreviewNative, _PyramidPreviewDart>(
+            'blur_pyramid_preview',
+          ),
+      statsRead = lib.lookupFunction<_StatsReadNative, _StatsReadDart>(
+        'blur_stats_read',
+      ),
+      statsReset = lib.lookupFunction<_StatsResetNative, _StatsResetDart>(
+        'blur_stats_reset',
+      ),
+      statsEnable = lib.lookupFunction<_SetIntNative, _SetIntDart>(
+        'blur_stats_enable',
+      ),
+      maskProcess = lib.lookupFunction<_MaskProcessNative, _MaskProcessDart>(
+        'blur_mask_process',
+      ),
+      applyMasked = lib.lookupFunction<_ApplyMaskedNative, _ApplyMaskedDart>(
+        'blur_apply_masked',
+      ),
+      jobSubmit = lib.lookupFunction<_JobSubmitNative, _JobSubmitDart>(
+        'blur_job_submit',
+      ),
+      jobCancel = lib.lookupFunction<_JobCancelNative, _JobCancelDart>(
+        'blur_job_cancel',
+      );
+
+  final _ApplyExDart applyEx;
+  final Pointer<Void> Function() contextCreate;
+  final _ContextDestroyDart contextDestroy;
+  final Pointer<NativeFunction<_ContextDestroyNative>> contextDestroyPtr;
+  final _ContextDestroyDart contextCancel;
+  final _SetIntDart setThreadCount;
+  final _PyramidCreateDart pyramidCreate;
+  final Pointer<NativeFunction<_ContextDestroyNative>> pyramidDestroyPtr;
+  final _PyramidLevelForDart pyramidLevelFor;
+  final _PyramidLevelSizeDart pyramidLevelSize;
+  final _PyramidPreviewDart pyramidPreview;
+  final _StatsReadDart statsRead;
+  final _StatsResetDart statsReset;
+  final _SetIntDart statsEnable;
+  final _MaskProcessDart maskProcess;
+  final _ApplyMaskedDart applyMasked;
+  final _JobSubmitDart jobSubmit;
+  final _JobCancelDart jobCancel;
+
+  static _BlurCoreLibrary? _instance;
+  static bool _loadFailed = false;
+
+  static _BlurCoreLibrary? get instance {
+    if (_instance != null || _loadFailed) return _instance;
+    try {
+      _instance = _BlurCoreLibrary(_open());
+    } catch (_) {
+      // Library missing (e.g. host unit tests) or built without the C API
+      _loadFailed = true;
+    }
+    return _instance;
+  }
+
+  static DynamicLibrary _open() {
+    if (Platform.isAndroid || Platform.isLinux) {
+      return DynamicLibrary.open('libblurcore.so');
+    }
+    if (Platform.isIOS || Platform.isMacOS) {
+      // Statically linked into the app binary
+      return DynamicLibrary.process();
+    }
+    if (Platform.isWindows) return DynamicLibrary.open('blurcore.dll');
+    throw UnsupportedError('blurcore is not available on this platform');
+  }
+}
+
+/// RGBA (or any [BlurPixelFormat]) pixels in native memory.
+///
+/// [bytes] is a view over the native allocation, not a copy: writes through
+/// it are seen by the blur core and vice versa. Call [dispose] when done;
+/// buffers that are dropped without it are freed by a finalizer.
+class NativePixelBuffer implements Finalizable {
+  NativePixelBuffer(
+    this.width,
+    this.height, {
+    int? stride,
+    this.format = BlurPixelFormat.rgba8888,
+  }) : stride = stride ?? width * _bytesPerPixel(format),
+       _owned = true {
+    _pointer = malloc<Uint8>(byteLength);
+    _finalizer.attach(
+      this,
+      _pointer.cast(),
+      detach: this,
+      externalSize: byteLength,
+    );
+  }
 
-class FfiBlur {
+  /// A view over memory owned by another [NativePixelBuffer], typically in
+  /// another isolate. It never frees the memory.
+  NativePixelBuffer.fromAddress(
+    int address,
+    this.width,
+    this.height, {
+    required this.stride,
+    this.format = BlurPixelFormat.rgba8888,
+  }) : _owned = false {
+    _pointer = Pointer<Uint8>.fromAddress(address);
+  }
+
+  static final _finalizer = NativeFinalizer(malloc.nativeFree);
+
+  final int width;
+  final int height;
+
+  /// Bytes per row (of the luma plane for NV21).
+  final int stride;
+  final int format;
+  final bool _owned;
+  late Pointer<Uint8> _pointer;
+  bool _disposed = false;
+
+  int get byteLength => format == BlurPixelFormat.nv21
+      ? stride * (height + (height + 1) ~/ 2)
+      : stride * height;
+
+  /// Address to hand to another isolate via [NativePixelBuffer.fromAddress].
+  int get address => _pointer.address;
+
+  Pointer<Uint8> get pointer {
+    if (_disposed) throw StateError('NativePixelBuffer used after dispose');
+    return _pointer;
+  }
+
+  /// Zero-copy view of the pixels.
+  Uint8List get bytes => pointer.asTypedList(byteLength);
+
+  void dispose() {
+    if (_disposed) return;
+    _disposed = true;
+    if (_owned) {
+      _finalizer.detach(this);
+      malloc.free(_pointer);
+    }
+  }
+
+  static int _bytesPerPixel(int format) {
+    switch (format) {
+      case BlurPixelFormat.rgb888:
+        return 3;
+      case BlurPixelFormat.gray8:
+      case BlurPixelFormat.nv21:
+        return 1;
+      default:
+        return 4;
+    }
+  }
+}
+
+class FfiBlur implements Finalizable {
   FfiBlur();
 
+  /// Uses a context owned by another [FfiBlur] (see [contextAddress]),
+  /// typically in another isolate. [dispose] never frees it.
+  FfiBlur._borrowed(int contextAddress)
+    : _context = Pointer<Void>.fromAddress(contextAddress),
+      _ownsContext = false;
+
+  /// Returned when the native library could not be loaded.
+  static const int errorUnavailable = -100;
+
+  /// Returned by a blur that was stopped through [cancel].
+  static const int errorCancelled = -5;
+
+  static bool get isAvailable => _BlurCoreLibrary.instance != null;
+
+  /// Threads used by blur calls (<= 0 means one per core). Applies to the
+  /// whole process.
+  static int setThreadCount(int threads) =>
+      _BlurCoreLibrary.instance?.setThreadCount(threads) ?? errorUnavailable;
+
+  // Context scratch and the rect array are reused across calls on this
+  // instance, so steady-state calls allocate nothing.
+  Pointer<Void> _context = nullptr;
+  bool _ownsContext = true;
+  Pointer<BlurRectNative> _rects = nullptr;
+  int _rectCapacity = 0;
+
+  static final _rectFinalizer = NativeFinalizer(malloc.nativeFree);
+
   /// Apply blur effect to image pixels.
   ///
   /// Parameters:
   /// - [pixels]: raw RGBA bytes (length should be width * height * 4)
   /// - [width],[height]: image dimensions
-  /// - [rects]: list of 4-int rectangles (l,t,r,b) flattened or empty to apply to whole image
-  /// - [mode]: blur mode id (0 = gaussian, 1 = pixelate, etc.)
-  /// - [strength]: blur strength (0-100)
+  /// - [rects]: flattened x,y,w,h rectangles, or empty to apply to the whole image
+  /// - [mode]: 0 = box, 1 = pixelate, 2 = gaussian, 3 = box and 4 = pixelate
+  ///   from a summed-area table (faster for many rects or large radii)
+  /// - [strength]: radius, block size or sigma in pixels
   ///
-  /// Returns 0 on success, non-zero on error. Currently this is a no-op
-  /// stub that returns success so higher-level code can be exercised in tests.
+  /// [pixels] is copied into native memory and back; use [applyToBuffer]
+  /// to avoid both copies. Returns 0 on success, non-zero on error.
   int apply(
     Uint8List pixels,
     int width,
@@ -31,9 +581,578 @@ class FfiBlur {
     int mode,
     int strength,
   ) {
-    // For now, do a basic validation to help catch incorrect usage in tests.
     if (pixels.length < width * height * 4) return 1;
-    // No-op success
-    return 0;
+    if (!isAvailable) return errorUnavailable;
+
+    final buffer = NativePixelBuffer(width, height);
+    try {
+      buffer.bytes.setRange(0, width * height * 4, pixels);
+      final rc = applyToBuffer(buffer, rects, mode, strength);
+      if (rc == 0) pixels.setRange(0, width * height * 4, buffer.bytes);
+      return rc;
+    } finally {
+      buffer.dispose();
+    }
+  }
+
+  /// Blur [buffer] in place. Returns the blur_apply_regions_ex status
+  /// ([errorCancelled] if [cancel] stopped it).
+  int applyToBuffer(
+    NativePixelBuffer buffer,
+    List<int> rects,
+    int mode,
+    int strength,
+  ) {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null) return errorUnavailable;
+    if (!_ensureContext(lib)) return -3;
+
+    final count = _fillRects(rects, buffer.width, buffer.height);
+    return lib.applyEx(
+      _context,
+      buffer.pointer,
+      buffer.width,
+      buffer.height,
+      buffer.stride,
+      buffer.format,
+      _rects,
+      count,
+      mode,
+      strength,
+    );
+  }
+
+  /// Run [steps] on a [BlurPixelFormat.gray8] [mask] in place, in one
+  /// native call. Only the mask's non-zero bounding box (grown by each
+  /// step's reach) is processed. The mask stays in native memory, ready for
+  /// [applyMasked]. Returns the blur_mask_process status.
+  int processMask(NativePixelBuffer mask, List<MaskStep> steps) {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null) return errorUnavailable;
+    if (mask.format != BlurPixelFormat.gray8) return -1;
+    if (!_ensureContext(lib)) return -3;
+
+    final native = malloc<BlurMaskStepNative>(
+      steps.isEmpty ? 1 : steps.length,
+    );
+    try {
+      for (var i = 0; i < steps.length; ++i) {
+        native[i]
+          ..op = steps[i].op
+          ..radius = steps[i].radius
+          ..param = steps[i].param;
+      }
+      return lib.maskProcess(
+        _context,
+        mask.pointer,
+        mask.width,
+        mask.height,
+        mask.stride,
+        native,
+        steps.length,
+      );
+    } finally {
+      malloc.free(native);
+    }
+  }
+
+  /// Portrait blend of [pixels] in place: [fgStrength] where [mask] (gray8,
+  /// same size, 255 = foreground) is set, [bgStrength] elsewhere. [mode] is
+  /// 0 (box) or 2 (gaussian). Returns the blur_apply_masked status.
+  int applyMasked(
+    NativePixelBuffer pixels,
+    NativePixelBuffer mask, {
+    int mode = 2,
+    int fgStrength = 0,
+    required int bgStrength,
+  }) {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null) return errorUnavailable;
+    if (mask.width != pixels.width || mask.height != pixels.height) return -1;
+    if (!_ensureContext(lib)) return -3;
+    return lib.applyMasked(
+      _context,
+      pixels.pointer,
+      pixels.width,
+      pixels.height,
+      pixels.stride,
+      pixels.format,
+      mask.pointer,
+      mask.stride,
+      mode,
+      fgStrength,
+      bgStrength,
+    );
+  }
+
+  /// Native context address, created on demand (0 if the library is
+  /// missing). Pass it to [applyInBackground] so [cancel] on this instance
+  /// can stop the background blur.
+  int get contextAddress {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null || !_ensureContext(lib)) return 0;
+    return _context.address;
+  }
+
+  /// Ask the blur running on this instance's context, on any thread or
+  /// isolate, to stop early. It returns [errorCancelled]; the next call on
+  /// the context runs normally.
+  void cancel() {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib != null && _context != nullptr) lib.contextCancel(_context);
+  }
+
+  /// Blur [buffer] on a background isolate. Only the native address is sent
+  /// across, so nothing is copied; [buffer] must stay alive (not disposed)
+  /// until the returned future completes. With [contextAddress] the blur
+  /// runs on that context, which must stay alive too and can be cancelled
+  /// from the calling isolate; only one blur may use it at a time.
+  ///
+  /// A blur clears a pending [cancel] when it starts, so a cancel sent while
+  /// the isolate is still spinning up would be lost. With [generationAddress]
+  /// (a native Int64 the caller bumps before cancelling) the isolate returns
+  /// [errorCancelled] without blurring if the value there no longer equals
+  /// [generation] by the time it is ready to call in.
+  static Future<int> applyInBackground(
+    NativePixelBuffer buffer,
+    List<int> rects,
+    int mode,
+    int strength, {
+    int contextAddress = 0,
+    int generationAddress = 0,
+    int generation = 0,
+  }) {
+    final address = buffer.address;
+    final width = buffer.width;
+    final height = buffer.height;
+    final stride = buffer.stride;
+    final format = buffer.format;
+    final rectList = List<int>.of(rects);
+    return Isolate.run(() {
+      if (generationAddress != 0 &&
+          Pointer<Int64>.fromAddress(generationAddress).value != generation) {
+        return errorCancelled;
+      }
+      final view = NativePixelBuffer.fromAddress(
+        address,
+        width,
+        height,
+        stride: stride,
+        format: format,
+      );
+      final blur = contextAddress != 0
+          ? FfiBlur._borrowed(contextAddress)
+          : FfiBlur();
+      try {
+        return blur.applyToBuffer(view, rectList, mode, strength);
+      } finally {
+        blur.dispose();
+      }
+    });
+  }
+
+  /// Queue a blur of [buffer] on the native worker pool and return at once.
+  /// [rects] are flattened x,y,w,h (empty: the whole image); with [mask]
+  /// (gray8, same size) the job is a portrait blend like [applyMasked]
+  /// instead, using [fgStrength] and [strength] for the background.
+  /// [preview] jobs run ahead of queued exports, and a non-zero [tag]
+  /// cancels unfinished jobs submitted with the same tag. [buffer] and
+  /// [mask] must stay alive until [FfiBlurJob.done] completes. Returns null
+  /// if the library is missing or the job was rejected.
+  static FfiBlurJob? submit(
+    NativePixelBuffer buffer,
+    List<int> rects,
+    int mode,
+    int strength, {
+    NativePixelBuffer? mask,
+    int fgStrength = 0,
+    bool preview = false,
+    int tag = 0,
+  }) {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null) return null;
+    if (mask != null &&
+        (mask.width != buffer.width || mask.height != buffer.height)) {
+      return null;
+    }
+    final count = rects.length ~/ 4;
+    final spec = calloc<BlurJobSpecNative>();
+    final nativeRects = malloc<BlurRectNative>(count == 0 ? 1 : count);
+    try {
+      for (var i = 0; i < count; ++i) {
+        nativeRects[i]
+          ..x = rects[i * 4]
+          ..y = rects[i * 4 + 1]
+          ..w = rects[i * 4 + 2]
+          ..h = rects[i * 4 + 3];
+      }
+      spec.ref
+        ..kind = mask == null ? 0 : 1
+        ..priority = preview ? 1 : 0
+        ..tag = tag
+        ..pixels = buffer.pointer
+        ..width = buffer.width
+        ..height = buffer.height
+        ..stride = buffer.stride
+        ..format = buffer.format
+        ..rects = nativeRects
+        ..rectCount = count
+        ..mask = mask?.pointer ?? nullptr
+        ..maskStride = mask?.stride ?? 0
+        ..mode = mode
+        ..strength = strength
+        ..fgStrength = fgStrength
+        ..bgStrength = strength;
+      // Completion arrives on a worker thread; the listener posts it to this
+      // isolate's event loop
+      final job = FfiBlurJob._(lib);
+      final callable = NativeCallable<_JobDoneNative>.listener((
+        Pointer<Void> user,
+        int id,
+        int status,
+      ) {
+        job._complete(status);
+      });
+      job._callable = callable;
+      final id = lib.jobSubmit(spec, callable.nativeFunction, nullptr);
+      if (id <= 0) {
+        callable.close();
+        return null;
+      }
+      job.id = id;
+      return job;
+    } finally {
+      malloc.free(nativeRects);
+      calloc.free(spec);
+    }
+  }
+
+  /// Free the native context and rect array. The instance can still be used
+  /// afterwards; they are recreated on demand.
+  void dispose() {
+    final lib = _BlurCoreLibrary.instance;
+    if (_context != nullptr && lib != null && _ownsContext) {
+      _contextFinalizer?.detach(_contextToken);
+      lib.contextDestroy(_context);
+    }
+    _context = nullptr;
+    if (_rects != nullptr) {
+      _rectFinalizer.detach(_rectToken);
+      malloc.free(_rects);
+    }
+    _rects = nullptr;
+    _rectCapacity = 0;
+  }
+
+  // Detach tokens, one per finalizer attachment
+  final Object _contextToken = Object();
+  final Object _rectToken = Object();
+  static NativeFinalizer? _contextFinalizer;
+
+  bool _ensureContext(_BlurCoreLibrary lib) {
+    if (_context != nullptr) return true;
+    _ownsContext = true;
+    _context = lib.contextCreate();
+    if (_context == nullptr) return false;
+    _contextFinalizer ??= NativeFinalizer(lib.contextDestroyPtr.cast());
+    _contextFinalizer!.attach(this, _context, detach: _contextToken);
+    return true;
+  }
+
+  /// Copy flattened x,y,w,h [rects] (empty: the whole image) into the
+  /// native rect array and return their count.
+  int _fillRects(List<int> rects, int width, int height) {
+    final count = rects.isEmpty ? 1 : rects.length ~/ 4;
+    _ensureRects(count);
+    if (rects.isEmpty) {
+      _rects[0]
+        ..x = 0
+        ..y = 0
+        ..w = width
+        ..h = height;
+    } else {
+      for (var i = 0; i < count; ++i) {
+        _rects[i]
+          ..x = rects[i * 4]
+          ..y = rects[i * 4 + 1]
+          ..w = rects[i * 4 + 2]
+          ..h = rects[i * 4 + 3];
+      }
+    }
+    return count;
+  }
+
+  void _ensureRects(int count) {
+    if (count <= _rectCapacity) return;
+    if (_rects != nullptr) {
+      _rectFinalizer.detach(_rectToken);
+      malloc.free(_rects);
+    }
+    _rects = malloc<BlurRectNative>(count);
+    _rectCapacity = count;
+    _rectFinalizer.attach(this, _rects.cast(), detach: _rectToken);
+  }
+}
+
+/// A blur queued by [FfiBlur.submit].
+class FfiBlurJob {
+  FfiBlurJob._(this._lib);
+
+  final _BlurCoreLibrary _lib;
+  final _done = Completer<int>();
+  NativeCallable<_JobDoneNative>? _callable;
+  late final int id;
+
+  /// The blur status: 0, [FfiBlur.errorCancelled] if cancelled or
+  /// superseded by a job with the same tag, or another negative status.
+  Future<int> get done => _done.future;
+
+  /// Stop the job from any point; [done] still completes. Returns false if
+  /// it had already finished.
+  bool cancel() => !_done.isCompleted && _lib.jobCancel(id) == 0;
+
+  void _complete(int status) {
+    _callable?.close();
+    _callable = null;
+    _done.complete(status);
+  }
+}
+
+/// Timings of one native stage, in nanoseconds. Percentiles come from
+/// log-linear buckets and are within about 12%.
+class NativeStageStats {
+  const NativeStageStats({
+    required this.count,
+    required this.totalNs,
+    required this.maxNs,
+    required this.p50Ns,
+    required this.p90Ns,
+    required this.p99Ns,
+    required this.bytes,
+  });
+
+  final int count;
+  final int totalNs;
+  final int maxNs;
+  final int p50Ns;
+  final int p90Ns;
+  final int p99Ns;
+
+  /// Bytes moved, for the copy stages.
+  final int bytes;
+}
+
+/// Occupancy of the session layer cache.
+class NativeLayerCacheStats {
+  const NativeLayerCacheStats({
+    required this.hits,
+    required this.misses,
+    required this.interpolated,
+    required this.bytes,
+    required this.limitBytes,
+    required this.layers,
+  });
+
+  /// Renders served from a cached layer.
+  final int hits;
+
+  /// Layers blurred from the original.
+  final int misses;
+
+  /// Renders blended from the two nearest cached strengths.
+  final int interpolated;
+  final int bytes;
+  final int limitBytes;
+  final int layers;
+
+  double get hitRate {
+    final lookups = hits + misses;
+    return lookups == 0 ? 0 : hits / lookups;
+  }
+}
+
+/// Snapshot of the blur core's instrumentation (blur_stats_read).
+class NativeBlurStats {
+  NativeBlurStats._(
+    this.stages,
+    this.poolHits,
+    this.poolMisses,
+    this.poolIdleBytes,
+    this.poolInUseBytes,
+    this.layerCache,
+  );
+
+  /// Stage names in `BlurStage` order.
+  static const List<String> stageNames = [
+    'copy_in',
+    'blur_h',
+    'blur_v',
+    'pixelate',
+    'integral',
+    'blend',
+    'copy_out',
+    'mask',
+  ];
+
+  /// Keyed by [stageNames].
+  final Map<String, NativeStageStats> stages;
+  final int poolHits;
+  final int poolMisses;
+  final int poolIdleBytes;
+  final int poolInUseBytes;
+
+  /// Blurred layers cached by editing sessions.
+  final NativeLayerCacheStats layerCache;
+
+  double get poolHitRate {
+    final lookups = poolHits + poolMisses;
+    return lookups == 0 ? 0 : poolHits / lookups;
+  }
+
+  /// Current counters, or null if the library is missing.
+  static NativeBlurStats? read() {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null) return null;
+    final out = malloc<BlurStatsNative>();
+    try {
+      if (lib.statsRead(out) != 0) return null;
+      final s = out.ref;
+      final stages = <String, NativeStageStats>{};
+      for (var i = 0; i < stageNames.length; i++) {
+        final st = s.stages[i];
+        stages[stageNames[i]] = NativeStageStats(
+          count: st.count,
+          totalNs: st.totalNs,
+          maxNs: st.maxNs,
+          p50Ns: st.p50Ns,
+          p90Ns: st.p90Ns,
+          p99Ns: st.p99Ns,
+          bytes: st.bytes,
+        );
+      }
+      return NativeBlurStats._(
+        stages,
+        s.poolHits,
+        s.poolMisses,
+        s.poolIdleBytes,
+        s.poolInUseBytes,
+        NativeLayerCacheStats(
+          hits: s.layerCacheHits,
+          misses: s.layerCacheMisses,
+          interpolated: s.layerCacheInterpolated,
+          bytes: s.layerCacheBytes,
+          limitBytes: s.layerCacheLimitBytes,
+          layers: s.layerCacheLayers,
+        ),
+      );
+    } finally {
+      malloc.free(out);
+    }
+  }
+
+  static void reset() => _BlurCoreLibrary.instance?.statsReset();
+
+  /// Turns stage timing on or off for the whole process; returns the
+  /// previous setting.
+  static bool setEnabled(bool enabled) =>
+      (_BlurCoreLibrary.instance?.statsEnable(enabled ? 1 : 0) ?? 0) != 0;
+}
+
+/// Half, quarter and eighth resolution copies of an RGBA image, built once
+/// per image for fast previews (native/src/pyramid.cpp).
+///
+/// [source] is level 0 and is not copied; the pyramid does not keep a
+/// reference to it after construction.
+class NativePyramid implements Finalizable {
+  NativePyramid._(this._pyramid, this.width, this.height);
+
+  /// Build up to [levels] downsampled levels of [source], or return null if
+  /// the library is missing or the build fails.
+  static NativePyramid? build(NativePixelBuffer source, {int levels = 3}) {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null || source.format != BlurPixelFormat.rgba8888) return null;
+    final handle = lib.pyramidCreate(
+      source.pointer,
+      source.width,
+      source.height,
+      source.stride,
+      levels,
+    );
+    if (handle == nullptr) return null;
+    final pyramid = NativePyramid._(handle, source.width, source.height);
+    _finalizer ??= NativeFinalizer(lib.pyramidDestroyPtr.cast());
+    _finalizer!.attach(pyramid, handle, detach: pyramid);
+    return pyramid;
+  }
+
+  static NativeFinalizer? _finalizer;
+
+  final int width;
+  final int height;
+  Pointer<Void> _pyramid;
+
+  /// Smallest level that still covers a [viewportWidth] x [viewportHeight]
+  /// view; 0 means only the full-resolution source does.
+  int levelFor(int viewportWidth, int viewportHeight) {
+    if (_pyramid == nullptr) return 0;
+    return _BlurCoreLibrary.instance!.pyramidLevelFor(
+      _pyramid,
+      viewportWidth,
+      viewportHeight,
+    );
+  }
+
+  /// (width, height) of [level], or null if it does not exist.
+  (int, int)? levelSize(int level) {
+    if (_pyramid == nullptr) return null;
+    final out = malloc<Int32>(2);
+    try {
+      final rc = _BlurCoreLibrary.instance!.pyramidLevelSize(
+        _pyramid,
+        level,
+        out,
+        out + 1,
+      );
+      return rc == 0 ? (out[0], out[1]) : null;
+    } finally {
+      malloc.free(out);
+    }
+  }
+
+  /// Copy [level] (>= 1) into [dst] and blur it. [rects] and [strength] are
+  /// in source coordinates; the core scales them to the level. [blur]
+  /// supplies the context and rect array. Returns the native status.
+  int preview(
+    FfiBlur blur,
+    int level,
+    NativePixelBuffer dst,
+    List<int> rects,
+    int mode,
+    int strength,
+  ) {
+    final lib = _BlurCoreLibrary.instance;
+    if (lib == null) return FfiBlur.errorUnavailable;
+    if (_pyramid == nullptr) return -1;
+    if (!blur._ensureContext(lib)) return -3;
+    final count = blur._fillRects(rects, width, height);
+    return lib.pyramidPreview(
+      _pyramid,
+      blur._context,
+      level,
+      dst.pointer,
+      dst.stride,
+      blur._rects,
+      count,
+      mode,
+      strength,
+    );
+  }
+
+  void dispose() {
+    if (_pyramid == nullptr) return;
+    _finalizer?.detach(this);
+    final lib = _BlurCoreLibrary.instance;
+    lib?.pyramidDestroyPtr.asFunction<_ContextDestroyDart>()(_pyramid);
+    _pyramid = nullptr;
   }
 }
@@ -1,7 +1,12 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ui' show Offset;
+
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 import '../features/editor/blur_pipeline.dart';
+import 'blur_bindings.dart' show MaskStep;
 
 /// Native blur core bindings for enhanced processing
 ///
@@ -70,6 +75,26 @@ class NativeBlurBindings {
     }
   }
 
+  /// Start the one-time native setup (SIMD kernels, worker pool, engines and
+  /// both tflite models) on a background thread. Returns as soon as it has
+  /// started; calls made meanwhile wait natively for the part they need.
+  /// Only the first call does anything. Pass null to skip a model.
+  static Future<bool> warmUp({
+    String? segmentationModel = 'assets/models/selfie_segmentation.tflite',
+    String? faceModel = 'assets/models/face_detection_short_range.tflite',
+  }) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('warmUp', {
+        'segmentationModel': segmentationModel,
+        'faceModel': faceModel,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('NativeBlurBindings error starting warm-up: $e');
+      return false;
+    }
+  }
+
   /// Initialize MediaPipe segmentation (Phase 1)
   static Future<bool> initializeSegmentation({
     String modelPath = 'assets/models/selfie_segmentation.tflite',
@@ -91,6 +116,82 @@ class NativeBlurBindings {
     }
   }
 
+  /// Initialize native face detection for [blurFaces] (Phase 1)
+  static Future<bool> initializeFaceDetection({
+    String modelPath = 'assets/models/face_detection_short_range.tflite',
+  }) async {
+    try {
+      final result = await _channel.invokeMethod<bool>(
+        'initializeFaceDetection',
+        {'modelPath': modelPath},
+      );
+      return result ?? false;
+    } catch (e) {
+      debugPrint('NativeBlurBindings error initializing face detection: $e');
+      return false;
+    }
+  }
+
+  /// Detect faces and blur them natively in one call; the face boxes stay
+  /// on the native side. [padding] grows each face by that fraction of its
+  /// size per side. Returns the blurred image, or null on failure.
+  static Future<Uint8List?> blurFaces(
+    Uint8List imageBytes, {
+    int mode = 2,
+    int strength = 12,
+    double padding = 0.25,
+  }) async {
+    try {
+      final result = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+        'blurFaces',
+        {
+          'imageBytes': imageBytes,
+          'mode': mode,
+          'strength': strength,
+          'padding': padding,
+        },
+      );
+      return result?['imageBytes'] as Uint8List?;
+    } catch (e) {
+      debugPrint('NativeBlurBindings error in face blur: $e');
+      return null;
+    }
+  }
+
+  /// Blur a very large photo file (50-200 MP) strip by strip so it is never
+  /// decoded whole. [rects] holds x, y, w, h quadruples in image pixels.
+  /// A JPEG [input] with a `.jpg` [output] is redacted in place of its
+  /// compressed blocks when the native library has libjpeg-turbo, so only
+  /// the rects are decoded and re-encoded; otherwise the result is a PNG.
+  /// Returns 0 on success or a negative blurcore status (-7 unreadable
+  /// input, -8 output not written).
+  static Future<int> exportLargeImage(
+    String input,
+    String output, {
+    required List<int> rects,
+    int mode = 2,
+    int strength = 12,
+    int stripRows = 256,
+  }) async {
+    try {
+      final status = await _channel.invokeMethod<int>(
+        'exportLargeImage',
+        {
+          'input': input,
+          'output': output,
+          'rects': rects,
+          'mode': mode,
+          'strength': strength,
+          'stripRows': stripRows,
+        },
+      );
+      return status ?? -1;
+    } catch (e) {
+      debugPrint('NativeBlurBindings error in large image export: $e');
+      return -1;
+    }
+  }
+
   /// Apply basic native blur (Phase 1 - preparation for MediaPipe)
   static Future<Uint8List?> processImageBasic(
     Uint8List imageBytes,
@@ -255,7 +356,8 @@ class NativeBlurBindings {
     }
   }
 
-  /// Phase 3: Optimize mask using connected components analysis
+  /// Phase 3: Optimize mask: drop blobs under [minArea] pixels, an
+  /// edge-preserving guided-filter cleanup, binarize and close
   static Future<Uint8List?> optimizeMask(
     Uint8List maskBytes,
     int width,
@@ -276,6 +378,36 @@ class NativeBlurBindings {
     }
   }
 
+  /// Snap a coarse mask to the photo's edges with a guided filter, e.g. a
+  /// low-resolution segmentation upscaled to the photo. [imageBytes] are
+  /// RGBA pixels of the same size; [eps] on the [0, 1] scale trades edge
+  /// fidelity (small) for smoothness. Blobs under [minArea] pixels are
+  /// dropped first. Returns the soft refined mask.
+  static Future<Uint8List?> refineMaskGuided(
+    Uint8List imageBytes,
+    Uint8List maskBytes,
+    int width,
+    int height, {
+    int radius = 8,
+    double eps = 1e-3,
+    int minArea = 0,
+  }) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('refineMaskGuided', {
+        'imageBytes': imageBytes,
+        'maskBytes': maskBytes,
+        'width': width,
+        'height': height,
+        'radius': radius,
+        'eps': eps,
+        'minArea': minArea,
+      });
+    } catch (e) {
+      debugPrint('NativeBlurBindings error in guided mask refinement: $e');
+      return null;
+    }
+  }
+
   /// Phase 3: Create feathered mask using dual distance transforms
   static Future<Uint8List?> createFeatheredMask(
     Uint8List maskBytes,
@@ -299,6 +431,11 @@ class NativeBlurBindings {
   }
 
   /// Phase 3: Apply complete mask processing pipeline
+  ///
+  /// All steps run in one native call, in place on one buffer and only over
+  /// the mask's bounding box, so the mask crosses the channel once each way.
+  /// With [keepNative] the result also stays on the native side for
+  /// [applySelectiveBlurWithProcessedMask].
   static Future<Uint8List?> processAdvancedMask(
     Uint8List maskBytes,
     int width,
@@ -308,84 +445,146 @@ class NativeBlurBindings {
     double edgeBlurSigma = 1.0,
     int? minArea,
     int? featherRadius,
+    bool keepNative = false,
   }) async {
-    Uint8List? processedMask = maskBytes;
-
-    try {
-      // Step 1: Apply morphological operations if specified
-      if (morphOperation != null) {
-        processedMask = await refineMask(
-          processedMask,
-          width,
-          height,
-          operation: morphOperation,
-          kernelSize: morphKernelSize,
-        );
-        if (processedMask == null) return null;
-        debugPrint(
-          'NativeBlurBindings: Applied morphological operation: $morphOperation',
-        );
-      }
-
-      // Step 2: Optimize mask with connected components if specified
-      if (minArea != null) {
-        processedMask = await optimizeMask(
-          processedMask,
-          width,
-          height,
-          minArea: minArea,
-        );
-        if (processedMask == null) return null;
-        debugPrint(
-          'NativeBlurBindings: Optimized mask with min area: $minArea',
-        );
-      }
+    final steps = <MaskStep>[];
+    final radius = morphKernelSize ~/ 2;
+    switch (morphOperation) {
+      case 'dilate':
+        steps.add(MaskStep.dilate(radius));
+      case 'erode':
+        steps.add(MaskStep.erode(radius));
+      case 'opening':
+        steps.add(MaskStep.open(radius));
+      case 'closing':
+        steps.add(MaskStep.close(radius));
+      case 'gradient':
+        steps.add(MaskStep.gradient(radius));
+    }
+    if (minArea != null) {
+      // As optimizeMask, less the guided cleanup: drop blobs, binarize,
+      // close 5x5
+      steps.addAll([
+        MaskStep.removeSmall(minArea),
+        const MaskStep.threshold(127),
+        const MaskStep.close(2),
+      ]);
+    }
+    final sigma = edgeBlurSigma.round();
+    if (sigma > 0) steps.add(MaskStep.smooth(sigma));
+    if (featherRadius != null) {
+      // Outer ramp as createFeatheredMask's default
+      steps.add(MaskStep.feather(featherRadius, 15));
+    }
 
-      // Step 3: Smooth edges
-      processedMask = await smoothMaskEdges(
-        processedMask,
-        width,
-        height,
-        blurSigma: edgeBlurSigma,
-      );
-      if (processedMask == null) return null;
-      debugPrint(
-        'NativeBlurBindings: Smoothed mask edges with sigma: $edgeBlurSigma',
-      );
+    return processMaskPipeline(
+      maskBytes,
+      width,
+      height,
+      steps,
+      keepNative: keepNative,
+    );
+  }
 
-      // Step 4: Apply feathering if specified
-      if (featherRadius != null) {
-        processedMask = await createFeatheredMask(
-          processedMask,
-          width,
-          height,
-          featherRadius: featherRadius,
-        );
-        if (processedMask == null) return null;
-        debugPrint(
-          'NativeBlurBindings: Applied feathering with radius: $featherRadius',
-        );
-      }
+  /// Run [steps] on a mask in one native call (see [MaskStep]).
+  static Future<Uint8List?> processMaskPipeline(
+    Uint8List maskBytes,
+    int width,
+    int height,
+    List<MaskStep> steps, {
+    bool keepNative = false,
+  }) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('processMaskPipeline', {
+        'maskBytes': maskBytes,
+        'width': width,
+        'height': height,
+        'steps': MaskStep.flatten(steps),
+        'keepNative': keepNative,
+      });
+    } catch (e) {
+      debugPrint('NativeBlurBindings error in mask pipeline: $e');
+      return null;
+    }
+  }
 
-      return processedMask;
+  /// Selective blur with the mask kept by the last [processAdvancedMask] or
+  /// [processMaskPipeline] call with `keepNative`, so the mask is not sent
+  /// again. The image must have the mask's size.
+  static Future<Uint8List?> applySelectiveBlurWithProcessedMask(
+    Uint8List imageBytes, {
+    double foregroundSigma = 0.0,
+    double backgroundSigma = 5.0,
+  }) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('applySelectiveBlur', {
+        'imageBytes': imageBytes,
+        'useProcessedMask': true,
+        'foregroundSigma': foregroundSigma,
+        'backgroundSigma': backgroundSigma,
+      });
     } catch (e) {
-      debugPrint('NativeBlurBindings error in advanced mask processing: $e');
+      debugPrint('NativeBlurBindings error in selective blur: $e');
       return null;
     }
   }
 
-  /// Get device processing capabilities
+  /// Free the mask kept by `keepNative`.
+  static Future<void> releaseProcessedMask() async {
+    try {
+      await _channel.invokeMethod<bool>('releaseProcessedMask');
+    } catch (e) {
+      debugPrint('NativeBlurBindings error releasing processed mask: $e');
+    }
+  }
+
+  /// Get device processing capabilities. `governor` holds the measured
+  /// backend timings (`backends`: ms per megapixel by size and strength),
+  /// the backend each case `routes` to, `pressure` and `preview_scale`;
+  /// `calibrated` stays false until [warmUp] has run.
   static Future<Map<String, dynamic>?> getProcessingCapabilities() async {
     try {
       final result = await _channel.invokeMethod<Map<dynamic, dynamic>>(
         'getProcessingCapabilities',
       );
-      return result?.cast<String, dynamic>();
+      final capabilities = result?.cast<String, dynamic>();
+      final governor = capabilities?['governor'];
+      if (governor is String) {
+        capabilities!['governor'] = jsonDecode(governor) as Map<String, dynamic>;
+      }
+      return capabilities;
     } catch (e) {
       debugPrint('NativeBlurBindings error getting capabilities: $e');
       return null;
     }
   }
+
+  /// Per-stage native timings and buffer pool counters. `core.stages` maps
+  /// each stage name (copy_in, blur_h, blur_v, pixelate, integral, blend,
+  /// copy_out) to its count, total/max/p50/p90/p99 in ns and bytes moved;
+  /// `core.pool` holds hits, misses and hit_rate. `startup` holds the
+  /// one-time setup costs in ms (engines_ms, core_ms, segmentation_ms,
+  /// face_detection_ms, warm_up_ms; null until paid), `on_demand` (the
+  /// engines were built by a request before [warmUp] ran) and `threads`.
+  /// `governor` is the same backend report as in [getProcessingCapabilities].
+  static Future<Map<String, dynamic>?> getPerformanceStats() async {
+    try {
+      final json = await _channel.invokeMethod<String>('getPerformanceStats');
+      if (json == null) return null;
+      return jsonDecode(json) as Map<String, dynamic>;
+    } catch (e) {
+      debugPrint('NativeBlurBindings error reading performance stats: $e');
+      return null;
+    }
+  }
+
+  static Future<void> resetPerformanceStats() async {
+    try {
+      await _channel.invokeMethod<bool>('resetPerformanceStats');
+    } catch (e) {
+      debugPrint('NativeBlurBindings error resetting performance stats: $e');
+    }
+  }
 }
 
 /// Enhanced blur pipeline that intelligently uses native or Dart processing
@@ -519,3 +718,355 @@ class ProcessingModeInfo {
     return 'Privacy-First (Dart)';
   }
 }
+
+/// Progress of a [NativeBatchExport] job.
+class BatchExportProgress {
+  final int done;
+  final int failed;
+  final int total;
+  final bool finished;
+
+  const BatchExportProgress({
+    required this.done,
+    required this.failed,
+    required this.total,
+    required this.finished,
+  });
+
+  double get fraction => total == 0 ? 1.0 : done / total;
+}
+
+/// Native batch export: every photo is decoded, face-detected, blurred and
+/// encoded on native stage threads, overlapping the stages of consecutive
+/// photos, without passing pixels through the method channel.
+class NativeBatchExport {
+  static const _channel = MethodChannel('blur_core');
+
+  final int _handle;
+  bool _finished = false;
+
+  NativeBatchExport._(this._handle);
+
+  /// Start exporting [inputs] to [outputs] (parallel lists of file paths;
+  /// `.png` outputs are PNG, the rest JPEG at [quality]). With
+  /// [detectFaces] only faces are blurred (call
+  /// [NativeBlurBindings.initializeFaceDetection] first), otherwise whole
+  /// photos. Returns null when the device has no native codecs (Android
+  /// < 11); export photo by photo in that case.
+  static Future<NativeBatchExport?> start(
+    List<String> inputs,
+    List<String> outputs, {
+    int mode = 2,
+    int strength = 12,
+    bool detectFaces = true,
+    double padding = 0.25,
+    int quality = 90,
+  }) async {
+    if (inputs.isEmpty || inputs.length != outputs.length) return null;
+    try {
+      final handle = await _channel.invokeMethod<int>('startBatchExport', {
+        'inputs': inputs,
+        'outputs': outputs,
+        'mode': mode,
+        'strength': strength,
+        'detectFaces': detectFaces,
+        'padding': padding,
+        'quality': quality,
+      });
+      if (handle == null || handle == 0) return null;
+      return NativeBatchExport._(handle);
+    } catch (e) {
+      debugPrint('NativeBatchExport error starting: $e');
+      return null;
+    }
+  }
+
+  Future<BatchExportProgress> progress() async {
+    final result = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+      'batchProgress',
+      {'handle': _handle},
+    );
+    return BatchExportProgress(
+      done: result?['done'] as int? ?? 0,
+      failed: result?['failed'] as int? ?? 0,
+      total: result?['total'] as int? ?? 0,
+      finished: result?['finished'] as bool? ?? true,
+    );
+  }
+
+  /// Polls [progress] until the job finishes.
+  Stream<BatchExportProgress> watch({
+    Duration interval = const Duration(milliseconds: 200),
+  }) async* {
+    while (!_finished) {
+      final p = await progress();
+      if (_finished) break;
+      yield p;
+      if (p.finished) break;
+      await Future<void>.delayed(interval);
+    }
+  }
+
+  Future<void> cancel() async {
+    if (_finished) return;
+    await _channel.invokeMethod<void>('cancelBatchExport', {'handle': _handle});
+  }
+
+  /// Wait for the job and release it. Returns 0 if every photo was written,
+  /// -5 if cancelled, otherwise the status of the first failure.
+  Future<int> finish() async {
+    if (_finished) return -1;
+    // No progress call may reach the handle once it is being released
+    _finished = true;
+    final status = await _channel.invokeMethod<int>(
+      'finishBatchExport',
+      {'handle': _handle},
+    );
+    return status ?? -1;
+  }
+}
+
+/// A photo kept decoded on the native side while it is edited. The image
+/// crosses the channel once in [open] and once in [export]; masks and
+/// renders in between only pass the handle, and blurred layers are cached
+/// natively (dropped first under memory pressure).
+class NativeImageSession {
+  static const _channel = MethodChannel('blur_core');
+
+  final int _handle;
+  final int width;
+  final int height;
+  bool _closed = false;
+
+  NativeImageSession._(this._handle, this.width, this.height);
+
+  /// Returns null when the image cannot be decoded or the native library
+  /// is unavailable.
+  static Future<NativeImageSession?> open(Uint8List imageBytes) async {
+    try {
+      final result = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+        'sessionOpen',
+        {'imageBytes': imageBytes},
+      );
+      final handle = result?['handle'] as int? ?? 0;
+      if (handle == 0) return null;
+      return NativeImageSession._(
+        handle,
+        result!['width'] as int,
+        result['height'] as int,
+      );
+    } catch (e) {
+      debugPrint('NativeImageSession error opening: $e');
+      return null;
+    }
+  }
+
+  /// Add a width x height mask (null for an empty one). Returns its id, or
+  /// a negative status.
+  Future<int> addMask([Uint8List? maskBytes]) async {
+    if (_closed) return -1;
+    final id = await _channel.invokeMethod<int>('sessionAddMask', {
+      'handle': _handle,
+      'maskBytes': maskBytes,
+    });
+    return id ?? -1;
+  }
+
+  Future<int> removeMask(int maskId) => _call('sessionRemoveMask', {
+    'maskId': maskId,
+  });
+
+  /// Run [steps] on a mask in place (see [MaskStep]).
+  Future<int> processMask(int maskId, List<MaskStep> steps) =>
+      _call('sessionProcessMask', {
+        'maskId': maskId,
+        'steps': MaskStep.flatten(steps),
+      });
+
+  /// Paint (or [erase]) a brush stroke through [points], in image pixels,
+  /// into a mask. Follow with [renderMasked] using the previous parameters
+  /// to re-blend only the tiles the stroke touched.
+  Future<int> paintMask(
+    int maskId,
+    List<Offset> points, {
+    required double radius,
+    bool erase = false,
+  }) => _call('sessionPaintMask', {
+    'maskId': maskId,
+    'points': [
+      for (final p in points) ...[p.dx, p.dy],
+    ],
+    'radius': radius,
+    'erase': erase,
+  });
+
+  /// Render the original with [fgStrength] where the mask is set and
+  /// [bgStrength] elsewhere (mode 0 box or 2 gaussian). Repeating the last
+  /// render only updates the areas painted since.
+  Future<int> renderMasked(
+    int maskId, {
+    int mode = 2,
+    int fgStrength = 0,
+    int bgStrength = 12,
+  }) => _call('sessionRenderMasked', {
+    'maskId': maskId,
+    'mode': mode,
+    'fgStrength': fgStrength,
+    'bgStrength': bgStrength,
+  });
+
+  /// Render the whole image at [strength] from cached layers. While the
+  /// user scrubs a slider pass [interpolate] to blend the nearest cached
+  /// strengths instead of blurring again; render once without it when the
+  /// slider settles.
+  Future<int> renderBlurred(
+    int strength, {
+    int mode = 2,
+    bool interpolate = false,
+  }) => _call('sessionRenderBlurred', {
+    'mode': mode,
+    'strength': strength,
+    'interpolate': interpolate,
+  });
+
+  /// Render the original with [rects] (x, y, w, h each) blurred.
+  Future<int> renderRegions(
+    List<int> rects, {
+    int mode = 2,
+    int strength = 12,
+  }) => _call('sessionRenderRegions', {
+    'rects': rects,
+    'mode': mode,
+    'strength': strength,
+  });
+
+  /// [renderMasked] on the native worker pool: returns at once with a
+  /// [NativeJob] whose [NativeJob.done] completes with the render status.
+  /// Previews run ahead of queued exports; with [supersede] an unfinished
+  /// render on this session is cancelled (it completes with -5), so only
+  /// the latest slider position is drawn.
+  Future<NativeJob?> submitRenderMasked(
+    int maskId, {
+    int mode = 2,
+    int fgStrength = 0,
+    int bgStrength = 12,
+    bool preview = true,
+    bool supersede = true,
+  }) => _submit('sessionSubmitRenderMasked', {
+    'maskId': maskId,
+    'mode': mode,
+    'fgStrength': fgStrength,
+    'bgStrength': bgStrength,
+    'preview': preview,
+    'supersede': supersede,
+  });
+
+  /// [renderBlurred] as a job, see [submitRenderMasked].
+  Future<NativeJob?> submitRenderBlurred(
+    int strength, {
+    int mode = 2,
+    bool interpolate = false,
+    bool preview = true,
+    bool supersede = true,
+  }) => _submit('sessionSubmitRenderBlurred', {
+    'mode': mode,
+    'strength': strength,
+    'interpolate': interpolate,
+    'preview': preview,
+    'supersede': supersede,
+  });
+
+  /// Encode the last render ('jpeg' or 'png').
+  Future<Uint8List?> export({String format = 'jpeg', int quality = 90}) async {
+    if (_closed) return null;
+    try {
+      return await _channel.invokeMethod<Uint8List>('sessionExport', {
+        'handle': _handle,
+        'format': format,
+        'quality': quality,
+      });
+    } catch (e) {
+      debugPrint('NativeImageSession error exporting: $e');
+      return null;
+    }
+  }
+
+  /// Stop a render in progress; it returns -5.
+  Future<void> cancel() async {
+    if (_closed) return;
+    await _channel.invokeMethod<void>('sessionCancel', {'handle': _handle});
+  }
+
+  Future<void> close() async {
+    if (_closed) return;
+    _closed = true;
+    await _channel.invokeMethod<void>('sessionClose', {'handle': _handle});
+  }
+
+  Future<int> _call(String method, Map<String, Object> args) async {
+    if (_closed) return -1;
+    final status = await _channel.invokeMethod<int>(method, {
+      'handle': _handle,
+      ...args,
+    });
+    return status ?? -1;
+  }
+
+  Future<NativeJob?> _submit(String method, Map<String, Object> args) async {
+    if (_closed) return null;
+    NativeJob._listen();
+    final id = await _channel.invokeMethod<int>(method, {
+      'handle': _handle,
+      ...args,
+    });
+    if (id == null || id <= 0) return null;
+    return NativeJob._(id);
+  }
+}
+
+/// A render queued natively by [NativeImageSession.submitRenderMasked] or
+/// [NativeImageSession.submitRenderBlurred].
+class NativeJob {
+  static const _channel = MethodChannel('blur_core');
+  static final _pending = <int, Completer<int>>{};
+  // Completions that arrived before their submit call returned
+  static final _early = <int, int>{};
+  static bool _listening = false;
+
+  final int id;
+  final Completer<int> _done;
+
+  NativeJob._(this.id) : _done = _pending.putIfAbsent(id, Completer<int>.new) {
+    final status = _early.remove(id);
+    if (status != null) _complete(id, status);
+  }
+
+  /// The render status: 0, -5 if cancelled or superseded, or another
+  /// negative blurcore status.
+  Future<int> get done => _done.future;
+
+  /// Stop the job; [done] still completes, with -5. Returns false if it had
+  /// already finished.
+  Future<bool> cancel() async =>
+      await _channel.invokeMethod<bool>('jobCancel', {'job': id}) ?? false;
+
+  static void _listen() {
+    if (_listening) return;
+    _listening = true;
+    _channel.setMethodCallHandler((call) async {
+      if (call.method != 'jobDone') return;
+      final args = call.arguments as Map<dynamic, dynamic>;
+      final job = args['job'] as int;
+      final status = args['status'] as int;
+      if (_pending.containsKey(job)) {
+        _complete(job, status);
+      } else {
+        _early[job] = status;
+      }
+    });
+  }
+
+  static void _complete(int job, int status) {
+    _pending.remove(job)?.complete(status);
+  }
+}
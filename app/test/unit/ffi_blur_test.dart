@@ -0,0 +1,129 @@
+import 'dart:ffi';
+import 'dart:typed_data';
+
+import 'package:blurapp/native/blur_bindings.dart';
+import 'package:ffi/ffi.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import '../test_framework.dart';
+
+void main() {
+  BlurAppTestFramework.testGroup('FfiBlur native bindings', () {
+    BlurAppTestFramework.testCase(
+      'NativePixelBuffer exposes native memory without copying',
+      () {
+        final buffer = NativePixelBuffer(8, 4);
+        try {
+          expect(buffer.stride, 32);
+          expect(buffer.bytes.length, 8 * 4 * 4);
+
+          buffer.bytes[5] = 42;
+          // A fresh view and an address-based view see the same memory
+          expect(buffer.bytes[5], 42);
+          final view = NativePixelBuffer.fromAddress(
+            buffer.address,
+            8,
+            4,
+            stride: buffer.stride,
+          );
+          expect(view.bytes[5], 42);
+          view.bytes[6] = 7;
+          expect(buffer.bytes[6], 7);
+        } finally {
+          buffer.dispose();
+        }
+        expect(() => buffer.bytes, throwsStateError);
+      },
+      level: TestLevel.core,
+    );
+
+    BlurAppTestFramework.testCase('NV21 buffers include the chroma plane', () {
+      final buffer = NativePixelBuffer(5, 5, format: BlurPixelFormat.nv21);
+      expect(buffer.byteLength, 5 * 5 + 5 * 3);
+      buffer.dispose();
+    });
+
+    BlurAppTestFramework.testCase('apply rejects undersized pixel buffers', () {
+      final blur = FfiBlur();
+      expect(blur.apply(Uint8List(10), 4, 4, const [], 0, 3), 1);
+      blur.dispose();
+    }, level: TestLevel.core);
+
+    BlurAppTestFramework.testCase(
+      'apply blurs in place or reports the library as unavailable',
+      () async {
+        final buffer = NativePixelBuffer(16, 16);
+        try {
+          final bytes = buffer.bytes;
+          for (var i = 0; i < bytes.length; ++i) {
+            bytes[i] = (i ~/ 4) % 16 < 8 ? 0 : 255;
+          }
+          final rc = await FfiBlur.applyInBackground(buffer, const [], 0, 2);
+          if (!FfiBlur.isAvailable) {
+            expect(rc, FfiBlur.errorUnavailable);
+            return;
+          }
+          expect(rc, 0);
+          // The hard edge between columns 7 and 8 is softened
+          expect(bytes[7 * 4], inExclusiveRange(0, 255));
+        } finally {
+          buffer.dispose();
+        }
+      },
+    );
+
+    BlurAppTestFramework.testCase(
+      'a background blur whose generation moved on never starts',
+      () async {
+        final buffer = NativePixelBuffer(8, 8);
+        final cell = calloc<Int64>()..value = 2;
+        try {
+          buffer.bytes[0] = 200;
+          final rc = await FfiBlur.applyInBackground(
+            buffer,
+            const [],
+            0,
+            2,
+            generationAddress: cell.address,
+            generation: 1,
+          );
+          expect(rc, FfiBlur.errorCancelled);
+          expect(buffer.bytes[0], 200);
+        } finally {
+          calloc.free(cell);
+          buffer.dispose();
+        }
+      },
+    );
+
+    BlurAppTestFramework.testCase(
+      'pyramid previews use the level that fits the viewport',
+      () {
+        final source = NativePixelBuffer(64, 32);
+        final pyramid = NativePyramid.build(source);
+        try {
+          if (!FfiBlur.isAvailable) {
+            expect(pyramid, isNull);
+            return;
+          }
+          expect(pyramid!.levelFor(30, 10), 1);
+          expect(pyramid.levelFor(100, 100), 0);
+          expect(pyramid.levelSize(2), (16, 8));
+
+          final blur = FfiBlur();
+          final dst = NativePixelBuffer(16, 8);
+          expect(pyramid.preview(blur, 2, dst, const [], 0, 8), 0);
+          // Cancelling an idle context does not affect the next call
+          blur.cancel();
+          expect(pyramid.preview(blur, 2, dst, const [], 0, 8), 0);
+          dst.dispose();
+          blur.dispose();
+        } finally {
+          pyramid?.dispose();
+          source.dispose();
+        }
+      },
+      level: TestLevel.core,
+    );
+  });
+}
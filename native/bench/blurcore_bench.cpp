@@ -0,0 +1,400 @@
+// blurcore_bench: throughput sweeps for the portable blur core.
+//
+// Every case blurs one frame repeatedly through a BlurContext (the path the
+// apps use) and reports the median time per call, MPix/s over the blurred
+// area, heap bytes allocated per call after warm-up, and the per-stage time
+// split from the built-in instrumentation. Sweeps vary one axis at a time
+// around 1080p / gaussian / strength 12 / one full-frame rect: resolution
+// (VGA to 48 MP), mode, strength, rect count and overlap, thread count and
+// SIMD level.
+//
+//   blurcore_bench [--quick] [--filter=text] [--min-time=seconds]
+//                  [--json=out.json] [--baseline=old.json] [--tolerance=0.10]
+//                  [--list]
+//
+// --baseline compares MPix/s against an earlier --json file case by case
+// and exits with status 2 if any case is slower by more than the tolerance.
+// On Android build with the NDK toolchain and run over adb
+// (scripts/bench_android.sh). On iOS, where a bare executable cannot run,
+// compile with BLURCORE_BENCH_NO_MAIN and call blurcore_bench_main() from a
+// test host.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "blur.h"
+
+// Heap accounting: every operator new in the process, including the
+// buffer pool's aligned allocations, is counted here.
+static std::atomic<int64_t> g_allocatedBytes{0};
+
+static void* countedAlloc(size_t size) {
+    g_allocatedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+static void* countedAlignedAlloc(size_t size, std::align_val_t align) {
+    g_allocatedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    const size_t a = std::max(static_cast<size_t>(align), sizeof(void*));
+    void* p = nullptr;
+    return posix_memalign(&p, a, (size + a - 1) / a * a) == 0 ? p : nullptr;
+}
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new(size_t size, std::align_val_t align) {
+    void* p = countedAlignedAlloc(size, align);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace {
+
+struct Case {
+    std::string name;
+    int width, height;
+    int mode, strength;
+    int rects;    // 1: the whole frame; n > 1: an n-cell grid
+    bool overlap; // grid cells grown to overlap their neighbours by half
+    int threads;  // 0: one per core
+    int simd;     // BlurSimdLevel
+};
+
+struct Result {
+    int64_t iterations = 0;
+    double medianNs = 0, minNs = 0;
+    double mpixPerSec = 0;
+    int64_t allocPerIter = 0;
+    int64_t stageNs[BLUR_STAGE_COUNT] = {};
+    int status = 0;
+};
+
+struct Resolution { int width, height; };
+
+// VGA, 720p, 1080p, 12 MP, 48 MP
+const Resolution kResolutions[] = {{640, 480}, {1280, 720}, {1920, 1080}, {4000, 3000}, {8000, 6000}};
+
+const char* modeName(int mode) {
+    static const char* const names[] = {"box", "pixelate", "gaussian", "sat_box", "sat_pixelate"};
+    return mode >= 0 && mode <= 4 ? names[mode] : "?";
+}
+
+const char* simdName(int level) {
+    switch (level) {
+    case BLUR_SIMD_SCALAR: return "scalar";
+    case BLUR_SIMD_SSE41: return "sse41";
+    case BLUR_SIMD_AVX2: return "avx2";
+    case BLUR_SIMD_NEON: return "neon";
+    default: return "auto";
+    }
+}
+
+std::string caseName(const char* sweep, const Case& c) {
+    std::ostringstream n;
+    n << sweep << "/" << c.width << "x" << c.height << "/" << modeName(c.mode) << "/s" << c.strength
+      << "/r" << c.rects << (c.overlap ? "o" : "") << "/t" << c.threads << "/" << simdName(c.simd);
+    return n.str();
+}
+
+std::vector<BlurRect> rectsFor(const Case& c) {
+    if (c.rects <= 1) return {{0, 0, c.width, c.height}};
+    int cols = 1;
+    while (cols * cols < c.rects) ++cols;
+    const int rows = (c.rects + cols - 1) / cols;
+    const int cw = c.width / cols, ch = c.height / rows;
+    std::vector<BlurRect> rects;
+    for (int i = 0; i < c.rects; ++i) {
+        BlurRect r = {(i % cols) * cw, (i / cols) * ch, cw, ch};
+        if (c.overlap) {
+            r.x = std::max(0, r.x - cw / 4);
+            r.y = std::max(0, r.y - ch / 4);
+            r.w = std::min(c.width - r.x, cw + cw / 2);
+            r.h = std::min(c.height - r.y, ch + ch / 2);
+        }
+        rects.push_back(r);
+    }
+    return rects;
+}
+
+std::vector<Case> buildCases(bool quick, int hwThreads, int bestSimd) {
+    std::vector<Case> cases;
+    const Case base = {"", 1920, 1080, 2, 12, 1, false, 0, BLUR_SIMD_AUTO};
+    auto add = [&](const char* sweep, Case c) {
+        c.name = caseName(sweep, c);
+        for (const Case& e : cases)
+            if (e.name == c.name) return;
+        cases.push_back(c);
+    };
+    const int resolutions = quick ? 1 : static_cast<int>(sizeof(kResolutions) / sizeof(kResolutions[0]));
+    const Case top = quick ? Case{"", 640, 480, 2, 12, 1, false, 0, BLUR_SIMD_AUTO} : base;
+
+    for (int i = 0; i < resolutions; ++i) {
+        for (int mode : {0, 2, 3}) {
+            Case c = top;
+            c.width = kResolutions[i].width;
+            c.height = kResolutions[i].height;
+            c.mode = mode;
+            add("resolution", c);
+        }
+    }
+    for (int mode = 0; mode <= 4; ++mode) {
+        Case c = top;
+        c.mode = mode;
+        c.strength = (mode == 1 || mode == 4) ? 16 : 12;
+        add("mode", c);
+    }
+    for (int mode : {0, 2, 3}) {
+        for (int strength : {2, 8, 32, 128}) {
+            Case c = top;
+            c.mode = mode;
+            c.strength = strength;
+            add("strength", c);
+        }
+    }
+    for (int mode : {0, 3}) {
+        for (int rects : {4, 16, 64}) {
+            for (bool overlap : {false, true}) {
+                Case c = top;
+                c.mode = mode;
+                c.rects = rects;
+                c.overlap = overlap;
+                add("rects", c);
+            }
+        }
+    }
+    for (int threads = 1; threads <= hwThreads; threads *= 2) {
+        Case c = top;
+        c.threads = threads;
+        add("threads", c);
+    }
+    Case all = top;
+    all.threads = hwThreads;
+    add("threads", all);
+    for (int simd : {static_cast<int>(BLUR_SIMD_SCALAR), bestSimd}) {
+        for (int mode : {0, 2}) {
+            Case c = top;
+            c.mode = mode;
+            c.simd = simd;
+            c.threads = 1;
+            add("simd", c);
+        }
+    }
+    return cases;
+}
+
+Result runCase(const Case& c, double minSeconds) {
+    Result res;
+    blur_set_thread_count(c.threads);
+    if (blur_set_simd_level(c.simd) != 0) {
+        res.status = -2;
+        return res;
+    }
+    std::vector<uint8_t> pixels(static_cast<size_t>(c.width) * c.height * 4);
+    uint32_t seed = 0x9e3779b9u;
+    for (uint8_t& p : pixels) {
+        seed = seed * 1664525u + 1013904223u;
+        p = static_cast<uint8_t>(seed >> 24);
+    }
+    const std::vector<BlurRect> rects = rectsFor(c);
+    int64_t area = 0;
+    for (const BlurRect& r : rects) area += static_cast<int64_t>(r.w) * r.h;
+
+    BlurContext* ctx = blur_context_create();
+    auto call = [&] {
+        return blur_apply_regions_ex(ctx, pixels.data(), c.width, c.height, 0, BLUR_FORMAT_RGBA8888,
+                                     rects.data(), static_cast<int>(rects.size()), c.mode, c.strength);
+    };
+    res.status = call(); // warm-up: grows the context and the pool
+    if (res.status != 0) {
+        blur_context_destroy(ctx);
+        return res;
+    }
+
+    std::vector<double> samples;
+    samples.reserve(1000);
+    blur_stats_reset();
+    const int64_t allocBefore = g_allocatedBytes.load();
+    double total = 0;
+    while (samples.size() < 3 || (total < minSeconds && samples.size() < 1000)) {
+        const auto t0 = std::chrono::steady_clock::now();
+        call();
+        const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        samples.push_back(s);
+        total += s;
+    }
+    res.iterations = static_cast<int64_t>(samples.size());
+    res.allocPerIter = (g_allocatedBytes.load() - allocBefore) / res.iterations;
+    BlurStats stats;
+    blur_stats_read(&stats);
+    for (int s = 0; s < BLUR_STAGE_COUNT; ++s) res.stageNs[s] = stats.stages[s].total_ns / res.iterations;
+    blur_context_destroy(ctx);
+
+    std::sort(samples.begin(), samples.end());
+    const double median = samples[samples.size() / 2];
+    res.medianNs = median * 1e9;
+    res.minNs = samples.front() * 1e9;
+    res.mpixPerSec = median > 0 ? area / 1e6 / median : 0;
+    return res;
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+// MPix/s by case name from an earlier --json file. Only our own output is
+// parsed, so a scan for the two keys is enough.
+std::vector<std::pair<std::string, double>> readBaseline(const std::string& path) {
+    std::vector<std::pair<std::string, double>> out;
+    std::ifstream in(path);
+    if (!in) return out;
+    std::stringstream buf;
+    buf << in.rdbuf();
+    const std::string text = buf.str();
+    size_t pos = 0;
+    const std::string nameKey = "\"name\":\"", rateKey = "\"mpix_per_s\":";
+    while ((pos = text.find(nameKey, pos)) != std::string::npos) {
+        pos += nameKey.size();
+        const size_t end = text.find('"', pos);
+        const size_t rate = text.find(rateKey, end);
+        if (end == std::string::npos || rate == std::string::npos) break;
+        out.emplace_back(text.substr(pos, end - pos), std::atof(text.c_str() + rate + rateKey.size()));
+        pos = end;
+    }
+    return out;
+}
+
+bool flagValue(const char* arg, const char* flag, std::string& value) {
+    const size_t n = std::strlen(flag);
+    if (std::strncmp(arg, flag, n) != 0 || arg[n] != '=') return false;
+    value = arg + n + 1;
+    return true;
+}
+
+} // namespace
+
+extern "C" int blurcore_bench_main(int argc, char** argv) {
+    bool quick = false, list = false;
+    double minSeconds = 0.5, tolerance = 0.10;
+    std::string filter, jsonPath, baselinePath, value;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) quick = true;
+        else if (std::strcmp(argv[i], "--list") == 0) list = true;
+        else if (flagValue(argv[i], "--filter", value)) filter = value;
+        else if (flagValue(argv[i], "--min-time", value)) minSeconds = std::atof(value.c_str());
+        else if (flagValue(argv[i], "--json", value)) jsonPath = value;
+        else if (flagValue(argv[i], "--baseline", value)) baselinePath = value;
+        else if (flagValue(argv[i], "--tolerance", value)) tolerance = std::atof(value.c_str());
+        else {
+            std::fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (quick && minSeconds == 0.5) minSeconds = 0.02;
+
+    blur_set_thread_count(0);
+    const int hwThreads = blur_get_thread_count();
+    blur_set_simd_level(BLUR_SIMD_AUTO);
+    const int bestSimd = blur_get_simd_level();
+
+    std::vector<Case> cases = buildCases(quick, hwThreads, bestSimd);
+    cases.erase(std::remove_if(cases.begin(), cases.end(),
+                               [&](const Case& c) { return c.name.find(filter) == std::string::npos; }),
+                cases.end());
+    if (list) {
+        for (const Case& c : cases) std::printf("%s\n", c.name.c_str());
+        return 0;
+    }
+
+    const std::vector<std::pair<std::string, double>> baseline =
+        baselinePath.empty() ? std::vector<std::pair<std::string, double>>() : readBaseline(baselinePath);
+    if (!baselinePath.empty() && baseline.empty()) {
+        std::fprintf(stderr, "no cases in baseline %s\n", baselinePath.c_str());
+        return 1;
+    }
+
+    std::ostringstream json;
+    json << "{\"schema\":1,\"threads\":" << hwThreads << ",\"simd\":\"" << simdName(bestSimd)
+         << "\",\"pointer_bits\":" << sizeof(void*) * 8 << ",\"results\":[";
+    std::printf("%-58s %10s %10s %12s %9s\n", "case", "median ms", "MPix/s", "alloc B/call", "vs base");
+    int regressions = 0;
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const Case& c = cases[i];
+        const Result r = runCase(c, minSeconds);
+        json << (i ? "," : "") << "{\"name\":\"" << jsonEscape(c.name) << "\",\"status\":" << r.status
+             << ",\"iterations\":" << r.iterations << ",\"median_ns\":" << static_cast<int64_t>(r.medianNs)
+             << ",\"min_ns\":" << static_cast<int64_t>(r.minNs) << ",\"mpix_per_s\":" << r.mpixPerSec
+             << ",\"alloc_bytes_per_call\":" << r.allocPerIter << ",\"stage_ns\":{";
+        bool firstStage = true;
+        for (int s = 0; s < BLUR_STAGE_COUNT; ++s) {
+            if (!r.stageNs[s]) continue;
+            json << (firstStage ? "" : ",") << "\"" << blur_stage_name(s) << "\":" << r.stageNs[s];
+            firstStage = false;
+        }
+        json << "}}";
+
+        char versus[32] = "";
+        for (const auto& b : baseline) {
+            if (b.first != c.name || b.second <= 0) continue;
+            const double ratio = r.mpixPerSec / b.second;
+            std::snprintf(versus, sizeof(versus), "%+.1f%%%s", (ratio - 1) * 100, ratio < 1 - tolerance ? " !" : "");
+            if (ratio < 1 - tolerance) ++regressions;
+        }
+        if (r.status != 0) {
+            std::printf("%-58s %10s (status %d)\n", c.name.c_str(), "skipped", r.status);
+        } else {
+            std::printf("%-58s %10.3f %10.1f %12lld %9s\n", c.name.c_str(), r.medianNs / 1e6, r.mpixPerSec,
+                        static_cast<long long>(r.allocPerIter), versus);
+        }
+        std::fflush(stdout);
+    }
+    json << "]}\n";
+    blur_set_thread_count(0);
+    blur_set_simd_level(BLUR_SIMD_AUTO);
+
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        out << json.str();
+        if (!out) {
+            std::fprintf(stderr, "could not write %s\n", jsonPath.c_str());
+            return 1;
+        }
+    }
+    if (regressions > 0) {
+        std::printf("%d case(s) slower than the baseline by more than %.0f%%\n", regressions, tolerance * 100);
+        return 2;
+    }
+    return 0;
+}
+
+#ifndef BLURCORE_BENCH_NO_MAIN
+int main(int argc, char** argv) { return blurcore_bench_main(argc, argv); }
+#endif
@@ -1,5 +1,6 @@
  #pragma once
 #include <cstdint>
+#include <cstddef>
 
 
 #ifdef __cplusplus
@@ -15,8 +16,17 @@ int h; // height
 } BlurRect;
 
 
-// mode: 0 = gaussian-ish box blur, 1 = pixelate
-// strength: radius for blur, block size for pixelate (>=2)
+// mode: 0 = box blur, 1 = pixelate, 2 = gaussian (three box passes),
+//       3 = box blur, 4 = pixelate, both from a summed-area table
+// strength: radius for box blur, block size for pixelate (>=2),
+//           sigma in pixels for gaussian
+// Modes 3 and 4 build one table over the bounding box of all rects, so the
+// pixels are read once however many rects there are and the cost does not
+// depend on the radius or block size. The table takes 4 bytes (8 for huge
+// windows) per pixel and channel of that box. Every rect reads the original
+// pixels, so overlapping rects do not blur each other's output, and the
+// mode 3 window is clipped to the image instead of clamped to the rect. Mode
+// 4 matches mode 1 exactly for rects that do not overlap.
 // pixels: RGBA8888 contiguous buffer, row stride = width*4
 // returns 0 on success
 int blur_apply_regions(uint8_t* pixels, int width, int height,
@@ -24,6 +34,890 @@ const BlurRect* rects, int rect_count,
 int mode, int strength);
 
 
+// Reusable scratch for blur calls. A context keeps its buffers between calls
+// and only ever grows them, so repeated calls on frames of the same size do
+// no heap allocation. A context must not be used by two threads at once;
+// give each thread its own.
+typedef struct BlurContext BlurContext;
+
+
+// returns NULL if out of memory
+BlurContext* blur_context_create(void);
+
+
+void blur_context_destroy(BlurContext* ctx);
+
+
+// Ask the call currently running on ctx to stop early; it returns -5 and
+// leaves the rects partly blurred. Safe to call from any thread. Each call
+// clears the request when it starts, so a cancel issued between calls has
+// no effect. A call made of several blurs (a masked blur, strips, a mask
+// pipeline, a session render or a queued job) clears it once, on entry.
+void blur_context_cancel(BlurContext* ctx);
+
+
+// returns the bytes of pixel scratch currently held by ctx
+size_t blur_context_scratch_bytes(const BlurContext* ctx);
+
+
+// Same as blur_apply_regions, drawing all scratch from ctx.
+// returns 0 on success, -1 on bad arguments, -2 for an unsupported mode,
+// -3 if the scratch could not grow, -5 if cancelled via blur_context_cancel
+int blur_apply_regions_ctx(BlurContext* ctx, uint8_t* pixels, int width, int height,
+const BlurRect* rects, int rect_count,
+int mode, int strength);
+
+
+// Layouts accepted by blur_apply_regions_ex. Every format is 8 bits per
+// channel; channels are blurred independently.
+enum BlurPixelFormat {
+BLUR_FORMAT_RGBA8888 = 0,
+BLUR_FORMAT_BGRA8888 = 1, // iOS CVPixelBuffer
+BLUR_FORMAT_RGB888 = 2,
+BLUR_FORMAT_GRAY8 = 3,    // single channel, e.g. the Y plane of a camera frame
+BLUR_FORMAT_NV21 = 4      // Y plane, then interleaved VU at half resolution
+};
+
+
+// Blur a buffer in place without repacking it first.
+// ctx: scratch to draw from, or NULL to use a temporary one
+// stride: bytes per row (0 = tightly packed). For NV21 the VU plane starts
+//         at pixels + stride*height and uses the same stride.
+// rects are in pixel (luma) coordinates; for NV21 they and the strength are
+// halved for the chroma plane.
+// returns 0 on success, -1 on bad arguments, -2 for an unsupported mode,
+// -3 if the scratch could not grow, -5 if cancelled via blur_context_cancel
+int blur_apply_regions_ex(BlurContext* ctx, uint8_t* pixels, int width, int height,
+int stride, int format,
+const BlurRect* rects, int rect_count,
+int mode, int strength);
+
+
+// Portrait-mode blend: pixels = fg * m + bg * (1 - m), where fg and bg are
+// the image blurred with fg_strength and bg_strength (0 = unblurred) and m
+// is the 8-bit mask (255 = foreground). Tiles where the mask is all 0 or
+// all 255 only compute the layer they show, so uniform areas skip the
+// other blur entirely. Output matches blurring the whole image twice and
+// blending with rounding.
+// format: any BlurPixelFormat except NV21; mask_stride in bytes (0 = width)
+// mode: 0 = box or 2 = gaussian
+// returns 0 on success, -1 on bad arguments, -2 for an unsupported mode,
+// -3 if the scratch could not grow, -5 if cancelled via blur_context_cancel
+int blur_apply_masked(BlurContext* ctx, uint8_t* pixels, int width, int height, int stride,
+int format, const uint8_t* mask, int mask_stride,
+int mode, int fg_strength, int bg_strength);
+
+
+// Seamless compositing: paste src into dst where the mask is set, keeping
+// src's gradients but shifting its colours smoothly so the seam matches dst
+// (Poisson blending). Only the mask's bounding box is solved; cost is
+// linear in its area, times cycles. Soft mask edges fade the result into
+// dst; alpha is kept from dst. dst and src share size, format and stride.
+// format: any BlurPixelFormat except NV21; mask_stride in bytes (0 = width)
+// cycles: multigrid V-cycles, 0 = default (4); more only refine the colour
+// match slightly
+// returns 0 on success, -1 on bad arguments, -2 for NV21, -3 if out of
+// memory
+int blur_composite_poisson(uint8_t* dst, const uint8_t* src, int width, int height, int stride,
+int format, const uint8_t* mask, int mask_stride, int cycles);
+
+
+// Colour spaces for blur_blend_colorspace.
+enum BlurBlendSpace {
+BLUR_BLEND_SRGB = 0,   // plain alpha blend of the stored values
+BLUR_BLEND_LINEAR = 1, // linear light: soft edges keep their brightness
+BLUR_BLEND_OKLAB = 2,  // perceptual lightness and chroma (Oklab)
+BLUR_BLEND_HSV = 3     // hue along the shorter arc, then saturation and value
+};
+
+
+// dst = src * m + dst * (1 - m), mixed in the given space, in one pass over
+// the packed pixels. Pixels with m 0 or 255 are kept or copied, so only the
+// mask's soft edge pays for the conversion. Alpha mixes as coverage; grey
+// images mix lightness only. dst and src share size, format and stride.
+// format: any BlurPixelFormat except NV21; mask_stride in bytes (0 = width)
+// returns 0 on success, -1 on bad arguments, -2 for NV21 or an unknown space
+int blur_blend_colorspace(uint8_t* dst, const uint8_t* src, int width, int height, int stride,
+int format, const uint8_t* mask, int mask_stride, int space);
+
+
+// Segmentation model input: resize pixels (RGBA, BGRA or RGB) bilinearly to
+// tensor_width x tensor_height and write them as float RGB, channel last,
+// value = byte * scale + bias (e.g. 1/255 and 0 for a [0, 1] model). One
+// pass straight into the model's input tensor.
+// returns 0 on success, -1 on bad arguments
+int blur_image_to_tensor(const uint8_t* pixels, int width, int height, int stride, int format,
+float* tensor, int tensor_width, int tensor_height,
+float scale, float bias);
+
+
+// Segmentation model output: resize one channel of a channel-last float
+// tensor of scores in [0, 1] bilinearly to width x height and write it as
+// an 8-bit mask (score 1 = 255). mask_stride in bytes (0 = width).
+// returns 0 on success, -1 on bad arguments
+int blur_tensor_to_mask(const float* scores, int tensor_width, int tensor_height,
+int channels, int channel,
+uint8_t* mask, int width, int height, int mask_stride);
+
+
+// Mask refinement steps for blur_mask_process, applied in order to an 8-bit
+// mask (255 = foreground). Windows are square; foreground for the
+// component and feather steps means > 127.
+enum BlurMaskOp {
+BLUR_MASK_DILATE = 0,       // radius: window half-size
+BLUR_MASK_ERODE = 1,
+BLUR_MASK_OPEN = 2,         // erode, then dilate
+BLUR_MASK_CLOSE = 3,        // dilate, then erode
+BLUR_MASK_REMOVE_SMALL = 4, // param: blobs (8-connected) under this many pixels are cleared
+BLUR_MASK_SMOOTH = 5,       // radius: gaussian sigma in pixels, as blur mode 2
+BLUR_MASK_FEATHER = 6,      // radius: inner ramp, param: outer ramp, by distance to the edge
+BLUR_MASK_THRESHOLD = 7,    // param: values above it become 255, the rest 0
+BLUR_MASK_GRADIENT = 8      // radius: dilate minus erode (the outline)
+};
+
+
+typedef struct {
+int op;     // BlurMaskOp
+int radius;
+int param;
+} BlurMaskStep;
+
+
+// Run a list of refinement steps on a mask in place, e.g. close, remove
+// small blobs, smooth and feather, in one call instead of one per step.
+// Every step only touches the bounding box of the non-zero pixels grown by
+// its reach, so the cost follows the subject rather than the frame. The
+// mask can go straight to blur_apply_masked afterwards.
+// ctx: scratch for the smoothing steps, or NULL; mask_stride in bytes
+// (0 = width)
+// returns 0 on success, -1 on bad arguments (the mask is untouched), -2 for
+// an unknown op, -3 if out of memory, -5 if cancelled via
+// blur_context_cancel
+int blur_mask_process(BlurContext* ctx, uint8_t* mask, int width, int height, int mask_stride,
+const BlurMaskStep* steps, int step_count);
+
+
+// Edge-aware mask refinement (guided filter): each output pixel is a local
+// linear function of the guide image, fitted so a coarse or blocky mask
+// snaps to the guide's edges (hair, fingers) while flat regions stay flat.
+// The soft result stays in the mask (threshold it for a hard cutout). Cost
+// is independent of radius: the coefficients are fitted on a subsampled
+// grid and applied at full resolution over the mask's grown bounding box.
+// guide: width x height pixels in guide_format (any BlurPixelFormat except
+// NV21; alpha is ignored), guide_stride in bytes (0 = tight); radius: window
+// half-size in pixels; eps: regularisation on the [0, 1] intensity scale,
+// e.g. 1e-3 (smaller follows edges more closely)
+// returns 0 on success, -1 on bad arguments, -2 for NV21, -3 if out of
+// memory
+int blur_mask_refine_guided(uint8_t* mask, int width, int height, int mask_stride,
+const uint8_t* guide, int guide_stride, int guide_format,
+int radius, float eps);
+
+
+// Resident editing session. The image is copied in once and then edited by
+// handle: masks, renders and the blurred layers behind them stay in native
+// memory, and the final pixels are copied out once on export. Every render
+// starts again from the original. Blurred layers are cached per session
+// and evicted least recently used first, across all sessions, when the
+// cache limit is passed or blur_session_trim is called; the original, the
+// masks and the latest render are never evicted. A session must not be
+// used by two threads at once.
+typedef struct BlurSession BlurSession;
+
+
+// format: any BlurPixelFormat except NV21; stride in bytes (0 = packed)
+// returns NULL on bad arguments or out of memory
+BlurSession* blur_session_open(const uint8_t* pixels, int width, int height, int stride, int format);
+
+
+// Frees the session and its cached layers. Jobs submitted on it
+// (blur_job_submit) are cancelled and waited for first, so this must not be
+// called from inside one of them; their completion callbacks are fine.
+void blur_session_close(BlurSession* session);
+
+
+// Stop the render running on the session (it returns -5). Safe from any
+// thread.
+void blur_session_cancel(BlurSession* session);
+
+
+// returns 0 on success, -1 if session is NULL
+int blur_session_size(const BlurSession* session, int* width, int* height);
+
+
+// Copy a mask (255 = foreground) of the session's size into the session;
+// mask NULL starts from an empty one. mask_stride in bytes (0 = width).
+// returns the mask id (> 0), -1 on bad arguments, -3 if out of memory
+int blur_session_add_mask(BlurSession* session, const uint8_t* mask, int mask_stride);
+
+
+// The mask's pixels, width bytes per row, for reading or painting in place.
+// Report in-place edits with blur_session_mark_mask_dirty.
+// returns NULL for an unknown id
+uint8_t* blur_session_mask(BlurSession* session, int mask_id);
+
+
+// returns 0 on success, -1 for an unknown id
+int blur_session_remove_mask(BlurSession* session, int mask_id);
+
+
+// blur_mask_process on a session mask.
+// returns its status, or -1 for an unknown id
+int blur_session_process_mask(BlurSession* session, int mask_id, const BlurMaskStep* steps, int step_count);
+
+
+// Tell the session a rect of the mask was edited in place (rect NULL = all
+// of it), so the next masked render re-blends that area.
+// returns 0 on success, -1 for an unknown id
+int blur_session_mark_mask_dirty(BlurSession* session, int mask_id, const BlurRect* rect);
+
+
+// Paint (erase 0) or erase a round brush stroke into a session mask.
+// points: point_count (x, y) pairs in pixels, one point paints a dab;
+// radius in pixels, edges antialiased.
+// returns 0 on success, -1 on bad arguments or an unknown id
+int blur_session_paint_mask(BlurSession* session, int mask_id, const float* points, int point_count,
+float radius, int erase);
+
+
+// Render the original with rects blurred, as blur_apply_regions_ex. No
+// rects renders the original unchanged.
+// returns the blur_apply_regions_ex status, or -1 on bad arguments
+int blur_session_render_regions(BlurSession* session, const BlurRect* rects, int rect_count,
+int mode, int strength);
+
+
+// Render the portrait blend of blur_apply_masked with a session mask, from
+// cached full-frame layers: moving only the mask or one strength rebuilds
+// at most one layer. Repeating the previous masked render re-blends only
+// the tiles of the mask edited since, so painting costs the stroke area.
+// mode: 0 = box or 2 = gaussian
+// returns the blur_apply_masked status, or -1 for an unknown mask id
+int blur_session_render_masked(BlurSession* session, int mask_id, int mode, int fg_strength, int bg_strength);
+
+
+enum BlurSessionFlags {
+BLUR_SESSION_INTERPOLATE = 1 // approximate from the nearest cached strengths
+};
+
+
+// Render the whole frame blurred at strength, from a cached layer when one
+// exists. With BLUR_SESSION_INTERPOLATE (modes 0 and 2) a strength without
+// its own layer blends the two nearest levels of a fixed ladder (every
+// strength up to 8, then four per doubling), building those as needed, so
+// slider scrubbing reuses a handful of layers; otherwise the exact layer is
+// built and cached.
+// returns the blur_apply_regions_ex status, or -1 on bad arguments
+int blur_session_render_blurred(BlurSession* session, int mode, int strength, int flags);
+
+
+// The latest render, packed (width * bytes per pixel per row). Valid until
+// the next render or close.
+const uint8_t* blur_session_result(const BlurSession* session);
+
+
+// Copy the latest render out. dst_stride in bytes (0 = packed).
+// returns 0 on success, -1 on bad arguments
+int blur_session_export(const BlurSession* session, uint8_t* dst, int dst_stride);
+
+
+// Bytes of cached layers kept across all sessions (default 192 MB); bytes
+// <= 0 restores the default. returns 0
+int blur_session_set_cache_limit(int64_t bytes);
+
+
+// Drop cached layers, least recently used first, until at most keep_bytes
+// remain, e.g. from memory-pressure callbacks. Layers a render is reading
+// are kept. returns the bytes freed
+int64_t blur_session_trim(int64_t keep_bytes);
+
+
+// returns the bytes of cached layers across all sessions
+int64_t blur_session_cache_bytes(void);
+
+
+// Face detection model output (BlazeFace short range, 128x128 input, 896
+// anchors) to BlurRects ready for blur_apply_regions. Boxes scoring below
+// score_threshold (0-1) are dropped, boxes overlapping by at least
+// iou_threshold are merged by score-weighted NMS, each face grows by padding
+// times its size on every side, and the padded rects that still overlap are
+// joined into one. Feed the model with blur_image_to_tensor (scale 2/255,
+// bias -1) stretched from the whole image; rects are in image pixels.
+// regressors: anchors x regressor_stride floats (box at 0-3, usually 16)
+// scores: one logit per anchor
+// returns the number of rects written (most confident first, at most
+// max_rects), or -1 on bad arguments
+int blur_decode_faces(const float* regressors, int regressor_stride, const float* scores,
+int image_width, int image_height,
+float score_threshold, float iou_threshold, float padding,
+BlurRect* rects, int max_rects);
+
+
+// returns the number of anchors blur_decode_faces expects (896)
+int blur_face_anchor_count(void);
+
+
+// Streaming blur for live camera preview and video. The detector (person
+// segmentation, face boxes drawn into a mask, ...) only runs on keyframes:
+// every keyframe_interval frames, or when the frame no longer matches the
+// previous one after motion compensation. In between, the last mask follows
+// a global motion estimate, and only 64x64 tiles whose content or mask
+// changed since they were last blurred are blurred again; the rest keep
+// their previous output, moved along with the camera. Each frame is blurred
+// like blur_apply_masked.
+typedef struct BlurStream BlurStream;
+
+
+typedef struct {
+int keyframe_interval; // run the detector at least every N frames (>= 1)
+int scene_change;      // mean luma difference (0-255) that forces a keyframe
+int content_threshold; // luma change of an 8x8 block (0-255) that re-blurs its tile
+int smoothing;         // weight 0-255 of a new detection against the carried mask (a scene change replaces it)
+int mode;              // 0 = box, 2 = gaussian
+int fg_strength;       // blur where the mask is 255 (0 = none)
+int bg_strength;       // blur where the mask is 0 (0 = none)
+} BlurStreamConfig;
+
+
+typedef struct {
+int keyframe;      // 1 if the detector ran for this frame
+int motion_x;      // estimated camera motion in pixels
+int motion_y;
+int tiles_blurred; // tiles blurred again
+int tiles_total;
+} BlurStreamStats;
+
+
+// Write a width x height mask (255 = fg_strength applies) for the frame.
+// returns 0 on success; any other value aborts the frame with that status.
+typedef int (*BlurStreamDetectFn)(void* user, const uint8_t* pixels, int width, int height, int stride,
+int format, uint8_t* mask, int mask_stride);
+
+
+// format: any BlurPixelFormat except NV21
+// returns NULL on bad arguments or out of memory
+BlurStream* blur_stream_create(int width, int height, int format, const BlurStreamConfig* config);
+
+
+void blur_stream_destroy(BlurStream* stream);
+
+
+// Blur the next frame in place (stride in bytes, 0 = packed).
+// returns 0 on success, -1 on bad arguments, the detector's status, or a
+// blur_apply_masked error
+int blur_stream_process(BlurStream* stream, uint8_t* pixels, int stride,
+BlurStreamDetectFn detect, void* user);
+
+
+// Statistics of the last blur_stream_process call. returns 0, or -1 on
+// bad arguments
+int blur_stream_stats(const BlurStream* stream, BlurStreamStats* stats);
+
+
+// Out-of-core blur for images too large to hold decoded: rows come from
+// read and go to write one horizontal strip at a time. Each strip is
+// blurred with a halo of extra source rows (blur_strip_halo) above and
+// below, so the output is identical to blur_apply_regions_ex on the whole
+// image, with no seams. Memory is about (strip_rows + 4 * halo) rows plus
+// the blur scratch of one strip, independent of the image height.
+// read: fill rows [y, y + rows) of the source into dst (stride bytes per
+//       row). Calls go top to bottom and never ask for a row twice, so a
+//       sequential scanline decoder works.
+// write: take the finished rows [y, y + rows), also top to bottom.
+// Either returns 0, or a status that aborts the call and is returned.
+typedef int (*BlurStripReadFn)(void* user, int y, int rows, uint8_t* dst, int stride);
+
+
+typedef int (*BlurStripWriteFn)(void* user, int y, int rows, const uint8_t* src, int stride);
+
+
+// ctx may be NULL; format: any BlurPixelFormat except NV21
+// strip_rows: output rows per strip (<= 0: 256)
+// returns 0 on success, -1 on bad arguments, -2 for an unsupported mode,
+// -3 if out of memory, or the status of a failed callback or blur
+int blur_apply_strips(BlurContext* ctx, int width, int height, int format,
+const BlurRect* rects, int rect_count, int mode, int strength,
+int strip_rows, BlurStripReadFn read, BlurStripWriteFn write, void* user);
+
+
+// Rows of halo blur_apply_strips adds on each side of a strip: the reach of
+// the blur, times the number of rects when modes 0-2 have overlapping rects
+// (those are blurred one after another). At most height.
+// returns -1 on bad arguments
+int blur_strip_halo(int height, const BlurRect* rects, int rect_count, int mode, int strength);
+
+
+// Redact a JPEG file without decoding it to pixels: the file is read as
+// quantized DCT blocks, only the iMCU rows holding a rect (plus the blur's
+// halo) are decoded, cropped to the rects' columns, and only the blocks a
+// rect touches are blurred, transformed and quantized again with the
+// source's own tables. Every other block is copied bit for bit, so the rest
+// of the photo loses nothing and time and pixel memory follow the redacted
+// area. The coefficients themselves (2 bytes per sample) are held for the
+// whole image, as libjpeg's transcoder requires. Built when
+// BLUR_ENABLE_JPEG is defined (libjpeg-turbo).
+enum BlurJpegFlags {
+BLUR_JPEG_COPY_METADATA = 1 // keep EXIF, XMP and comments (the ICC profile is always kept)
+};
+
+
+typedef struct {
+int rows_decoded;         // image rows decoded to pixels
+int64_t blocks_rewritten; // 8x8 blocks encoded again from blurred pixels
+int64_t blocks_total;
+} BlurJpegStats;
+
+
+// returns 1 if blur_jpeg_redact is built in
+int blur_jpeg_available(void);
+
+
+// rects are in stored pixel coordinates (EXIF orientation is not applied)
+// and blurred as blur_apply_regions; mode: 0-4. The output is written
+// through a temporary file next to output_path, so a failure never leaves
+// a truncated image. stats may be NULL.
+// returns 0 on success, -1 on bad arguments, -2 for an unsupported mode or
+// colour space (only greyscale and YCbCr JPEGs are handled), -3 if out of
+// memory, -6 if built without JPEG support, -7 if the input cannot be read
+// as a JPEG, -8 if the output could not be written
+int blur_jpeg_redact(const char* input_path, const char* output_path,
+const BlurRect* rects, int rect_count, int mode, int strength,
+int flags, BlurJpegStats* stats);
+
+
+// Batch export: decode -> detect -> blur -> encode over a list of files,
+// one thread per stage so the stages of consecutive images overlap, with
+// the blur itself split over the shared worker pool. Decoding and encoding
+// are left to the caller (platform codecs) through callbacks. Back-pressure:
+// a new image is only decoded while fewer than max_in_flight images (and
+// fewer than max_bytes of pixels) are between decode and release.
+typedef struct BlurBatch BlurBatch;
+
+
+// A decoded image as handed between stages. decode fills every field;
+// opaque is the decoder's own handle, passed back to release.
+typedef struct {
+uint8_t* pixels;
+int width;
+int height;
+int stride; // bytes per row
+int format; // BlurPixelFormat
+void* opaque;
+} BlurBatchImage;
+
+
+// Callbacks run on the stage threads, never two of the same kind at once.
+// Any non-zero return (or negative detect result) fails only that image.
+typedef struct {
+// required: decode paths[index] into image
+int (*decode)(void* user, int index, const char* path, BlurBatchImage* image);
+// optional: write up to max_rects regions to blur; returns how many.
+// NULL blurs the spec's rects instead.
+int (*detect)(void* user, int index, const BlurBatchImage* image, BlurRect* rects, int max_rects);
+// required: encode the blurred image
+int (*encode)(void* user, int index, const BlurBatchImage* image);
+// required: free what decode allocated; called for every decoded image
+void (*release)(void* user, int index, BlurBatchImage* image);
+// optional: image index finished with status (0 = written), in index order
+void (*progress)(void* user, int index, int status, int done, int total);
+void* user;
+} BlurBatchCallbacks;
+
+
+typedef struct {
+int mode;               // as blur_apply_regions
+int strength;
+const BlurRect* rects;  // used without detect; NULL/0 = the whole image
+int rect_count;
+int max_in_flight;      // decoded images held at once (<= 0: 3)
+int64_t max_bytes;      // pixel bytes held at once (0 = no limit)
+} BlurBatchSpec;
+
+
+// Start a job over count paths (copied, like spec and callbacks).
+// returns NULL on bad arguments or if the stage threads could not start (a
+// build without C++ exceptions, such as the Android one, aborts instead)
+BlurBatch* blur_batch_start(const char* const* paths, int count, const BlurBatchSpec* spec,
+const BlurBatchCallbacks* callbacks);
+
+
+// Stop decoding new images and skip the remaining stages of those in
+// flight (the current blur stops early). Safe to call from any thread,
+// including from a callback.
+void blur_batch_cancel(BlurBatch* batch);
+
+
+// done: images finished so far (written, failed or skipped by cancel);
+// failed: those that failed. Either may be NULL. returns 1 once the job has
+// finished, 0 while it runs, -1 on bad arguments
+int blur_batch_progress(const BlurBatch* batch, int* done, int* failed);
+
+
+// Block until the job finishes. returns 0 if every image was written, -5
+// if cancelled, otherwise the status of the first image that failed
+int blur_batch_wait(BlurBatch* batch);
+
+
+// Cancel if still running, wait, and free the job
+void blur_batch_destroy(BlurBatch* batch);
+
+
+// Asynchronous jobs: blur work queued on the shared worker pool, finished
+// through a callback. Previews run before exports; within a priority, jobs
+// start oldest first. Jobs on the same session, or with the same non-zero
+// tag, never run at the same time. Cancelling is cooperative: a running
+// blur stops at its next band or tile.
+enum BlurJobKind {
+BLUR_JOB_REGIONS = 0,         // blur_apply_regions_ex on pixels
+BLUR_JOB_MASKED = 1,          // blur_apply_masked on pixels
+BLUR_JOB_SESSION_MASKED = 2,  // blur_session_render_masked
+BLUR_JOB_SESSION_BLURRED = 3, // blur_session_render_blurred
+};
+
+
+enum BlurJobPriority {
+BLUR_JOB_EXPORT = 0,
+BLUR_JOB_PREVIEW = 1,
+};
+
+
+// Fields not used by the kind are ignored. Pixels, the mask and the session
+// must stay valid until the job finishes; rects are copied.
+typedef struct {
+int kind;            // BlurJobKind
+int priority;        // BlurJobPriority
+int64_t tag;         // non-zero: submitting cancels unfinished jobs with the same tag
+uint8_t* pixels;     // pixel kinds: as blur_apply_regions
+int width;
+int height;
+int stride;
+int format;
+const BlurRect* rects; // BLUR_JOB_REGIONS; NULL/0 = the whole image
+int rect_count;
+const uint8_t* mask;   // BLUR_JOB_MASKED
+int mask_stride;
+BlurSession* session;  // session kinds
+int mask_id;           // BLUR_JOB_SESSION_MASKED
+int flags;             // BLUR_JOB_SESSION_BLURRED: BlurSessionFlags
+int mode;
+int strength;          // regions and blurred
+int fg_strength;       // masked kinds
+int bg_strength;
+} BlurJobSpec;
+
+
+// Called once per job on a worker thread with the blur's status (-5 if
+// cancelled, including jobs cancelled before they started). It may submit,
+// cancel or wait for other jobs.
+typedef void (*BlurJobDone)(void* user, int64_t job, int status);
+
+
+// Queue a job; done may be NULL.
+// returns the job id (> 0), -1 on bad arguments, -3 if out of memory
+int64_t blur_job_submit(const BlurJobSpec* spec, BlurJobDone done, void* user);
+
+
+// Safe from any thread, including from a callback.
+// returns 0, or -1 if the job has already finished (or never existed)
+int blur_job_cancel(int64_t job);
+
+
+// Cancel every unfinished job with the tag.
+// returns how many were cancelled
+int blur_job_cancel_tag(int64_t tag);
+
+
+// Block until the job has finished and its callback has returned.
+// returns 0, or -1 if it had already finished
+int blur_job_wait(int64_t job);
+
+
+// Preview pyramid of an RGBA image: levels 1..n are the source halved n
+// times (2x2 average), built once per image. Level 0 is the source itself,
+// which the caller keeps; blur it with blur_apply_regions_ex for the final
+// full-resolution result.
+typedef struct BlurPyramid BlurPyramid;
+
+
+// levels: extra levels to build, 1-3 (other values: 3). Stops early once a
+// level is 1x1. returns NULL on bad arguments or out of memory
+BlurPyramid* blur_pyramid_create(const uint8_t* pixels, int width, int height, int stride, int levels);
+
+
+void blur_pyramid_destroy(BlurPyramid* pyramid);
+
+
+// returns the number of downsampled levels
+int blur_pyramid_levels(const BlurPyramid* pyramid);
+
+
+// returns 0 on success, -1 if level is out of range
+int blur_pyramid_level_size(const BlurPyramid* pyramid, int level, int* width, int* height);
+
+
+// returns the smallest level still at least viewport_width x viewport_height
+// (0 if only the source is large enough). Under pressure the viewport is
+// first scaled by blur_governor_preview_scale.
+int blur_pyramid_level_for(const BlurPyramid* pyramid, int viewport_width, int viewport_height);
+
+
+// Copy level (>= 1) into dst (RGBA, dst_stride bytes, 0 = packed) and blur
+// it. rects and strength are in source coordinates and are scaled to the
+// level. ctx may be NULL. returns the blur_apply_regions_ex status, or -1 on
+// bad arguments
+int blur_pyramid_preview(BlurPyramid* pyramid, BlurContext* ctx, int level,
+uint8_t* dst, int dst_stride,
+const BlurRect* rects, int rect_count,
+int mode, int strength);
+
+
+// Resident GPU image (OpenGL ES 3.1 compute). The source is uploaded once
+// and kept in a texture; every blur_gpu_apply_regions call renders from it
+// into a result texture, so scrubbing a strength slider costs only shader
+// passes. Read the result back only when it is needed, e.g. on export.
+// The backend owns its own EGL context and restores the caller's current
+// context afterwards. An image must not be used by two threads at once.
+typedef struct BlurGpuImage BlurGpuImage;
+
+
+// returns 1 if the GPU backend is built in and a GLES 3.1 device is usable
+int blur_gpu_available(void);
+
+
+// pixels: RGBA8888, stride in bytes (0 = width*4, must be a multiple of 4)
+// returns NULL if the GPU backend is unavailable
+BlurGpuImage* blur_gpu_image_create(const uint8_t* pixels, int width, int height, int stride);
+
+
+void blur_gpu_image_destroy(BlurGpuImage* image);
+
+
+// Modes 0-2 of blur_apply_regions with the same strengths (identical
+// output), always applied to the original source rather than the previous
+// result.
+// returns 0 on success, -1 on bad arguments, -2 for an unsupported mode,
+// -4 if the GPU call failed
+int blur_gpu_apply_regions(BlurGpuImage* image, const BlurRect* rects, int rect_count,
+int mode, int strength);
+
+
+// Copy the current result into pixels (RGBA8888, stride as above).
+// returns 0 on success, -1 on bad arguments, -4 if the GPU call failed
+int blur_gpu_image_read(BlurGpuImage* image, uint8_t* pixels, int stride);
+
+
+// SIMD kernel level used by the blur passes. The best level the CPU supports
+// is picked automatically on first use.
+enum BlurSimdLevel {
+BLUR_SIMD_AUTO = -1,
+BLUR_SIMD_SCALAR = 0,
+BLUR_SIMD_SSE41 = 1,
+BLUR_SIMD_AVX2 = 2,
+BLUR_SIMD_NEON = 3
+};
+
+
+// Force a kernel level (or BLUR_SIMD_AUTO to re-detect). Output is identical
+// at every level; this exists for testing and benchmarking.
+// returns 0 on success, -1 if the level is not available on this CPU
+int blur_set_simd_level(int level);
+
+
+// returns the BlurSimdLevel currently in use
+int blur_get_simd_level(void);
+
+
+// Number of threads (including the caller) used by blur calls. Passes are
+// split into row and column bands, and non-overlapping rects run together.
+// threads <= 0 selects one per performance core (the default): cores more
+// than 20% slower than the fastest (by cpu_capacity, else max frequency)
+// are left out, since every pass waits for its last band. 1 disables the
+// worker pool. The pool persists across calls.
+// returns 0 on success, -1 if threads is above 256 (the setting is kept)
+int blur_set_thread_count(int threads);
+
+
+// returns the resolved thread count, after any blur_governor_set_pressure cap
+int blur_get_thread_count(void);
+
+
+// Pay the one-time setup now instead of in the first blur: pick the SIMD
+// kernels and start the worker pool. Meant for a background thread at app
+// start. Safe from any thread; concurrent callers wait for the one that
+// does the work.
+// returns the nanoseconds the setup took (the same value on every call)
+int64_t blur_warm_up(void);
+
+
+// Adaptive backend choice. blur_governor_calibrate times gaussian blurs of
+// three image sizes and two radii on every backend once and keeps the
+// results in a file; blur_governor_apply then runs each request on the
+// backend that was fastest for its size and radius. All backends give
+// identical output.
+enum BlurBackend {
+BLUR_BACKEND_SCALAR = 0,   // one thread, scalar kernels
+BLUR_BACKEND_SIMD = 1,     // one thread, the best SIMD kernels
+BLUR_BACKEND_THREADED = 2, // SIMD kernels on the worker pool
+BLUR_BACKEND_GPU = 3,      // GLES compute, upload and read-back included
+BLUR_BACKEND_COUNT = 4
+};
+
+
+// Platform signals, highest wins. Moderate (battery saver, or thermal
+// status moderate) halves the threads and scales previews to 3/4; severe
+// (thermal severe or worse) runs on one thread, keeps off the GPU and
+// halves previews.
+enum BlurPressure {
+BLUR_PRESSURE_NONE = 0,
+BLUR_PRESSURE_MODERATE = 1,
+BLUR_PRESSURE_SEVERE = 2
+};
+
+
+typedef struct {
+int backend;         // BlurBackend
+int threads;         // CPU threads the call runs on (0 on the GPU)
+int64_t estimate_ns; // predicted from the calibration, -1 before it
+} BlurRoute;
+
+
+// Load the timings from cache_path, or measure them (a second or so on a
+// slow phone; call it from a background thread) and write them there.
+// Timings from another device, core count or GPU availability are measured
+// again. cache_path may be NULL to measure without saving.
+// returns 0 on success, -8 if the results could not be saved (they are
+// still used)
+int blur_governor_calibrate(const char* cache_path);
+
+
+// returns 0 on success, -1 for an unknown BlurPressure
+int blur_governor_set_pressure(int level);
+
+
+// returns the current BlurPressure
+int blur_governor_pressure(void);
+
+
+// Factor to apply to preview sizes: 1, 3/4 or 1/2 by pressure.
+// blur_pyramid_level_for already applies it.
+float blur_governor_preview_scale(void);
+
+
+// Where a blur_apply_regions_ex call over the whole image would run.
+// Before calibration this is the worker pool (one thread: SIMD).
+// returns 0 on success, -1 on bad arguments
+int blur_governor_route(int width, int height, int format, int mode, int strength, BlurRoute* route);
+
+
+// blur_apply_regions_ex on the routed backend; the rects' area decides the
+// CPU size class, the whole image the GPU one (it uploads everything). The
+// GPU is only used for RGBA8888 and modes 0-2, and falls back to the CPU if
+// it fails. route, if not NULL, receives where the call ran.
+// returns as blur_apply_regions_ex
+int blur_governor_apply(BlurContext* ctx, uint8_t* pixels, int width, int height, int stride, int format,
+const BlurRect* rects, int rect_count, int mode, int strength, BlurRoute* route);
+
+
+// Calibration, pressure and the routing table as JSON:
+// {"calibrated":bool,"source":"none"|"benchmark"|"cache","calibration_ms":n,
+//  "simd_level":n,"threads":n,"gpu":bool,"pressure":n,"preview_scale":f,
+//  "sizes":[pixels...],"strengths":[n...],
+//  "backends":{"scalar":[[ms per megapixel by strength] by size],...},
+//  "routes":[[backend name by strength] by size]}
+// with null for backends not measured. NUL-terminated and truncated to
+// capacity.
+// returns the full length without the NUL, so a call with capacity 0 sizes
+// the buffer
+int blur_governor_json(char* buf, int capacity);
+
+
+// Large scratch and image buffers come from a process-wide pool in
+// power-of-two size classes and go back to it when released. Frees idle
+// pooled memory until at most keep_bytes remain (0 frees it all); call it
+// from memory-pressure callbacks. Buffers in use are not affected.
+// returns the bytes freed
+int64_t blur_memory_trim(int64_t keep_bytes);
+
+
+// Idle memory the pool may keep (default 64 MB); buffers released beyond
+// it are freed. bytes <= 0 restores the default.
+// returns 0 on success
+int blur_memory_set_pool_limit(int64_t bytes);
+
+
+// pooled: idle bytes held for reuse, in_use: bytes handed out; either may
+// be NULL. returns 0 on success
+int blur_memory_stats(int64_t* pooled, int64_t* in_use);
+
+
+// Stages timed by the built-in instrumentation. Each sample is one pass of
+// one call (all bands of it), not one row.
+enum BlurStage {
+BLUR_STAGE_COPY_IN = 0,  // pixels copied into scratch or across JNI / FFI
+BLUR_STAGE_BLUR_H = 1,   // horizontal box passes
+BLUR_STAGE_BLUR_V = 2,   // vertical box passes
+BLUR_STAGE_PIXELATE = 3,
+BLUR_STAGE_INTEGRAL = 4, // summed-area table build and lookups (modes 3, 4)
+BLUR_STAGE_BLEND = 5,    // mask-weighted write-back and layer compositing
+BLUR_STAGE_COPY_OUT = 6,
+BLUR_STAGE_MASK = 7,     // blur_mask_process steps other than smoothing
+BLUR_STAGE_COUNT = 8
+};
+
+
+// Percentiles come from log-linear buckets and are within about 12%.
+typedef struct {
+int64_t count;
+int64_t total_ns;
+int64_t max_ns;
+int64_t p50_ns;
+int64_t p90_ns;
+int64_t p99_ns;
+int64_t bytes;   // bytes moved, for the copy stages
+} BlurStageStats;
+
+
+typedef struct {
+BlurStageStats stages[BLUR_STAGE_COUNT];
+int64_t pool_hits;         // buffer pool requests served from idle buffers
+int64_t pool_misses;
+int64_t pool_idle_bytes;
+int64_t pool_in_use_bytes;
+int64_t layer_cache_hits;         // session layers reused (blur_session_*)
+int64_t layer_cache_misses;       // session layers built
+int64_t layer_cache_interpolated; // renders blended from two cached layers
+int64_t layer_cache_bytes;
+int64_t layer_cache_limit_bytes;
+int64_t layer_cache_layers;
+} BlurStats;
+
+
+// returns the short name of a stage ("blur_h", ...), NULL if out of range
+const char* blur_stage_name(int stage);
+
+
+// Stage timing is on by default and costs two clock reads and a few atomic
+// adds per pass. Builds with BLUR_ENABLE_PLATFORM_TRACE also emit every
+// stage as an ATrace section (Android) or os_signpost interval (Apple),
+// independently of this switch.
+// returns the previous setting
+int blur_stats_enable(int enabled);
+
+
+// Clears the histograms and restarts the pool hit counters.
+void blur_stats_reset(void);
+
+
+// returns 0 on success, -1 if out is NULL
+int blur_stats_read(BlurStats* out);
+
+
+// The same numbers as JSON, NUL-terminated and truncated to capacity.
+// returns the full length without the NUL, so a call with capacity 0 sizes
+// the buffer
+int blur_stats_json(char* buf, int capacity);
+
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
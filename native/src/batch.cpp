@@ -0,0 +1,302 @@
+// Batch export pipeline. Four stage threads (decode, detect, blur, encode)
+// pass images along through queues, so while one image is being encoded the
+// next is blurred and the one after that decoded. Memory is bounded by
+// admission: decode waits until the images still in flight drop below the
+// count and byte limits, and an image leaves flight when it is released
+// after encoding. The blur stage draws on the shared worker pool.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "blur.h"
+
+namespace {
+
+const int kDefaultInFlight = 3;
+const int kMaxDetectedRects = 64;
+
+struct Item {
+    int index;
+    int status;      // 0 until a stage fails
+    bool decoded;    // image must go back to release
+    int64_t bytes;
+    BlurBatchImage image;
+    std::vector<BlurRect> rects;
+};
+
+// Unbounded FIFO between two stages; admission keeps it short.
+class Channel {
+public:
+    void push(Item* item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            items_.push_back(item);
+        }
+        cv_.notify_one();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    // returns nullptr once closed and drained
+    Item* pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return nullptr;
+        Item* item = items_.front();
+        items_.pop_front();
+        return item;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Item*> items_;
+    bool closed_ = false;
+};
+
+// std::thread reports a failed start by throwing, so this fails softly only
+// where exceptions are enabled; a -fno-exceptions build aborts instead.
+template <typename Fn>
+bool startStage(std::thread& thread, Fn fn) {
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+    try {
+        thread = std::thread(fn);
+    } catch (const std::system_error&) {
+        return false;
+    }
+#else
+    thread = std::thread(fn);
+#endif
+    return true;
+}
+
+int64_t imageBytes(const BlurBatchImage& image) {
+    const int64_t plane = static_cast<int64_t>(image.stride) * image.height;
+    return image.format == BLUR_FORMAT_NV21 ? plane + plane / 2 : plane;
+}
+
+} // namespace
+
+struct BlurBatch {
+    std::vector<std::string> paths;
+    BlurBatchSpec spec;
+    std::vector<BlurRect> specRects;
+    BlurBatchCallbacks cb;
+    BlurContext* ctx = nullptr;
+
+    Channel toDetect, toBlur, toEncode;
+    std::thread decoder, detector, blurrer, encoder;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> done{0};
+    std::atomic<int> failed{0};
+    int firstError = 0;    // encode thread only
+    bool skipped = false; // an image was dropped by cancel
+
+    // Admission and completion, guarded by flightMutex
+    mutable std::mutex flightMutex;
+    std::condition_variable flightCv;
+    int inFlight = 0;
+    int64_t bytesInFlight = 0;
+    bool finished = false;
+
+    ~BlurBatch() { blur_context_destroy(ctx); }
+
+    bool admit() {
+        std::unique_lock<std::mutex> lock(flightMutex);
+        flightCv.wait(lock, [this] {
+            if (cancelled.load()) return true;
+            if (inFlight == 0) return true; // one image always fits, however large
+            return inFlight < spec.max_in_flight && (spec.max_bytes <= 0 || bytesInFlight < spec.max_bytes);
+        });
+        if (cancelled.load()) return false;
+        ++inFlight;
+        return true;
+    }
+
+    void leave(int64_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(flightMutex);
+            --inFlight;
+            bytesInFlight -= bytes;
+        }
+        flightCv.notify_all();
+    }
+
+    void decodeStage() {
+        for (int i = 0; i < static_cast<int>(paths.size()) && admit(); ++i) {
+            Item* item = new (std::nothrow) Item();
+            if (!item) {
+                leave(0);
+                cancelled.store(true); // nothing can be tracked any more
+                break;
+            }
+            item->index = i;
+            item->image = {};
+            item->status = cb.decode(cb.user, i, paths[i].c_str(), &item->image);
+            item->decoded = item->status == 0;
+            if (item->decoded && (!item->image.pixels || item->image.width <= 0 || item->image.height <= 0)) {
+                item->status = -1;
+            }
+            // Failed images still travel down the pipeline so progress is
+            // reported in order from one thread
+            item->bytes = item->decoded ? imageBytes(item->image) : 0;
+            {
+                std::lock_guard<std::mutex> lock(flightMutex);
+                bytesInFlight += item->bytes;
+            }
+            toDetect.push(item);
+        }
+        toDetect.close();
+    }
+
+    void detectStage() {
+        while (Item* item = toDetect.pop()) {
+            if (item->status == 0 && !cancelled.load()) {
+                if (cb.detect) {
+                    item->rects.resize(kMaxDetectedRects);
+                    const int n = cb.detect(cb.user, item->index, &item->image, item->rects.data(),
+                                            kMaxDetectedRects);
+                    if (n < 0) {
+                        item->status = n;
+                    } else {
+                        item->rects.resize(std::min(n, kMaxDetectedRects));
+                    }
+                } else if (!specRects.empty()) {
+                    item->rects = specRects;
+                } else {
+                    item->rects.assign(1, BlurRect{0, 0, item->image.width, item->image.height});
+                }
+            }
+            toBlur.push(item);
+        }
+        toBlur.close();
+    }
+
+    void blurStage() {
+        while (Item* item = toBlur.pop()) {
+            if (item->status == 0 && !cancelled.load() && !item->rects.empty()) {
+                const BlurBatchImage& im = item->image;
+                item->status = blur_apply_regions_ex(ctx, im.pixels, im.width, im.height, im.stride, im.format,
+                                                     item->rects.data(), static_cast<int>(item->rects.size()),
+                                                     spec.mode, spec.strength);
+            }
+            toEncode.push(item);
+        }
+        toEncode.close();
+    }
+
+    void encodeStage() {
+        while (Item* item = toEncode.pop()) {
+            if (item->status == 0 && cancelled.load()) item->status = -5;
+            if (item->status == 0) item->status = cb.encode(cb.user, item->index, &item->image);
+            if (item->decoded) cb.release(cb.user, item->index, &item->image);
+            leave(item->bytes);
+
+            if (item->status == -5) {
+                skipped = true;
+            } else if (item->status != 0) {
+                failed.fetch_add(1);
+                if (firstError == 0) firstError = item->status;
+            }
+            const int finishedCount = done.fetch_add(1) + 1;
+            if (cb.progress) {
+                cb.progress(cb.user, item->index, item->status, finishedCount, static_cast<int>(paths.size()));
+            }
+            delete item;
+        }
+        std::lock_guard<std::mutex> lock(flightMutex);
+        finished = true;
+    }
+
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lock(flightMutex);
+            cancelled.store(true);
+        }
+        flightCv.notify_all();
+        blur_context_cancel(ctx);
+    }
+};
+
+extern "C" BlurBatch* blur_batch_start(const char* const* paths, int count, const BlurBatchSpec* spec,
+                                       const BlurBatchCallbacks* callbacks) {
+    if (!paths || count <= 0 || !spec || !callbacks) return nullptr;
+    if (!callbacks->decode || !callbacks->encode || !callbacks->release) return nullptr;
+    if (spec->rect_count < 0 || (spec->rect_count > 0 && !spec->rects)) return nullptr;
+    if (spec->mode < 0 || spec->mode > 4) return nullptr;
+
+    std::unique_ptr<BlurBatch> b(new (std::nothrow) BlurBatch());
+    if (!b) return nullptr;
+    for (int i = 0; i < count; ++i) {
+        if (!paths[i]) return nullptr;
+        b->paths.emplace_back(paths[i]);
+    }
+    b->spec = *spec;
+    if (b->spec.max_in_flight <= 0) b->spec.max_in_flight = kDefaultInFlight;
+    b->specRects.assign(spec->rects, spec->rects + spec->rect_count);
+    b->spec.rects = nullptr; // the caller's array may not outlive the call
+    b->cb = *callbacks;
+    b->ctx = blur_context_create();
+    if (!b->ctx) return nullptr;
+
+    // Stages start downstream first: if one cannot, closing its input lets
+    // the ones already running drain and exit before the batch is freed
+    BlurBatch* batch = b.get();
+    auto abandon = [&b](Channel& input) {
+        input.close();
+        blur_batch_destroy(b.release());
+        return static_cast<BlurBatch*>(nullptr);
+    };
+    if (!startStage(batch->encoder, [batch] { batch->encodeStage(); })) return nullptr;
+    if (!startStage(batch->blurrer, [batch] { batch->blurStage(); })) return abandon(batch->toEncode);
+    if (!startStage(batch->detector, [batch] { batch->detectStage(); })) return abandon(batch->toBlur);
+    if (!startStage(batch->decoder, [batch] { batch->decodeStage(); })) return abandon(batch->toDetect);
+    return b.release();
+}
+
+extern "C" void blur_batch_cancel(BlurBatch* batch) {
+    if (batch) batch->cancel();
+}
+
+extern "C" int blur_batch_progress(const BlurBatch* batch, int* done, int* failed) {
+    if (!batch) return -1;
+    if (done) *done = batch->done.load();
+    if (failed) *failed = batch->failed.load();
+    std::lock_guard<std::mutex> lock(batch->flightMutex);
+    return batch->finished ? 1 : 0;
+}
+
+extern "C" int blur_batch_wait(BlurBatch* batch) {
+    if (!batch) return -1;
+    // Threads are joined once; later waits just report the result. Not
+    // meant to be called from two threads at once.
+    if (batch->decoder.joinable()) batch->decoder.join();
+    if (batch->detector.joinable()) batch->detector.join();
+    if (batch->blurrer.joinable()) batch->blurrer.join();
+    if (batch->encoder.joinable()) batch->encoder.join();
+    // A cancel that came after the last image was written changes nothing
+    if (batch->skipped || batch->done.load() < static_cast<int>(batch->paths.size())) return -5;
+    return batch->firstError;
+}
+
+extern "C" void blur_batch_destroy(BlurBatch* batch) {
+    if (!batch) return;
+    batch->cancel();
+    blur_batch_wait(batch);
+    delete batch;
+}
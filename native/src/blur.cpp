@@ -1,140 +1,647 @@
 // Clean, single-definition implementation for blur operations
 #include <algorithm>
+#include <atomic>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <new>
 #include "blur.h"
+#include "blur_kernels.h"
+#include "buffer_pool.h"
+#include "cancel.h"
+#include "thread_pool.h"
+#include "trace.h"
 
 static inline int clampi(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
 
-// Naive separable box blur (horizontal then vertical) on an RGBA sub-rect.
-static void boxBlurRGBA(uint8_t* p, int W, int H, int rx, int ry, const BlurRect& r) {
-    rx = std::max(1, rx);
-    ry = std::max(1, ry);
-
-    const int x0 = clampi(r.x, 0, W - 1);
-    const int y0 = clampi(r.y, 0, H - 1);
-    const int x1 = clampi(r.x + r.w - 1, 0, W - 1);
-    const int y1 = clampi(r.y + r.h - 1, 0, H - 1);
-
-    const int w = x1 - x0 + 1;
-    const int h = y1 - y0 + 1;
-    if (w <= 0 || h <= 0) return;
-
-    // Copy sub-rect into temporary buffer
-    std::vector<uint8_t> tmp(static_cast<size_t>(w) * h * 4);
-    for (int yy = 0; yy < h; ++yy) {
-        const uint8_t* src = p + ((y0 + yy) * W + x0) * 4;
-        uint8_t* dst = tmp.data() + (yy * w) * 4;
-        std::copy(src, src + w * 4, dst);
-    }
-
-    // Horizontal pass -> horiz
-    std::vector<uint8_t> horiz(static_cast<size_t>(w) * h * 4);
-    for (int yy = 0; yy < h; ++yy) {
-        for (int xx = 0; xx < w; ++xx) {
-            int rsum = 0, gsum = 0, bsum = 0, asum = 0, cnt = 0;
-            for (int k = -rx; k <= rx; ++k) {
-                int sx = clampi(xx + k, 0, w - 1);
-                const uint8_t* s = tmp.data() + (yy * w + sx) * 4;
-                rsum += s[0]; gsum += s[1]; bsum += s[2]; asum += s[3];
-                ++cnt;
+using blurcore::BlurKernels;
+using blurcore::Reciprocal;
+
+// Smallest slices worth handing to another thread.
+static const int kMinBandRows = 16;
+static const int kMinBandColumns = 64;
+
+// A rect clamped to the image, in pixels (inclusive bounds).
+struct Span {
+    int x0, y0, x1, y1;
+    int w() const { return x1 - x0 + 1; }
+    int h() const { return y1 - y0 + 1; }
+    bool overlaps(const Span& o) const {
+        return x0 <= o.x1 && o.x0 <= x1 && y0 <= o.y1 && o.y0 <= y1;
+    }
+};
+
+static Span clampRect(const BlurRect& r, int W, int H) {
+    Span s;
+    s.x0 = clampi(r.x, 0, W - 1);
+    s.y0 = clampi(r.y, 0, H - 1);
+    s.x1 = clampi(r.x + r.w - 1, 0, W - 1);
+    s.y1 = clampi(r.y + r.h - 1, 0, H - 1);
+    return s;
+}
+
+// One interleaved 8-bit plane: an RGBA/BGRA/RGB/gray image, or the Y or VU
+// plane of an NV21 frame. Rows may be padded (stride >= width * channels).
+struct Plane {
+    uint8_t* base;
+    int width;
+    int height;
+    int stride;   // bytes per row
+    int channels; // 1..4
+
+    uint8_t* at(int x, int y) const {
+        return base + static_cast<ptrdiff_t>(y) * stride + static_cast<ptrdiff_t>(x) * channels;
+    }
+};
+
+// Separable box blur on a sub-rect of a plane: every horizontal pass in
+// `radii`, then every vertical pass. Each pass uses a running sum per
+// channel, so the cost per pixel is independent of the radius. Taps are
+// clamped to the rect edges and the result is truncated exactly like a
+// direct (2r+1)-tap average.
+//
+// Horizontal passes only read their own row and vertical passes only their
+// own columns, so the work splits into row bands followed by column bands
+// with a single barrier in between. The first pass reads the image rows in
+// place and the last one writes straight back, so a single box pass needs
+// one scratch plane and the three-pass gaussian two.
+struct BoxJob {
+    Plane plane;
+    Span span;
+    const int* radii; // effective radii, all in [1, kMaxBoxRadius]
+    int passes;
+    uint8_t* bufs[2];
+    uint32_t* colSum; // one accumulator per byte of a sub-rect row
+
+    static size_t scratchBytes(const Span& s, int channels, int passes) {
+        const size_t rowLen = static_cast<size_t>(s.w()) * channels;
+        return (passes > 1 ? 2 : 1) * rowLen * s.h() + rowLen * sizeof(uint32_t);
+    }
+
+    void init(const Plane& pl, const Span& s, const int* rs, int n, uint8_t* scratch) {
+        plane = pl; span = s; radii = rs; passes = n;
+        const size_t size = static_cast<size_t>(s.w()) * pl.channels * s.h();
+        bufs[0] = scratch;
+        bufs[1] = n > 1 ? scratch + size : scratch;
+        colSum = reinterpret_cast<uint32_t*>(scratch + (n > 1 ? 2 : 1) * size);
+    }
+
+    uint8_t* image(int yy, int xx) const { return plane.at(span.x0 + xx, span.y0 + yy); }
+
+    // Run every horizontal pass over rows [yBegin, yEnd) of the sub-rect.
+    void rows(int yBegin, int yEnd) {
+        const int w = span.w();
+        const int ch = plane.channels;
+        const int rowLen = w * ch;
+        const auto hblurRow = ch == 4 ? blurcore::activeKernels().hblurRow : blurcore::channelKernels(ch).hblurRow;
+
+        for (int pass = 0; pass < passes; ++pass) {
+            const Reciprocal rc = blurcore::makeReciprocal(2 * radii[pass] + 1);
+            uint8_t* dst = bufs[pass & 1];
+            for (int yy = yBegin; yy < yEnd; ++yy) {
+                const uint8_t* src = pass == 0 ? image(yy, 0) : bufs[(pass - 1) & 1] + yy * rowLen;
+                hblurRow(src, dst + yy * rowLen, w, radii[pass], rc);
             }
-            uint8_t* d = horiz.data() + (yy * w + xx) * 4;
-            d[0] = static_cast<uint8_t>(rsum / cnt);
-            d[1] = static_cast<uint8_t>(gsum / cnt);
-            d[2] = static_cast<uint8_t>(bsum / cnt);
-            d[3] = static_cast<uint8_t>(asum / cnt);
         }
     }
 
-    // Vertical pass back into tmp
-    for (int yy = 0; yy < h; ++yy) {
-        for (int xx = 0; xx < w; ++xx) {
-            int rsum = 0, gsum = 0, bsum = 0, asum = 0, cnt = 0;
-            for (int k = -ry; k <= ry; ++k) {
-                int sy = clampi(yy + k, 0, h - 1);
-                const uint8_t* s = horiz.data() + (sy * w + xx) * 4;
-                rsum += s[0]; gsum += s[1]; bsum += s[2]; asum += s[3];
-                ++cnt;
+    // Run every vertical pass over pixel columns [cBegin, cEnd); the last
+    // pass lands in the image. One accumulator per column/channel lets us
+    // walk the buffer row by row instead of striding down each column.
+    void columns(int cBegin, int cEnd) {
+        const BlurKernels& k = blurcore::activeKernels();
+        const int h = span.h();
+        const int rowLen = span.w() * plane.channels;
+        const int off = cBegin * plane.channels;
+        const int n = (cEnd - cBegin) * plane.channels;
+        uint32_t* acc = colSum + off;
+
+        for (int pass = 0; pass < passes; ++pass) {
+            const int ry = radii[pass];
+            const int seq = passes + pass; // position in the full H+V sequence
+            const Reciprocal rc = blurcore::makeReciprocal(2 * ry + 1);
+            const uint8_t* src = bufs[(seq - 1) & 1] + off;
+            const bool last = pass == passes - 1;
+            uint8_t* dst = last ? image(0, cBegin) : bufs[seq & 1] + off;
+            const ptrdiff_t dstStride = last ? plane.stride : rowLen;
+
+            std::fill(acc, acc + n, 0u);
+            for (int kk = -ry; kk <= ry; ++kk) {
+                k.colAccumulate(acc, src + clampi(kk, 0, h - 1) * rowLen, n);
+            }
+            for (int yy = 0; yy < h; ++yy) {
+                const uint8_t* in = src + clampi(yy + ry + 1, 0, h - 1) * rowLen;
+                const uint8_t* outp = src + clampi(yy - ry, 0, h - 1) * rowLen;
+                k.colEmit(acc, in, outp, dst + yy * dstStride, n, rc);
             }
-            uint8_t* d = tmp.data() + (yy * w + xx) * 4;
-            d[0] = static_cast<uint8_t>(rsum / cnt);
-            d[1] = static_cast<uint8_t>(gsum / cnt);
-            d[2] = static_cast<uint8_t>(bsum / cnt);
-            d[3] = static_cast<uint8_t>(asum / cnt);
         }
     }
+};
 
-    // Blit back into original buffer
-    for (int yy = 0; yy < h; ++yy) {
-        uint8_t* dst = p + ((y0 + yy) * W + x0) * 4;
-        const uint8_t* src = tmp.data() + (yy * w) * 4;
-        std::copy(src, src + w * 4, dst);
+// Paint a cw x rows block of a plane with one pixel value.
+static void fillBlock(const Plane& pl, uint8_t* block, int cw, int rows, const uint8_t avg[4]) {
+    if (pl.channels == 4) {
+        const BlurKernels& k = blurcore::activeKernels();
+        uint32_t pixel;
+        std::memcpy(&pixel, avg, 4);
+        for (int yy = 0; yy < rows; ++yy) k.fillRow(block + static_cast<ptrdiff_t>(yy) * pl.stride, cw, pixel);
+    } else {
+        const auto fillRow = blurcore::channelKernels(pl.channels).fillRow;
+        for (int yy = 0; yy < rows; ++yy) fillRow(block + static_cast<ptrdiff_t>(yy) * pl.stride, cw, avg);
     }
 }
 
-// Pixelate (block-average) over a rect
-static void pixelateRGBA(uint8_t* p, int W, int H, int blockSize, const BlurRect& r) {
-    const int x0 = clampi(r.x, 0, W - 1);
-    const int y0 = clampi(r.y, 0, H - 1);
-    const int x1 = clampi(r.x + r.w - 1, 0, W - 1);
-    const int y1 = clampi(r.y + r.h - 1, 0, H - 1);
-    const int bw = std::max(1, blockSize);
+// Pixelate (block-average) one row of blocks starting at `by`. Only a few
+// divides happen per block, so they stay plain integer divisions; the RGBA
+// block sum and fill are vectorized.
+static void pixelateBlockRow(const Plane& pl, const Span& s, int bw, int by) {
+    const int ch = pl.channels;
+    const auto blockSum = ch == 4 ? blurcore::activeKernels().blockSum : blurcore::channelKernels(ch).blockSum;
+    const int ey = std::min(by + bw - 1, s.y1);
+    const int rows = ey - by + 1;
 
-    for (int by = y0; by <= y1; by += bw) {
-        for (int bx = x0; bx <= x1; bx += bw) {
-            const int ex = std::min(bx + bw - 1, x1);
-            const int ey = std::min(by + bw - 1, y1);
+    for (int bx = s.x0; bx <= s.x1; bx += bw) {
+        const int ex = std::min(bx + bw - 1, s.x1);
+        const int cw = ex - bx + 1;
+        uint8_t* block = pl.at(bx, by);
 
-            uint32_t rsum = 0, gsum = 0, bsum = 0, asum = 0;
-            uint32_t cnt = 0;
-            for (int yy = by; yy <= ey; ++yy) {
-                for (int xx = bx; xx <= ex; ++xx) {
-                    uint8_t* pix = p + (yy * W + xx) * 4;
-                    rsum += pix[0]; gsum += pix[1]; bsum += pix[2]; asum += pix[3];
-                    ++cnt;
-                }
+        uint32_t sums[4];
+        blockSum(block, pl.stride, cw, rows, sums);
+
+        const uint32_t cnt = static_cast<uint32_t>(cw) * static_cast<uint32_t>(rows);
+        uint8_t avg[4] = {0, 0, 0, 0};
+        for (int c = 0; c < ch; ++c) avg[c] = static_cast<uint8_t>(sums[c] / cnt);
+        fillBlock(pl, block, cw, rows, avg);
+    }
+}
+
+// Split [0, n) into at most maxBands slices of at least minSize each.
+static int bandCount(int n, int minSize, int maxBands) {
+    return clampi(n / minSize, 1, maxBands);
+}
+
+static int bandStart(int n, int bands, int i) {
+    return static_cast<int>(static_cast<int64_t>(n) * i / bands);
+}
+
+// One slice of work for parallelFor: which rect, and which band of it.
+struct BandTask {
+    int job;
+    int begin;
+    int end;
+};
+
+// Scratch owned by a BlurContext. Everything only grows, so once a context
+// has seen the largest frame and rect set it will be used for, later calls
+// reuse the same memory. The arena comes from the buffer pool, so even a
+// short-lived context (ctx == NULL calls) reuses the last call's memory.
+struct BlurContext {
+    blurcore::PooledBuffer arena;
+    size_t arenaSize = 0;
+    std::vector<Span> spans;
+    std::vector<BoxJob> jobs;
+    std::vector<BandTask> rowTasks;
+    std::vector<BandTask> colTasks;
+    std::atomic<bool> cancelled{false}; // set by blur_context_cancel
+    int cancelDepth = 0;                 // open CancelScopes
+
+    // Returns nullptr if the arena cannot grow to `bytes`.
+    uint8_t* reserve(size_t bytes) {
+        if (bytes > arenaSize) {
+            // Scratch is always written before read, so the old contents go
+            arena.reset();
+            arenaSize = 0;
+            arena = blurcore::acquireBuffer(bytes);
+            if (!arena) return nullptr;
+            arenaSize = arena.capacity();
+        }
+        return arena.data();
+    }
+};
+
+// Scratch offsets are kept 64-byte aligned so planes start on a cache line.
+static size_t alignUp(size_t n) { return (n + 63) & ~static_cast<size_t>(63); }
+
+extern "C" BlurContext* blur_context_create(void) {
+    return new (std::nothrow) BlurContext();
+}
+
+extern "C" void blur_context_destroy(BlurContext* ctx) {
+    delete ctx;
+}
+
+extern "C" void blur_context_cancel(BlurContext* ctx) {
+    if (ctx) ctx->cancelled.store(true);
+}
+
+namespace blurcore {
+
+CancelScope::CancelScope(BlurContext* ctx) : ctx_(ctx) {
+    if (ctx_ && ctx_->cancelDepth++ == 0) ctx_->cancelled.store(false);
+}
+
+CancelScope::~CancelScope() {
+    if (ctx_) --ctx_->cancelDepth;
+}
+
+} // namespace blurcore
+
+extern "C" size_t blur_context_scratch_bytes(const BlurContext* ctx) {
+    return ctx ? ctx->arenaSize : 0;
+}
+
+// Rects run concurrently in batches of mutually non-overlapping rects.
+// A rect that overlaps anything in the current batch starts a new one, so
+// overlapping rects still see each other's output in caller order. returns
+// one past the last span of the batch starting at `first`.
+static size_t batchEnd(const std::vector<Span>& spans, size_t first) {
+    size_t last = first + 1;
+    while (last < spans.size()) {
+        bool clash = false;
+        for (size_t j = first; j < last && !clash; ++j) clash = spans[j].overlaps(spans[last]);
+        if (clash) break;
+        ++last;
+    }
+    return last;
+}
+
+// floor(n / d) for the varying window sizes of the integral modes. The
+// reciprocal only changes at the image edges, so it is cached.
+struct CountDivider {
+    uint32_t d = 0;
+    Reciprocal rc = {0, 0};
+
+    uint32_t divide(uint64_t n, uint32_t cnt) {
+        if (cnt >= (1u << 22)) return static_cast<uint32_t>(n / cnt); // past the exact reciprocal range
+        if (cnt != d) {
+            d = cnt;
+            rc = blurcore::makeReciprocal(cnt);
+        }
+        return blurcore::divideBy(static_cast<uint32_t>(n), rc);
+    }
+};
+
+// Summed-area table over `dom` of a plane: entry (x, y) holds the sums of
+// every pixel above and left of it, with a zero first row and column. Any
+// box sum is then four lookups, whatever its size. Sums are kept modulo
+// 2^bits: a difference of four entries is exact as long as the true box sum
+// fits in T, so 32-bit entries do whenever 255 * window area < 2^32.
+template <typename T>
+struct Integral {
+    const Plane* plane;
+    Span dom;
+    T* sat;
+    size_t rowLen; // entries per table row
+
+    static size_t scratchBytes(const Span& d, int channels) {
+        return (static_cast<size_t>(d.w()) + 1) * channels * (static_cast<size_t>(d.h()) + 1) * sizeof(T);
+    }
+
+    void init(const Plane& pl, const Span& d, uint8_t* scratch) {
+        plane = &pl; dom = d;
+        sat = reinterpret_cast<T*>(scratch);
+        rowLen = (static_cast<size_t>(d.w()) + 1) * pl.channels;
+        std::fill(sat, sat + rowLen, T(0));
+    }
+
+    T* row(int yy) const { return sat + yy * rowLen; }
+
+    // Running sums along rows [yBegin, yEnd) of the domain.
+    void prefixRows(int yBegin, int yEnd) {
+        const int ch = plane->channels;
+        const int n = dom.w() * ch;
+        for (int yy = yBegin; yy < yEnd; ++yy) {
+            const uint8_t* in = plane->at(dom.x0, dom.y0 + yy);
+            T* out = row(yy + 1);
+            std::fill(out, out + ch, T(0));
+            for (int i = 0; i < n; ++i) out[ch + i] = static_cast<T>(out[i] + in[i]);
+        }
+    }
+
+    // Running sums down pixel columns [cBegin, cEnd), walked row by row.
+    void prefixColumns(int cBegin, int cEnd) {
+        const int ch = plane->channels;
+        const size_t i0 = static_cast<size_t>(cBegin + 1) * ch;
+        const size_t i1 = static_cast<size_t>(cEnd + 1) * ch;
+        for (int yy = 2; yy <= dom.h(); ++yy) {
+            const T* prev = row(yy - 1);
+            T* cur = row(yy);
+            for (size_t i = i0; i < i1; ++i) cur[i] = static_cast<T>(cur[i] + prev[i]);
+        }
+    }
+
+    // Per-channel sums over pixels [x0, x1] x [y0, y1] (plane coordinates,
+    // inside the domain).
+    template <int C>
+    void boxSums(int x0, int y0, int x1, int y1, uint64_t sums[4]) const {
+        const T* top = row(y0 - dom.y0);
+        const T* bottom = row(y1 - dom.y0 + 1);
+        const size_t l = static_cast<size_t>(x0 - dom.x0) * C;
+        const size_t r = static_cast<size_t>(x1 - dom.x0 + 1) * C;
+        for (int c = 0; c < C; ++c) {
+            sums[c] = static_cast<T>(bottom[r + c] - bottom[l + c] - top[r + c] + top[l + c]);
+        }
+    }
+
+    void boxSums(int x0, int y0, int x1, int y1, uint64_t sums[4]) const {
+        switch (plane->channels) {
+        case 1: boxSums<1>(x0, y0, x1, y1, sums); break;
+        case 2: boxSums<2>(x0, y0, x1, y1, sums); break;
+        case 3: boxSums<3>(x0, y0, x1, y1, sums); break;
+        default: boxSums<4>(x0, y0, x1, y1, sums); break;
+        }
+    }
+
+    // Box average of radius `radius` over rows [yBegin, yEnd) of `s`. The
+    // window is clipped to the plane rather than clamped, so rect edges
+    // leave no seam.
+    template <int C>
+    void boxRows(const Span& s, int radius, int yBegin, int yEnd) const {
+        CountDivider div;
+        for (int y = yBegin; y < yEnd; ++y) {
+            const int wy0 = std::max(y - radius, 0);
+            const int wy1 = std::min(y + radius, plane->height - 1);
+            uint8_t* out = plane->at(s.x0, y);
+            for (int x = s.x0; x <= s.x1; ++x, out += C) {
+                const int wx0 = std::max(x - radius, 0);
+                const int wx1 = std::min(x + radius, plane->width - 1);
+                const uint32_t cnt = static_cast<uint32_t>(wx1 - wx0 + 1) * static_cast<uint32_t>(wy1 - wy0 + 1);
+                uint64_t sums[4];
+                boxSums<C>(wx0, wy0, wx1, wy1, sums);
+                for (int c = 0; c < C; ++c) out[c] = static_cast<uint8_t>(div.divide(sums[c], cnt));
             }
+        }
+    }
+
+    void boxRows(const Span& s, int radius, int yBegin, int yEnd) const {
+        switch (plane->channels) {
+        case 1: boxRows<1>(s, radius, yBegin, yEnd); break;
+        case 2: boxRows<2>(s, radius, yBegin, yEnd); break;
+        case 3: boxRows<3>(s, radius, yBegin, yEnd); break;
+        default: boxRows<4>(s, radius, yBegin, yEnd); break;
+        }
+    }
+
+    // Same blocks and averages as pixelateBlockRow.
+    void pixelateRow(const Span& s, int bw, int by) const {
+        const int ey = std::min(by + bw - 1, s.y1);
+        for (int bx = s.x0; bx <= s.x1; bx += bw) {
+            const int ex = std::min(bx + bw - 1, s.x1);
+            const uint32_t cnt = static_cast<uint32_t>(ex - bx + 1) * static_cast<uint32_t>(ey - by + 1);
+            uint64_t sums[4];
+            boxSums(bx, by, ex, ey, sums);
+            uint8_t avg[4] = {0, 0, 0, 0};
+            for (int c = 0; c < plane->channels; ++c) avg[c] = static_cast<uint8_t>(sums[c] / cnt);
+            fillBlock(*plane, plane->at(bx, by), ex - bx + 1, ey - by + 1, avg);
+        }
+    }
+};
+
+// Modes 3 and 4: one summed-area table over the bounding box of every span
+// (grown by the radius for box averages), then O(1) lookups per output
+// pixel or block. The table is built from the input before anything is
+// written, so every rect reads the original pixels.
+template <typename T>
+static int integralPlane(BlurContext* ctx, const Plane& plane, const std::vector<Span>& spans,
+                         int mode, int size) {
+    Span dom = spans[0];
+    for (const Span& s : spans) {
+        dom.x0 = std::min(dom.x0, s.x0); dom.y0 = std::min(dom.y0, s.y0);
+        dom.x1 = std::max(dom.x1, s.x1); dom.y1 = std::max(dom.y1, s.y1);
+    }
+    if (mode == 3) {
+        dom.x0 = std::max(dom.x0 - size, 0); dom.y0 = std::max(dom.y0 - size, 0);
+        dom.x1 = std::min(dom.x1 + size, plane.width - 1); dom.y1 = std::min(dom.y1 + size, plane.height - 1);
+    }
 
-            if (cnt == 0) continue;
-            const uint8_t rr = static_cast<uint8_t>(rsum / cnt);
-            const uint8_t gg = static_cast<uint8_t>(gsum / cnt);
-            const uint8_t bb = static_cast<uint8_t>(bsum / cnt);
-            const uint8_t aa = static_cast<uint8_t>(asum / cnt);
+    uint8_t* arena = ctx->reserve(Integral<T>::scratchBytes(dom, plane.channels));
+    if (!arena) return -3;
+    blurcore::StageScope stage(BLUR_STAGE_INTEGRAL);
+    Integral<T> table;
+    table.init(plane, dom, arena);
 
-            for (int yy = by; yy <= ey; ++yy) {
-                for (int xx = bx; xx <= ex; ++xx) {
-                    uint8_t* pix = p + (yy * W + xx) * 4;
-                    pix[0] = rr; pix[1] = gg; pix[2] = bb; pix[3] = aa;
+    const int maxBands = 4 * blurcore::configuredThreadCount();
+    std::vector<BandTask>& tasks = ctx->rowTasks;
+    // Single capture keeps the std::function inside its small buffer; the
+    // task list is swapped in before each parallelFor.
+    struct {
+        Integral<T>* table; const Span* spans; const BandTask* tasks; int mode; int size;
+        const std::atomic<bool>* cancelled;
+    } batch = {&table, spans.data(), nullptr, mode, size, &ctx->cancelled};
+
+    tasks.clear();
+    const int rb = bandCount(dom.h(), kMinBandRows, maxBands);
+    for (int b = 0; b < rb; ++b) tasks.push_back({0, bandStart(dom.h(), rb, b), bandStart(dom.h(), rb, b + 1)});
+    batch.tasks = tasks.data();
+    blurcore::parallelFor(rb, [&batch](int t) {
+        if (batch.cancelled->load(std::memory_order_relaxed)) return;
+        batch.table->prefixRows(batch.tasks[t].begin, batch.tasks[t].end);
+    });
+    std::vector<BandTask>& cols = ctx->colTasks;
+    cols.clear();
+    const int cb = bandCount(dom.w(), kMinBandColumns, maxBands);
+    for (int b = 0; b < cb; ++b) cols.push_back({0, bandStart(dom.w(), cb, b), bandStart(dom.w(), cb, b + 1)});
+    batch.tasks = cols.data();
+    blurcore::parallelFor(cb, [&batch](int t) {
+        if (batch.cancelled->load(std::memory_order_relaxed)) return;
+        batch.table->prefixColumns(batch.tasks[t].begin, batch.tasks[t].end);
+    });
+    if (ctx->cancelled.load()) return -5;
+
+    size_t first = 0;
+    while (first < spans.size()) {
+        const size_t last = batchEnd(spans, first);
+        tasks.clear();
+        for (size_t j = first; j < last; ++j) {
+            const Span& s = spans[j];
+            if (mode == 4) {
+                for (int by = s.y0; by <= s.y1; by += size) tasks.push_back({static_cast<int>(j), by, by});
+            } else {
+                const int n = bandCount(s.h(), kMinBandRows, maxBands);
+                for (int b = 0; b < n; ++b) {
+                    tasks.push_back({static_cast<int>(j), s.y0 + bandStart(s.h(), n, b), s.y0 + bandStart(s.h(), n, b + 1)});
                 }
             }
         }
+        batch.tasks = tasks.data();
+        blurcore::parallelFor(static_cast<int>(tasks.size()), [&batch](int t) {
+            if (batch.cancelled->load(std::memory_order_relaxed)) return;
+            const BandTask& task = batch.tasks[t];
+            const Span& s = batch.spans[task.job];
+            if (batch.mode == 4) {
+                batch.table->pixelateRow(s, batch.size, task.begin);
+            } else {
+                batch.table->boxRows(s, batch.size, task.begin, task.end);
+            }
+        });
+        if (ctx->cancelled.load()) return -5;
+        first = last;
     }
+    return 0;
 }
 
-extern "C" int blur_apply_regions(uint8_t* pixels, int width, int height,
-                                   const BlurRect* rects, int rect_count,
-                                   int mode, int strength) {
-    if (!pixels || width <= 0 || height <= 0) return -1;
-    if (!rects || rect_count <= 0) return 0; // nothing to do
+// Blur every span of one plane. `spans` are already clamped to the plane.
+static int blurPlane(BlurContext* ctx, const Plane& plane, const std::vector<Span>& spans,
+                     int mode, int strength) {
+    if (mode == 3 || mode == 4) {
+        const int size = mode == 3 ? clampi(strength, 1, blurcore::kMaxBoxRadius) : std::max(1, strength);
+        // Largest window any lookup can cover
+        const uint64_t side = mode == 3 ? 2 * static_cast<uint64_t>(size) + 1 : static_cast<uint64_t>(size);
+        const uint64_t area = std::min<uint64_t>(side, plane.width) * std::min<uint64_t>(side, plane.height);
+        if (area * 255 <= UINT32_MAX) return integralPlane<uint32_t>(ctx, plane, spans, mode, size);
+        return integralPlane<uint64_t>(ctx, plane, spans, mode, size);
+    }
 
-    for (int i = 0; i < rect_count; ++i) {
-        const BlurRect r = rects[i];
-        if (r.w <= 0 || r.h <= 0) continue;
-
-        if (mode == 0) {
-            int rx = std::max(1, strength);
-            int ry = rx;
-            boxBlurRGBA(pixels, width, height, rx, ry, r);
-        } else if (mode == 1) {
-            int block = std::max(1, strength);
-            pixelateRGBA(pixels, width, height, block, r);
+    int radii[3];
+    const int passes = blurcore::boxPassRadii(mode, strength, radii);
+    if (mode != 1 && passes == 0) return 0;
+    const int block = std::max(1, strength);
+
+    const int maxBands = 4 * blurcore::configuredThreadCount();
+    std::vector<BandTask>& rowTasks = ctx->rowTasks;
+    std::vector<BandTask>& colTasks = ctx->colTasks;
+    size_t first = 0;
+    while (first < spans.size()) {
+        const size_t last = batchEnd(spans, first);
+
+        rowTasks.clear();
+        colTasks.clear();
+        if (mode == 1) {
+            for (size_t j = first; j < last; ++j) {
+                for (int by = spans[j].y0; by <= spans[j].y1; by += block) {
+                    rowTasks.push_back({static_cast<int>(j), by, by});
+                }
+            }
+            // Single capture keeps the std::function inside its small buffer.
+            const struct {
+                const Plane* plane; int block; const Span* spans; const BandTask* tasks;
+                const std::atomic<bool>* cancelled;
+            } batch = {&plane, block, spans.data(), rowTasks.data(), &ctx->cancelled};
+            blurcore::StageScope stage(BLUR_STAGE_PIXELATE);
+            blurcore::parallelFor(static_cast<int>(rowTasks.size()), [&batch](int t) {
+                if (batch.cancelled->load(std::memory_order_relaxed)) return;
+                const BandTask& task = batch.tasks[t];
+                pixelateBlockRow(*batch.plane, batch.spans[task.job], batch.block, task.begin);
+            });
         } else {
-            // unsupported mode
-            return -2;
+            size_t scratch = 0;
+            for (size_t j = first; j < last; ++j) {
+                scratch += alignUp(BoxJob::scratchBytes(spans[j], plane.channels, passes));
+            }
+            uint8_t* arena = ctx->reserve(scratch);
+            if (!arena) return -3;
+
+            std::vector<BoxJob>& jobs = ctx->jobs;
+            jobs.resize(last - first);
+            for (size_t j = first; j < last; ++j) {
+                const Span& s = spans[j];
+                const int ji = static_cast<int>(j - first);
+                jobs[ji].init(plane, s, radii, passes, arena);
+                arena += alignUp(BoxJob::scratchBytes(s, plane.channels, passes));
+
+                const int rb = bandCount(s.h(), kMinBandRows, maxBands);
+                for (int b = 0; b < rb; ++b) {
+                    rowTasks.push_back({ji, bandStart(s.h(), rb, b), bandStart(s.h(), rb, b + 1)});
+                }
+                const int cb = bandCount(s.w(), kMinBandColumns, maxBands);
+                for (int b = 0; b < cb; ++b) {
+                    colTasks.push_back({ji, bandStart(s.w(), cb, b), bandStart(s.w(), cb, b + 1)});
+                }
+            }
+
+            const struct {
+                BoxJob* jobs; const BandTask* rows; const BandTask* cols;
+                const std::atomic<bool>* cancelled;
+            } batch = {jobs.data(), rowTasks.data(), colTasks.data(), &ctx->cancelled};
+            {
+                blurcore::StageScope stage(BLUR_STAGE_BLUR_H);
+                blurcore::parallelFor(static_cast<int>(rowTasks.size()), [&batch](int t) {
+                    if (batch.cancelled->load(std::memory_order_relaxed)) return;
+                    batch.jobs[batch.rows[t].job].rows(batch.rows[t].begin, batch.rows[t].end);
+                });
+            }
+            blurcore::StageScope stage(BLUR_STAGE_BLUR_V);
+            blurcore::parallelFor(static_cast<int>(colTasks.size()), [&batch](int t) {
+                if (batch.cancelled->load(std::memory_order_relaxed)) return;
+                batch.jobs[batch.cols[t].job].columns(batch.cols[t].begin, batch.cols[t].end);
+            });
         }
+
+        // Bands skipped after a cancel leave the rects partly blurred.
+        if (ctx->cancelled.load()) return -5;
+        first = last;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+static int bytesPerPixel(int format) {
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: return 4;
+    case BLUR_FORMAT_RGB888: return 3;
+    case BLUR_FORMAT_GRAY8:
+    case BLUR_FORMAT_NV21: return 1; // luma plane
+    default: return 0;
+    }
+}
+
+extern "C" int blur_apply_regions_ex(BlurContext* ctx, uint8_t* pixels, int width, int height,
+                                      int stride, int format,
+                                      const BlurRect* rects, int rect_count,
+                                      int mode, int strength) {
+    const int bpp = bytesPerPixel(format);
+    if (!pixels || width <= 0 || height <= 0 || bpp == 0) return -1;
+    if (stride == 0) stride = width * bpp;
+    if (stride < width * bpp) return -1;
+    // NV21's VU rows hold (width + 1) / 2 pairs in the same stride; checked
+    // before the luma pass so a rejected frame is left untouched
+    if (format == BLUR_FORMAT_NV21 && stride < (width + 1) / 2 * 2) return -1;
+    if (!rects || rect_count <= 0) return 0; // nothing to do
+
+    BlurContext local;
+    if (!ctx) ctx = &local;
+    blurcore::CancelScope scope(ctx);
+
+    // Clamp every non-empty rect up front
+    std::vector<Span>& spans = ctx->spans;
+    spans.clear();
+    for (int i = 0; i < rect_count; ++i) {
+        if (rects[i].w <= 0 || rects[i].h <= 0) continue;
+        spans.push_back(clampRect(rects[i], width, height));
+    }
+    if (spans.empty()) return 0;
+    if (mode < 0 || mode > 4) return -2; // unsupported mode
+
+    // Channels are blurred independently, so RGBA and BGRA are the same
+    // four-channel plane; only NV21 needs a second pass for its chroma.
+    const Plane main = {pixels, width, height, stride, format == BLUR_FORMAT_NV21 ? 1 : bpp};
+    const int rc = blurPlane(ctx, main, spans, mode, strength);
+    if (rc != 0 || format != BLUR_FORMAT_NV21) return rc;
+
+    // NV21: interleaved VU at half resolution right after the Y plane, same
+    // stride. Rects and strength are mapped to chroma coordinates.
+    const Plane chroma = {pixels + static_cast<ptrdiff_t>(stride) * height,
+                          (width + 1) / 2, (height + 1) / 2, stride, 2};
+    for (Span& s : spans) {
+        s.x0 /= 2; s.y0 /= 2; s.x1 /= 2; s.y1 /= 2;
+    }
+    return blurPlane(ctx, chroma, spans, mode, (strength + 1) / 2);
+}
+
+extern "C" int blur_apply_regions_ctx(BlurContext* ctx, uint8_t* pixels, int width, int height,
+                                       const BlurRect* rects, int rect_count,
+                                       int mode, int strength) {
+    if (!ctx) return -1;
+    return blur_apply_regions_ex(ctx, pixels, width, height, 0, BLUR_FORMAT_RGBA8888,
+                                 rects, rect_count, mode, strength);
+}
+
+extern "C" int blur_apply_regions(uint8_t* pixels, int width, int height,
+                                   const BlurRect* rects, int rect_count,
+                                   int mode, int strength) {
+    return blur_apply_regions_ex(nullptr, pixels, width, height, 0, BLUR_FORMAT_RGBA8888,
+                                 rects, rect_count, mode, strength);
+}
@@ -0,0 +1,555 @@
+// Scalar and SIMD row kernels for the portable blur core, plus runtime dispatch.
+// NEON is part of the arm64 baseline, so it is selected at compile time there.
+// On x86 the SSE4.1/AVX2 variants are built with per-function target attributes
+// and picked from CPUID at first use, so the library itself still targets the
+// baseline ISA and runs on any x86_64 emulator image.
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "blur.h"
+#include "blur_kernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BLUR_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define BLUR_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace blurcore {
+
+static inline int clampi(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+Reciprocal makeReciprocal(uint32_t d) {
+    uint32_t log2d = 0;
+    while ((d >> (log2d + 1)) != 0) ++log2d;
+    Reciprocal rc;
+    rc.shift = 31 + log2d;
+    rc.mul = static_cast<uint32_t>(((1ull << rc.shift) + d - 1) / d);
+    return rc;
+}
+
+// Box radii for `passes` successive box blurs whose combined response
+// approximates a Gaussian of the given sigma (box widths per Wells, 1986:
+// pick the two odd widths around the ideal one so the variances add up).
+static void gaussianBoxRadii(double sigma, int passes, int* radii) {
+    const double ideal = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int wl = static_cast<int>(std::floor(ideal));
+    if (wl % 2 == 0) --wl;
+    const int wu = wl + 2;
+    const double mIdeal = (12.0 * sigma * sigma - passes * wl * wl - 4.0 * passes * wl - 3.0 * passes)
+                          / (-4.0 * wl - 4.0);
+    const int m = static_cast<int>(std::lround(mIdeal));
+    for (int i = 0; i < passes; ++i) {
+        radii[i] = ((i < m ? wl : wu) - 1) / 2;
+    }
+}
+
+int boxPassRadii(int mode, int strength, int radii[3]) {
+    int passes = 0;
+    if (mode == 0) {
+        radii[passes++] = clampi(strength, 1, kMaxBoxRadius);
+    } else if (mode == 2) {
+        int gauss[3];
+        gaussianBoxRadii(strength < 1 ? 1 : strength, 3, gauss);
+        for (int r : gauss) {
+            if (r >= 1) radii[passes++] = r < kMaxBoxRadius ? r : kMaxBoxRadius; // zero-width box is the identity
+        }
+    }
+    return passes;
+}
+
+// ---------------------------------------------------------------------------
+// Scalar
+// ---------------------------------------------------------------------------
+
+// Running-sum box over one row of C-channel pixels. The window only needs
+// clamping within r of either end, so the interior runs without it.
+template <int C>
+static void hblurRowN(const uint8_t* row, uint8_t* out, int w, int r, Reciprocal rc) {
+    uint32_t sum[C] = {};
+    for (int k = -r; k <= r; ++k) {
+        const uint8_t* s = row + clampi(k, 0, w - 1) * C;
+        for (int c = 0; c < C; ++c) sum[c] += s[c];
+    }
+
+    const int interior0 = r < w ? r : w;
+    const int interior1 = w - r - 1 > interior0 ? w - r - 1 : interior0;
+    int xx = 0;
+    for (; xx < interior0; ++xx) {
+        const uint8_t* in = row + clampi(xx + r + 1, 0, w - 1) * C;
+        const uint8_t* outp = row + clampi(xx - r, 0, w - 1) * C;
+        for (int c = 0; c < C; ++c) {
+            out[xx * C + c] = static_cast<uint8_t>(divideBy(sum[c], rc));
+            sum[c] += in[c] - outp[c];
+        }
+    }
+    for (; xx < interior1; ++xx) {
+        const uint8_t* in = row + (xx + r + 1) * C;
+        const uint8_t* outp = row + (xx - r) * C;
+        for (int c = 0; c < C; ++c) {
+            out[xx * C + c] = static_cast<uint8_t>(divideBy(sum[c], rc));
+            sum[c] += in[c] - outp[c];
+        }
+    }
+    for (; xx < w; ++xx) {
+        const uint8_t* in = row + clampi(xx + r + 1, 0, w - 1) * C;
+        const uint8_t* outp = row + (xx - r) * C;
+        for (int c = 0; c < C; ++c) {
+            out[xx * C + c] = static_cast<uint8_t>(divideBy(sum[c], rc));
+            sum[c] += in[c] - outp[c];
+        }
+    }
+}
+
+static void colAccumulateScalar(uint32_t* acc, const uint8_t* row, int n) {
+    for (int i = 0; i < n; ++i) acc[i] += row[i];
+}
+
+static void colEmitScalar(uint32_t* acc, const uint8_t* in, const uint8_t* out,
+                          uint8_t* dst, int n, Reciprocal rc) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = static_cast<uint8_t>(divideBy(acc[i], rc));
+        acc[i] += in[i];
+        acc[i] -= out[i];
+    }
+}
+
+template <int C>
+static void blockSumN(const uint8_t* p, int stride, int bw, int bh, uint32_t sums[4]) {
+    uint32_t acc[C] = {};
+    for (int yy = 0; yy < bh; ++yy) {
+        const uint8_t* pix = p + static_cast<ptrdiff_t>(yy) * stride;
+        for (int xx = 0; xx < bw; ++xx, pix += C) {
+            for (int c = 0; c < C; ++c) acc[c] += pix[c];
+        }
+    }
+    for (int c = 0; c < C; ++c) sums[c] = acc[c];
+}
+
+static void fillRowScalar(uint8_t* dst, int n, uint32_t pixel) {
+    for (int i = 0; i < n; ++i) std::memcpy(dst + i * 4, &pixel, 4);
+}
+
+template <int C>
+static void fillRowN(uint8_t* dst, int n, const uint8_t* pixel) {
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < C; ++c) dst[i * C + c] = pixel[c];
+    }
+}
+
+// round(v / 255) for v <= 255 * 255
+static inline uint8_t div255(uint32_t v) {
+    v += 128;
+    return static_cast<uint8_t>((v + (v >> 8)) >> 8);
+}
+
+template <int C>
+static void blendRowN(uint8_t* out, const uint8_t* fg, const uint8_t* bg, const uint8_t* mask, int n) {
+    for (int x = 0; x < n; ++x) {
+        const uint32_t w = mask[x];
+        for (int c = 0; c < C; ++c) {
+            const int i = x * C + c;
+            out[i] = div255(fg[i] * w + bg[i] * (255 - w));
+        }
+    }
+}
+
+static const ChannelKernels kChannelKernels[4] = {
+    {1, hblurRowN<1>, blockSumN<1>, fillRowN<1>, blendRowN<1>},
+    {2, hblurRowN<2>, blockSumN<2>, fillRowN<2>, blendRowN<2>},
+    {3, hblurRowN<3>, blockSumN<3>, fillRowN<3>, blendRowN<3>},
+    {4, hblurRowN<4>, blockSumN<4>, fillRowN<4>, blendRowN<4>},
+};
+
+const ChannelKernels& channelKernels(int channels) {
+    return kChannelKernels[clampi(channels, 1, 4) - 1];
+}
+
+static const BlurKernels kScalarKernels = {
+    BLUR_SIMD_SCALAR,
+    hblurRowN<4>, colAccumulateScalar, colEmitScalar, blockSumN<4>, fillRowScalar,
+};
+
+// ---------------------------------------------------------------------------
+// x86: SSE4.1 and AVX2
+// ---------------------------------------------------------------------------
+
+#ifdef BLUR_HAVE_X86_SIMD
+
+#define BLUR_SSE41 __attribute__((target("sse4.1")))
+#define BLUR_AVX2 __attribute__((target("avx2")))
+
+BLUR_SSE41 static inline __m128i loadPixelSse(const uint8_t* p) {
+    int32_t v;
+    std::memcpy(&v, p, 4);
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(v));
+}
+
+// Four u32 lanes divided through the reciprocal (32x32->64 multiply per lane).
+BLUR_SSE41 static inline __m128i divideSse(__m128i v, __m128i mul, __m128i shift) {
+    __m128i even = _mm_srl_epi64(_mm_mul_epu32(v, mul), shift);
+    __m128i odd = _mm_srl_epi64(_mm_mul_epu32(_mm_srli_epi64(v, 32), mul), shift);
+    return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+BLUR_SSE41 static void hblurRowSse41(const uint8_t* row, uint8_t* out, int w, int r, Reciprocal rc) {
+    const __m128i mul = _mm_set1_epi32(static_cast<int>(rc.mul));
+    const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(rc.shift));
+
+    __m128i sum = _mm_setzero_si128();
+    for (int k = -r; k <= r; ++k) sum = _mm_add_epi32(sum, loadPixelSse(row + clampi(k, 0, w - 1) * 4));
+
+    for (int xx = 0; xx < w; ++xx) {
+        __m128i q = divideSse(sum, mul, shift);
+        q = _mm_packus_epi16(_mm_packus_epi32(q, q), q);
+        const int32_t px = _mm_cvtsi128_si32(q);
+        std::memcpy(out + xx * 4, &px, 4);
+
+        const __m128i in = loadPixelSse(row + clampi(xx + r + 1, 0, w - 1) * 4);
+        const __m128i outp = loadPixelSse(row + clampi(xx - r, 0, w - 1) * 4);
+        sum = _mm_sub_epi32(_mm_add_epi32(sum, in), outp);
+    }
+}
+
+BLUR_SSE41 static void colAccumulateSse41(uint32_t* acc, const uint8_t* row, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a + 0, _mm_add_epi32(_mm_loadu_si128(a + 0), _mm_cvtepu8_epi32(b)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_cvtepu8_epi32(_mm_srli_si128(b, 4))));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_cvtepu8_epi32(_mm_srli_si128(b, 8))));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_cvtepu8_epi32(_mm_srli_si128(b, 12))));
+    }
+    colAccumulateScalar(acc + i, row + i, n - i);
+}
+
+BLUR_SSE41 static void colEmitSse41(uint32_t* acc, const uint8_t* in, const uint8_t* out,
+                                    uint8_t* dst, int n, Reciprocal rc) {
+    const __m128i mul = _mm_set1_epi32(static_cast<int>(rc.mul));
+    const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(rc.shift));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        const __m128i bi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i bo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+
+        __m128i s0 = _mm_loadu_si128(a + 0), s1 = _mm_loadu_si128(a + 1);
+        __m128i s2 = _mm_loadu_si128(a + 2), s3 = _mm_loadu_si128(a + 3);
+
+        const __m128i q01 = _mm_packus_epi32(divideSse(s0, mul, shift), divideSse(s1, mul, shift));
+        const __m128i q23 = _mm_packus_epi32(divideSse(s2, mul, shift), divideSse(s3, mul, shift));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(q01, q23));
+
+        s0 = _mm_sub_epi32(_mm_add_epi32(s0, _mm_cvtepu8_epi32(bi)), _mm_cvtepu8_epi32(bo));
+        s1 = _mm_sub_epi32(_mm_add_epi32(s1, _mm_cvtepu8_epi32(_mm_srli_si128(bi, 4))),
+                           _mm_cvtepu8_epi32(_mm_srli_si128(bo, 4)));
+        s2 = _mm_sub_epi32(_mm_add_epi32(s2, _mm_cvtepu8_epi32(_mm_srli_si128(bi, 8))),
+                           _mm_cvtepu8_epi32(_mm_srli_si128(bo, 8)));
+        s3 = _mm_sub_epi32(_mm_add_epi32(s3, _mm_cvtepu8_epi32(_mm_srli_si128(bi, 12))),
+                           _mm_cvtepu8_epi32(_mm_srli_si128(bo, 12)));
+        _mm_storeu_si128(a + 0, s0); _mm_storeu_si128(a + 1, s1);
+        _mm_storeu_si128(a + 2, s2); _mm_storeu_si128(a + 3, s3);
+    }
+    colEmitScalar(acc + i, in + i, out + i, dst + i, n - i, rc);
+}
+
+BLUR_SSE41 static void blockSumSse41(const uint8_t* p, int stride, int bw, int bh, uint32_t sums[4]) {
+    __m128i acc = _mm_setzero_si128();
+    for (int yy = 0; yy < bh; ++yy) {
+        const uint8_t* pix = p + yy * stride;
+        int xx = 0;
+        for (; xx + 4 <= bw; xx += 4, pix += 16) {
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix));
+            acc = _mm_add_epi32(acc, _mm_cvtepu8_epi32(b));
+            acc = _mm_add_epi32(acc, _mm_cvtepu8_epi32(_mm_srli_si128(b, 4)));
+            acc = _mm_add_epi32(acc, _mm_cvtepu8_epi32(_mm_srli_si128(b, 8)));
+            acc = _mm_add_epi32(acc, _mm_cvtepu8_epi32(_mm_srli_si128(b, 12)));
+        }
+        for (; xx < bw; ++xx, pix += 4) acc = _mm_add_epi32(acc, loadPixelSse(pix));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), acc);
+}
+
+BLUR_SSE41 static void fillRowSse41(uint8_t* dst, int n, uint32_t pixel) {
+    const __m128i v = _mm_set1_epi32(static_cast<int>(pixel));
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), v);
+    fillRowScalar(dst + i * 4, n - i, pixel);
+}
+
+BLUR_AVX2 static inline __m256i divideAvx2(__m256i v, __m256i mul, __m128i shift) {
+    __m256i even = _mm256_srl_epi64(_mm256_mul_epu32(v, mul), shift);
+    __m256i odd = _mm256_srl_epi64(_mm256_mul_epu32(_mm256_srli_epi64(v, 32), mul), shift);
+    return _mm256_or_si256(even, _mm256_slli_epi64(odd, 32));
+}
+
+BLUR_AVX2 static void colAccumulateAvx2(uint32_t* acc, const uint8_t* row, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a + 0, _mm256_add_epi32(_mm256_loadu_si256(a + 0), _mm256_cvtepu8_epi32(b)));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1),
+                                                    _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8))));
+    }
+    colAccumulateScalar(acc + i, row + i, n - i);
+}
+
+BLUR_AVX2 static void colEmitAvx2(uint32_t* acc, const uint8_t* in, const uint8_t* out,
+                                  uint8_t* dst, int n, Reciprocal rc) {
+    const __m256i mul = _mm256_set1_epi32(static_cast<int>(rc.mul));
+    const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(rc.shift));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        const __m128i bi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i bo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+
+        __m256i s0 = _mm256_loadu_si256(a + 0), s1 = _mm256_loadu_si256(a + 1);
+
+        // packus works per 128-bit lane; permute restores byte order.
+        __m256i q = _mm256_packus_epi32(divideAvx2(s0, mul, shift), divideAvx2(s1, mul, shift));
+        q = _mm256_permute4x64_epi64(q, 0xD8);
+        const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+
+        s0 = _mm256_sub_epi32(_mm256_add_epi32(s0, _mm256_cvtepu8_epi32(bi)), _mm256_cvtepu8_epi32(bo));
+        s1 = _mm256_sub_epi32(_mm256_add_epi32(s1, _mm256_cvtepu8_epi32(_mm_srli_si128(bi, 8))),
+                              _mm256_cvtepu8_epi32(_mm_srli_si128(bo, 8)));
+        _mm256_storeu_si256(a + 0, s0);
+        _mm256_storeu_si256(a + 1, s1);
+    }
+    colEmitScalar(acc + i, in + i, out + i, dst + i, n - i, rc);
+}
+
+BLUR_AVX2 static void blockSumAvx2(const uint8_t* p, int stride, int bw, int bh, uint32_t sums[4]) {
+    __m256i acc = _mm256_setzero_si256(); // two pixels' worth of channel sums
+    for (int yy = 0; yy < bh; ++yy) {
+        const uint8_t* pix = p + yy * stride;
+        int xx = 0;
+        for (; xx + 4 <= bw; xx += 4, pix += 16) {
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pix));
+            acc = _mm256_add_epi32(acc, _mm256_cvtepu8_epi32(b));
+            acc = _mm256_add_epi32(acc, _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8)));
+        }
+        for (; xx < bw; ++xx, pix += 4) {
+            int32_t v;
+            std::memcpy(&v, pix, 4);
+            acc = _mm256_add_epi32(acc, _mm256_cvtepu8_epi32(_mm_cvtsi32_si128(v)));
+        }
+    }
+    const __m128i folded = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), folded);
+}
+
+BLUR_AVX2 static void fillRowAvx2(uint8_t* dst, int n, uint32_t pixel) {
+    const __m256i v = _mm256_set1_epi32(static_cast<int>(pixel));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), v);
+    fillRowScalar(dst + i * 4, n - i, pixel);
+}
+
+static const BlurKernels kSse41Kernels = {
+    BLUR_SIMD_SSE41,
+    hblurRowSse41, colAccumulateSse41, colEmitSse41, blockSumSse41, fillRowSse41,
+};
+
+// The horizontal pass is a serial dependency chain over one pixel's four
+// channels, so 256-bit registers don't help it; AVX2 reuses the SSE4.1 row.
+static const BlurKernels kAvx2Kernels = {
+    BLUR_SIMD_AVX2,
+    hblurRowSse41, colAccumulateAvx2, colEmitAvx2, blockSumAvx2, fillRowAvx2,
+};
+
+#endif // BLUR_HAVE_X86_SIMD
+
+// ---------------------------------------------------------------------------
+// ARM: NEON
+// ---------------------------------------------------------------------------
+
+#ifdef BLUR_HAVE_NEON
+
+static inline uint32x4_t loadPixelNeon(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    const uint8x8_t b = vreinterpret_u8_u32(vdup_n_u32(v));
+    return vmovl_u16(vget_low_u16(vmovl_u8(b)));
+}
+
+static inline uint32x4_t divideNeon(uint32x4_t v, uint32x2_t mul, int64x2_t shift) {
+    const uint64x2_t lo = vshlq_u64(vmull_u32(vget_low_u32(v), mul), shift);
+    const uint64x2_t hi = vshlq_u64(vmull_u32(vget_high_u32(v), mul), shift);
+    return vcombine_u32(vmovn_u64(lo), vmovn_u64(hi));
+}
+
+static inline uint8x16_t narrowNeon(uint32x4_t a, uint32x4_t b, uint32x4_t c, uint32x4_t d) {
+    const uint16x8_t ab = vcombine_u16(vqmovn_u32(a), vqmovn_u32(b));
+    const uint16x8_t cd = vcombine_u16(vqmovn_u32(c), vqmovn_u32(d));
+    return vcombine_u8(vqmovn_u16(ab), vqmovn_u16(cd));
+}
+
+static void hblurRowNeon(const uint8_t* row, uint8_t* out, int w, int r, Reciprocal rc) {
+    const uint32x2_t mul = vdup_n_u32(rc.mul);
+    const int64x2_t shift = vdupq_n_s64(-static_cast<int64_t>(rc.shift));
+
+    uint32x4_t sum = vdupq_n_u32(0);
+    for (int k = -r; k <= r; ++k) sum = vaddq_u32(sum, loadPixelNeon(row + clampi(k, 0, w - 1) * 4));
+
+    for (int xx = 0; xx < w; ++xx) {
+        const uint32x4_t q = divideNeon(sum, mul, shift);
+        const uint8x8_t b = vqmovn_u16(vcombine_u16(vqmovn_u32(q), vdup_n_u16(0)));
+        const uint32_t px = vget_lane_u32(vreinterpret_u32_u8(b), 0);
+        std::memcpy(out + xx * 4, &px, 4);
+
+        const uint32x4_t in = loadPixelNeon(row + clampi(xx + r + 1, 0, w - 1) * 4);
+        const uint32x4_t outp = loadPixelNeon(row + clampi(xx - r, 0, w - 1) * 4);
+        sum = vsubq_u32(vaddq_u32(sum, in), outp);
+    }
+}
+
+static void colAccumulateNeon(uint32_t* acc, const uint8_t* row, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t b = vld1q_u8(row + i);
+        const uint16x8_t lo = vmovl_u8(vget_low_u8(b));
+        const uint16x8_t hi = vmovl_u8(vget_high_u8(b));
+        vst1q_u32(acc + i + 0, vaddw_u16(vld1q_u32(acc + i + 0), vget_low_u16(lo)));
+        vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(lo)));
+        vst1q_u32(acc + i + 8, vaddw_u16(vld1q_u32(acc + i + 8), vget_low_u16(hi)));
+        vst1q_u32(acc + i + 12, vaddw_u16(vld1q_u32(acc + i + 12), vget_high_u16(hi)));
+    }
+    colAccumulateScalar(acc + i, row + i, n - i);
+}
+
+static void colEmitNeon(uint32_t* acc, const uint8_t* in, const uint8_t* out,
+                        uint8_t* dst, int n, Reciprocal rc) {
+    const uint32x2_t mul = vdup_n_u32(rc.mul);
+    const int64x2_t shift = vdupq_n_s64(-static_cast<int64_t>(rc.shift));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint32x4_t s0 = vld1q_u32(acc + i + 0), s1 = vld1q_u32(acc + i + 4);
+        uint32x4_t s2 = vld1q_u32(acc + i + 8), s3 = vld1q_u32(acc + i + 12);
+
+        vst1q_u8(dst + i, narrowNeon(divideNeon(s0, mul, shift), divideNeon(s1, mul, shift),
+                                     divideNeon(s2, mul, shift), divideNeon(s3, mul, shift)));
+
+        const uint8x16_t bi = vld1q_u8(in + i);
+        const uint8x16_t bo = vld1q_u8(out + i);
+        const uint16x8_t ilo = vmovl_u8(vget_low_u8(bi)), ihi = vmovl_u8(vget_high_u8(bi));
+        const uint16x8_t olo = vmovl_u8(vget_low_u8(bo)), ohi = vmovl_u8(vget_high_u8(bo));
+        s0 = vsubw_u16(vaddw_u16(s0, vget_low_u16(ilo)), vget_low_u16(olo));
+        s1 = vsubw_u16(vaddw_u16(s1, vget_high_u16(ilo)), vget_high_u16(olo));
+        s2 = vsubw_u16(vaddw_u16(s2, vget_low_u16(ihi)), vget_low_u16(ohi));
+        s3 = vsubw_u16(vaddw_u16(s3, vget_high_u16(ihi)), vget_high_u16(ohi));
+        vst1q_u32(acc + i + 0, s0); vst1q_u32(acc + i + 4, s1);
+        vst1q_u32(acc + i + 8, s2); vst1q_u32(acc + i + 12, s3);
+    }
+    colEmitScalar(acc + i, in + i, out + i, dst + i, n - i, rc);
+}
+
+static void blockSumNeon(const uint8_t* p, int stride, int bw, int bh, uint32_t sums[4]) {
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (int yy = 0; yy < bh; ++yy) {
+        const uint8_t* pix = p + yy * stride;
+        int xx = 0;
+        for (; xx + 4 <= bw; xx += 4, pix += 16) {
+            const uint8x16_t b = vld1q_u8(pix);
+            const uint16x8_t lo = vmovl_u8(vget_low_u8(b));
+            const uint16x8_t hi = vmovl_u8(vget_high_u8(b));
+            // Two pixels per 16-bit half: fold them before widening.
+            const uint16x4_t pair = vadd_u16(vadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+                                             vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+            acc = vaddw_u16(acc, pair);
+        }
+        for (; xx < bw; ++xx, pix += 4) acc = vaddq_u32(acc, loadPixelNeon(pix));
+    }
+    vst1q_u32(sums, acc);
+}
+
+static void fillRowNeon(uint8_t* dst, int n, uint32_t pixel) {
+    const uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(pixel));
+    int i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_u8(dst + i * 4, v);
+    fillRowScalar(dst + i * 4, n - i, pixel);
+}
+
+static const BlurKernels kNeonKernels = {
+    BLUR_SIMD_NEON,
+    hblurRowNeon, colAccumulateNeon, colEmitNeon, blockSumNeon, fillRowNeon,
+};
+
+#endif // BLUR_HAVE_NEON
+
+// ---------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------
+
+static const BlurKernels* kernelsForLevel(int level) {
+    switch (level) {
+        case BLUR_SIMD_SCALAR:
+            return &kScalarKernels;
+#ifdef BLUR_HAVE_X86_SIMD
+        case BLUR_SIMD_SSE41:
+            return __builtin_cpu_supports("sse4.1") ? &kSse41Kernels : nullptr;
+        case BLUR_SIMD_AVX2:
+            return __builtin_cpu_supports("avx2") ? &kAvx2Kernels : nullptr;
+#endif
+#ifdef BLUR_HAVE_NEON
+        case BLUR_SIMD_NEON:
+            return &kNeonKernels;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+static const BlurKernels* bestKernels() {
+    const int preferred[] = {BLUR_SIMD_NEON, BLUR_SIMD_AVX2, BLUR_SIMD_SSE41};
+    for (int level : preferred) {
+        if (const BlurKernels* k = kernelsForLevel(level)) return k;
+    }
+    return &kScalarKernels;
+}
+
+static std::atomic<const BlurKernels*> g_kernels{nullptr};
+static thread_local const BlurKernels* t_kernels = nullptr;
+
+const BlurKernels& activeKernels() {
+    if (t_kernels) return *t_kernels;
+    const BlurKernels* k = g_kernels.load(std::memory_order_acquire);
+    if (!k) {
+        k = bestKernels();
+        g_kernels.store(k, std::memory_order_release);
+    }
+    return *k;
+}
+
+ScopedSimdLevel::ScopedSimdLevel(int level) : previous_(t_kernels) {
+    const BlurKernels* k = kernelsForLevel(level);
+    ok_ = k != nullptr;
+    if (k) t_kernels = k;
+}
+
+ScopedSimdLevel::~ScopedSimdLevel() {
+    t_kernels = previous_;
+}
+
+} // namespace blurcore
+
+extern "C" int blur_set_simd_level(int level) {
+    const blurcore::BlurKernels* k =
+        level == BLUR_SIMD_AUTO ? blurcore::bestKernels() : blurcore::kernelsForLevel(level);
+    if (!k) return -1;
+    blurcore::g_kernels.store(k, std::memory_order_release);
+    return 0;
+}
+
+extern "C" int blur_get_simd_level(void) {
+    return blurcore::activeKernels().level;
+}
@@ -0,0 +1,111 @@
+// Internal kernel table for the portable blur core (not part of the public API).
+// Each SIMD level provides the same set of row kernels; blur.cpp only talks to
+// the table returned by activeKernels(), so adding a level never touches the
+// blur drivers.
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace blurcore {
+
+// floor(n / d) as a multiply-shift. Exact for n <= 255 * d when d < 2^22,
+// which covers every box window the core produces (see kMaxBoxRadius).
+struct Reciprocal {
+    uint32_t mul;
+    uint32_t shift;
+};
+
+Reciprocal makeReciprocal(uint32_t d);
+
+inline uint32_t divideBy(uint32_t n, const Reciprocal& rc) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(n) * rc.mul) >> rc.shift);
+}
+
+// Box windows are capped so the reciprocal divide stays exact (d < 2^22).
+constexpr int kMaxBoxRadius = 1 << 20;
+
+// std::isfinite on the bits: the Android build uses -ffast-math, which lets
+// the compiler fold isfinite() and NaN comparisons to true, so argument
+// checks on caller-supplied floats go through this instead.
+inline bool isFiniteFloat(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x7F800000u) != 0x7F800000u;
+}
+
+// Radii of the box passes blur_apply_regions runs for `mode` (1 for box, up
+// to 3 for gaussian; passes of radius 0 are dropped). returns the count,
+// 0 for pixelate. Shared by every backend so they agree on the output.
+int boxPassRadii(int mode, int strength, int radii[3]);
+
+struct BlurKernels {
+    int level; // BlurSimdLevel
+
+    // Sliding-window horizontal box pass over one RGBA row of w pixels,
+    // taps clamped to [0, w-1].
+    void (*hblurRow)(const uint8_t* src, uint8_t* dst, int w, int r, Reciprocal rc);
+
+    // acc[i] += row[i] for n bytes.
+    void (*colAccumulate)(uint32_t* acc, const uint8_t* row, int n);
+
+    // dst[i] = acc[i] / d, then acc[i] += in[i] - out[i] for n bytes.
+    void (*colEmit)(uint32_t* acc, const uint8_t* in, const uint8_t* out,
+                    uint8_t* dst, int n, Reciprocal rc);
+
+    // Per-channel sums over a bw x bh block of RGBA pixels (stride in bytes).
+    void (*blockSum)(const uint8_t* p, int stride, int bw, int bh, uint32_t sums[4]);
+
+    // Write the same RGBA pixel n times.
+    void (*fillRow)(uint8_t* dst, int n, uint32_t pixel);
+};
+
+// Scalar kernels instantiated per channel count (1-4) of interleaved 8-bit
+// pixels, so each inner loop has a constant pixel stride that the compiler
+// unrolls and vectorises. Gray masks, NV21 planes and RGB use these; four
+// channel blurs go through the SIMD table above, and the mask blend uses
+// this table for every count.
+struct ChannelKernels {
+    int channels;
+
+    // As BlurKernels::hblurRow, for pixels of `channels` bytes.
+    void (*hblurRow)(const uint8_t* src, uint8_t* dst, int w, int r, Reciprocal rc);
+
+    // As BlurKernels::blockSum; sums past `channels` are left untouched.
+    void (*blockSum)(const uint8_t* p, int stride, int bw, int bh, uint32_t sums[4]);
+
+    // Write the same `channels`-byte pixel n times.
+    void (*fillRow)(uint8_t* dst, int n, const uint8_t* pixel);
+
+    // out = round((fg * m + bg * (255 - m)) / 255) for n pixels, one mask
+    // byte per pixel. out may alias fg or bg.
+    void (*blendRow)(uint8_t* out, const uint8_t* fg, const uint8_t* bg, const uint8_t* mask, int n);
+};
+
+// Table for `channels` in 1..4.
+const ChannelKernels& channelKernels(int channels);
+
+// Kernel table for the level selected by blur_set_simd_level (defaults to the
+// best level the running CPU supports), or the calling thread's
+// ScopedSimdLevel.
+const BlurKernels& activeKernels();
+
+// Pins activeKernels() to one level on the calling thread while in scope.
+// Pool workers keep the process-wide level, so pair it with a
+// ScopedThreadCount of 1. ok() is false (and nothing changes) if the CPU
+// lacks the level.
+class ScopedSimdLevel {
+public:
+    explicit ScopedSimdLevel(int level);
+    ~ScopedSimdLevel();
+
+    ScopedSimdLevel(const ScopedSimdLevel&) = delete;
+    ScopedSimdLevel& operator=(const ScopedSimdLevel&) = delete;
+
+    bool ok() const { return ok_; }
+
+private:
+    const BlurKernels* previous_;
+    bool ok_;
+};
+
+} // namespace blurcore
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include "blur.h"
+#include "buffer_pool.h"
+
+namespace blurcore {
+
+namespace {
+
+const int kMinShift = 12; // 4 KB
+const int kMaxShift = 30; // 1 GB; larger requests are not pooled
+const int kClasses = kMaxShift - kMinShift + 1;
+const int kCacheClasses = 18 - kMinShift + 1; // thread caches hold up to 256 KB buffers
+const int kCacheDepth = 2;
+const uint32_t kMaxSlots = 4096;
+const int64_t kDefaultLimit = static_cast<int64_t>(64) << 20;
+const std::align_val_t kAlign{64};
+
+int64_t classBytes(int cls) { return static_cast<int64_t>(1) << (kMinShift + cls); }
+
+int classFor(size_t bytes) {
+    int shift = kMinShift;
+    while (shift <= kMaxShift && (static_cast<size_t>(1) << shift) < bytes) ++shift;
+    return shift <= kMaxShift ? shift - kMinShift : -1;
+}
+
+uint8_t* allocate(size_t bytes) {
+    return static_cast<uint8_t*>(::operator new(bytes, kAlign, std::nothrow));
+}
+
+void deallocate(uint8_t* data) { ::operator delete(data, kAlign); }
+
+// An idle buffer. Only the thread that owns a slot touches data and cls;
+// next is read by racing pops, so it is atomic.
+struct Slot {
+    uint8_t* data = nullptr;
+    int cls = 0;
+    std::atomic<uint32_t> next{0};
+};
+
+// Treiber stack of slot indices (stored + 1, 0 ends the list). The head
+// also carries a tag bumped on every change, so a slot that is popped and
+// pushed back between another thread's load and CAS cannot fool it.
+class SlotStack {
+public:
+    void push(Slot* slots, uint32_t index) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        do {
+            slots[index].next.store(link(head), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, pack(tag(head) + 1, index + 1),
+                                              std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    int32_t pop(Slot* slots) {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        while (link(head) != 0) {
+            const uint32_t index = link(head) - 1;
+            const uint32_t next = slots[index].next.load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, pack(tag(head) + 1, next),
+                                            std::memory_order_acquire, std::memory_order_acquire)) {
+                return static_cast<int32_t>(index);
+            }
+        }
+        return -1;
+    }
+
+private:
+    static uint64_t pack(uint32_t t, uint32_t l) { return static_cast<uint64_t>(t) << 32 | l; }
+    static uint32_t tag(uint64_t v) { return static_cast<uint32_t>(v >> 32); }
+    static uint32_t link(uint64_t v) { return static_cast<uint32_t>(v); }
+
+    std::atomic<uint64_t> head_{0};
+};
+
+// Constant-initialized and trivially destructible, so it is usable from
+// any static initializer and outlives every thread cache at exit.
+struct Pool {
+    Slot slots[kMaxSlots];
+    SlotStack idle[kClasses];
+    SlotStack spare; // slots without a buffer
+    std::atomic<uint32_t> fresh{0};
+    std::atomic<int64_t> pooled{0};
+    std::atomic<int64_t> inUse{0};
+    std::atomic<int64_t> hits{0};
+    std::atomic<int64_t> misses{0};
+    std::atomic<int64_t> limit{kDefaultLimit};
+    std::atomic<uint64_t> epoch{0}; // bumped by trim so thread caches flush
+};
+
+Pool g_pool;
+
+int32_t newSlot() {
+    const int32_t reused = g_pool.spare.pop(g_pool.slots);
+    if (reused >= 0) return reused;
+    uint32_t n = g_pool.fresh.load();
+    while (n < kMaxSlots) {
+        if (g_pool.fresh.compare_exchange_weak(n, n + 1)) return static_cast<int32_t>(n);
+    }
+    return -1;
+}
+
+void freeSlot(int32_t slot) {
+    deallocate(g_pool.slots[slot].data);
+    g_pool.slots[slot].data = nullptr;
+    g_pool.spare.push(g_pool.slots, static_cast<uint32_t>(slot));
+}
+
+// Park an idle buffer on its class list, or free it past the limit.
+void giveBack(int32_t slot) {
+    const int64_t bytes = classBytes(g_pool.slots[slot].cls);
+    if (g_pool.pooled.fetch_add(bytes) + bytes > g_pool.limit.load()) {
+        g_pool.pooled.fetch_sub(bytes);
+        freeSlot(slot);
+        return;
+    }
+    g_pool.idle[g_pool.slots[slot].cls].push(g_pool.slots, static_cast<uint32_t>(slot));
+}
+
+// Per-thread stack of recently released small buffers. Counted as pooled
+// bytes; handed to the shared lists when a trim has happened since.
+struct ThreadCache {
+    int32_t slots[kCacheClasses][kCacheDepth];
+    int count[kCacheClasses] = {};
+    uint64_t epoch = 0;
+
+    ~ThreadCache() { flush(); }
+
+    void flush() {
+        for (int cls = 0; cls < kCacheClasses; ++cls) {
+            while (count[cls] > 0) {
+                g_pool.pooled.fetch_sub(classBytes(cls));
+                giveBack(slots[cls][--count[cls]]);
+            }
+        }
+    }
+
+    void sync() {
+        const uint64_t now = g_pool.epoch.load(std::memory_order_relaxed);
+        if (now != epoch) {
+            flush();
+            epoch = now;
+        }
+    }
+};
+
+ThreadCache& threadCache() {
+    thread_local ThreadCache cache;
+    cache.sync();
+    return cache;
+}
+
+int64_t trimPool(int64_t keep) {
+    g_pool.epoch.fetch_add(1);
+    threadCache(); // flushes this thread's cache; other threads flush on their next call
+    int64_t freed = 0;
+    for (int cls = kClasses - 1; cls >= 0 && g_pool.pooled.load() > keep; --cls) {
+        while (g_pool.pooled.load() > keep) {
+            const int32_t slot = g_pool.idle[cls].pop(g_pool.slots);
+            if (slot < 0) break;
+            g_pool.pooled.fetch_sub(classBytes(cls));
+            freed += classBytes(cls);
+            freeSlot(slot);
+        }
+    }
+    return freed;
+}
+
+} // namespace
+
+size_t PooledBuffer::capacity() const {
+    return cls_ >= 0 ? static_cast<size_t>(classBytes(cls_)) : size_;
+}
+
+void PooledBuffer::reset() {
+    if (!data_) return;
+    if (cls_ < 0) {
+        g_pool.inUse.fetch_sub(static_cast<int64_t>(std::max<size_t>(size_, 1)));
+        deallocate(data_);
+    } else {
+        g_pool.inUse.fetch_sub(classBytes(cls_));
+        ThreadCache& cache = threadCache();
+        if (cls_ < kCacheClasses && cache.count[cls_] < kCacheDepth) {
+            g_pool.pooled.fetch_add(classBytes(cls_));
+            cache.slots[cls_][cache.count[cls_]++] = slot_;
+        } else {
+            giveBack(slot_);
+        }
+    }
+    data_ = nullptr;
+    size_ = 0;
+    cls_ = -1;
+    slot_ = -1;
+}
+
+PooledBuffer acquireBuffer(size_t bytes) {
+    PooledBuffer buffer;
+    const int cls = classFor(std::max<size_t>(bytes, 1));
+    int32_t slot = -1;
+    if (cls >= 0) {
+        ThreadCache& cache = threadCache();
+        if (cls < kCacheClasses && cache.count[cls] > 0) {
+            slot = cache.slots[cls][--cache.count[cls]];
+        } else {
+            slot = g_pool.idle[cls].pop(g_pool.slots);
+        }
+        if (slot >= 0) g_pool.pooled.fetch_sub(classBytes(cls));
+    }
+
+    if (slot >= 0) {
+        g_pool.hits.fetch_add(1);
+    } else {
+        g_pool.misses.fetch_add(1);
+        slot = cls >= 0 ? newSlot() : -1;
+        const size_t wanted = slot >= 0 ? static_cast<size_t>(classBytes(cls)) : std::max<size_t>(bytes, 1);
+        uint8_t* data = allocate(wanted);
+        if (!data && trimPool(0) > 0) data = allocate(wanted); // idle buffers are cheaper to lose
+        if (!data) {
+            if (slot >= 0) g_pool.spare.push(g_pool.slots, static_cast<uint32_t>(slot));
+            return buffer;
+        }
+        if (slot >= 0) {
+            g_pool.slots[slot].data = data;
+            g_pool.slots[slot].cls = cls;
+        } else {
+            // Too large for a class, or out of slots: freed on release
+            buffer.data_ = data;
+            buffer.size_ = bytes;
+            buffer.cls_ = -1;
+            g_pool.inUse.fetch_add(static_cast<int64_t>(std::max<size_t>(bytes, 1)));
+            return buffer;
+        }
+    }
+    buffer.data_ = g_pool.slots[slot].data;
+    buffer.size_ = bytes;
+    buffer.cls_ = cls;
+    buffer.slot_ = slot;
+    g_pool.inUse.fetch_add(classBytes(cls));
+    return buffer;
+}
+
+BufferPoolStats bufferPoolStats() {
+    return {g_pool.pooled.load(), g_pool.inUse.load(), g_pool.hits.load(), g_pool.misses.load()};
+}
+
+} // namespace blurcore
+
+extern "C" int64_t blur_memory_trim(int64_t keep_bytes) {
+    return blurcore::trimPool(std::max<int64_t>(keep_bytes, 0));
+}
+
+extern "C" int blur_memory_set_pool_limit(int64_t bytes) {
+    const int64_t limit = bytes > 0 ? bytes : blurcore::kDefaultLimit;
+    blurcore::g_pool.limit.store(limit);
+    blurcore::trimPool(limit);
+    return 0;
+}
+
+extern "C" int blur_memory_stats(int64_t* pooled, int64_t* in_use) {
+    const blurcore::BufferPoolStats stats = blurcore::bufferPoolStats();
+    if (pooled) *pooled = stats.pooledBytes;
+    if (in_use) *in_use = stats.inUseBytes;
+    return 0;
+}
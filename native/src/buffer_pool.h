@@ -0,0 +1,64 @@
+// Process-wide pool for large scratch and image buffers, shared by the
+// portable core and the platform engines. Sizes are rounded up to a power
+// of two so a buffer only ever serves requests of its own class; idle
+// buffers sit on lock-free per-class free lists, with a small per-thread
+// cache in front for the small classes. Memory goes back to the system on
+// blur_memory_trim() or when the idle total would pass the pool limit.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace blurcore {
+
+// Move-only handle to a pooled buffer; the memory returns to the pool when
+// the handle is destroyed or reset. Contents are not initialized.
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    PooledBuffer(PooledBuffer&& other) noexcept { swap(other); }
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+        PooledBuffer(std::move(other)).swap(*this);
+        return *this;
+    }
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    ~PooledBuffer() { reset(); }
+
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }         // bytes requested
+    size_t capacity() const;                      // bytes usable
+    explicit operator bool() const { return data_ != nullptr; }
+
+    void reset();
+
+private:
+    friend PooledBuffer acquireBuffer(size_t bytes);
+
+    void swap(PooledBuffer& other) noexcept {
+        uint8_t* d = data_; data_ = other.data_; other.data_ = d;
+        size_t s = size_; size_ = other.size_; other.size_ = s;
+        int c = cls_; cls_ = other.cls_; other.cls_ = c;
+        int32_t l = slot_; slot_ = other.slot_; other.slot_ = l;
+    }
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    int cls_ = -1;     // size class, -1: too large to pool
+    int32_t slot_ = -1; // descriptor while pooled
+};
+
+// At least `bytes` of 64-byte aligned memory; an empty handle when out of
+// memory.
+PooledBuffer acquireBuffer(size_t bytes);
+
+struct BufferPoolStats {
+    int64_t pooledBytes; // idle, ready for reuse
+    int64_t inUseBytes;  // handed out (by capacity)
+    int64_t hits;
+    int64_t misses;
+};
+
+BufferPoolStats bufferPoolStats();
+
+} // namespace blurcore
@@ -0,0 +1,23 @@
+// Cancellation scopes on a BlurContext (blur_context_cancel). A pending
+// cancel is cleared only when the outermost scope on the context opens, so
+// an operation made of several blur calls (a masked blur, a session render,
+// a queued job) stays cancelled between them instead of each call clearing
+// the request again. Scopes nest on the thread that owns the context.
+#pragma once
+#include "blur.h"
+
+namespace blurcore {
+
+class CancelScope {
+public:
+    explicit CancelScope(BlurContext* ctx); // ctx may be NULL
+    ~CancelScope();
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+
+private:
+    BlurContext* ctx_;
+};
+
+} // namespace blurcore
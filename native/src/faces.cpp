@@ -0,0 +1,147 @@
+// Face detector output (BlazeFace short range, face_detection_short_range
+// .tflite) straight to BlurRects: anchor decode, score threshold, weighted
+// non-maximum suppression, then padding and merging of overlapping boxes so
+// the rects can go to blur_apply_regions as they are.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "blur.h"
+
+namespace {
+
+// SSD anchors of the 128x128 short-range model: strides 8, 16, 16, 16 with
+// two anchors per cell each, layers of the same stride sharing one grid.
+const int kInputSize = 128;
+const int kAnchorCount = 896;
+
+struct Anchor {
+    float x, y; // centre, normalized
+};
+
+const std::vector<Anchor>& anchors() {
+    static const std::vector<Anchor> table = [] {
+        std::vector<Anchor> a;
+        a.reserve(kAnchorCount);
+        const int strides[] = {8, 16, 16, 16};
+        for (int layer = 0; layer < 4;) {
+            int perCell = 0;
+            int last = layer;
+            while (last < 4 && strides[last] == strides[layer]) {
+                perCell += 2;
+                ++last;
+            }
+            const int grid = kInputSize / strides[layer];
+            for (int y = 0; y < grid; ++y)
+                for (int x = 0; x < grid; ++x)
+                    for (int k = 0; k < perCell; ++k) a.push_back({(x + 0.5f) / grid, (y + 0.5f) / grid});
+            layer = last;
+        }
+        return a;
+    }();
+    return table;
+}
+
+struct Box {
+    float x0, y0, x1, y1; // normalized
+    float score;
+
+    float area() const { return std::max(0.0f, x1 - x0) * std::max(0.0f, y1 - y0); }
+};
+
+float iou(const Box& a, const Box& b) {
+    const float w = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
+    const float h = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
+    if (w <= 0 || h <= 0) return 0;
+    const float inter = w * h;
+    return inter / (a.area() + b.area() - inter);
+}
+
+bool touches(const BlurRect& a, const BlurRect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+} // namespace
+
+extern "C" int blur_face_anchor_count(void) {
+    return kAnchorCount;
+}
+
+extern "C" int blur_decode_faces(const float* regressors, int regressor_stride, const float* scores,
+                                 int image_width, int image_height,
+                                 float score_threshold, float iou_threshold, float padding,
+                                 BlurRect* rects, int max_rects) {
+    if (!regressors || !scores || regressor_stride < 4 || image_width <= 0 || image_height <= 0) return -1;
+    if (!rects || max_rects <= 0) return -1;
+
+    // Scores are logits; compare in logit space to skip most sigmoids
+    const float t = std::min(std::max(score_threshold, 1e-6f), 1.0f - 1e-6f);
+    const float logitThreshold = std::log(t / (1.0f - t));
+    const std::vector<Anchor>& table = anchors();
+    std::vector<Box> candidates;
+    for (int i = 0; i < kAnchorCount; ++i) {
+        const float logit = std::min(std::max(scores[i], -100.0f), 100.0f);
+        if (logit < logitThreshold) continue;
+        const float* r = regressors + static_cast<size_t>(i) * regressor_stride;
+        const float cx = r[0] / kInputSize + table[i].x;
+        const float cy = r[1] / kInputSize + table[i].y;
+        const float w = r[2] / kInputSize, h = r[3] / kInputSize;
+        candidates.push_back({cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, 1.0f / (1.0f + std::exp(-logit))});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Box& a, const Box& b) { return a.score > b.score; });
+
+    // Weighted NMS: each kept face averages the boxes it suppresses, which
+    // is steadier from frame to frame than keeping the single best box
+    std::vector<Box> faces;
+    std::vector<bool> used(candidates.size(), false);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (used[i]) continue;
+        Box sum = {0, 0, 0, 0, candidates[i].score};
+        float weight = 0;
+        for (size_t j = i; j < candidates.size(); ++j) {
+            if (used[j] || iou(candidates[i], candidates[j]) < iou_threshold) continue;
+            used[j] = true;
+            const float s = candidates[j].score;
+            sum.x0 += candidates[j].x0 * s; sum.y0 += candidates[j].y0 * s;
+            sum.x1 += candidates[j].x1 * s; sum.y1 += candidates[j].y1 * s;
+            weight += s;
+        }
+        faces.push_back({sum.x0 / weight, sum.y0 / weight, sum.x1 / weight, sum.y1 / weight, sum.score});
+    }
+
+    // Pad, clamp to the image and convert to pixels. Edges round to the
+    // nearest pixel: the NMS average is never exact, and padding is what
+    // keeps the face covered
+    std::vector<BlurRect> out;
+    for (const Box& f : faces) {
+        const float px = (f.x1 - f.x0) * padding, py = (f.y1 - f.y0) * padding;
+        const int x0 = std::max(0, static_cast<int>(std::lround((f.x0 - px) * image_width)));
+        const int y0 = std::max(0, static_cast<int>(std::lround((f.y0 - py) * image_height)));
+        const int x1 = std::min(image_width, static_cast<int>(std::lround((f.x1 + px) * image_width)));
+        const int y1 = std::min(image_height, static_cast<int>(std::lround((f.y1 + py) * image_height)));
+        if (x1 > x0 && y1 > y0) out.push_back({x0, y0, x1 - x0, y1 - y0});
+    }
+
+    // Overlapping rects become their union: one blur pass per area, and no
+    // seams where two padded faces meet
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (size_t i = 0; i < out.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < out.size(); ++j) {
+                if (!touches(out[i], out[j])) continue;
+                const int x0 = std::min(out[i].x, out[j].x), y0 = std::min(out[i].y, out[j].y);
+                const int x1 = std::max(out[i].x + out[i].w, out[j].x + out[j].w);
+                const int y1 = std::max(out[i].y + out[i].h, out[j].y + out[j].h);
+                out[i] = {x0, y0, x1 - x0, y1 - y0};
+                out.erase(out.begin() + j);
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    // Faces are in score order, so a short buffer keeps the most confident
+    const int count = std::min(static_cast<int>(out.size()), max_rects);
+    std::copy(out.begin(), out.begin() + count, rects);
+    return count;
+}
@@ -0,0 +1,338 @@
+// Adaptive backend choice. A one-off micro-benchmark times a gaussian blur
+// on each backend at three image sizes and two radii; the table is kept in a
+// file keyed by the things that change the answer (SIMD level, thread
+// count, GPU availability). Each request then runs on the backend that was
+// fastest for its size class and radius class. A pressure level from the
+// platform caps the worker threads and preview sizes so latency stays
+// predictable when the device is hot or saving battery.
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "blur.h"
+#include "blur_kernels.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace blurcore {
+namespace {
+
+constexpr int kSizes = 3;
+constexpr int kStrengths = 2;
+constexpr int kRuns = 3; // best of, the first also pays any warm-up
+constexpr int kFileVersion = 1;
+
+// Square benchmark images per size class, and the pixel counts where one
+// class hands over to the next (geometric means of neighbouring sizes)
+const int kBenchSide[kSizes] = {192, 512, 1024};
+const int64_t kSizeLimit[kSizes - 1] = {98304, 524288};
+// Benchmark strength per radius class, and the largest strength in class 0
+const int kBenchStrength[kStrengths] = {4, 24};
+constexpr int kSmallStrength = 8;
+
+const char* const kBackendName[BLUR_BACKEND_COUNT] = {"scalar", "simd", "threaded", "gpu"};
+const char* const kSourceName[] = {"none", "benchmark", "cache"};
+
+enum Source { kNone = 0, kBenchmark = 1, kCache = 2 };
+
+struct Table {
+    // ns per megapixel, -1 where the backend was not measured
+    int64_t ns[BLUR_BACKEND_COUNT][kSizes][kStrengths];
+    int simdLevel = BLUR_SIMD_SCALAR;
+    int threads = 1;
+    int gpu = 0;
+    int64_t calibrationNs = 0;
+    Source source = kNone;
+};
+
+std::mutex g_tableMutex;
+Table g_table;
+std::mutex g_calibrateMutex; // one calibration at a time
+std::atomic<int> g_pressure{BLUR_PRESSURE_NONE};
+
+int sizeClass(int64_t pixels) {
+    int c = 0;
+    while (c < kSizes - 1 && pixels >= kSizeLimit[c]) ++c;
+    return c;
+}
+
+int strengthClass(int strength) { return strength <= kSmallStrength ? 0 : 1; }
+
+// What blur_set_thread_count resolved to, ignoring the pressure cap
+int uncappedThreads() {
+    ScopedThreadCount all(1 << 30);
+    return configuredThreadCount();
+}
+
+bool sameDevice(const Table& t) {
+    return t.simdLevel == blur_get_simd_level() && t.threads == uncappedThreads() &&
+           t.gpu == blur_gpu_available();
+}
+
+bool gpuEligible(int format, int mode, int stride) {
+    return (format == BLUR_FORMAT_RGBA8888 || format == BLUR_FORMAT_BGRA8888) && mode >= 0 && mode <= 2 &&
+           stride % 4 == 0;
+}
+
+// Runs one whole-image blur on a backend; -4 if the GPU path failed
+int runOn(int backend, BlurContext* ctx, uint8_t* pixels, int width, int height, int stride, int format,
+          const BlurRect* rects, int rectCount, int mode, int strength, int threads) {
+    if (backend == BLUR_BACKEND_GPU) {
+        BlurGpuImage* image = blur_gpu_image_create(pixels, width, height, stride);
+        if (!image) return -4;
+        int rc = blur_gpu_apply_regions(image, rects, rectCount, mode, strength);
+        if (rc == 0) rc = blur_gpu_image_read(image, pixels, stride);
+        blur_gpu_image_destroy(image);
+        return rc;
+    }
+    ScopedThreadCount count(backend == BLUR_BACKEND_THREADED ? threads : 1);
+    ScopedSimdLevel scalar(backend == BLUR_BACKEND_SCALAR ? BLUR_SIMD_SCALAR : BLUR_SIMD_AUTO); // AUTO: unchanged
+    return blur_apply_regions_ex(ctx, pixels, width, height, stride, format, rects, rectCount, mode, strength);
+}
+
+// Fastest allowed backend for a request under the current pressure. CPU
+// costs follow the blurred area, the GPU's the whole image.
+BlurRoute choose(const Table& t, int64_t imagePixels, int64_t workPixels, bool gpuOk, int strength) {
+    BlurRoute route = {BLUR_BACKEND_SIMD, 1, -1};
+    const int threads = configuredThreadCount();
+    if (threads > 1) route = {BLUR_BACKEND_THREADED, threads, -1};
+    if (t.source == kNone) return route;
+
+    const int rc = strengthClass(strength);
+    const int cpuClass = sizeClass(workPixels), gpuClass = sizeClass(imagePixels);
+    auto cost = [&](int backend) -> int64_t {
+        const int sc = backend == BLUR_BACKEND_GPU ? gpuClass : cpuClass;
+        const int64_t pixels = backend == BLUR_BACKEND_GPU ? imagePixels : workPixels;
+        int64_t ns = t.ns[backend][sc][rc];
+        if (ns < 0) return -1;
+        if (backend == BLUR_BACKEND_THREADED) {
+            if (threads <= 1) return -1;
+            // Measured on t.threads; scale the speed-up over one thread
+            // linearly down to the threads the cap leaves
+            const int64_t single = t.ns[BLUR_BACKEND_SIMD][sc][rc] >= 0 ? t.ns[BLUR_BACKEND_SIMD][sc][rc]
+                                                                        : t.ns[BLUR_BACKEND_SCALAR][sc][rc];
+            if (threads < t.threads && single > ns && t.threads > 1) {
+                const double speedup = 1.0 + (static_cast<double>(single) / ns - 1.0) * (threads - 1) / (t.threads - 1);
+                ns = static_cast<int64_t>(single / speedup);
+            }
+        }
+        return ns * pixels / 1000000;
+    };
+
+    int64_t best = -1;
+    for (int b = 0; b < BLUR_BACKEND_COUNT; ++b) {
+        if (b == BLUR_BACKEND_GPU && !gpuOk) continue;
+        const int64_t ns = cost(b);
+        if (ns < 0 || (best >= 0 && ns >= best)) continue;
+        best = ns;
+        route = {b, b == BLUR_BACKEND_THREADED ? threads : (b == BLUR_BACKEND_GPU ? 0 : 1), ns};
+    }
+    return route;
+}
+
+Table benchmark() {
+    Table t;
+    for (auto& b : t.ns)
+        for (auto& s : b)
+            for (int64_t& v : s) v = -1;
+    t.simdLevel = blur_get_simd_level();
+    t.threads = uncappedThreads();
+    t.gpu = blur_gpu_available();
+
+    const int statsWere = blur_stats_enable(0); // keep the benchmark out of the stage histograms
+    BlurContext* ctx = blur_context_create();
+    const int64_t start = monotonicNs();
+    for (int s = 0; s < kSizes; ++s) {
+        const int n = kBenchSide[s];
+        std::vector<uint8_t> image(static_cast<size_t>(n) * n * 4);
+        for (size_t i = 0; i < image.size(); ++i) image[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+        const BlurRect rect = {0, 0, n, n};
+        for (int r = 0; r < kStrengths; ++r) {
+            for (int b = 0; b < BLUR_BACKEND_COUNT; ++b) {
+                if (b == BLUR_BACKEND_SIMD && t.simdLevel == BLUR_SIMD_SCALAR) continue;
+                if (b == BLUR_BACKEND_THREADED && t.threads <= 1) continue;
+                if (b == BLUR_BACKEND_GPU && !t.gpu) continue;
+                int64_t best = -1;
+                for (int run = 0; run < kRuns; ++run) {
+                    const int64_t t0 = monotonicNs();
+                    if (runOn(b, ctx, image.data(), n, n, 0, BLUR_FORMAT_RGBA8888, &rect, 1, 2,
+                              kBenchStrength[r], t.threads) != 0) {
+                        best = -1;
+                        break;
+                    }
+                    const int64_t ns = monotonicNs() - t0;
+                    if (best < 0 || ns < best) best = ns;
+                }
+                if (best >= 0) t.ns[b][s][r] = best * 1000000 / (static_cast<int64_t>(n) * n);
+            }
+        }
+    }
+    t.calibrationNs = monotonicNs() - start;
+    blur_context_destroy(ctx);
+    blur_stats_enable(statsWere);
+    t.source = kBenchmark;
+    return t;
+}
+
+bool load(const char* path, Table* out) {
+    FILE* file = std::fopen(path, "r");
+    if (!file) return false;
+    Table t;
+    int version = 0;
+    bool ok = std::fscanf(file, "blurcore-governor %d %d %d %d %" SCNd64, &version, &t.simdLevel, &t.threads,
+                          &t.gpu, &t.calibrationNs) == 5 && version == kFileVersion;
+    for (int b = 0; ok && b < BLUR_BACKEND_COUNT; ++b)
+        for (int s = 0; ok && s < kSizes; ++s)
+            for (int r = 0; ok && r < kStrengths; ++r) ok = std::fscanf(file, "%" SCNd64, &t.ns[b][s][r]) == 1;
+    std::fclose(file);
+    if (!ok || !sameDevice(t)) return false;
+    t.source = kCache;
+    *out = t;
+    return true;
+}
+
+// Written to <path>.part and renamed, so a crash never leaves half a table
+bool save(const char* path, const Table& t) {
+    char temp[4096];
+    if (std::snprintf(temp, sizeof(temp), "%s.part", path) >= static_cast<int>(sizeof(temp))) return false;
+    FILE* file = std::fopen(temp, "w");
+    if (!file) return false;
+    std::fprintf(file, "blurcore-governor %d %d %d %d %" PRId64 "\n", kFileVersion, t.simdLevel, t.threads, t.gpu,
+                 t.calibrationNs);
+    for (int b = 0; b < BLUR_BACKEND_COUNT; ++b) {
+        for (int s = 0; s < kSizes; ++s)
+            for (int r = 0; r < kStrengths; ++r) std::fprintf(file, "%s%" PRId64, s || r ? " " : "", t.ns[b][s][r]);
+        std::fputc('\n', file);
+    }
+    const bool ok = std::fclose(file) == 0 && std::rename(temp, path) == 0;
+    if (!ok) std::remove(temp);
+    return ok;
+}
+
+Table snapshot() {
+    std::lock_guard<std::mutex> lock(g_tableMutex);
+    return g_table;
+}
+
+} // namespace
+} // namespace blurcore
+
+extern "C" int blur_governor_calibrate(const char* cache_path) {
+    std::lock_guard<std::mutex> calibrating(blurcore::g_calibrateMutex);
+    blurcore::Table t;
+    const bool cached = cache_path && blurcore::load(cache_path, &t);
+    if (!cached) t = blurcore::benchmark();
+    {
+        std::lock_guard<std::mutex> lock(blurcore::g_tableMutex);
+        blurcore::g_table = t;
+    }
+    if (cached || !cache_path) return 0;
+    return blurcore::save(cache_path, t) ? 0 : -8;
+}
+
+extern "C" int blur_governor_set_pressure(int level) {
+    if (level < BLUR_PRESSURE_NONE || level > BLUR_PRESSURE_SEVERE) return -1;
+    blurcore::g_pressure.store(level);
+    const int threads = blurcore::uncappedThreads();
+    blurcore::setThreadCap(level == BLUR_PRESSURE_SEVERE ? 1 : level == BLUR_PRESSURE_MODERATE ? std::max(1, (threads + 1) / 2) : 0);
+    return 0;
+}
+
+extern "C" int blur_governor_pressure(void) {
+    return blurcore::g_pressure.load();
+}
+
+extern "C" float blur_governor_preview_scale(void) {
+    switch (blurcore::g_pressure.load()) {
+        case BLUR_PRESSURE_MODERATE: return 0.75f;
+        case BLUR_PRESSURE_SEVERE: return 0.5f;
+        default: return 1.0f;
+    }
+}
+
+extern "C" int blur_governor_route(int width, int height, int format, int mode, int strength, BlurRoute* route) {
+    if (!route || width <= 0 || height <= 0) return -1;
+    const int64_t pixels = static_cast<int64_t>(width) * height;
+    const bool gpuOk = blurcore::gpuEligible(format, mode, 0) && blur_governor_pressure() < BLUR_PRESSURE_SEVERE;
+    *route = blurcore::choose(blurcore::snapshot(), pixels, pixels, gpuOk, strength);
+    return 0;
+}
+
+extern "C" int blur_governor_apply(BlurContext* ctx, uint8_t* pixels, int width, int height, int stride, int format,
+                                   const BlurRect* rects, int rect_count, int mode, int strength, BlurRoute* route) {
+    if (!pixels || width <= 0 || height <= 0 || rect_count < 0 || (rect_count > 0 && !rects)) return -1;
+    const int64_t imagePixels = static_cast<int64_t>(width) * height;
+    int64_t work = 0;
+    for (int i = 0; i < rect_count; ++i) {
+        const int64_t w = std::min(rects[i].x + rects[i].w, width) - std::max(rects[i].x, 0);
+        const int64_t h = std::min(rects[i].y + rects[i].h, height) - std::max(rects[i].y, 0);
+        if (w > 0 && h > 0) work += w * h;
+    }
+    work = std::min(work, imagePixels);
+
+    const blurcore::Table t = blurcore::snapshot();
+    const bool gpuOk = blurcore::gpuEligible(format, mode, stride) && blur_governor_pressure() < BLUR_PRESSURE_SEVERE;
+    BlurRoute chosen = blurcore::choose(t, imagePixels, work, gpuOk, strength);
+    int rc = blurcore::runOn(chosen.backend, ctx, pixels, width, height, stride, format, rects, rect_count, mode,
+                             strength, chosen.threads);
+    if (rc == -4 && chosen.backend == BLUR_BACKEND_GPU) {
+        chosen = blurcore::choose(t, imagePixels, work, false, strength);
+        rc = blurcore::runOn(chosen.backend, ctx, pixels, width, height, stride, format, rects, rect_count, mode,
+                             strength, chosen.threads);
+    }
+    if (route) *route = chosen;
+    return rc;
+}
+
+extern "C" int blur_governor_json(char* buf, int capacity) {
+    const blurcore::Table t = blurcore::snapshot();
+    std::string json;
+    blurcore::appendf(json, "{\"calibrated\":%s,\"source\":\"%s\",\"calibration_ms\":%.1f", t.source ? "true" : "false",
+                      blurcore::kSourceName[t.source], t.calibrationNs / 1e6);
+    blurcore::appendf(json, ",\"simd_level\":%d,\"threads\":%d,\"gpu\":%s,\"pressure\":%d,\"preview_scale\":%.2f",
+                      blur_get_simd_level(), blur_get_thread_count(), blur_gpu_available() ? "true" : "false",
+                      blur_governor_pressure(), blur_governor_preview_scale());
+    json += ",\"sizes\":[";
+    for (int s = 0; s < blurcore::kSizes; ++s)
+        blurcore::appendf(json, "%s%d", s ? "," : "", blurcore::kBenchSide[s] * blurcore::kBenchSide[s]);
+    json += "],\"strengths\":[";
+    for (int r = 0; r < blurcore::kStrengths; ++r) blurcore::appendf(json, "%s%d", r ? "," : "", blurcore::kBenchStrength[r]);
+    json += "],\"backends\":{";
+    for (int b = 0; b < BLUR_BACKEND_COUNT; ++b) {
+        blurcore::appendf(json, "%s\"%s\":[", b ? "," : "", blurcore::kBackendName[b]);
+        for (int s = 0; s < blurcore::kSizes; ++s) {
+            json += s ? ",[" : "[";
+            for (int r = 0; r < blurcore::kStrengths; ++r) {
+                const int64_t ns = t.ns[b][s][r];
+                if (t.source == blurcore::kNone || ns < 0) blurcore::appendf(json, "%snull", r ? "," : "");
+                else blurcore::appendf(json, "%s%.3f", r ? "," : "", ns / 1e6);
+            }
+            json += "]";
+        }
+        json += "]";
+    }
+    json += "},\"routes\":[";
+    const bool gpuOk = blur_governor_pressure() < BLUR_PRESSURE_SEVERE;
+    for (int s = 0; s < blurcore::kSizes; ++s) {
+        json += s ? ",[" : "[";
+        const int64_t pixels = static_cast<int64_t>(blurcore::kBenchSide[s]) * blurcore::kBenchSide[s];
+        for (int r = 0; r < blurcore::kStrengths; ++r) {
+            const BlurRoute route = blurcore::choose(t, pixels, pixels, gpuOk, blurcore::kBenchStrength[r]);
+            blurcore::appendf(json, "%s\"%s\"", r ? "," : "", blurcore::kBackendName[route.backend]);
+        }
+        json += "]";
+    }
+    json += "]}";
+
+    if (buf && capacity > 0) {
+        const size_t n = std::min(json.size(), static_cast<size_t>(capacity - 1));
+        std::memcpy(buf, json.data(), n);
+        buf[n] = '\0';
+    }
+    return static_cast<int>(json.size());
+}
@@ -0,0 +1,421 @@
+// Resident GPU backend: OpenGL ES 3.1 compute shaders over RGBA8 textures.
+// The source image is uploaded once per BlurGpuImage and every apply renders
+// from it into a result texture, so a strength slider only costs the shader
+// passes. The passes mirror the CPU drivers (same sliding sums, edge clamps
+// and multiply-shift divide), so the output matches blur_apply_regions.
+//
+// Built when BLUR_ENABLE_GLES is defined; otherwise every entry point reports
+// the backend as unavailable.
+#include "blur.h"
+
+#ifdef BLUR_ENABLE_GLES
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl31.h>
+#include <mutex>
+#include <new>
+#include "blur_kernels.h"
+
+namespace blurcore {
+namespace {
+
+// One invocation per row (horizontal) or column (vertical) of the rect,
+// walking it with a running sum exactly like hblurRow / colEmit.
+const char* kBoxShader = R"(#version 310 es
+layout(local_size_x = 64) in;
+layout(rgba8, binding = 0) readonly uniform highp image2D u_src;
+layout(rgba8, binding = 1) writeonly uniform highp image2D u_dst;
+uniform ivec4 u_rect; // x, y, w, h
+uniform int u_radius;
+uniform int u_vertical;
+uniform uint u_mul;
+uniform uint u_shift;
+
+ivec2 at(int i, int lane) {
+    return u_vertical != 0 ? ivec2(u_rect.x + lane, u_rect.y + i) : ivec2(u_rect.x + i, u_rect.y + lane);
+}
+
+uvec4 texel(int i, int lane) {
+    return uvec4(imageLoad(u_src, at(i, lane)) * 255.0 + 0.5);
+}
+
+// floor(n / d) through the same reciprocal as the CPU (shift >= 31)
+uvec4 divide(uvec4 n) {
+    uvec4 hi, lo;
+    umulExtended(n, uvec4(u_mul), hi, lo);
+    return u_shift >= 32u ? hi >> (u_shift - 32u) : (hi << (32u - u_shift)) | (lo >> u_shift);
+}
+
+void main() {
+    int lane = int(gl_GlobalInvocationID.x);
+    int lanes = u_vertical != 0 ? u_rect.z : u_rect.w;
+    int len = u_vertical != 0 ? u_rect.w : u_rect.z;
+    if (lane >= lanes) return;
+
+    uvec4 sum = uvec4(0u);
+    for (int k = -u_radius; k <= u_radius; ++k) sum += texel(clamp(k, 0, len - 1), lane);
+    for (int i = 0; i < len; ++i) {
+        imageStore(u_dst, at(i, lane), vec4(divide(sum)) / 255.0);
+        sum += texel(min(i + u_radius + 1, len - 1), lane);
+        sum -= texel(max(i - u_radius, 0), lane);
+    }
+}
+)";
+
+// One invocation per block.
+const char* kPixelateShader = R"(#version 310 es
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rgba8, binding = 0) readonly uniform highp image2D u_src;
+layout(rgba8, binding = 1) writeonly uniform highp image2D u_dst;
+uniform ivec4 u_rect;
+uniform int u_block;
+
+void main() {
+    ivec2 b = ivec2(u_rect.xy) + ivec2(gl_GlobalInvocationID.xy) * u_block;
+    ivec2 e = min(b + u_block, u_rect.xy + u_rect.zw);
+    if (b.x >= e.x || b.y >= e.y) return;
+
+    uvec4 sum = uvec4(0u);
+    for (int y = b.y; y < e.y; ++y)
+        for (int x = b.x; x < e.x; ++x) sum += uvec4(imageLoad(u_src, ivec2(x, y)) * 255.0 + 0.5);
+    vec4 avg = vec4(sum / uint((e.x - b.x) * (e.y - b.y))) / 255.0;
+    for (int y = b.y; y < e.y; ++y)
+        for (int x = b.x; x < e.x; ++x) imageStore(u_dst, ivec2(x, y), avg);
+}
+)";
+
+const char* kCopyShader = R"(#version 310 es
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rgba8, binding = 0) readonly uniform highp image2D u_src;
+layout(rgba8, binding = 1) writeonly uniform highp image2D u_dst;
+uniform ivec4 u_rect;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (p.x >= u_rect.z || p.y >= u_rect.w) return;
+    p += u_rect.xy;
+    imageStore(u_dst, p, imageLoad(u_src, p));
+}
+)";
+
+struct Program {
+    GLuint id = 0;
+    GLint rect = -1;
+    GLint radius = -1;
+    GLint vertical = -1;
+    GLint mul = -1;
+    GLint shift = -1;
+    GLint block = -1;
+};
+
+// Process-wide EGL context and programs. Every GPU call takes `mutex` and
+// makes the context current for its duration, so callers need no GL setup
+// of their own.
+struct GlesDevice {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    Program box, pixelate, copy;
+    bool ok = false;
+    std::mutex mutex;
+};
+
+// Makes the device context current and restores whatever the thread had
+// bound before (e.g. a UI renderer's context).
+class ScopedCurrent {
+public:
+    explicit ScopedCurrent(const GlesDevice& d)
+        : display_(eglGetCurrentDisplay()), context_(eglGetCurrentContext()),
+          draw_(eglGetCurrentSurface(EGL_DRAW)), read_(eglGetCurrentSurface(EGL_READ)), own_(d.display) {
+        ok_ = eglMakeCurrent(d.display, EGL_NO_SURFACE, EGL_NO_SURFACE, d.context) == EGL_TRUE;
+    }
+
+    ~ScopedCurrent() {
+        if (context_ != EGL_NO_CONTEXT) {
+            eglMakeCurrent(display_, draw_, read_, context_);
+        } else {
+            eglMakeCurrent(own_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+private:
+    EGLDisplay display_;
+    EGLContext context_;
+    EGLSurface draw_;
+    EGLSurface read_;
+    EGLDisplay own_;
+    bool ok_ = false;
+};
+
+bool buildProgram(const char* source, Program& p) {
+    const GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteShader(shader);
+        return false;
+    }
+
+    p.id = glCreateProgram();
+    glAttachShader(p.id, shader);
+    glLinkProgram(p.id);
+    glDeleteShader(shader);
+    glGetProgramiv(p.id, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) return false;
+
+    p.rect = glGetUniformLocation(p.id, "u_rect");
+    p.radius = glGetUniformLocation(p.id, "u_radius");
+    p.vertical = glGetUniformLocation(p.id, "u_vertical");
+    p.mul = glGetUniformLocation(p.id, "u_mul");
+    p.shift = glGetUniformLocation(p.id, "u_shift");
+    p.block = glGetUniformLocation(p.id, "u_block");
+    return true;
+}
+
+EGLDisplay openDisplay() {
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr) == EGL_TRUE) return display;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    // Headless desktop Mesa (CI, host tests) has no default display
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr) == EGL_TRUE) return display;
+    }
+#endif
+    return EGL_NO_DISPLAY;
+}
+
+GlesDevice* createDevice() {
+    GlesDevice* d = new (std::nothrow) GlesDevice();
+    if (!d) return nullptr;
+
+    d->display = openDisplay();
+    if (d->display == EGL_NO_DISPLAY || eglBindAPI(EGL_OPENGL_ES_API) != EGL_TRUE) return d;
+
+    // No surface: the context is only used for compute and readback
+    const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR, EGL_SURFACE_TYPE, 0, EGL_NONE};
+    EGLConfig config;
+    EGLint count = 0;
+    if (eglChooseConfig(d->display, configAttribs, &config, 1, &count) != EGL_TRUE || count == 0) return d;
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3, EGL_CONTEXT_MINOR_VERSION_KHR, 1, EGL_NONE};
+    d->context = eglCreateContext(d->display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (d->context == EGL_NO_CONTEXT) return d;
+
+    ScopedCurrent current(*d);
+    if (!current.ok()) return d;
+    d->ok = buildProgram(kBoxShader, d->box) && buildProgram(kPixelateShader, d->pixelate) &&
+            buildProgram(kCopyShader, d->copy);
+    return d;
+}
+
+// Created on first use and kept for the life of the process.
+GlesDevice* device() {
+    static GlesDevice* d = createDevice();
+    return d && d->ok ? d : nullptr;
+}
+
+GLuint groups(int n, int size) { return static_cast<GLuint>((n + size - 1) / size); }
+
+void bindImages(GLuint src, GLuint dst) {
+    glBindImageTexture(0, src, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+    glBindImageTexture(1, dst, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+}
+
+void copyRect(const Program& p, GLuint src, GLuint dst, int x, int y, int w, int h) {
+    glUseProgram(p.id);
+    bindImages(src, dst);
+    glUniform4i(p.rect, x, y, w, h);
+    glDispatchCompute(groups(w, 8), groups(h, 8), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+} // namespace
+} // namespace blurcore
+
+struct BlurGpuImage {
+    int width;
+    int height;
+    GLuint source;
+    GLuint result;
+    GLuint temp;
+    GLuint framebuffer; // result attached, for readback
+};
+
+static GLuint createTexture(int w, int h) {
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, w, h);
+    return tex;
+}
+
+static void releaseImage(BlurGpuImage* image) {
+    const GLuint textures[] = {image->source, image->result, image->temp};
+    glDeleteTextures(3, textures);
+    glDeleteFramebuffers(1, &image->framebuffer);
+}
+
+extern "C" int blur_gpu_available(void) {
+    return blurcore::device() ? 1 : 0;
+}
+
+extern "C" BlurGpuImage* blur_gpu_image_create(const uint8_t* pixels, int width, int height, int stride) {
+    if (!pixels || width <= 0 || height <= 0) return nullptr;
+    if (stride == 0) stride = width * 4;
+    if (stride < width * 4 || stride % 4 != 0) return nullptr;
+
+    blurcore::GlesDevice* d = blurcore::device();
+    if (!d) return nullptr;
+    std::lock_guard<std::mutex> lock(d->mutex);
+    blurcore::ScopedCurrent current(*d);
+    if (!current.ok()) return nullptr;
+
+    BlurGpuImage* image = new (std::nothrow) BlurGpuImage();
+    if (!image) return nullptr;
+    image->width = width;
+    image->height = height;
+    image->source = createTexture(width, height);
+    image->result = createTexture(width, height);
+    image->temp = createTexture(width, height);
+
+    glBindTexture(GL_TEXTURE_2D, image->source);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    glGenFramebuffers(1, &image->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, image->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image->result, 0);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Result starts out as the unblurred source
+    blurcore::copyRect(d->copy, image->source, image->result, 0, 0, width, height);
+
+    if (!complete || glGetError() != GL_NO_ERROR) {
+        releaseImage(image);
+        delete image;
+        return nullptr;
+    }
+    return image;
+}
+
+extern "C" void blur_gpu_image_destroy(BlurGpuImage* image) {
+    if (!image) return;
+    blurcore::GlesDevice* d = blurcore::device();
+    if (d) {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        blurcore::ScopedCurrent current(*d);
+        if (current.ok()) releaseImage(image);
+    }
+    delete image;
+}
+
+extern "C" int blur_gpu_apply_regions(BlurGpuImage* image, const BlurRect* rects, int rect_count,
+                                       int mode, int strength) {
+    if (!image) return -1;
+    if (mode < 0 || mode > 2) return -2; // unsupported mode
+
+    blurcore::GlesDevice* d = blurcore::device();
+    if (!d) return -4;
+    std::lock_guard<std::mutex> lock(d->mutex);
+    blurcore::ScopedCurrent current(*d);
+    if (!current.ok()) return -4;
+
+    const int W = image->width, H = image->height;
+    blurcore::copyRect(d->copy, image->source, image->result, 0, 0, W, H);
+
+    int radii[3];
+    const int passes = blurcore::boxPassRadii(mode, strength, radii);
+    const int block = strength < 1 ? 1 : strength;
+
+    // Rects run in caller order, so overlapping rects compound like on the CPU
+    for (int i = 0; i < rect_count && rects; ++i) {
+        const BlurRect& r = rects[i];
+        if (r.w <= 0 || r.h <= 0) continue;
+        const int x0 = r.x < 0 ? 0 : (r.x > W - 1 ? W - 1 : r.x);
+        const int y0 = r.y < 0 ? 0 : (r.y > H - 1 ? H - 1 : r.y);
+        int x1 = r.x + r.w - 1, y1 = r.y + r.h - 1;
+        x1 = x1 < 0 ? 0 : (x1 > W - 1 ? W - 1 : x1);
+        y1 = y1 < 0 ? 0 : (y1 > H - 1 ? H - 1 : y1);
+        const int w = x1 - x0 + 1, h = y1 - y0 + 1;
+
+        if (mode == 1) {
+            const blurcore::Program& p = d->pixelate;
+            glUseProgram(p.id);
+            blurcore::bindImages(image->result, image->temp);
+            glUniform4i(p.rect, x0, y0, w, h);
+            glUniform1i(p.block, block);
+            glDispatchCompute(blurcore::groups(blurcore::groups(w, block), 8),
+                              blurcore::groups(blurcore::groups(h, block), 8), 1);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            blurcore::copyRect(d->copy, image->temp, image->result, x0, y0, w, h);
+            continue;
+        }
+
+        // 2 * passes dispatches ping-pong result -> temp -> result, so the
+        // last one always lands back in result
+        const blurcore::Program& p = d->box;
+        glUseProgram(p.id);
+        glUniform4i(p.rect, x0, y0, w, h);
+        GLuint src = image->result, dst = image->temp;
+        for (int axis = 0; axis < 2; ++axis) {
+            glUniform1i(p.vertical, axis);
+            for (int k = 0; k < passes; ++k) {
+                const blurcore::Reciprocal rc = blurcore::makeReciprocal(2 * radii[k] + 1);
+                blurcore::bindImages(src, dst);
+                glUniform1i(p.radius, radii[k]);
+                glUniform1ui(p.mul, rc.mul);
+                glUniform1ui(p.shift, rc.shift);
+                glDispatchCompute(blurcore::groups(axis ? w : h, 64), 1, 1);
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                const GLuint t = src; src = dst; dst = t;
+            }
+        }
+    }
+
+    return glGetError() == GL_NO_ERROR ? 0 : -4;
+}
+
+extern "C" int blur_gpu_image_read(BlurGpuImage* image, uint8_t* pixels, int stride) {
+    if (!image || !pixels) return -1;
+    if (stride == 0) stride = image->width * 4;
+    if (stride < image->width * 4 || stride % 4 != 0) return -1;
+
+    blurcore::GlesDevice* d = blurcore::device();
+    if (!d) return -4;
+    std::lock_guard<std::mutex> lock(d->mutex);
+    blurcore::ScopedCurrent current(*d);
+    if (!current.ok()) return -4;
+
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, image->framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_PACK_ROW_LENGTH, stride / 4);
+    glReadPixels(0, 0, image->width, image->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return glGetError() == GL_NO_ERROR ? 0 : -4;
+}
+
+#else // !BLUR_ENABLE_GLES
+
+extern "C" int blur_gpu_available(void) { return 0; }
+
+extern "C" BlurGpuImage* blur_gpu_image_create(const uint8_t*, int, int, int) { return nullptr; }
+
+extern "C" void blur_gpu_image_destroy(BlurGpuImage*) {}
+
+extern "C" int blur_gpu_apply_regions(BlurGpuImage*, const BlurRect*, int, int, int) { return -4; }
+
+extern "C" int blur_gpu_image_read(BlurGpuImage*, uint8_t*, int) { return -4; }
+
+#endif
@@ -0,0 +1,292 @@
+// Asynchronous jobs (blur_job_submit). Every job waits in one queue; each
+// submit posts a runner to the shared worker pool, and a runner keeps taking
+// the best runnable job (previews first, then oldest) until none is left.
+// A job is only runnable while no running job shares its session or tag, so
+// a superseded preview winds down before its replacement touches the same
+// pixels. The blur inside a job still splits over the pool through
+// parallelFor, which the runner joins, so nesting never deadlocks.
+//
+// Cancelling sets the job's flag and, if it is running, cancels its context
+// or session, which the blur checks per band or tile. The runner opens a
+// CancelScope on that context before the job counts as running, so the
+// blur calls inside the job never clear a cancel that already landed.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include "blur.h"
+#include "cancel.h"
+#include "jobs.h"
+#include "session.h"
+#include "thread_pool.h"
+
+namespace {
+
+struct Job {
+    int64_t id;
+    BlurJobSpec spec;
+    std::vector<BlurRect> rects;
+    BlurJobDone done;
+    void* user;
+    BlurContext* ctx = nullptr; // while running, for pixel jobs
+    bool running = false;
+    std::atomic<bool> cancelled{false};
+};
+
+// The job whose callback this thread is running, so that waiting from the
+// callback (e.g. closing its session) does not wait for the callback itself
+thread_local const Job* t_reporting = nullptr;
+
+class JobQueue {
+public:
+    int64_t submit(const BlurJobSpec& spec, BlurJobDone done, void* user) {
+        Job* job = new (std::nothrow) Job();
+        if (!job) return -3;
+        job->spec = spec;
+        if (spec.kind == BLUR_JOB_REGIONS) {
+            if (spec.rect_count > 0) {
+                job->rects.assign(spec.rects, spec.rects + spec.rect_count);
+            } else {
+                job->rects.assign(1, BlurRect{0, 0, spec.width, spec.height});
+            }
+            job->spec.rects = nullptr; // the caller's array may not outlive the call
+        }
+        job->done = done;
+        job->user = user;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job->id = nextId_++;
+            if (spec.tag != 0) cancelLocked([&](const Job& j) { return j.spec.tag == spec.tag; });
+            pending_.push_back(job);
+        }
+        const int64_t id = job->id; // job may already be gone once a runner starts
+        startRunner();
+        return id;
+    }
+
+    template <typename Match>
+    int cancel(Match match) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cancelLocked(match);
+    }
+
+    int wait(int64_t id) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!find(id)) return -1;
+        finished_.wait(lock, [&] {
+            const Job* j = find(id);
+            return !j || j == t_reporting;
+        });
+        return 0;
+    }
+
+    void finishSession(const BlurSession* session) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto onSession = [&](const Job& j) { return j.spec.session == session; };
+        cancelLocked(onSession);
+        finished_.wait(lock, [&] { return !any(onSession); });
+    }
+
+private:
+    // Caller holds mutex_. Queued jobs stay queued and finish with -5 as
+    // soon as a runner reaches them, so callbacks always come from a runner.
+    template <typename Match>
+    int cancelLocked(Match match) {
+        int count = 0;
+        for (std::vector<Job*>* list : {&pending_, &running_}) {
+            for (Job* j : *list) {
+                if (!match(*j) || j->cancelled.exchange(true)) continue;
+                ++count;
+                if (!j->running) continue;
+                if (j->spec.session) {
+                    blur_session_cancel(j->spec.session);
+                } else {
+                    blur_context_cancel(j->ctx);
+                }
+            }
+        }
+        return count;
+    }
+
+    // Queued, running or reporting
+    Job* find(int64_t id) const {
+        for (const std::vector<Job*>* list : {&pending_, &running_, &reporting_}) {
+            for (Job* j : *list) {
+                if (j->id == id) return j;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename Match>
+    bool any(Match match) const {
+        for (const std::vector<Job*>* list : {&pending_, &running_, &reporting_}) {
+            for (const Job* j : *list) {
+                if (j != t_reporting && match(*j)) return true;
+            }
+        }
+        return false;
+    }
+
+    bool blocked(const Job& job) const {
+        for (const Job* r : running_) {
+            if (job.spec.session && r->spec.session == job.spec.session) return true;
+            if (job.spec.tag != 0 && r->spec.tag == job.spec.tag) return true;
+        }
+        return false;
+    }
+
+    // Cancelled jobs first (they only report), then previews, then oldest
+    std::vector<Job*>::iterator best() {
+        auto pick = pending_.end();
+        for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+            if (blocked(**it)) continue;
+            if (pick == pending_.end()) {
+                pick = it;
+                continue;
+            }
+            const Job& a = **it;
+            const Job& b = **pick;
+            const bool ac = a.cancelled.load(), bc = b.cancelled.load();
+            if (ac != bc ? ac : a.spec.priority > b.spec.priority) pick = it;
+        }
+        return pick;
+    }
+
+    void startRunner() {
+        std::shared_ptr<blurcore::ThreadPool> pool = blurcore::sharedThreadPool();
+        if (pool && pool->post([this] { run(); })) return;
+        // Single-threaded configuration: a runner thread of its own
+        std::thread([this] { run(); }).detach();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            auto it = best();
+            if (it == pending_.end()) return;
+            Job* job = *it;
+            pending_.erase(it);
+            running_.push_back(job);
+
+            int status = -5;
+            if (!job->cancelled.load()) {
+                if (!job->spec.session) {
+                    if (!idleContexts_.empty()) {
+                        job->ctx = idleContexts_.back();
+                        idleContexts_.pop_back();
+                    } else {
+                        job->ctx = blur_context_create();
+                    }
+                }
+                {
+                    // Cancels from here on reach the context and stay set
+                    blurcore::CancelScope scope(job->spec.session ? blurcore::sessionContext(job->spec.session)
+                                                                  : job->ctx);
+                    job->running = true;
+                    lock.unlock();
+                    status = job->spec.session || job->ctx ? execute(*job) : -3;
+                    lock.lock();
+                    job->running = false;
+                }
+                if (job->cancelled.load()) status = -5;
+                if (job->ctx) idleContexts_.push_back(job->ctx);
+                job->ctx = nullptr;
+            }
+            running_.erase(std::find(running_.begin(), running_.end(), job));
+            reporting_.push_back(job);
+
+            // Jobs that waited on this one may run now; give them a runner
+            // in case the callback below blocks (e.g. closing the session)
+            if (best() != pending_.end()) startRunner();
+            lock.unlock();
+            t_reporting = job;
+            if (job->done) job->done(job->user, job->id, status);
+            t_reporting = nullptr;
+            lock.lock();
+            reporting_.erase(std::find(reporting_.begin(), reporting_.end(), job));
+            finished_.notify_all();
+            delete job;
+        }
+    }
+
+    static int execute(const Job& job) {
+        const BlurJobSpec& s = job.spec;
+        switch (s.kind) {
+        case BLUR_JOB_REGIONS:
+            return blur_apply_regions_ex(job.ctx, s.pixels, s.width, s.height, s.stride, s.format,
+                                         job.rects.data(), static_cast<int>(job.rects.size()), s.mode, s.strength);
+        case BLUR_JOB_MASKED:
+            return blur_apply_masked(job.ctx, s.pixels, s.width, s.height, s.stride, s.format, s.mask,
+                                     s.mask_stride, s.mode, s.fg_strength, s.bg_strength);
+        case BLUR_JOB_SESSION_MASKED:
+            return blur_session_render_masked(s.session, s.mask_id, s.mode, s.fg_strength, s.bg_strength);
+        case BLUR_JOB_SESSION_BLURRED:
+            return blur_session_render_blurred(s.session, s.mode, s.strength, s.flags);
+        default:
+            return -2;
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable finished_; // a job left the queue
+    std::vector<Job*> pending_;
+    std::vector<Job*> running_;
+    std::vector<Job*> reporting_; // finished, callback still running
+    std::vector<BlurContext*> idleContexts_; // scratch kept between jobs
+    int64_t nextId_ = 1;
+};
+
+// Never destroyed: runners may still be unwinding at process exit
+JobQueue& queue() {
+    static JobQueue* q = new JobQueue();
+    return *q;
+}
+
+} // namespace
+
+namespace blurcore {
+
+void finishSessionJobs(const BlurSession* session) {
+    queue().finishSession(session);
+}
+
+} // namespace blurcore
+
+extern "C" int64_t blur_job_submit(const BlurJobSpec* spec, BlurJobDone done, void* user) {
+    if (!spec) return -1;
+    switch (spec->kind) {
+    case BLUR_JOB_REGIONS:
+        if (spec->rect_count < 0 || (spec->rect_count > 0 && !spec->rects)) return -1;
+        // fall through
+    case BLUR_JOB_MASKED:
+        if (!spec->pixels || spec->session) return -1;
+        if (spec->kind == BLUR_JOB_MASKED && !spec->mask) return -1;
+        break;
+    case BLUR_JOB_SESSION_MASKED:
+    case BLUR_JOB_SESSION_BLURRED:
+        if (!spec->session) return -1;
+        break;
+    default:
+        return -1;
+    }
+    return queue().submit(*spec, done, user);
+}
+
+extern "C" int blur_job_cancel(int64_t job) {
+    return queue().cancel([&](const Job& j) { return j.id == job; }) > 0 ? 0 : -1;
+}
+
+extern "C" int blur_job_cancel_tag(int64_t tag) {
+    if (tag == 0) return 0;
+    return queue().cancel([&](const Job& j) { return j.spec.tag == tag; });
+}
+
+extern "C" int blur_job_wait(int64_t job) {
+    return queue().wait(job);
+}
@@ -0,0 +1,12 @@
+// Internal hooks of the asynchronous job queue (jobs.cpp).
+#pragma once
+#include "blur.h"
+
+namespace blurcore {
+
+// Cancel every unfinished job on the session and wait until none is queued
+// or running, so the session can be freed. Must not be called from one of
+// those jobs (their callbacks are fine).
+void finishSessionJobs(const BlurSession* session);
+
+} // namespace blurcore
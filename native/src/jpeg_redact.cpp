@@ -0,0 +1,387 @@
+// Redaction of JPEG files in the DCT domain. The source is read as
+// quantized coefficients (entropy decoding only); a second decoder on the
+// same file skips to the iMCU rows that hold a rect and decodes just those,
+// cropped to the rects' columns. The rects are blurred there, and every
+// iMCU cell a rect touches is converted back to YCbCr, downsampled, forward
+// transformed and quantized with the source's tables into the coefficient
+// arrays. The arrays are then written out unchanged everywhere else, so
+// untouched blocks are copied bit for bit instead of going through a decode
+// and a lossy re-encode.
+//
+// libjpeg reports errors by longjmp, so everything that calls into it keeps
+// its state in the Redactor and has only trivial locals.
+//
+// Built when BLUR_ENABLE_JPEG is defined; otherwise the entry point reports
+// the backend as unavailable.
+#include "blur.h"
+
+#ifdef BLUR_ENABLE_JPEG
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <jpeglib.h>
+#include "buffer_pool.h"
+
+#if !defined(LIBJPEG_TURBO_VERSION_NUMBER) || LIBJPEG_TURBO_VERSION_NUMBER < 1005000
+#error "blur_jpeg_redact needs libjpeg-turbo 1.5 or newer (jpeg_skip_scanlines, jpeg_crop_scanline)"
+#endif
+
+namespace {
+
+struct ErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+void onError(j_common_ptr cinfo) { longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jump, 1); }
+
+void onMessage(j_common_ptr) {} // corrupt-data warnings are not worth a log line per file
+
+// cos table of the 8-point DCT-II with the JPEG normalisation folded in:
+// F(u, v) = sum T[u][x] T[v][y] s(x, y)
+struct DctTable {
+    float t[8][8];
+    DctTable() {
+        const double pi = 3.14159265358979323846;
+        for (int u = 0; u < 8; ++u)
+            for (int x = 0; x < 8; ++x)
+                t[u][x] = static_cast<float>((u == 0 ? std::sqrt(0.5) : 1.0) * 0.5 * std::cos((2 * x + 1) * u * pi / 16));
+    }
+};
+
+const DctTable kDct;
+
+// Forward DCT of one block of level-shifted samples, quantized into out
+void quantizeBlock(const float in[64], const UINT16* quant, JCOEF* out) {
+    float rows[64];
+    for (int y = 0; y < 8; ++y)
+        for (int u = 0; u < 8; ++u) {
+            float s = 0;
+            for (int x = 0; x < 8; ++x) s += kDct.t[u][x] * in[y * 8 + x];
+            rows[y * 8 + u] = s;
+        }
+    for (int v = 0; v < 8; ++v)
+        for (int u = 0; u < 8; ++u) {
+            float s = 0;
+            for (int y = 0; y < 8; ++y) s += kDct.t[v][y] * rows[y * 8 + u];
+            const long q = std::lround(s / quant[v * 8 + u]);
+            out[v * 8 + u] = static_cast<JCOEF>(std::min(32767L, std::max(-32767L, q)));
+        }
+}
+
+// Rows [y0, y1) decoded together, aligned to iMCU rows, and the rects in them
+struct Band {
+    int y0, y1;
+    std::vector<BlurRect> rects;
+};
+
+bool isIcc(const jpeg_marker_struct* m) {
+    return m->marker == JPEG_APP0 + 2 && m->data_length >= 12 && std::memcmp(m->data, "ICC_PROFILE", 12) == 0;
+}
+
+class Redactor {
+public:
+    Redactor(const BlurRect* rects, int rectCount, int mode, int strength, int flags)
+        : mode_(mode), strength_(strength), flags_(flags) {
+        rects_.assign(rects, rects + rectCount);
+        src_.err = jpeg_std_error(&srcErr_.pub);
+        pix_.err = jpeg_std_error(&pixErr_.pub);
+        dst_.err = jpeg_std_error(&dstErr_.pub);
+        for (ErrorManager* e : {&srcErr_, &pixErr_, &dstErr_}) {
+            e->pub.error_exit = onError;
+            e->pub.output_message = onMessage;
+        }
+    }
+
+    ~Redactor() {
+        if (pixCreated_) jpeg_destroy_decompress(&pix_);
+        if (dstCreated_) jpeg_destroy_compress(&dst_);
+        if (srcCreated_) jpeg_destroy_decompress(&src_);
+        if (ctx_) blur_context_destroy(ctx_);
+    }
+
+    Redactor(const Redactor&) = delete;
+    Redactor& operator=(const Redactor&) = delete;
+
+    // in is read twice (coefficients, then pixels), so it is opened twice
+    int run(FILE* in, FILE* inPixels, FILE* out) {
+        if (setjmp(srcErr_.jump)) return -7;
+        jpeg_create_decompress(&src_);
+        srcCreated_ = true;
+        jpeg_stdio_src(&src_, in);
+        jpeg_save_markers(&src_, JPEG_COM, 0xFFFF);
+        for (int m = 0; m < 16; ++m) jpeg_save_markers(&src_, JPEG_APP0 + m, 0xFFFF);
+        jpeg_read_header(&src_, TRUE);
+        const bool gray = src_.num_components == 1 && src_.jpeg_color_space == JCS_GRAYSCALE;
+        if (!gray && (src_.num_components != 3 || src_.jpeg_color_space != JCS_YCbCr)) return -2;
+        coefficients_ = jpeg_read_coefficients(&src_);
+        // comp_info is freed by jpeg_finish_decompress, so count now
+        for (int c = 0; c < src_.num_components; ++c)
+            blocksTotal_ += static_cast<int64_t>(src_.comp_info[c].width_in_blocks) * src_.comp_info[c].height_in_blocks;
+
+        const int status = planBands();
+        if (status != 0) return status;
+        if (!bands_.empty()) {
+            const int rc = redactBands(inPixels, gray);
+            if (rc != 0) return rc;
+        }
+        return writeOutput(out);
+    }
+
+    void stats(BlurJpegStats* out) const {
+        out->rows_decoded = rowsDecoded_;
+        out->blocks_rewritten = blocksRewritten_;
+        out->blocks_total = blocksTotal_;
+    }
+
+private:
+    int imcuWidth() const { return src_.max_h_samp_factor * DCTSIZE; }
+    int imcuHeight() const { return src_.max_v_samp_factor * DCTSIZE; }
+
+    // Group the rects into bands of iMCU rows and find the columns to decode.
+    // Only mode 3 reads pixels outside its rects (its window is clipped to
+    // the image), so only it needs a halo.
+    int planBands() {
+        const int width = static_cast<int>(src_.image_width), height = static_cast<int>(src_.image_height);
+        const int iw = imcuWidth(), ih = imcuHeight();
+        std::vector<BlurRect> clamped;
+        for (const BlurRect& r : rects_) {
+            const int x0 = std::max(r.x, 0), y0 = std::max(r.y, 0);
+            const int x1 = std::min<int64_t>(static_cast<int64_t>(r.x) + r.w, width);
+            const int y1 = std::min<int64_t>(static_cast<int64_t>(r.y) + r.h, height);
+            if (x1 > x0 && y1 > y0) clamped.push_back({x0, y0, x1 - x0, y1 - y0});
+        }
+        if (clamped.empty()) return 0;
+        const int halo = mode_ == 3 ? blur_strip_halo(height, clamped.data(), static_cast<int>(clamped.size()),
+                                                      mode_, strength_) : 0;
+        std::sort(clamped.begin(), clamped.end(), [](const BlurRect& a, const BlurRect& b) { return a.y < b.y; });
+
+        int cropX0 = width, cropX1 = 0;
+        for (const BlurRect& r : clamped) {
+            const int y0 = std::max(0, r.y - halo) / ih * ih;
+            const int y1 = std::min(height, (std::min(height, r.y + r.h + halo) + ih - 1) / ih * ih);
+            if (!bands_.empty() && y0 <= bands_.back().y1) {
+                bands_.back().y1 = std::max(bands_.back().y1, y1);
+            } else {
+                bands_.push_back({y0, y1, {}});
+            }
+            bands_.back().rects.push_back(r);
+            cropX0 = std::min(cropX0, std::max(0, r.x - halo) / iw * iw);
+            cropX1 = std::max(cropX1, std::min(width, (std::min(width, r.x + r.w + halo) + iw - 1) / iw * iw));
+        }
+        cropX_ = cropX0;
+        cropWidth_ = cropX1 - cropX0;
+
+        int tallest = 0;
+        for (const Band& b : bands_) tallest = std::max(tallest, b.y1 - b.y0);
+        ctx_ = blur_context_create();
+        pixels_ = blurcore::acquireBuffer(static_cast<size_t>(width) * (src_.num_components) * tallest);
+        cells_.resize(static_cast<size_t>((width + iw - 1) / iw) * ((tallest + ih - 1) / ih));
+        rows_.resize(static_cast<size_t>(tallest));
+        return ctx_ && pixels_ ? 0 : -3;
+    }
+
+    int redactBands(FILE* in, bool gray) {
+        if (setjmp(pixErr_.jump)) return -7;
+        jpeg_create_decompress(&pix_);
+        pixCreated_ = true;
+        jpeg_stdio_src(&pix_, in);
+        jpeg_read_header(&pix_, TRUE);
+        pix_.out_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_start_decompress(&pix_);
+        JDIMENSION x = static_cast<JDIMENSION>(cropX_), w = static_cast<JDIMENSION>(cropWidth_);
+        jpeg_crop_scanline(&pix_, &x, &w);
+        cropX_ = static_cast<int>(x);
+        cropWidth_ = static_cast<int>(w);
+        stride_ = static_cast<size_t>(cropWidth_) * pix_.output_components;
+
+        for (size_t i = 0; i < bands_.size(); ++i) {
+            const Band& band = bands_[i];
+            if (static_cast<int>(pix_.output_scanline) < band.y0)
+                jpeg_skip_scanlines(&pix_, static_cast<JDIMENSION>(band.y0) - pix_.output_scanline);
+            const int rows = band.y1 - band.y0;
+            for (int r = 0; r < rows; ++r) rows_[r] = pixels_.data() + stride_ * r;
+            while (static_cast<int>(pix_.output_scanline) < band.y1) {
+                const int done = static_cast<int>(pix_.output_scanline) - band.y0;
+                jpeg_read_scanlines(&pix_, &rows_[done], static_cast<JDIMENSION>(rows - done));
+            }
+            rowsDecoded_ += rows;
+            const int rc = blurBand(band, gray);
+            if (rc != 0) return rc;
+            encodeBand(band, gray);
+        }
+        jpeg_abort_decompress(&pix_);
+        return 0;
+    }
+
+    int blurBand(const Band& band, bool gray) {
+        std::vector<BlurRect> local(band.rects);
+        for (BlurRect& r : local) {
+            r.x -= cropX_;
+            r.y -= band.y0;
+        }
+        return blur_apply_regions_ex(ctx_, pixels_.data(), cropWidth_, band.y1 - band.y0,
+                                     static_cast<int>(stride_), gray ? BLUR_FORMAT_GRAY8 : BLUR_FORMAT_RGB888,
+                                     local.data(), static_cast<int>(local.size()), mode_, strength_);
+    }
+
+    // Mark the iMCU cells the band's rects touch, then rebuild their blocks
+    void encodeBand(const Band& band, bool gray) {
+        const int iw = imcuWidth(), ih = imcuHeight();
+        const int cols = (static_cast<int>(src_.image_width) + iw - 1) / iw;
+        const int cellRows = (band.y1 - band.y0 + ih - 1) / ih;
+        std::fill(cells_.begin(), cells_.begin() + static_cast<size_t>(cols) * cellRows, 0);
+        for (const BlurRect& r : band.rects)
+            for (int cy = (r.y - band.y0) / ih; cy <= (r.y + r.h - 1 - band.y0) / ih; ++cy)
+                for (int cx = r.x / iw; cx <= (r.x + r.w - 1) / iw; ++cx) cells_[static_cast<size_t>(cy) * cols + cx] = 1;
+
+        for (int cy = 0; cy < cellRows; ++cy) {
+            const int imcuRow = band.y0 / ih + cy;
+            for (int c = 0; c < src_.num_components; ++c) {
+                jpeg_component_info* comp = &src_.comp_info[c];
+                JBLOCKARRAY blocks = (*src_.mem->access_virt_barray)(
+                    reinterpret_cast<j_common_ptr>(&src_), coefficients_[c],
+                    static_cast<JDIMENSION>(imcuRow * comp->v_samp_factor),
+                    static_cast<JDIMENSION>(comp->v_samp_factor), TRUE);
+                for (int cx = 0; cx < cols; ++cx) {
+                    if (!cells_[static_cast<size_t>(cy) * cols + cx]) continue;
+                    for (int by = 0; by < comp->v_samp_factor; ++by) {
+                        const int blockRow = imcuRow * comp->v_samp_factor + by;
+                        if (blockRow >= static_cast<int>(comp->height_in_blocks)) continue;
+                        for (int bx = 0; bx < comp->h_samp_factor; ++bx) {
+                            const int blockCol = cx * comp->h_samp_factor + bx;
+                            if (blockCol >= static_cast<int>(comp->width_in_blocks)) continue;
+                            encodeBlock(band, gray, c, blockRow, blockCol, blocks[by][blockCol]);
+                            ++blocksRewritten_;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // One block of component c from the blurred pixels: YCbCr (JFIF), the
+    // average over the component's subsampling footprint, edges replicated
+    void encodeBlock(const Band& band, bool gray, int c, int blockRow, int blockCol, JCOEF* out) const {
+        const jpeg_component_info* comp = &src_.comp_info[c];
+        const int fx = src_.max_h_samp_factor / comp->h_samp_factor;
+        const int fy = src_.max_v_samp_factor / comp->v_samp_factor;
+        const int maxX = static_cast<int>(src_.image_width) - 1, maxY = static_cast<int>(src_.image_height) - 1;
+        const int bpp = gray ? 1 : 3;
+        static const float kWeights[3][3] = {
+            {0.299f, 0.587f, 0.114f}, {-0.168736f, -0.331264f, 0.5f}, {0.5f, -0.418688f, -0.081312f}};
+        const float* w = kWeights[c];
+        const float offset = c == 0 ? -128.0f : 0.0f; // level shift; chroma's +128 and -128 cancel
+        const float scale = 1.0f / (fx * fy);
+        float samples[64];
+        for (int v = 0; v < 8; ++v)
+            for (int u = 0; u < 8; ++u) {
+                float sum = 0;
+                for (int j = 0; j < fy; ++j) {
+                    const int y = std::min((blockRow * 8 + v) * fy + j, maxY) - band.y0;
+                    const uint8_t* row = pixels_.data() + stride_ * y;
+                    for (int i = 0; i < fx; ++i) {
+                        const int x = std::min((blockCol * 8 + u) * fx + i, maxX) - cropX_;
+                        const uint8_t* p = row + static_cast<size_t>(x) * bpp;
+                        sum += gray ? p[0] : w[0] * p[0] + w[1] * p[1] + w[2] * p[2];
+                    }
+                }
+                samples[v * 8 + u] = sum * scale + offset;
+            }
+        quantizeBlock(samples, comp->quant_table->quantval, out);
+    }
+
+    int writeOutput(FILE* out) {
+        if (setjmp(dstErr_.jump)) return -8;
+        jpeg_create_compress(&dst_);
+        dstCreated_ = true;
+        jpeg_stdio_dest(&dst_, out);
+        jpeg_copy_critical_parameters(&src_, &dst_);
+        jpeg_write_coefficients(&dst_, coefficients_);
+        for (jpeg_saved_marker_ptr m = src_.marker_list; m; m = m->next) {
+            // The JFIF and Adobe headers are written by libjpeg itself
+            if (dst_.write_JFIF_header && m->marker == JPEG_APP0 && m->data_length >= 5 &&
+                std::memcmp(m->data, "JFIF", 5) == 0)
+                continue;
+            if (dst_.write_Adobe_marker && m->marker == JPEG_APP0 + 14 && m->data_length >= 5 &&
+                std::memcmp(m->data, "Adobe", 5) == 0)
+                continue;
+            if (!isIcc(m) && !(flags_ & BLUR_JPEG_COPY_METADATA)) continue;
+            jpeg_write_marker(&dst_, m->marker, m->data, m->data_length);
+        }
+        jpeg_finish_compress(&dst_);
+        if (setjmp(srcErr_.jump)) return -7;
+        jpeg_finish_decompress(&src_);
+        return 0;
+    }
+
+    std::vector<BlurRect> rects_;
+    int mode_, strength_, flags_;
+
+    jpeg_decompress_struct src_ = {};
+    jpeg_decompress_struct pix_ = {};
+    jpeg_compress_struct dst_ = {};
+    ErrorManager srcErr_ = {}, pixErr_ = {}, dstErr_ = {};
+    bool srcCreated_ = false, pixCreated_ = false, dstCreated_ = false;
+    jvirt_barray_ptr* coefficients_ = nullptr;
+
+    std::vector<Band> bands_;
+    int cropX_ = 0, cropWidth_ = 0;
+    size_t stride_ = 0;
+    BlurContext* ctx_ = nullptr;
+    blurcore::PooledBuffer pixels_; // the current band, cropped
+    std::vector<JSAMPROW> rows_;
+    std::vector<uint8_t> cells_;    // iMCU cells of the band to rebuild
+
+    int rowsDecoded_ = 0;
+    int64_t blocksRewritten_ = 0;
+    int64_t blocksTotal_ = 0;
+};
+
+} // namespace
+
+extern "C" int blur_jpeg_available(void) { return 1; }
+
+extern "C" int blur_jpeg_redact(const char* input_path, const char* output_path,
+                                const BlurRect* rects, int rect_count, int mode, int strength,
+                                int flags, BlurJpegStats* stats) {
+    if (!input_path || !output_path || rect_count < 0 || (rect_count > 0 && !rects)) return -1;
+    if (mode < 0 || mode > 4) return -2;
+    char temp[4096];
+    if (std::snprintf(temp, sizeof(temp), "%s.part", output_path) >= static_cast<int>(sizeof(temp))) return -1;
+
+    FILE* in = std::fopen(input_path, "rb");
+    FILE* inPixels = in ? std::fopen(input_path, "rb") : nullptr;
+    if (!inPixels) {
+        if (in) std::fclose(in);
+        return -7;
+    }
+    FILE* out = std::fopen(temp, "wb");
+    int status = -8;
+    if (out) {
+        Redactor redactor(rects, rect_count, mode, strength, flags);
+        status = redactor.run(in, inPixels, out);
+        if (status == 0 && stats) redactor.stats(stats);
+        if (std::fclose(out) != 0 && status == 0) status = -8;
+        if (status == 0 && std::rename(temp, output_path) != 0) status = -8;
+        if (status != 0) std::remove(temp);
+    }
+    std::fclose(in);
+    std::fclose(inPixels);
+    return status;
+}
+
+#else // !BLUR_ENABLE_JPEG
+
+extern "C" int blur_jpeg_available(void) { return 0; }
+
+extern "C" int blur_jpeg_redact(const char*, const char*, const BlurRect*, int, int, int, int, BlurJpegStats*) {
+    return -6;
+}
+
+#endif
@@ -0,0 +1,570 @@
+// Mask refinement as one in-place pass list (blur_mask_process). Background
+// is 0, so a step can only change pixels within its reach of the non-zero
+// bounding box; every step runs on that box grown by its reach and the box
+// is tightened again afterwards. A portrait mask that covers a third of the
+// frame costs a third of a full-frame pass, and an empty mask costs one scan.
+// blur_mask_refine_guided is the guided filter, on float planes with a
+// running-sum box mean over a subsampled grid.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include "blur.h"
+#include "blur_kernels.h"
+#include "buffer_pool.h"
+#include "cancel.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace {
+
+struct Box {
+    int x0, y0, x1, y1; // exclusive end
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    int w() const { return x1 - x0; }
+    int h() const { return y1 - y0; }
+};
+
+Box grow(const Box& b, int r, int width, int height) {
+    if (b.empty()) return b;
+    return {std::max(b.x0 - r, 0), std::max(b.y0 - r, 0), std::min(b.x1 + r, width), std::min(b.y1 + r, height)};
+}
+
+// Bounding box of the non-zero pixels inside `within`
+Box nonZeroBounds(const uint8_t* mask, int stride, const Box& within) {
+    Box b = {within.x1, within.y1, within.x0, within.y0};
+    for (int y = within.y0; y < within.y1; ++y) {
+        const uint8_t* row = mask + static_cast<size_t>(y) * stride;
+        int x = within.x0;
+        while (x < within.x1 && !row[x]) ++x;
+        if (x == within.x1) continue;
+        int last = within.x1 - 1;
+        while (!row[last]) --last;
+        b.x0 = std::min(b.x0, x);
+        b.x1 = std::max(b.x1, last + 1);
+        b.y0 = std::min(b.y0, y);
+        b.y1 = y + 1;
+    }
+    return b;
+}
+
+// Split [0, n) into bands on the shared pool. fn returns false when it runs
+// out of memory.
+bool forBands(int n, const std::function<bool(int, int)>& fn) {
+    const int bands = std::max(1, std::min(n, 4 * blurcore::configuredThreadCount()));
+    std::atomic<bool> ok{true};
+    blurcore::parallelFor(bands, [&](int i) {
+        const int b0 = static_cast<int>(static_cast<int64_t>(n) * i / bands);
+        const int b1 = static_cast<int>(static_cast<int64_t>(n) * (i + 1) / bands);
+        if (!fn(b0, b1)) ok.store(false, std::memory_order_relaxed);
+    });
+    return ok.load();
+}
+
+// Max (dilate) or min (erode) over a window of 2r+1 along one line of n
+// values `step` bytes apart, ends clamped. van Herk / Gil-Werman: prefix and
+// suffix extremes within blocks of the window size give any window from two
+// lookups, so the cost does not depend on r. ext, g and h hold n + 2r bytes.
+template <bool kMax>
+void windowLine(uint8_t* line, ptrdiff_t step, int n, int r, uint8_t* ext, uint8_t* g, uint8_t* h) {
+    const int len = n + 2 * r, k = 2 * r + 1;
+    auto pick = [](uint8_t a, uint8_t b) { return kMax ? std::max(a, b) : std::min(a, b); };
+    for (int i = 0; i < len; ++i) ext[i] = line[std::min(std::max(i - r, 0), n - 1) * step];
+    for (int i = 0, j = 0; i < len; ++i, j = j + 1 == k ? 0 : j + 1) g[i] = j ? pick(g[i - 1], ext[i]) : ext[i];
+    h[len - 1] = ext[len - 1];
+    for (int i = len - 2; i >= 0; --i) h[i] = (i + 1) % k ? pick(h[i + 1], ext[i]) : ext[i];
+    for (int x = 0; x < n; ++x) line[x * step] = pick(h[x], g[x + k - 1]);
+}
+
+// Square-window dilate or erode of box b (the image has `stride` bytes per
+// row), clamped at the box edges
+int morph(uint8_t* base, int stride, const Box& b, int r, bool dilate) {
+    if (r <= 0 || b.empty()) return 0;
+    auto pass = [&](int lines, int n, ptrdiff_t lineStep, ptrdiff_t step) {
+        return forBands(lines, [&](int l0, int l1) {
+            const size_t len = static_cast<size_t>(n) + 2 * r;
+            blurcore::PooledBuffer scratch = blurcore::acquireBuffer(3 * len);
+            if (!scratch) return false;
+            uint8_t* ext = scratch.data();
+            for (int l = l0; l < l1; ++l) {
+                uint8_t* line = base + static_cast<size_t>(b.y0) * stride + b.x0 + l * lineStep;
+                if (dilate) windowLine<true>(line, step, n, r, ext, ext + len, ext + 2 * len);
+                else windowLine<false>(line, step, n, r, ext, ext + len, ext + 2 * len);
+            }
+            return true;
+        });
+    };
+    if (!pass(b.h(), b.w(), stride, 1) || !pass(b.w(), b.h(), 1, stride)) return -3;
+    return 0;
+}
+
+// Morphological gradient: dilate minus erode, the erosion done on a copy
+int gradient(uint8_t* mask, int stride, const Box& b, int r) {
+    if (r <= 0 || b.empty()) return 0;
+    blurcore::PooledBuffer copy = blurcore::acquireBuffer(static_cast<size_t>(b.w()) * b.h());
+    if (!copy) return -3;
+    for (int y = b.y0; y < b.y1; ++y) {
+        std::memcpy(copy.data() + static_cast<size_t>(y - b.y0) * b.w(), mask + static_cast<size_t>(y) * stride + b.x0, b.w());
+    }
+    const Box local = {0, 0, b.w(), b.h()};
+    if (morph(mask, stride, b, r, true) != 0 || morph(copy.data(), b.w(), local, r, false) != 0) return -3;
+    for (int y = b.y0; y < b.y1; ++y) {
+        uint8_t* row = mask + static_cast<size_t>(y) * stride + b.x0;
+        const uint8_t* eroded = copy.data() + static_cast<size_t>(y - b.y0) * b.w();
+        for (int x = 0; x < b.w(); ++x) row[x] = static_cast<uint8_t>(row[x] - eroded[x]);
+    }
+    return 0;
+}
+
+// Union-find over pixel indices: a root holds minus its component size
+int findRoot(int32_t* parent, int32_t i) {
+    while (parent[i] >= 0) {
+        if (parent[parent[i]] >= 0) parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void unite(int32_t* parent, int32_t a, int32_t b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a == b) return;
+    if (parent[a] > parent[b]) std::swap(a, b);
+    parent[a] += parent[b];
+    parent[b] = a;
+}
+
+// Clear 8-connected foreground (> 127) components smaller than minArea.
+// Softer pixels are left alone.
+int removeSmall(uint8_t* mask, int stride, const Box& b, int minArea) {
+    if (minArea <= 1 || b.empty()) return 0;
+    const int w = b.w(), h = b.h();
+    blurcore::PooledBuffer labels = blurcore::acquireBuffer(static_cast<size_t>(w) * h * sizeof(int32_t));
+    if (!labels) return -3;
+    int32_t* parent = reinterpret_cast<int32_t*>(labels.data());
+    auto fg = [&](int x, int y) { return mask[static_cast<size_t>(y + b.y0) * stride + b.x0 + x] > 127; };
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            if (!fg(x, y)) continue;
+            const int32_t i = y * w + x;
+            parent[i] = -1;
+            if (x > 0 && fg(x - 1, y)) unite(parent, i, i - 1);
+            if (y == 0) continue;
+            if (x > 0 && fg(x - 1, y - 1)) unite(parent, i, i - w - 1);
+            if (fg(x, y - 1)) unite(parent, i, i - w);
+            if (x + 1 < w && fg(x + 1, y - 1)) unite(parent, i, i - w + 1);
+        }
+    }
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = mask + static_cast<size_t>(y + b.y0) * stride + b.x0;
+        for (int x = 0; x < w; ++x) {
+            if (row[x] > 127 && -parent[findRoot(parent, y * w + x)] < minArea) row[x] = 0;
+        }
+    }
+    return 0;
+}
+
+const float kFar = 1e30f;
+
+// Squared distance to the nearest feature (f == 0) along one line
+// (Felzenszwalb & Huttenlocher lower envelope of parabolas). f holds kFar
+// or squared distances from the previous axis; d receives the result. v and
+// z are scratch for n and n + 1 values; the intersections are kept in double
+// since q * q alone runs out of float precision on large frames.
+void edtLine(const float* f, int n, float* d, int* v, double* z) {
+    int k = -1;
+    for (int q = 0; q < n; ++q) {
+        if (f[q] >= kFar) continue;
+        double s = -kFar;
+        while (k >= 0) {
+            const int p = v[k];
+            s = ((f[q] + static_cast<double>(q) * q) - (f[p] + static_cast<double>(p) * p)) / (2.0 * (q - p));
+            if (s > z[k]) break;
+            --k;
+        }
+        if (k < 0) s = -kFar;
+        v[++k] = q;
+        z[k] = s;
+    }
+    if (k < 0) {
+        for (int q = 0; q < n; ++q) d[q] = kFar;
+        return;
+    }
+    z[k + 1] = kFar;
+    for (int q = 0, j = 0; q < n; ++q) {
+        while (z[j + 1] < q) ++j;
+        const float dq = static_cast<float>(q - v[j]);
+        d[q] = dq * dq + f[v[j]];
+    }
+}
+
+// 2D squared Euclidean distance transform of grid (w x h), in place:
+// columns first, then rows
+bool edt(float* grid, int w, int h) {
+    auto pass = [&](int lines, int n, ptrdiff_t lineStep, ptrdiff_t step) {
+        return forBands(lines, [&](int l0, int l1) {
+            blurcore::PooledBuffer scratch =
+                blurcore::acquireBuffer((n + 1) * sizeof(double) + 2 * n * sizeof(float) + n * sizeof(int));
+            if (!scratch) return false;
+            double* z = reinterpret_cast<double*>(scratch.data());
+            float* f = reinterpret_cast<float*>(z + n + 1);
+            float* d = f + n;
+            int* v = reinterpret_cast<int*>(d + n);
+            for (int l = l0; l < l1; ++l) {
+                float* line = grid + l * lineStep;
+                for (int i = 0; i < n; ++i) f[i] = line[i * step];
+                edtLine(f, n, d, v, z);
+                for (int i = 0; i < n; ++i) line[i * step] = d[i];
+            }
+            return true;
+        });
+    };
+    return pass(w, h, 1, w) && pass(h, w, w, 1);
+}
+
+// Distance feathering: a foreground pixel (> 127) at distance d from the
+// background gets 255 * min(1, d / inner); a background pixel at distance d
+// from the foreground gets 255 * max(0, 1 - d / outer).
+int feather(uint8_t* mask, int stride, const Box& b, int inner, int outer) {
+    if (b.empty()) return 0;
+    const int w = b.w(), h = b.h();
+    const size_t n = static_cast<size_t>(w) * h;
+    blurcore::PooledBuffer scratch = blurcore::acquireBuffer(n * (sizeof(float) + 1));
+    if (!scratch) return -3;
+    float* grid = reinterpret_cast<float*>(scratch.data());
+    uint8_t* inside = scratch.data() + n * sizeof(float);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = mask + static_cast<size_t>(y + b.y0) * stride + b.x0;
+        for (int x = 0; x < w; ++x) inside[static_cast<size_t>(y) * w + x] = row[x] > 127;
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        // pass 0: distance to the foreground, for background pixels
+        const uint8_t feature = pass == 0 ? 1 : 0;
+        const int ramp = pass == 0 ? outer : inner;
+        for (size_t i = 0; i < n; ++i) grid[i] = inside[i] == feature ? 0.0f : kFar;
+        if (ramp > 0 && !edt(grid, w, h)) return -3;
+        for (int y = 0; y < h; ++y) {
+            uint8_t* row = mask + static_cast<size_t>(y + b.y0) * stride + b.x0;
+            for (int x = 0; x < w; ++x) {
+                const size_t i = static_cast<size_t>(y) * w + x;
+                if (inside[i] == feature) continue;
+                float alpha = pass == 0 ? 0.0f : 1.0f;
+                if (ramp > 0 && grid[i] < static_cast<float>(ramp) * ramp) {
+                    const float t = std::sqrt(grid[i]) / ramp;
+                    alpha = pass == 0 ? 1.0f - t : t;
+                }
+                row[x] = static_cast<uint8_t>(std::lround(alpha * 255.0f));
+            }
+        }
+    }
+    return 0;
+}
+
+// Pixels a step can change beyond the current bounds
+int stepReach(const BlurMaskStep& s) {
+    switch (s.op) {
+    case BLUR_MASK_DILATE:
+    case BLUR_MASK_CLOSE:
+    case BLUR_MASK_GRADIENT:
+        return s.radius;
+    case BLUR_MASK_SMOOTH: {
+        int radii[3];
+        const int passes = blurcore::boxPassRadii(2, s.radius, radii);
+        int reach = 0;
+        for (int i = 0; i < passes; ++i) reach += radii[i];
+        return reach;
+    }
+    case BLUR_MASK_FEATHER:
+        return s.param + 1;
+    default:
+        return 0;
+    }
+}
+
+// Margin around the bounds a step needs to read. Closing erodes what the
+// dilation grew, so it needs background around that too.
+int stepHalo(const BlurMaskStep& s) {
+    switch (s.op) {
+    case BLUR_MASK_ERODE:
+    case BLUR_MASK_OPEN:
+        return s.radius;
+    case BLUR_MASK_CLOSE:
+        return 2 * s.radius;
+    default:
+        return stepReach(s);
+    }
+}
+
+bool validStep(const BlurMaskStep& s) {
+    if (s.radius < 0 || s.param < 0) return false;
+    if (s.op == BLUR_MASK_SMOOTH && s.radius > blurcore::kMaxBoxRadius) return false;
+    return s.op != BLUR_MASK_THRESHOLD || s.param <= 255;
+}
+
+// Mean over a (2r+1)^2 window, truncated at the grid edge, of a w x h float
+// plane, in place: running sums along rows, then a running sum of rows per
+// column band. The cost does not depend on r.
+bool boxMean(float* plane, int w, int h, int r) {
+    const bool rowsOk = forBands(h, [&](int y0, int y1) {
+        blurcore::PooledBuffer scratch = blurcore::acquireBuffer(static_cast<size_t>(w) * sizeof(float));
+        if (!scratch) return false;
+        float* tmp = reinterpret_cast<float*>(scratch.data());
+        for (int y = y0; y < y1; ++y) {
+            float* row = plane + static_cast<size_t>(y) * w;
+            double sum = 0.0;
+            for (int x = 0; x < std::min(r, w); ++x) sum += row[x];
+            for (int x = 0; x < w; ++x) {
+                if (x + r < w) sum += row[x + r];
+                if (x - r - 1 >= 0) sum -= row[x - r - 1];
+                tmp[x] = static_cast<float>(sum / (std::min(x + r, w - 1) - std::max(x - r, 0) + 1));
+            }
+            std::memcpy(row, tmp, static_cast<size_t>(w) * sizeof(float));
+        }
+        return true;
+    });
+    if (!rowsOk) return false;
+    return forBands(w, [&](int x0, int x1) {
+        const int n = x1 - x0;
+        blurcore::PooledBuffer scratch =
+            blurcore::acquireBuffer(static_cast<size_t>(n) * sizeof(double) + static_cast<size_t>(n) * h * sizeof(float));
+        if (!scratch) return false;
+        double* acc = reinterpret_cast<double*>(scratch.data());
+        float* out = reinterpret_cast<float*>(acc + n);
+        std::fill(acc, acc + n, 0.0);
+        for (int y = 0; y < std::min(r, h); ++y) {
+            const float* row = plane + static_cast<size_t>(y) * w + x0;
+            for (int i = 0; i < n; ++i) acc[i] += row[i];
+        }
+        for (int y = 0; y < h; ++y) {
+            if (y + r < h) {
+                const float* row = plane + static_cast<size_t>(y + r) * w + x0;
+                for (int i = 0; i < n; ++i) acc[i] += row[i];
+            }
+            if (y - r - 1 >= 0) {
+                const float* row = plane + static_cast<size_t>(y - r - 1) * w + x0;
+                for (int i = 0; i < n; ++i) acc[i] -= row[i];
+            }
+            const double count = std::min(y + r, h - 1) - std::max(y - r, 0) + 1;
+            for (int i = 0; i < n; ++i) out[static_cast<size_t>(y) * n + i] = static_cast<float>(acc[i] / count);
+        }
+        for (int y = 0; y < h; ++y) {
+            std::memcpy(plane + static_cast<size_t>(y) * w + x0, out + static_cast<size_t>(y) * n, n * sizeof(float));
+        }
+        return true;
+    });
+}
+
+int guideChannels(int format) {
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: return 4;
+    case BLUR_FORMAT_RGB888: return 3;
+    case BLUR_FORMAT_GRAY8: return 1;
+    default: return 0;
+    }
+}
+
+} // namespace
+
+extern "C" int blur_mask_process(BlurContext* ctx, uint8_t* mask, int width, int height, int stride,
+                                 const BlurMaskStep* steps, int step_count) {
+    if (!mask || width <= 0 || height <= 0 || step_count < 0 || (step_count > 0 && !steps)) return -1;
+    if (stride == 0) stride = width;
+    if (stride < width) return -1;
+    for (int i = 0; i < step_count; ++i) {
+        if (steps[i].op < BLUR_MASK_DILATE || steps[i].op > BLUR_MASK_GRADIENT) return -2;
+        if (!validStep(steps[i])) return -1;
+    }
+    blurcore::CancelScope cancelScope(ctx); // one request across all steps
+
+    const Box frame = {0, 0, width, height};
+    Box bounds = nonZeroBounds(mask, stride, frame);
+    for (int i = 0; i < step_count && !bounds.empty(); ++i) {
+        BlurMaskStep s = steps[i];
+        // Windows wider than the frame behave like the frame
+        if (s.op != BLUR_MASK_SMOOTH) {
+            s.radius = std::min(s.radius, std::max(width, height));
+            if (s.op == BLUR_MASK_FEATHER) s.param = std::min(s.param, std::max(width, height));
+        }
+        const Box work = grow(bounds, stepHalo(s), width, height);
+        int rc = 0;
+        if (s.op == BLUR_MASK_SMOOTH) {
+            // The copy of the rect is clamped at its edges, which are still
+            // background, so this matches a full-frame gaussian
+            const BlurRect rect = {work.x0, work.y0, work.w(), work.h()};
+            rc = s.radius > 0 ? blur_apply_regions_ex(ctx, mask, width, height, stride, BLUR_FORMAT_GRAY8,
+                                                      &rect, 1, 2, s.radius)
+                              : 0;
+        } else {
+            blurcore::StageScope stage(BLUR_STAGE_MASK, static_cast<int64_t>(work.w()) * work.h());
+            switch (s.op) {
+            case BLUR_MASK_DILATE: rc = morph(mask, stride, work, s.radius, true); break;
+            case BLUR_MASK_ERODE: rc = morph(mask, stride, work, s.radius, false); break;
+            case BLUR_MASK_OPEN:
+                rc = morph(mask, stride, work, s.radius, false);
+                if (rc == 0) rc = morph(mask, stride, work, s.radius, true);
+                break;
+            case BLUR_MASK_CLOSE:
+                rc = morph(mask, stride, work, s.radius, true);
+                if (rc == 0) rc = morph(mask, stride, work, s.radius, false);
+                break;
+            case BLUR_MASK_REMOVE_SMALL: rc = removeSmall(mask, stride, work, s.param); break;
+            case BLUR_MASK_FEATHER: rc = feather(mask, stride, work, s.radius, s.param); break;
+            case BLUR_MASK_THRESHOLD:
+                for (int y = work.y0; y < work.y1; ++y) {
+                    uint8_t* row = mask + static_cast<size_t>(y) * stride;
+                    for (int x = work.x0; x < work.x1; ++x) row[x] = row[x] > s.param ? 255 : 0;
+                }
+                break;
+            default: rc = gradient(mask, stride, work, s.radius); break;
+            }
+        }
+        if (rc != 0) return rc;
+        bounds = nonZeroBounds(mask, stride, grow(bounds, stepReach(s), width, height));
+    }
+    return 0;
+}
+
+extern "C" int blur_mask_refine_guided(uint8_t* mask, int width, int height, int mask_stride, const uint8_t* guide,
+                                       int guide_stride, int guide_format, int radius, float eps) {
+    const int bpp = guideChannels(guide_format);
+    if (!mask || !guide || width <= 0 || height <= 0 || radius < 1) return -1;
+    if (!blurcore::isFiniteFloat(eps) || !(eps > 0.0f)) return -1;
+    if (bpp == 0) return guide_format == BLUR_FORMAT_NV21 ? -2 : -1;
+    if (mask_stride == 0) mask_stride = width;
+    if (guide_stride == 0) guide_stride = width * bpp;
+    if (mask_stride < width || guide_stride < width * bpp) return -1;
+    radius = std::min(radius, std::max(width, height));
+
+    // Background stays 0 beyond twice the radius of the mask, so only that
+    // box is filtered (plus a radius of context for the windows)
+    const Box frame = {0, 0, width, height};
+    const Box b = grow(nonZeroBounds(mask, mask_stride, frame), 3 * radius, width, height);
+    if (b.empty()) return 0;
+    blurcore::StageScope stage(BLUR_STAGE_MASK, static_cast<int64_t>(b.w()) * b.h());
+
+    // Fast guided filter: the coefficients are smooth, so they are fitted
+    // on a grid subsampled by s (bounded to about a megapixel) and applied
+    // at full resolution against the full-resolution guide
+    const int64_t area = static_cast<int64_t>(b.w()) * b.h();
+    int s = std::max(radius / 4, static_cast<int>(std::ceil(std::sqrt(area / 1048576.0))));
+    s = std::min(std::max(s, 1), radius);
+    const int lw = (b.w() + s - 1) / s, lh = (b.h() + s - 1) / s, lr = std::max(1, (radius + s / 2) / s);
+    const size_t n = static_cast<size_t>(lw) * lh;
+
+    // Planes: guide (c), mask, guide products (c(c+1)/2), guide x mask (c)
+    const int c = bpp == 1 ? 1 : 3;
+    const int red = guide_format == BLUR_FORMAT_BGRA8888 ? 2 : 0, blue = c == 1 ? 0 : 2 - red;
+    const int channel[3] = {red, c == 1 ? 0 : 1, blue};
+    const int pairs = c * (c + 1) / 2, planes = c + 1 + pairs + c;
+    blurcore::PooledBuffer storage = blurcore::acquireBuffer(n * planes * sizeof(float));
+    if (!storage) return -3;
+    float* plane = reinterpret_cast<float*>(storage.data());
+    auto P = [&](int i) { return plane + static_cast<size_t>(i) * n; };
+
+    forBands(lh, [&](int y0, int y1) {
+        for (int ly = y0; ly < y1; ++ly) {
+            for (int lx = 0; lx < lw; ++lx) {
+                float g[3] = {0.0f, 0.0f, 0.0f}, p = 0.0f;
+                const int px0 = b.x0 + lx * s, py0 = b.y0 + ly * s;
+                const int px1 = std::min(px0 + s, b.x1), py1 = std::min(py0 + s, b.y1);
+                for (int y = py0; y < py1; ++y) {
+                    const uint8_t* gr = guide + static_cast<ptrdiff_t>(y) * guide_stride;
+                    const uint8_t* mr = mask + static_cast<ptrdiff_t>(y) * mask_stride;
+                    for (int x = px0; x < px1; ++x) {
+                        for (int k = 0; k < c; ++k) g[k] += gr[x * bpp + channel[k]];
+                        p += mr[x];
+                    }
+                }
+                const float scale = 1.0f / (255.0f * (px1 - px0) * (py1 - py0));
+                const size_t i = static_cast<size_t>(ly) * lw + lx;
+                p *= scale;
+                int q = 0;
+                for (int k = 0; k < c; ++k) P(k)[i] = g[k] *= scale;
+                P(c)[i] = p;
+                for (int k = 0; k < c; ++k)
+                    for (int j = k; j < c; ++j) P(c + 1 + q++)[i] = g[k] * g[j];
+                for (int k = 0; k < c; ++k) P(c + 1 + pairs + k)[i] = g[k] * p;
+            }
+        }
+        return true;
+    });
+    for (int i = 0; i < planes; ++i) {
+        if (!boxMean(P(i), lw, lh, lr)) return -3;
+    }
+
+    // Per window: a = (cov(I) + eps)^-1 cov(I, p), b = mean(p) - a . mean(I),
+    // written over the first c + 1 planes
+    forBands(lh, [&](int y0, int y1) {
+        for (size_t i = static_cast<size_t>(y0) * lw; i < static_cast<size_t>(y1) * lw; ++i) {
+            double mI[3], cov[3][3], cIp[3];
+            const double mp = P(c)[i];
+            int q = 0;
+            for (int k = 0; k < c; ++k) mI[k] = P(k)[i];
+            for (int k = 0; k < c; ++k)
+                for (int j = k; j < c; ++j) {
+                    cov[k][j] = cov[j][k] = P(c + 1 + q++)[i] - mI[k] * mI[j] + (k == j ? eps : 0.0);
+                }
+            for (int k = 0; k < c; ++k) cIp[k] = P(c + 1 + pairs + k)[i] - mI[k] * mp;
+            double a[3];
+            if (c == 1) {
+                a[0] = cIp[0] / cov[0][0];
+            } else {
+                // Symmetric 3x3 inverse by cofactors; eps keeps it positive definite
+                const double i00 = cov[1][1] * cov[2][2] - cov[1][2] * cov[1][2];
+                const double i01 = cov[0][2] * cov[1][2] - cov[0][1] * cov[2][2];
+                const double i02 = cov[0][1] * cov[1][2] - cov[0][2] * cov[1][1];
+                const double i11 = cov[0][0] * cov[2][2] - cov[0][2] * cov[0][2];
+                const double i12 = cov[0][1] * cov[0][2] - cov[0][0] * cov[1][2];
+                const double i22 = cov[0][0] * cov[1][1] - cov[0][1] * cov[0][1];
+                const double det = cov[0][0] * i00 + cov[0][1] * i01 + cov[0][2] * i02;
+                a[0] = (i00 * cIp[0] + i01 * cIp[1] + i02 * cIp[2]) / det;
+                a[1] = (i01 * cIp[0] + i11 * cIp[1] + i12 * cIp[2]) / det;
+                a[2] = (i02 * cIp[0] + i12 * cIp[1] + i22 * cIp[2]) / det;
+            }
+            double bias = mp;
+            for (int k = 0; k < c; ++k) {
+                P(k)[i] = static_cast<float>(a[k]);
+                bias -= a[k] * mI[k];
+            }
+            P(c)[i] = static_cast<float>(bias);
+        }
+        return true;
+    });
+    for (int i = 0; i <= c; ++i) {
+        if (!boxMean(P(i), lw, lh, lr)) return -3;
+    }
+
+    // q = mean(a) . I + mean(b), with the coefficients interpolated
+    // bilinearly between the subsampled grid's cell centres
+    forBands(b.h(), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const float fy = std::min(std::max((y + 0.5f) / s - 0.5f, 0.0f), static_cast<float>(lh - 1));
+            const int ly0 = static_cast<int>(fy), ly1 = std::min(ly0 + 1, lh - 1);
+            const float wy = fy - ly0;
+            const uint8_t* gr = guide + static_cast<ptrdiff_t>(b.y0 + y) * guide_stride;
+            uint8_t* mr = mask + static_cast<ptrdiff_t>(b.y0 + y) * mask_stride;
+            for (int x = 0; x < b.w(); ++x) {
+                const float fx = std::min(std::max((x + 0.5f) / s - 0.5f, 0.0f), static_cast<float>(lw - 1));
+                const int lx0 = static_cast<int>(fx), lx1 = std::min(lx0 + 1, lw - 1);
+                const float wx = fx - lx0;
+                const size_t i00 = static_cast<size_t>(ly0) * lw + lx0, i01 = static_cast<size_t>(ly0) * lw + lx1;
+                const size_t i10 = static_cast<size_t>(ly1) * lw + lx0, i11 = static_cast<size_t>(ly1) * lw + lx1;
+                auto at = [&](int k) {
+                    const float* pl = P(k);
+                    return (pl[i00] * (1.0f - wx) + pl[i01] * wx) * (1.0f - wy) + (pl[i10] * (1.0f - wx) + pl[i11] * wx) * wy;
+                };
+                float q = at(c);
+                const int px = b.x0 + x;
+                for (int k = 0; k < c; ++k) q += at(k) * (gr[px * bpp + channel[k]] / 255.0f);
+                mr[px] = static_cast<uint8_t>(std::lround(std::min(std::max(q, 0.0f), 1.0f) * 255.0f));
+            }
+        }
+        return true;
+    });
+    return 0;
+}
@@ -0,0 +1,279 @@
+// Seamless (Poisson) compositing, blur_composite_poisson. Inside the mask
+// the result keeps the gradients of src while meeting dst on the mask edge:
+// writing it as src + c, the correction c is the membrane that solves
+// Laplace(c) = 0 with c = dst - src outside the mask. The solve is a
+// correction-scheme multigrid over the mask's bounding box only: red-black
+// Gauss-Seidel smoothing, residuals restricted 2x2 to a coarser grid,
+// corrections interpolated back bilinearly. A few V-cycles cost a few dozen
+// linear passes, so runtime grows with the masked area, not with the
+// smoothing radius.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include "blur.h"
+#include "buffer_pool.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace {
+
+const int kDefaultCycles = 4;
+const int kSmoothSteps = 2;    // red-black sweeps before and after each coarse correction
+const int kCoarsestSteps = 40;
+const int kCoarsestSize = 8;   // stop coarsening once both sides fit
+
+struct Level {
+    int w = 0, h = 0;
+    blurcore::PooledBuffer storage;
+    float* u = nullptr;     // current solution (fixed cells hold their boundary value)
+    float* f = nullptr;     // right-hand side
+    float* r = nullptr;     // residual scratch
+    uint8_t* free = nullptr; // 1 where u is unknown
+
+    // Zeroed arrays for a w x h grid; false if out of memory
+    bool allocate(int width, int height) {
+        w = width;
+        h = height;
+        const size_t n = static_cast<size_t>(w) * h;
+        storage = blurcore::acquireBuffer(n * (3 * sizeof(float) + 1));
+        if (!storage) return false;
+        std::memset(storage.data(), 0, storage.size());
+        u = reinterpret_cast<float*>(storage.data());
+        f = u + n;
+        r = f + n;
+        free = reinterpret_cast<uint8_t*>(r + n);
+        return true;
+    }
+};
+
+// Row bands on the shared pool, a few per thread
+void forRows(int h, const std::function<void(int, int)>& fn) {
+    const int bands = std::max(1, std::min(h, 4 * blurcore::configuredThreadCount()));
+    blurcore::parallelFor(bands, [&](int i) {
+        fn(static_cast<int>(static_cast<int64_t>(h) * i / bands),
+           static_cast<int>(static_cast<int64_t>(h) * (i + 1) / bands));
+    });
+}
+
+// Neighbour sum and count of the 5-point stencil; missing neighbours at the
+// grid edge drop out (zero-flux boundary)
+inline float neighbours(const Level& L, int x, int y, int& n) {
+    const float* u = L.u + static_cast<size_t>(y) * L.w;
+    float s = 0.0f;
+    n = 0;
+    if (x > 0) { s += u[x - 1]; ++n; }
+    if (x + 1 < L.w) { s += u[x + 1]; ++n; }
+    if (y > 0) { s += u[x - L.w]; ++n; }
+    if (y + 1 < L.h) { s += u[x + L.w]; ++n; }
+    return s;
+}
+
+void smooth(Level& L, int sweeps) {
+    for (int it = 0; it < sweeps; ++it) {
+        for (int colour = 0; colour < 2; ++colour) {
+            forRows(L.h, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y) {
+                    const size_t row = static_cast<size_t>(y) * L.w;
+                    for (int x = (y + colour) & 1; x < L.w; x += 2) {
+                        if (!L.free[row + x]) continue;
+                        int n;
+                        const float s = neighbours(L, x, y, n);
+                        if (n) L.u[row + x] = (s - L.f[row + x]) / n;
+                    }
+                }
+            });
+        }
+    }
+}
+
+void residual(Level& L) {
+    forRows(L.h, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const size_t row = static_cast<size_t>(y) * L.w;
+            for (int x = 0; x < L.w; ++x) {
+                if (!L.free[row + x]) {
+                    L.r[row + x] = 0.0f;
+                    continue;
+                }
+                int n;
+                const float s = neighbours(L, x, y, n);
+                L.r[row + x] = L.f[row + x] - (s - n * L.u[row + x]);
+            }
+        }
+    });
+}
+
+// Coarse grid: a cell is unknown only if all of its 2x2 children are; a
+// coarse domain reaching past the fine one over-corrects near the edge and
+// the cycle diverges. Its right-hand side (restrictResidual) is the
+// children's mean residual scaled by the grid spacing squared (4).
+bool coarsen(const Level& fine, Level& coarse) {
+    if (!coarse.allocate((fine.w + 1) / 2, (fine.h + 1) / 2)) return false;
+    for (int y = 0; y < coarse.h; ++y) {
+        for (int x = 0; x < coarse.w; ++x) {
+            bool all = true;
+            for (int fy = 2 * y; fy < std::min(2 * y + 2, fine.h); ++fy) {
+                for (int fx = 2 * x; fx < std::min(2 * x + 2, fine.w); ++fx) {
+                    all = all && fine.free[static_cast<size_t>(fy) * fine.w + fx];
+                }
+            }
+            coarse.free[static_cast<size_t>(y) * coarse.w + x] = all;
+        }
+    }
+    return true;
+}
+
+void restrictResidual(const Level& fine, Level& coarse) {
+    forRows(coarse.h, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < coarse.w; ++x) {
+                const size_t i = static_cast<size_t>(y) * coarse.w + x;
+                coarse.u[i] = 0.0f;
+                if (!coarse.free[i]) {
+                    coarse.f[i] = 0.0f;
+                    continue;
+                }
+                float s = 0.0f;
+                int n = 0;
+                for (int fy = 2 * y; fy < std::min(2 * y + 2, fine.h); ++fy) {
+                    for (int fx = 2 * x; fx < std::min(2 * x + 2, fine.w); ++fx) {
+                        s += fine.r[static_cast<size_t>(fy) * fine.w + fx];
+                        ++n;
+                    }
+                }
+                coarse.f[i] = 4.0f * s / n;
+            }
+        }
+    });
+}
+
+// Add the coarse correction to the unknown fine cells, bilinearly between
+// the four nearest coarse cell centres (fixed coarse cells count as 0)
+void prolongate(const Level& coarse, Level& fine) {
+    forRows(fine.h, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const int cy0 = std::max((y - 1) / 2, 0), cy1 = std::min((y + 1) / 2, coarse.h - 1);
+            const float wy = cy0 == cy1 ? 0.0f : ((y & 1) ? 0.25f : 0.75f);
+            for (int x = 0; x < fine.w; ++x) {
+                const size_t i = static_cast<size_t>(y) * fine.w + x;
+                if (!fine.free[i]) continue;
+                const int cx0 = std::max((x - 1) / 2, 0), cx1 = std::min((x + 1) / 2, coarse.w - 1);
+                const float wx = cx0 == cx1 ? 0.0f : ((x & 1) ? 0.25f : 0.75f);
+                auto at = [&](int cx, int cy) {
+                    const size_t c = static_cast<size_t>(cy) * coarse.w + cx;
+                    return coarse.free[c] ? coarse.u[c] : 0.0f;
+                };
+                const float top = at(cx0, cy0) * (1.0f - wx) + at(cx1, cy0) * wx;
+                const float bottom = at(cx0, cy1) * (1.0f - wx) + at(cx1, cy1) * wx;
+                fine.u[i] += top * (1.0f - wy) + bottom * wy;
+            }
+        }
+    });
+}
+
+void vCycle(std::vector<Level>& levels, size_t l) {
+    Level& L = levels[l];
+    if (l + 1 == levels.size()) {
+        smooth(L, kCoarsestSteps);
+        return;
+    }
+    smooth(L, kSmoothSteps);
+    residual(L);
+    restrictResidual(L, levels[l + 1]);
+    vCycle(levels, l + 1);
+    prolongate(levels[l + 1], L);
+    smooth(L, kSmoothSteps);
+}
+
+int bytesPerPixel(int format) {
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: return 4;
+    case BLUR_FORMAT_RGB888: return 3;
+    case BLUR_FORMAT_GRAY8: return 1;
+    default: return 0;
+    }
+}
+
+} // namespace
+
+extern "C" int blur_composite_poisson(uint8_t* dst, const uint8_t* src, int width, int height, int stride,
+                                      int format, const uint8_t* mask, int mask_stride, int cycles) {
+    const int bpp = bytesPerPixel(format);
+    if (!dst || !src || !mask || width <= 0 || height <= 0 || cycles < 0) return -1;
+    if (bpp == 0) return format == BLUR_FORMAT_NV21 ? -2 : -1;
+    if (stride == 0) stride = width * bpp;
+    if (mask_stride == 0) mask_stride = width;
+    if (stride < width * bpp || mask_stride < width) return -1;
+    if (cycles == 0) cycles = kDefaultCycles;
+
+    // The solve covers the mask's bounding box and a one pixel ring of
+    // boundary values around it
+    int bx0 = width, by0 = height, bx1 = 0, by1 = 0;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = mask + static_cast<ptrdiff_t>(y) * mask_stride;
+        for (int x = 0; x < width; ++x) {
+            if (!row[x]) continue;
+            bx0 = std::min(bx0, x);
+            bx1 = std::max(bx1, x + 1);
+            by0 = std::min(by0, y);
+            by1 = y + 1;
+        }
+    }
+    if (bx0 >= bx1) return 0;
+    bx0 = std::max(bx0 - 1, 0);
+    by0 = std::max(by0 - 1, 0);
+    bx1 = std::min(bx1 + 1, width);
+    by1 = std::min(by1 + 1, height);
+
+    blurcore::StageScope stage(BLUR_STAGE_BLEND);
+    std::vector<Level> levels(1);
+    if (!levels[0].allocate(bx1 - bx0, by1 - by0)) return -3;
+    for (int y = 0; y < levels[0].h; ++y) {
+        const uint8_t* m = mask + static_cast<ptrdiff_t>(by0 + y) * mask_stride + bx0;
+        uint8_t* fr = levels[0].free + static_cast<size_t>(y) * levels[0].w;
+        for (int x = 0; x < levels[0].w; ++x) fr[x] = m[x] != 0;
+    }
+    while (levels.back().w > kCoarsestSize || levels.back().h > kCoarsestSize) {
+        Level coarse;
+        if (!coarsen(levels.back(), coarse)) return -3;
+        levels.push_back(std::move(coarse));
+    }
+
+    // Colour channels only; alpha stays as in dst
+    const int channels = bpp == 4 ? 3 : bpp;
+    Level& top = levels.front();
+    for (int c = 0; c < channels; ++c) {
+        for (int y = 0; y < top.h; ++y) {
+            const size_t off = static_cast<size_t>(by0 + y) * stride + static_cast<size_t>(bx0) * bpp + c;
+            const uint8_t* d = dst + off;
+            const uint8_t* s = src + off;
+            float* u = top.u + static_cast<size_t>(y) * top.w;
+            const uint8_t* fr = top.free + static_cast<size_t>(y) * top.w;
+            for (int x = 0; x < top.w; ++x) u[x] = fr[x] ? 0.0f : static_cast<float>(d[x * bpp]) - s[x * bpp];
+        }
+        for (int i = 0; i < cycles; ++i) vCycle(levels, 0);
+
+        // Write src + c, faded into dst by the mask's soft edge
+        forRows(top.h, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                const size_t off = static_cast<size_t>(by0 + y) * stride + static_cast<size_t>(bx0) * bpp + c;
+                uint8_t* d = dst + off;
+                const uint8_t* s = src + off;
+                const uint8_t* m = mask + static_cast<ptrdiff_t>(by0 + y) * mask_stride + bx0;
+                const float* u = top.u + static_cast<size_t>(y) * top.w;
+                for (int x = 0; x < top.w; ++x) {
+                    if (!m[x]) continue;
+                    const float v = std::min(std::max(s[x * bpp] + u[x], 0.0f), 255.0f);
+                    const float a = m[x] / 255.0f;
+                    d[x * bpp] = static_cast<uint8_t>(std::lround(v * a + d[x * bpp] * (1.0f - a)));
+                }
+            }
+        });
+    }
+    return 0;
+}
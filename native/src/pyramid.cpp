@@ -0,0 +1,156 @@
+// Preview pyramid: the source halved up to kMaxLevels times, built once per
+// image. A preview blurs the smallest level that still fills the viewport,
+// with rects and strength scaled to it, so its cost follows the screen size
+// instead of the photo size.
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include "blur.h"
+#include "buffer_pool.h"
+#include "cancel.h"
+
+namespace {
+
+const int kMaxLevels = 3; // half, quarter, eighth
+
+struct Level {
+    int width = 0;
+    int height = 0;
+    blurcore::PooledBuffer pixels; // packed RGBA
+};
+
+// 2x2 box average with rounding. An odd last row/column averages with
+// itself, so the image edge is not darkened.
+void halve(const uint8_t* src, int sw, int sh, ptrdiff_t stride, Level& dst) {
+    dst.width = (sw + 1) / 2;
+    dst.height = (sh + 1) / 2;
+    for (int y = 0; y < dst.height; ++y) {
+        const uint8_t* r0 = src + (2 * y) * stride;
+        const uint8_t* r1 = src + (2 * y + 1 < sh ? 2 * y + 1 : 2 * y) * stride;
+        uint8_t* out = dst.pixels.data() + static_cast<ptrdiff_t>(y) * dst.width * 4;
+        for (int x = 0; x < dst.width; ++x) {
+            const int x0 = 2 * x * 4;
+            const int x1 = (2 * x + 1 < sw ? 2 * x + 1 : 2 * x) * 4;
+            for (int c = 0; c < 4; ++c) {
+                out[x * 4 + c] = static_cast<uint8_t>(
+                    (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
+
+// floor(v / 2^level), also for negative v
+int scaleDown(int v, int level) { return v >> level; }
+
+int scaleUp(int v, int level) { return -((-v) >> level); }
+
+} // namespace
+
+struct BlurPyramid {
+    int width;
+    int height;
+    int levels;
+    Level level[kMaxLevels + 1]; // [0] unused: the caller keeps the source
+};
+
+extern "C" BlurPyramid* blur_pyramid_create(const uint8_t* pixels, int width, int height, int stride,
+                                             int levels) {
+    if (!pixels || width <= 0 || height <= 0) return nullptr;
+    if (stride == 0) stride = width * 4;
+    if (stride < width * 4) return nullptr;
+    if (levels <= 0 || levels > kMaxLevels) levels = kMaxLevels;
+
+    std::unique_ptr<BlurPyramid> p(new (std::nothrow) BlurPyramid());
+    if (!p) return nullptr;
+    p->width = width;
+    p->height = height;
+    p->levels = 0;
+
+    const uint8_t* src = pixels;
+    ptrdiff_t srcStride = stride;
+    int sw = width, sh = height;
+    for (int l = 1; l <= levels && (sw > 1 || sh > 1); ++l) {
+        Level& lv = p->level[l];
+        const size_t bytes = static_cast<size_t>((sw + 1) / 2) * ((sh + 1) / 2) * 4;
+        lv.pixels = blurcore::acquireBuffer(bytes);
+        if (!lv.pixels) return nullptr;
+        halve(src, sw, sh, srcStride, lv);
+        p->levels = l;
+
+        src = lv.pixels.data();
+        sw = lv.width;
+        sh = lv.height;
+        srcStride = static_cast<ptrdiff_t>(sw) * 4;
+    }
+    return p.release();
+}
+
+extern "C" void blur_pyramid_destroy(BlurPyramid* pyramid) {
+    delete pyramid;
+}
+
+extern "C" int blur_pyramid_levels(const BlurPyramid* pyramid) {
+    return pyramid ? pyramid->levels : 0;
+}
+
+extern "C" int blur_pyramid_level_size(const BlurPyramid* pyramid, int level, int* width, int* height) {
+    if (!pyramid || level < 0 || level > pyramid->levels) return -1;
+    if (width) *width = level == 0 ? pyramid->width : pyramid->level[level].width;
+    if (height) *height = level == 0 ? pyramid->height : pyramid->level[level].height;
+    return 0;
+}
+
+extern "C" int blur_pyramid_level_for(const BlurPyramid* pyramid, int viewport_width, int viewport_height) {
+    if (!pyramid) return 0;
+    const float scale = blur_governor_preview_scale();
+    viewport_width = static_cast<int>(std::ceil(viewport_width * scale));
+    viewport_height = static_cast<int>(std::ceil(viewport_height * scale));
+    int best = 0;
+    for (int l = 1; l <= pyramid->levels; ++l) {
+        if (pyramid->level[l].width < viewport_width || pyramid->level[l].height < viewport_height) break;
+        best = l;
+    }
+    return best;
+}
+
+extern "C" int blur_pyramid_preview(BlurPyramid* pyramid, BlurContext* ctx, int level,
+                                     uint8_t* dst, int dst_stride,
+                                     const BlurRect* rects, int rect_count,
+                                     int mode, int strength) {
+    if (!pyramid || !dst || level < 1 || level > pyramid->levels) return -1;
+    const Level& lv = pyramid->level[level];
+    if (dst_stride == 0) dst_stride = lv.width * 4;
+    if (dst_stride < lv.width * 4) return -1;
+
+    for (int y = 0; y < lv.height; ++y) {
+        std::memcpy(dst + static_cast<ptrdiff_t>(y) * dst_stride,
+                    lv.pixels.data() + static_cast<ptrdiff_t>(y) * lv.width * 4, static_cast<size_t>(lv.width) * 4);
+    }
+    if (!rects || rect_count <= 0) return 0;
+    blurcore::CancelScope cancelScope(ctx); // one request across the rect batches
+
+    // Scale rects outwards so the preview covers at least the full-res area
+    const int kMaxPreviewRects = 64;
+    BlurRect scaled[kMaxPreviewRects];
+    int done = 0;
+    while (done < rect_count) {
+        const int n = rect_count - done < kMaxPreviewRects ? rect_count - done : kMaxPreviewRects;
+        for (int i = 0; i < n; ++i) {
+            const BlurRect& r = rects[done + i];
+            const int x0 = scaleDown(r.x, level), y0 = scaleDown(r.y, level);
+            scaled[i].x = x0;
+            scaled[i].y = y0;
+            scaled[i].w = r.w > 0 ? scaleUp(r.x + r.w, level) - x0 : 0;
+            scaled[i].h = r.h > 0 ? scaleUp(r.y + r.h, level) - y0 : 0;
+        }
+        const int s = (strength + (1 << (level - 1))) >> level;
+        const int rc = blur_apply_regions_ex(ctx, dst, lv.width, lv.height, dst_stride, BLUR_FORMAT_RGBA8888,
+                                             scaled, n, mode, s < 1 ? 1 : s);
+        if (rc != 0) return rc;
+        done += n;
+    }
+    return 0;
+}
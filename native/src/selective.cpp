@@ -0,0 +1,190 @@
+// Mask-weighted blend of two blur strengths (portrait mode): the result is
+// fg * m + bg * (1 - m) per pixel, in 8-bit fixed point. The mask is split
+// into tiles first, and a layer is only blurred where some tile actually
+// uses it, so the uniform parts of a portrait mask (usually most of it)
+// cost one copy or nothing.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "blur.h"
+#include "blur_kernels.h"
+#include "buffer_pool.h"
+#include "cancel.h"
+#include "thread_pool.h"
+#include "tile_scheduler.h"
+#include "trace.h"
+
+namespace {
+
+const int kTile = 64;
+
+enum TileState : uint8_t { kAllBackground, kAllForeground, kMixed };
+
+// One blurred layer over a horizontal run of tiles, interior only.
+struct Run {
+    int x0, y0, x1, y1; // pixel bounds, exclusive end
+    blurcore::PooledBuffer pixels; // packed, (x1 - x0) * bpp per row
+};
+
+struct Layer {
+    int strength;
+    std::vector<int> runOfTile; // -1: tile does not use this layer
+    std::vector<Run> runs;
+
+    const uint8_t* row(int tile, int x, int y, int bpp) const {
+        const Run& r = runs[runOfTile[tile]];
+        return r.pixels.data() + (static_cast<size_t>(y - r.y0) * (r.x1 - r.x0) + (x - r.x0)) * bpp;
+    }
+};
+
+// Blur every tile run that needs this layer. Each run is copied out with a
+// halo of the total pass radius, so clamping at the copy edge never reaches
+// the interior and the result equals a full-image blur there.
+int blurLayer(BlurContext* ctx, const uint8_t* pixels, int width, int height, int stride, int format, int bpp,
+              int tilesX, int tilesY, const std::vector<uint8_t>& needed, int mode, Layer& layer) {
+    int radii[3];
+    const int passes = blurcore::boxPassRadii(mode, layer.strength, radii);
+    int halo = 0;
+    for (int i = 0; i < passes; ++i) halo += radii[i];
+    halo = std::min(halo, std::max(width, height));
+
+    blurcore::PooledBuffer scratch;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            if (!needed[ty * tilesX + tx]) continue;
+            int end = tx;
+            while (end + 1 < tilesX && needed[ty * tilesX + end + 1]) ++end;
+
+            Run run;
+            run.x0 = tx * kTile;
+            run.y0 = ty * kTile;
+            run.x1 = std::min((end + 1) * kTile, width);
+            run.y1 = std::min((ty + 1) * kTile, height);
+            const int hx0 = std::max(run.x0 - halo, 0), hy0 = std::max(run.y0 - halo, 0);
+            const int hx1 = std::min(run.x1 + halo, width), hy1 = std::min(run.y1 + halo, height);
+            const int hw = hx1 - hx0, hh = hy1 - hy0;
+
+            const size_t scratchBytes = static_cast<size_t>(hw) * hh * bpp;
+            if (scratch.capacity() < scratchBytes) {
+                scratch.reset();
+                scratch = blurcore::acquireBuffer(scratchBytes);
+                if (!scratch) return -3;
+            }
+            {
+                blurcore::StageScope stage(BLUR_STAGE_COPY_IN, static_cast<int64_t>(scratchBytes));
+                for (int y = 0; y < hh; ++y) {
+                    std::memcpy(scratch.data() + static_cast<size_t>(y) * hw * bpp,
+                                pixels + static_cast<ptrdiff_t>(hy0 + y) * stride + static_cast<ptrdiff_t>(hx0) * bpp,
+                                static_cast<size_t>(hw) * bpp);
+                }
+            }
+            if (passes > 0) {
+                const BlurRect all = {0, 0, hw, hh};
+                const int rc = blur_apply_regions_ex(ctx, scratch.data(), hw, hh, 0, format, &all, 1, mode,
+                                                     layer.strength);
+                if (rc != 0) return rc;
+            }
+
+            const int rw = run.x1 - run.x0;
+            run.pixels = blurcore::acquireBuffer(static_cast<size_t>(rw) * (run.y1 - run.y0) * bpp);
+            if (!run.pixels) return -3;
+            blurcore::StageScope stage(BLUR_STAGE_COPY_OUT, static_cast<int64_t>(run.pixels.size()));
+            for (int y = run.y0; y < run.y1; ++y) {
+                std::memcpy(run.pixels.data() + static_cast<size_t>(y - run.y0) * rw * bpp,
+                            scratch.data() + (static_cast<size_t>(y - hy0) * hw + (run.x0 - hx0)) * bpp,
+                            static_cast<size_t>(rw) * bpp);
+            }
+            for (int t = tx; t <= end; ++t) layer.runOfTile[ty * tilesX + t] = static_cast<int>(layer.runs.size());
+            layer.runs.push_back(std::move(run));
+            tx = end;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+extern "C" int blur_apply_masked(BlurContext* ctx, uint8_t* pixels, int width, int height, int stride,
+                                 int format, const uint8_t* mask, int mask_stride,
+                                 int mode, int fg_strength, int bg_strength) {
+    int bpp = 0;
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: bpp = 4; break;
+    case BLUR_FORMAT_RGB888: bpp = 3; break;
+    case BLUR_FORMAT_GRAY8: bpp = 1; break;
+    default: return -1; // NV21 chroma has no matching mask
+    }
+    if (!pixels || !mask || width <= 0 || height <= 0) return -1;
+    if (stride == 0) stride = width * bpp;
+    if (mask_stride == 0) mask_stride = width;
+    if (stride < width * bpp || mask_stride < width) return -1;
+    if (mode != 0 && mode != 2) return -2; // pixelate blocks would not line up across tiles
+    blurcore::CancelScope cancelScope(ctx); // one request across both layers
+
+    const int tilesX = (width + kTile - 1) / kTile;
+    const int tilesY = (height + kTile - 1) / kTile;
+    std::vector<uint8_t> state(static_cast<size_t>(tilesX) * tilesY);
+    blurcore::parallelFor(tilesY, [&](int ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            uint8_t lo = 255, hi = 0;
+            const int x1 = std::min((tx + 1) * kTile, width), y1 = std::min((ty + 1) * kTile, height);
+            // Stop as soon as the tile is known to be mixed
+            for (int y = ty * kTile; y < y1 && (lo == 255 || hi == 0); ++y) {
+                const uint8_t* m = mask + static_cast<ptrdiff_t>(y) * mask_stride;
+                for (int x = tx * kTile; x < x1; ++x) {
+                    lo = std::min(lo, m[x]);
+                    hi = std::max(hi, m[x]);
+                }
+            }
+            state[ty * tilesX + tx] = lo == 255 ? kAllForeground : (hi == 0 ? kAllBackground : kMixed);
+        }
+    });
+
+    // A layer with strength 0 is the source itself and needs no copy
+    Layer fg = {fg_strength, std::vector<int>(state.size(), -1), {}};
+    Layer bg = {bg_strength, std::vector<int>(state.size(), -1), {}};
+    const bool fgBlurred = fg_strength > 0;
+    const bool bgBlurred = bg_strength > 0;
+    std::vector<uint8_t> needed(state.size());
+    if (fgBlurred) {
+        for (size_t t = 0; t < state.size(); ++t) needed[t] = state[t] != kAllBackground;
+        const int rc = blurLayer(ctx, pixels, width, height, stride, format, bpp, tilesX, tilesY, needed, mode, fg);
+        if (rc != 0) return rc;
+    }
+    if (bgBlurred) {
+        for (size_t t = 0; t < state.size(); ++t) needed[t] = state[t] != kAllForeground;
+        const int rc = blurLayer(ctx, pixels, width, height, stride, format, bpp, tilesX, tilesY, needed, mode, bg);
+        if (rc != 0) return rc;
+    }
+
+    // Every layer is built from the untouched source, so writing back can
+    // now go tile by tile in any order. Mixed tiles cost far more than
+    // uniform ones, so they are balanced by the tile scheduler.
+    const blurcore::TileGrid grid = {width, height, kTile, kTile, 0};
+    const auto blend = blurcore::channelKernels(bpp).blendRow;
+    blurcore::StageScope stage(BLUR_STAGE_BLEND);
+    blurcore::forEachTile(grid, [&](const blurcore::Tile& t, int) {
+        const int tile = t.index;
+        const size_t rowBytes = static_cast<size_t>(t.x1 - t.x0) * bpp;
+        const bool useFg = state[tile] != kAllBackground, useBg = state[tile] != kAllForeground;
+        if ((useFg && !fgBlurred && !useBg) || (useBg && !bgBlurred && !useFg)) return; // source as is
+
+        for (int y = t.y0; y < t.y1; ++y) {
+            uint8_t* out = pixels + static_cast<ptrdiff_t>(y) * stride + static_cast<ptrdiff_t>(t.x0) * bpp;
+            const uint8_t* f = fgBlurred && useFg ? fg.row(tile, t.x0, y, bpp) : out;
+            const uint8_t* b = bgBlurred && useBg ? bg.row(tile, t.x0, y, bpp) : out;
+            if (!useBg) {
+                std::memcpy(out, f, rowBytes);
+            } else if (!useFg) {
+                std::memcpy(out, b, rowBytes);
+            } else {
+                const uint8_t* m = mask + static_cast<ptrdiff_t>(y) * mask_stride + t.x0;
+                blend(out, f, b, m, t.x1 - t.x0);
+            }
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,549 @@
+// Resident editing session (blur_session_*). The source image, its masks
+// and the latest render live in pooled native memory for as long as the
+// session is open, so an editor hands the pixels over once and afterwards
+// only passes parameters. Full-frame blurred layers used by masked renders
+// are cached too; they are the one part that can be rebuilt, so they sit on
+// a process-wide LRU list with a byte limit and are the first thing dropped
+// under memory pressure.
+//
+// Masked renders are incremental: each mask keeps a bitmap of the tiles
+// edited since the last render, and a render with the same mask and
+// parameters as the previous one re-blends only those tiles. The blurred
+// layers do not depend on the mask, so a brush stroke costs its own area
+// rather than the frame.
+//
+// Whole-frame renders for a strength slider can blend the two nearest of a
+// fixed ladder of cached strengths instead of blurring from the original,
+// so scrubbing back to a visited position is a copy or a blend.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "blur.h"
+#include "blur_kernels.h"
+#include "buffer_pool.h"
+#include "cancel.h"
+#include "jobs.h"
+#include "session.h"
+#include "thread_pool.h"
+#include "tile_scheduler.h"
+#include "trace.h"
+
+namespace {
+
+const int kTile = 64;
+const int64_t kDefaultCacheLimit = 192ll << 20; // four 12 MP RGBA layers
+
+// round(v / 255) for v <= 255 * 255
+inline uint8_t div255(uint32_t v) {
+    v += 128;
+    return static_cast<uint8_t>((v + (v >> 8)) >> 8);
+}
+
+struct CachedLayer {
+    const BlurSession* owner;
+    int mode;
+    int strength;
+    blurcore::PooledBuffer pixels;
+    int pins; // renders currently reading the layer; never evicted while > 0
+};
+
+std::mutex g_cacheLock;
+std::list<CachedLayer> g_layers; // most recently used first
+int64_t g_cacheBytes = 0;
+int64_t g_cacheLimit = kDefaultCacheLimit;
+std::atomic<int64_t> g_layerHits{0};
+std::atomic<int64_t> g_layerMisses{0};
+std::atomic<int64_t> g_layerInterpolated{0};
+
+// Drop unpinned layers, least recently used first, until at most keep
+// bytes remain. Caller holds g_cacheLock.
+int64_t evictLocked(int64_t keep) {
+    int64_t freed = 0;
+    for (auto it = g_layers.end(); it != g_layers.begin() && g_cacheBytes > keep;) {
+        --it;
+        if (it->pins > 0) continue;
+        const int64_t bytes = static_cast<int64_t>(it->pixels.size());
+        g_cacheBytes -= bytes;
+        freed += bytes;
+        it = g_layers.erase(it);
+    }
+    return freed;
+}
+
+struct SessionMask {
+    int id;
+    blurcore::PooledBuffer pixels; // width bytes per row
+    std::vector<uint8_t> dirty;    // one flag per kTile x kTile tile
+};
+
+// The masked render session->result currently holds
+struct MaskedRender {
+    int maskId = 0; // 0 when the result is anything else
+    int mode = 0;
+    int fg = 0;
+    int bg = 0;
+};
+
+} // namespace
+
+struct BlurSession {
+    int width = 0, height = 0, format = 0, bpp = 0;
+    blurcore::PooledBuffer original;
+    blurcore::PooledBuffer result;
+    std::vector<SessionMask> masks;
+    int nextMaskId = 1;
+    MaskedRender last;
+    BlurContext* ctx = nullptr;
+
+    size_t frameBytes() const { return static_cast<size_t>(width) * height * bpp; }
+    size_t rowBytes() const { return static_cast<size_t>(width) * bpp; }
+    int tilesX() const { return (width + kTile - 1) / kTile; }
+    int tilesY() const { return (height + kTile - 1) / kTile; }
+
+    // Flag the tiles of [x0, x1) x [y0, y1), clipped to the frame
+    void markDirty(SessionMask& m, int x0, int y0, int x1, int y1) const {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        if (x0 >= x1 || y0 >= y1) return;
+        for (int ty = y0 / kTile; ty <= (y1 - 1) / kTile; ++ty) {
+            std::memset(m.dirty.data() + ty * tilesX() + x0 / kTile, 1, (x1 - 1) / kTile - x0 / kTile + 1);
+        }
+    }
+
+    SessionMask* mask(int id) {
+        for (SessionMask& m : masks) {
+            if (m.id == id) return &m;
+        }
+        return nullptr;
+    }
+};
+
+namespace {
+
+// Keeps a cached layer pinned while a render reads it
+class LayerPin {
+public:
+    LayerPin() = default;
+    LayerPin(const LayerPin&) = delete;
+    LayerPin& operator=(const LayerPin&) = delete;
+    ~LayerPin() {
+        if (!layer_) return;
+        std::lock_guard<std::mutex> lock(g_cacheLock);
+        --layer_->pins;
+        evictLocked(g_cacheLimit);
+    }
+
+    const uint8_t* pixels() const { return layer_ ? layer_->pixels.data() : nullptr; }
+
+    // Find or build the layer; returns 0 or the blur status
+    int acquire(BlurSession* s, int mode, int strength) {
+        {
+            std::lock_guard<std::mutex> lock(g_cacheLock);
+            for (auto it = g_layers.begin(); it != g_layers.end(); ++it) {
+                if (it->owner == s && it->mode == mode && it->strength == strength) {
+                    g_layers.splice(g_layers.begin(), g_layers, it);
+                    ++it->pins;
+                    layer_ = &*it;
+                    g_layerHits.fetch_add(1, std::memory_order_relaxed);
+                    return 0;
+                }
+            }
+        }
+
+        blurcore::PooledBuffer pixels = blurcore::acquireBuffer(s->frameBytes());
+        if (!pixels) {
+            // Make room from other layers and try once more
+            {
+                std::lock_guard<std::mutex> lock(g_cacheLock);
+                evictLocked(0);
+            }
+            blur_memory_trim(0);
+            pixels = blurcore::acquireBuffer(s->frameBytes());
+            if (!pixels) return -3;
+        }
+        {
+            blurcore::StageScope stage(BLUR_STAGE_COPY_IN, static_cast<int64_t>(s->frameBytes()));
+            std::memcpy(pixels.data(), s->original.data(), s->frameBytes());
+        }
+        const BlurRect all = {0, 0, s->width, s->height};
+        const int rc = blur_apply_regions_ex(s->ctx, pixels.data(), s->width, s->height, 0, s->format,
+                                             &all, 1, mode, strength);
+        if (rc != 0) return rc;
+        g_layerMisses.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(g_cacheLock);
+        g_cacheBytes += static_cast<int64_t>(pixels.size());
+        g_layers.push_front(CachedLayer{s, mode, strength, std::move(pixels), 1});
+        layer_ = &g_layers.front();
+        evictLocked(g_cacheLimit);
+        return 0;
+    }
+
+private:
+    CachedLayer* layer_ = nullptr;
+};
+
+bool hasLayer(const BlurSession* s, int mode, int strength) {
+    std::lock_guard<std::mutex> lock(g_cacheLock);
+    for (const CachedLayer& l : g_layers) {
+        if (l.owner == s && l.mode == mode && l.strength == strength) return true;
+    }
+    return false;
+}
+
+// Cached strengths for interpolated renders: every strength up to 8, then
+// four per doubling. Sets lo <= strength <= hi from the ladder; the ladder
+// is walked in 64 bits and hi capped so strengths near INT_MAX stay defined.
+void bracketStrength(int strength, int& lo, int& hi) {
+    int step = 1;
+    for (int64_t top = 8; strength >= top; top *= 2) step = static_cast<int>(top / 4);
+    lo = strength - strength % step;
+    hi = lo == strength ? lo : static_cast<int>(std::min<int64_t>(static_cast<int64_t>(lo) + step, INT32_MAX));
+}
+
+int bytesPerPixel(int format) {
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: return 4;
+    case BLUR_FORMAT_RGB888: return 3;
+    case BLUR_FORMAT_GRAY8: return 1;
+    default: return 0; // NV21 chroma has no matching mask
+    }
+}
+
+} // namespace
+
+extern "C" BlurSession* blur_session_open(const uint8_t* pixels, int width, int height, int stride, int format) {
+    const int bpp = bytesPerPixel(format);
+    if (!pixels || width <= 0 || height <= 0 || bpp == 0) return nullptr;
+    if (stride == 0) stride = width * bpp;
+    if (stride < width * bpp) return nullptr;
+
+    std::unique_ptr<BlurSession> s(new (std::nothrow) BlurSession);
+    if (!s) return nullptr;
+    s->width = width;
+    s->height = height;
+    s->format = format;
+    s->bpp = bpp;
+    s->original = blurcore::acquireBuffer(s->frameBytes());
+    s->result = blurcore::acquireBuffer(s->frameBytes());
+    s->ctx = blur_context_create();
+    if (!s->original || !s->result || !s->ctx) {
+        blur_context_destroy(s->ctx);
+        return nullptr;
+    }
+    blurcore::StageScope stage(BLUR_STAGE_COPY_IN, static_cast<int64_t>(s->frameBytes()));
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(s->original.data() + y * s->rowBytes(), pixels + static_cast<ptrdiff_t>(y) * stride,
+                    s->rowBytes());
+    }
+    std::memcpy(s->result.data(), s->original.data(), s->frameBytes());
+    return s.release();
+}
+
+extern "C" void blur_session_close(BlurSession* session) {
+    if (!session) return;
+    blurcore::finishSessionJobs(session);
+    {
+        std::lock_guard<std::mutex> lock(g_cacheLock);
+        for (auto it = g_layers.begin(); it != g_layers.end();) {
+            if (it->owner == session) {
+                g_cacheBytes -= static_cast<int64_t>(it->pixels.size());
+                it = g_layers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    blur_context_destroy(session->ctx);
+    delete session;
+}
+
+extern "C" void blur_session_cancel(BlurSession* session) {
+    if (session) blur_context_cancel(session->ctx);
+}
+
+extern "C" int blur_session_size(const BlurSession* session, int* width, int* height) {
+    if (!session) return -1;
+    if (width) *width = session->width;
+    if (height) *height = session->height;
+    return 0;
+}
+
+extern "C" int blur_session_add_mask(BlurSession* session, const uint8_t* mask, int mask_stride) {
+    if (!session) return -1;
+    if (mask_stride == 0) mask_stride = session->width;
+    if (mask_stride < session->width) return -1;
+
+    SessionMask m = {session->nextMaskId, blurcore::acquireBuffer(static_cast<size_t>(session->width) * session->height),
+                     std::vector<uint8_t>(static_cast<size_t>(session->tilesX()) * session->tilesY(), 1)};
+    if (!m.pixels) return -3;
+    for (int y = 0; y < session->height; ++y) {
+        uint8_t* row = m.pixels.data() + static_cast<size_t>(y) * session->width;
+        if (mask) std::memcpy(row, mask + static_cast<ptrdiff_t>(y) * mask_stride, session->width);
+        else std::memset(row, 0, session->width);
+    }
+    session->masks.push_back(std::move(m));
+    return session->nextMaskId++;
+}
+
+extern "C" uint8_t* blur_session_mask(BlurSession* session, int mask_id) {
+    SessionMask* m = session ? session->mask(mask_id) : nullptr;
+    return m ? m->pixels.data() : nullptr;
+}
+
+extern "C" int blur_session_remove_mask(BlurSession* session, int mask_id) {
+    if (!session) return -1;
+    for (auto it = session->masks.begin(); it != session->masks.end(); ++it) {
+        if (it->id == mask_id) {
+            if (session->last.maskId == mask_id) session->last = MaskedRender();
+            session->masks.erase(it);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+extern "C" int blur_session_process_mask(BlurSession* session, int mask_id, const BlurMaskStep* steps,
+                                         int step_count) {
+    SessionMask* m = session ? session->mask(mask_id) : nullptr;
+    if (!m) return -1;
+    blurcore::CancelScope cancelScope(session->ctx);
+    const int rc =
+        blur_mask_process(session->ctx, m->pixels.data(), session->width, session->height, 0, steps, step_count);
+    // Even a failed run may have finished some steps
+    if (rc != -1 && step_count > 0) session->markDirty(*m, 0, 0, session->width, session->height);
+    return rc;
+}
+
+extern "C" int blur_session_mark_mask_dirty(BlurSession* session, int mask_id, const BlurRect* rect) {
+    SessionMask* m = session ? session->mask(mask_id) : nullptr;
+    if (!m) return -1;
+    if (!rect) session->markDirty(*m, 0, 0, session->width, session->height);
+    else if (rect->w > 0 && rect->h > 0) session->markDirty(*m, rect->x, rect->y, rect->x + rect->w, rect->y + rect->h);
+    return 0;
+}
+
+extern "C" int blur_session_paint_mask(BlurSession* session, int mask_id, const float* points, int point_count,
+                                       float radius, int erase) {
+    SessionMask* m = session ? session->mask(mask_id) : nullptr;
+    if (!m || !points || point_count <= 0) return -1;
+    if (!blurcore::isFiniteFloat(radius) || !(radius > 0.0f)) return -1;
+    for (int i = 0; i < point_count * 2; ++i) {
+        if (!blurcore::isFiniteFloat(points[i])) return -1;
+    }
+
+    // Stamp a round brush along each segment; coverage falls off over the
+    // last pixel so the edge is antialiased
+    const int width = session->width, height = session->height;
+    const int segments = std::max(point_count - 1, 1); // a single point is a dab
+    for (int i = 0; i < segments; ++i) {
+        const float ax = points[2 * i], ay = points[2 * i + 1];
+        const int j = std::min(i + 1, point_count - 1);
+        const float bx = points[2 * j], by = points[2 * j + 1];
+        const float dx = bx - ax, dy = by - ay, len2 = dx * dx + dy * dy;
+        const float reach = radius + 1.0f;
+        const int x0 = std::max(0, static_cast<int>(std::floor(std::min(ax, bx) - reach)));
+        const int y0 = std::max(0, static_cast<int>(std::floor(std::min(ay, by) - reach)));
+        const int x1 = std::min(width, static_cast<int>(std::ceil(std::max(ax, bx) + reach)) + 1);
+        const int y1 = std::min(height, static_cast<int>(std::ceil(std::max(ay, by) + reach)) + 1);
+        if (x0 >= x1 || y0 >= y1) continue;
+
+        for (int y = y0; y < y1; ++y) {
+            uint8_t* row = m->pixels.data() + static_cast<size_t>(y) * width;
+            const float py = y + 0.5f;
+            for (int x = x0; x < x1; ++x) {
+                const float px = x + 0.5f;
+                float t = len2 > 0.0f ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0.0f;
+                t = std::min(std::max(t, 0.0f), 1.0f);
+                const float ex = px - (ax + t * dx), ey = py - (ay + t * dy);
+                const float cover = radius + 0.5f - std::sqrt(ex * ex + ey * ey);
+                if (cover <= 0.0f) continue;
+                const uint8_t v = static_cast<uint8_t>(std::lround(std::min(cover, 1.0f) * 255.0f));
+                row[x] = erase ? std::min<uint8_t>(row[x], 255 - v) : std::max(row[x], v);
+            }
+        }
+        session->markDirty(*m, x0, y0, x1, y1);
+    }
+    return 0;
+}
+
+extern "C" int blur_session_render_regions(BlurSession* session, const BlurRect* rects, int rect_count,
+                                           int mode, int strength) {
+    if (!session || rect_count < 0 || (rect_count > 0 && !rects)) return -1;
+    blurcore::CancelScope cancelScope(session->ctx);
+    session->last = MaskedRender();
+    std::memcpy(session->result.data(), session->original.data(), session->frameBytes());
+    if (rect_count == 0) return 0;
+    return blur_apply_regions_ex(session->ctx, session->result.data(), session->width, session->height, 0,
+                                 session->format, rects, rect_count, mode, strength);
+}
+
+extern "C" int blur_session_render_masked(BlurSession* session, int mask_id, int mode, int fg_strength,
+                                          int bg_strength) {
+    SessionMask* m = session ? session->mask(mask_id) : nullptr;
+    if (!m || fg_strength < 0 || bg_strength < 0) return -1;
+    if (mode != 0 && mode != 2) return -2;
+    blurcore::CancelScope cancelScope(session->ctx); // one request across layers and tiles
+
+    // Anything but a repeat of the last render starts from scratch
+    const MaskedRender params = {mask_id, mode, fg_strength, bg_strength};
+    const MaskedRender& last = session->last;
+    if (last.maskId != mask_id || last.mode != mode || last.fg != fg_strength || last.bg != bg_strength) {
+        std::fill(m->dirty.begin(), m->dirty.end(), 1);
+        session->last = MaskedRender();
+    }
+    if (std::find(m->dirty.begin(), m->dirty.end(), 1) == m->dirty.end()) return 0;
+
+    // A layer with strength 0 is the original itself
+    LayerPin fgLayer, bgLayer;
+    if (fg_strength > 0) {
+        const int rc = fgLayer.acquire(session, mode, fg_strength);
+        if (rc != 0) return rc;
+    }
+    if (bg_strength > 0) {
+        const int rc = bgLayer.acquire(session, mode, bg_strength);
+        if (rc != 0) return rc;
+    }
+    const uint8_t* fg = fgLayer.pixels() ? fgLayer.pixels() : session->original.data();
+    const uint8_t* bg = bgLayer.pixels() ? bgLayer.pixels() : session->original.data();
+
+    const int width = session->width, bpp = session->bpp;
+    const blurcore::TileGrid grid = {width, session->height, kTile, kTile, 0};
+    blurcore::StageScope stage(BLUR_STAGE_BLEND);
+    const int tilesX = session->tilesX();
+    const auto blend = blurcore::channelKernels(bpp).blendRow;
+    blurcore::forEachTile(grid, [&](const blurcore::Tile& t, int) {
+        uint8_t& dirty = m->dirty[(t.y0 / kTile) * tilesX + t.x0 / kTile];
+        if (!dirty) return;
+        dirty = 0;
+        uint8_t lo = 255, hi = 0;
+        for (int y = t.y0; y < t.y1 && (lo == 255 || hi == 0); ++y) {
+            const uint8_t* mr = m->pixels.data() + static_cast<size_t>(y) * width;
+            for (int x = t.x0; x < t.x1; ++x) {
+                lo = std::min(lo, mr[x]);
+                hi = std::max(hi, mr[x]);
+            }
+        }
+        const size_t rowBytes = static_cast<size_t>(t.x1 - t.x0) * bpp;
+        for (int y = t.y0; y < t.y1; ++y) {
+            const size_t offset = static_cast<size_t>(y) * session->rowBytes() + static_cast<size_t>(t.x0) * bpp;
+            uint8_t* out = session->result.data() + offset;
+            if (lo == 255 || hi == 0) {
+                std::memcpy(out, (lo == 255 ? fg : bg) + offset, rowBytes);
+                continue;
+            }
+            const uint8_t* f = fg + offset;
+            const uint8_t* b = bg + offset;
+            const uint8_t* mr = m->pixels.data() + static_cast<size_t>(y) * width + t.x0;
+            blend(out, f, b, mr, t.x1 - t.x0);
+        }
+    });
+    session->last = params;
+    return 0;
+}
+
+extern "C" int blur_session_render_blurred(BlurSession* session, int mode, int strength, int flags) {
+    if (!session || strength < 0 || (flags & ~BLUR_SESSION_INTERPOLATE)) return -1;
+    blurcore::CancelScope cancelScope(session->ctx); // one request across both cached levels
+    session->last = MaskedRender();
+    if (strength == 0) {
+        std::memcpy(session->result.data(), session->original.data(), session->frameBytes());
+        return 0;
+    }
+
+    // Pixelation and the summed-area modes do not blend between strengths
+    int lo = strength, hi = strength;
+    if ((flags & BLUR_SESSION_INTERPOLATE) && (mode == 0 || mode == 2) && !hasLayer(session, mode, strength)) {
+        bracketStrength(strength, lo, hi);
+    }
+    LayerPin loLayer, hiLayer;
+    if (lo > 0) {
+        const int rc = loLayer.acquire(session, mode, lo);
+        if (rc != 0) return rc;
+    }
+    if (hi == lo) {
+        std::memcpy(session->result.data(), loLayer.pixels(), session->frameBytes());
+        return 0;
+    }
+    const int rc = hiLayer.acquire(session, mode, hi);
+    if (rc != 0) return rc;
+    g_layerInterpolated.fetch_add(1, std::memory_order_relaxed);
+
+    const uint8_t* a = lo > 0 ? loLayer.pixels() : session->original.data();
+    const uint8_t* b = hiLayer.pixels();
+    const uint32_t w = static_cast<uint32_t>((static_cast<int64_t>(strength - lo) * 255 + (hi - lo) / 2) / (hi - lo));
+    const size_t rowBytes = session->rowBytes();
+    blurcore::StageScope stage(BLUR_STAGE_BLEND);
+    blurcore::parallelFor(session->height, [&](int y) {
+        const size_t offset = static_cast<size_t>(y) * rowBytes;
+        uint8_t* out = session->result.data() + offset;
+        for (size_t i = 0; i < rowBytes; ++i) out[i] = div255(a[offset + i] * (255 - w) + b[offset + i] * w);
+    });
+    return 0;
+}
+
+extern "C" const uint8_t* blur_session_result(const BlurSession* session) {
+    return session ? session->result.data() : nullptr;
+}
+
+extern "C" int blur_session_export(const BlurSession* session, uint8_t* dst, int dst_stride) {
+    if (!session || !dst) return -1;
+    if (dst_stride == 0) dst_stride = session->width * session->bpp;
+    if (dst_stride < session->width * session->bpp) return -1;
+    blurcore::StageScope stage(BLUR_STAGE_COPY_OUT, static_cast<int64_t>(session->frameBytes()));
+    for (int y = 0; y < session->height; ++y) {
+        std::memcpy(dst + static_cast<ptrdiff_t>(y) * dst_stride, session->result.data() + y * session->rowBytes(),
+                    session->rowBytes());
+    }
+    return 0;
+}
+
+extern "C" int blur_session_set_cache_limit(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(g_cacheLock);
+    g_cacheLimit = bytes > 0 ? bytes : kDefaultCacheLimit;
+    evictLocked(g_cacheLimit);
+    return 0;
+}
+
+extern "C" int64_t blur_session_trim(int64_t keep_bytes) {
+    std::lock_guard<std::mutex> lock(g_cacheLock);
+    return evictLocked(std::max<int64_t>(keep_bytes, 0));
+}
+
+extern "C" int64_t blur_session_cache_bytes(void) {
+    std::lock_guard<std::mutex> lock(g_cacheLock);
+    return g_cacheBytes;
+}
+
+namespace blurcore {
+
+LayerCacheStats layerCacheStats() {
+    LayerCacheStats out = {};
+    {
+        std::lock_guard<std::mutex> lock(g_cacheLock);
+        out.bytes = g_cacheBytes;
+        out.limitBytes = g_cacheLimit;
+        out.layers = static_cast<int64_t>(g_layers.size());
+    }
+    out.hits = g_layerHits.load(std::memory_order_relaxed);
+    out.misses = g_layerMisses.load(std::memory_order_relaxed);
+    out.interpolated = g_layerInterpolated.load(std::memory_order_relaxed);
+    return out;
+}
+
+BlurContext* sessionContext(BlurSession* session) {
+    return session ? session->ctx : nullptr;
+}
+
+} // namespace blurcore
@@ -0,0 +1,23 @@
+// Internal view of sessions: the layer cache for the instrumentation and
+// the context the job queue cancels.
+#pragma once
+#include <cstdint>
+#include "blur.h"
+
+namespace blurcore {
+
+struct LayerCacheStats {
+    int64_t bytes;        // cached layers across all sessions
+    int64_t limitBytes;
+    int64_t layers;
+    int64_t hits;         // cumulative, like the pool counters
+    int64_t misses;       // layers built
+    int64_t interpolated; // renders blended from two cached levels
+};
+
+LayerCacheStats layerCacheStats();
+
+// The context every render on the session runs on (blur_session_cancel)
+BlurContext* sessionContext(BlurSession* session);
+
+} // namespace blurcore
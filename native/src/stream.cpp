@@ -0,0 +1,370 @@
+// Streaming mask blur for live preview and video: the expensive detector
+// (segmentation, face boxes) only runs on keyframes. In between, the last
+// mask follows a global motion estimate, and only tiles whose mask or
+// content changed are blurred again; the rest reuse the previous output,
+// moved along with the camera.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+#include "blur.h"
+#include "blur_kernels.h"
+#include "cancel.h"
+#include "trace.h"
+
+namespace {
+
+const int kTile = 64;      // reuse granularity, same tiles as blur_apply_masked
+const int kThumbScale = 8; // thumbnail pixel = mean luma of an 8x8 block
+const int kSearch = 4;     // motion search radius in thumbnail pixels (32 px)
+
+// Cheap luma for the thumbnail: (r + 2g + b) / 4
+inline int lumaAt(const uint8_t* p, int format) {
+    switch (format) {
+    case BLUR_FORMAT_GRAY8: return p[0];
+    case BLUR_FORMAT_BGRA8888: return (p[2] + 2 * p[1] + p[0]) >> 2;
+    default: return (p[0] + 2 * p[1] + p[2]) >> 2;
+    }
+}
+
+// Move a packed w x h plane with bpp bytes per pixel by (dx, dy) in place.
+// What scrolls in is copied from `fresh` when given (so it does not read as
+// a change), otherwise it keeps stale bytes; those tiles are redone anyway.
+void shiftPlane(std::vector<uint8_t>& plane, const std::vector<uint8_t>* fresh, int w, int h, int bpp,
+                int dx, int dy) {
+    const int cols = w - std::abs(dx);
+    const size_t row = static_cast<size_t>(w) * bpp;
+    if (cols > 0 && std::abs(dy) < h) {
+        for (int i = 0; i < h - std::abs(dy); ++i) {
+            // Walk away from the rows being written so no source is overwritten
+            const int y = dy > 0 ? h - 1 - i : i;
+            std::memmove(&plane[y * row + std::max(dx, 0) * bpp], &plane[(y - dy) * row + std::max(-dx, 0) * bpp],
+                         static_cast<size_t>(cols) * bpp);
+        }
+    }
+    if (!fresh) return;
+    const int x0 = std::max(dx, 0), x1 = w + std::min(dx, 0);
+    const int y0 = std::max(dy, 0), y1 = h + std::min(dy, 0);
+    for (int y = 0; y < h; ++y) {
+        if (y < y0 || y >= y1 || x0 >= x1) {
+            std::memcpy(&plane[y * row], &(*fresh)[y * row], row);
+            continue;
+        }
+        std::memcpy(&plane[y * row], &(*fresh)[y * row], static_cast<size_t>(x0) * bpp);
+        std::memcpy(&plane[y * row + x1 * bpp], &(*fresh)[y * row + x1 * bpp], static_cast<size_t>(w - x1) * bpp);
+    }
+}
+
+} // namespace
+
+struct BlurStream {
+    int width, height, format, bpp;
+    BlurStreamConfig config;
+    int thumbW, thumbH, tilesX, tilesY;
+    int halo = 0; // blur reach in pixels
+    long frame = 0;
+    long lastKey = -1;
+    BlurStreamStats stats = {};
+
+    std::vector<uint8_t> thumb, prevThumb;
+    std::vector<uint8_t> mask, prevMask, detected;
+    std::vector<uint8_t> output; // previous result, packed
+    // Thumbnail and mask as of each tile's last blur, so slow drift still
+    // adds up to a re-blur
+    std::vector<uint8_t> blurredThumb, blurredMask;
+    std::vector<uint8_t> dirty, grown;
+    std::vector<uint8_t> crop, cropMask;
+    BlurContext* ctx = nullptr;
+
+    ~BlurStream() { blur_context_destroy(ctx); }
+
+    void makeThumb(const uint8_t* pixels, int stride) {
+        for (int ty = 0; ty < thumbH; ++ty) {
+            const int y1 = std::min((ty + 1) * kThumbScale, height);
+            for (int tx = 0; tx < thumbW; ++tx) {
+                const int x1 = std::min((tx + 1) * kThumbScale, width);
+                int sum = 0, n = 0;
+                for (int y = ty * kThumbScale; y < y1; ++y) {
+                    const uint8_t* row = pixels + static_cast<ptrdiff_t>(y) * stride;
+                    for (int x = tx * kThumbScale; x < x1; ++x, ++n) sum += lumaAt(row + x * bpp, format);
+                }
+                thumb[ty * thumbW + tx] = static_cast<uint8_t>(sum / n);
+            }
+        }
+    }
+
+    // Mean absolute thumbnail difference when the previous frame is moved by
+    // (dx, dy), over the part that still overlaps.
+    int shiftedDifference(int dx, int dy) const {
+        long sum = 0, n = 0;
+        for (int y = std::max(0, dy); y < std::min(thumbH, thumbH + dy); ++y) {
+            for (int x = std::max(0, dx); x < std::min(thumbW, thumbW + dx); ++x, ++n) {
+                sum += std::abs(thumb[y * thumbW + x] - prevThumb[(y - dy) * thumbW + (x - dx)]);
+            }
+        }
+        return n ? static_cast<int>(sum / n) : 255;
+    }
+
+    // Global translation (in thumbnail pixels) that best explains the new
+    // frame, and the residual difference at that offset.
+    int estimateMotion(int& dx, int& dy) const {
+        int best = shiftedDifference(0, 0);
+        dx = dy = 0;
+        for (int oy = -kSearch; oy <= kSearch; ++oy) {
+            for (int ox = -kSearch; ox <= kSearch; ++ox) {
+                if (ox == 0 && oy == 0) continue;
+                const int d = shiftedDifference(ox, oy);
+                if (d < best) { best = d; dx = ox; dy = oy; }
+            }
+        }
+        return best;
+    }
+
+    // mask = prevMask moved by (dx, dy) pixels, edges replicated
+    void shiftMask(int dx, int dy) {
+        for (int y = 0; y < height; ++y) {
+            const int sy = std::min(std::max(y - dy, 0), height - 1);
+            const uint8_t* src = &prevMask[static_cast<size_t>(sy) * width];
+            uint8_t* dst = &mask[static_cast<size_t>(y) * width];
+            for (int x = 0; x < width; ++x) dst[x] = src[std::min(std::max(x - dx, 0), width - 1)];
+        }
+    }
+
+    // A tile is dirty if its thumbnail content or its mask moved past the
+    // thresholds since it was last blurred. Dirt then spreads by the blur
+    // reach, so neighbours that sample the tile are redone too.
+    void markDirty(bool all) {
+        std::vector<uint8_t>& d = dirty;
+        const int thumbsPerTile = kTile / kThumbScale;
+        for (int ty = 0; ty < tilesY; ++ty) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                bool changed = all;
+                for (int y = ty * thumbsPerTile; !changed && y < std::min((ty + 1) * thumbsPerTile, thumbH); ++y) {
+                    for (int x = tx * thumbsPerTile; x < std::min((tx + 1) * thumbsPerTile, thumbW); ++x) {
+                        if (std::abs(thumb[y * thumbW + x] - blurredThumb[y * thumbW + x]) > config.content_threshold) {
+                            changed = true;
+                            break;
+                        }
+                    }
+                }
+                for (int y = ty * kTile; !changed && y < std::min((ty + 1) * kTile, height); ++y) {
+                    const size_t row = static_cast<size_t>(y) * width;
+                    for (int x = tx * kTile; x < std::min((tx + 1) * kTile, width); ++x) {
+                        if (std::abs(mask[row + x] - blurredMask[row + x]) > 2) {
+                            changed = true;
+                            break;
+                        }
+                    }
+                }
+                d[ty * tilesX + tx] = changed;
+            }
+        }
+
+        const int reach = (halo + kTile - 1) / kTile;
+        if (reach == 0 || all) return;
+        for (int ty = 0; ty < tilesY; ++ty) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                bool any = false;
+                for (int y = std::max(ty - reach, 0); !any && y <= std::min(ty + reach, tilesY - 1); ++y) {
+                    for (int x = std::max(tx - reach, 0); x <= std::min(tx + reach, tilesX - 1); ++x) {
+                        if (d[y * tilesX + x]) { any = true; break; }
+                    }
+                }
+                grown[ty * tilesX + tx] = any;
+            }
+        }
+        d.swap(grown);
+    }
+
+    // After a camera move by (dx, dy) pixels, a reused pixel only matches a
+    // fresh blur if its whole blur window saw the same content before and
+    // after, edge clamping included. Tiles reaching into the band that
+    // scrolled in, or within the blur reach of an edge the content slid
+    // along, are redone.
+    void markMoved(int dx, int dy) {
+        auto band = [this](int d, int extent, int t0, int t1) {
+            if (d == 0) return false;
+            const int lo = std::max(d, 0) + halo, hi = extent + std::min(d, 0) - halo;
+            return t0 < lo || t1 > hi;
+        };
+        for (int ty = 0; ty < tilesY; ++ty) {
+            const bool rowMoved = band(dy, height, ty * kTile, std::min((ty + 1) * kTile, height));
+            for (int tx = 0; tx < tilesX; ++tx) {
+                if (rowMoved || band(dx, width, tx * kTile, std::min((tx + 1) * kTile, width))) {
+                    dirty[ty * tilesX + tx] = 1;
+                }
+            }
+        }
+    }
+
+    // Redo the dirty tiles of `output` from the untouched frame, one row run
+    // at a time with a halo so the run interior matches a full-frame blur.
+    int reblurDirty(const uint8_t* pixels, int stride) {
+        for (int ty = 0; ty < tilesY; ++ty) {
+            for (int tx = 0; tx < tilesX; ++tx) {
+                if (!dirty[ty * tilesX + tx]) continue;
+                int end = tx;
+                while (end + 1 < tilesX && dirty[ty * tilesX + end + 1]) ++end;
+
+                const int x0 = tx * kTile, y0 = ty * kTile;
+                const int x1 = std::min((end + 1) * kTile, width), y1 = std::min((ty + 1) * kTile, height);
+                const int hx0 = std::max(x0 - halo, 0), hy0 = std::max(y0 - halo, 0);
+                const int hx1 = std::min(x1 + halo, width), hy1 = std::min(y1 + halo, height);
+                const int hw = hx1 - hx0, hh = hy1 - hy0;
+                crop.resize(static_cast<size_t>(hw) * hh * bpp);
+                cropMask.resize(static_cast<size_t>(hw) * hh);
+                for (int y = 0; y < hh; ++y) {
+                    std::memcpy(&crop[static_cast<size_t>(y) * hw * bpp],
+                                pixels + static_cast<ptrdiff_t>(hy0 + y) * stride + static_cast<ptrdiff_t>(hx0) * bpp,
+                                static_cast<size_t>(hw) * bpp);
+                    std::memcpy(&cropMask[static_cast<size_t>(y) * hw],
+                                &mask[static_cast<size_t>(hy0 + y) * width + hx0], hw);
+                }
+                const int rc = blur_apply_masked(ctx, crop.data(), hw, hh, 0, format, cropMask.data(), 0,
+                                                 config.mode, config.fg_strength, config.bg_strength);
+                if (rc != 0) return rc;
+                for (int y = y0; y < y1; ++y) {
+                    std::memcpy(&output[(static_cast<size_t>(y) * width + x0) * bpp],
+                                &crop[(static_cast<size_t>(y - hy0) * hw + (x0 - hx0)) * bpp],
+                                static_cast<size_t>(x1 - x0) * bpp);
+                    std::memcpy(&blurredMask[static_cast<size_t>(y) * width + x0],
+                                &mask[static_cast<size_t>(y) * width + x0], x1 - x0);
+                }
+                const int tx0 = x0 / kThumbScale, tx1 = (x1 + kThumbScale - 1) / kThumbScale;
+                for (int y = y0 / kThumbScale; y < (y1 + kThumbScale - 1) / kThumbScale; ++y) {
+                    std::memcpy(&blurredThumb[y * thumbW + tx0], &thumb[y * thumbW + tx0], tx1 - tx0);
+                }
+                stats.tiles_blurred += end - tx + 1;
+                tx = end;
+            }
+        }
+        return 0;
+    }
+};
+
+extern "C" BlurStream* blur_stream_create(int width, int height, int format, const BlurStreamConfig* config) {
+    int bpp;
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: bpp = 4; break;
+    case BLUR_FORMAT_RGB888: bpp = 3; break;
+    case BLUR_FORMAT_GRAY8: bpp = 1; break;
+    default: return nullptr;
+    }
+    if (width <= 0 || height <= 0 || !config) return nullptr;
+    if (config->mode != 0 && config->mode != 2) return nullptr;
+
+    std::unique_ptr<BlurStream> s(new (std::nothrow) BlurStream());
+    if (!s) return nullptr;
+    s->width = width;
+    s->height = height;
+    s->format = format;
+    s->bpp = bpp;
+    s->config = *config;
+    if (s->config.keyframe_interval < 1) s->config.keyframe_interval = 1;
+    s->config.smoothing = std::min(std::max(s->config.smoothing, 0), 255);
+    s->thumbW = (width + kThumbScale - 1) / kThumbScale;
+    s->thumbH = (height + kThumbScale - 1) / kThumbScale;
+    s->tilesX = (width + kTile - 1) / kTile;
+    s->tilesY = (height + kTile - 1) / kTile;
+
+    int radii[3];
+    for (int strength : {config->fg_strength, config->bg_strength}) {
+        if (strength <= 0) continue;
+        int reach = 0;
+        const int passes = blurcore::boxPassRadii(config->mode, strength, radii);
+        for (int i = 0; i < passes; ++i) reach += radii[i];
+        s->halo = std::max(s->halo, std::min(reach, std::max(width, height)));
+    }
+
+    const size_t pixels = static_cast<size_t>(width) * height;
+    s->thumb.resize(static_cast<size_t>(s->thumbW) * s->thumbH);
+    s->prevThumb.resize(s->thumb.size());
+    s->mask.resize(pixels);
+    s->prevMask.resize(pixels);
+    s->detected.resize(pixels);
+    s->blurredThumb.resize(s->thumb.size());
+    s->blurredMask.resize(pixels);
+    s->output.resize(pixels * bpp);
+    s->dirty.resize(static_cast<size_t>(s->tilesX) * s->tilesY);
+    s->grown.resize(s->dirty.size());
+    s->ctx = blur_context_create();
+    if (!s->ctx) return nullptr;
+    return s.release();
+}
+
+extern "C" void blur_stream_destroy(BlurStream* stream) {
+    delete stream;
+}
+
+extern "C" int blur_stream_process(BlurStream* s, uint8_t* pixels, int stride,
+                                   BlurStreamDetectFn detect, void* user) {
+    if (!s || !pixels || !detect) return -1;
+    if (stride == 0) stride = s->width * s->bpp;
+    if (stride < s->width * s->bpp) return -1;
+
+    blurcore::CancelScope cancelScope(s->ctx); // one request across the dirty runs
+    s->stats = BlurStreamStats();
+    s->stats.tiles_total = s->tilesX * s->tilesY;
+    s->makeThumb(pixels, stride);
+
+    const bool first = s->lastKey < 0;
+    int dx = 0, dy = 0;
+    bool sceneCut = false;
+    bool key = first || s->frame - s->lastKey >= s->config.keyframe_interval;
+    if (!first) {
+        const int residual = s->estimateMotion(dx, dy);
+        sceneCut = residual > s->config.scene_change;
+        key = key || sceneCut;
+        s->shiftMask(dx * kThumbScale, dy * kThumbScale);
+    }
+
+    if (key) {
+        const int rc = detect(user, pixels, s->width, s->height, stride, s->format, s->detected.data(), s->width);
+        if (rc != 0) return rc;
+        // Blend the fresh detection with the carried-over mask to stop
+        // keyframe flicker; a scene change or the first frame starts over.
+        const int w = first || sceneCut ? 255 : s->config.smoothing;
+        for (size_t i = 0; i < s->mask.size(); ++i) {
+            s->mask[i] = static_cast<uint8_t>((s->detected[i] * w + s->mask[i] * (255 - w) + 127) / 255);
+        }
+        s->lastKey = s->frame;
+        s->stats.keyframe = 1;
+    }
+    s->stats.motion_x = dx * kThumbScale;
+    s->stats.motion_y = dy * kThumbScale;
+
+    // The previous output and what it was blurred from move with the camera,
+    // so tiles the motion did not otherwise change are reused
+    if (dx != 0 || dy != 0) {
+        const int px = dx * kThumbScale, py = dy * kThumbScale;
+        shiftPlane(s->output, nullptr, s->width, s->height, s->bpp, px, py);
+        shiftPlane(s->blurredMask, &s->mask, s->width, s->height, 1, px, py);
+        shiftPlane(s->blurredThumb, &s->thumb, s->thumbW, s->thumbH, 1, dx, dy);
+    }
+    s->markDirty(first);
+    if (!first) s->markMoved(dx * kThumbScale, dy * kThumbScale);
+    const int rc = s->reblurDirty(pixels, stride);
+    if (rc != 0) return rc;
+
+    const size_t rowBytes = static_cast<size_t>(s->width) * s->bpp;
+    blurcore::StageScope stage(BLUR_STAGE_COPY_OUT, static_cast<int64_t>(rowBytes) * s->height);
+    for (int y = 0; y < s->height; ++y) {
+        std::memcpy(pixels + static_cast<ptrdiff_t>(y) * stride, &s->output[y * rowBytes], rowBytes);
+    }
+
+    s->thumb.swap(s->prevThumb);
+    s->mask.swap(s->prevMask);
+    ++s->frame;
+    return 0;
+}
+
+extern "C" int blur_stream_stats(const BlurStream* stream, BlurStreamStats* stats) {
+    if (!stream || !stats) return -1;
+    *stats = stream->stats;
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Out-of-core blur in horizontal strips. Only one strip plus a halo of
+// source rows above and below it is ever in memory, so huge photos can go
+// from a row decoder to a row encoder without a full-size buffer. The halo
+// is the distance a false edge at the buffer boundary can travel through
+// the blur; rows further in are bit-identical to a whole-image blur, so
+// strips join without seams.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "blur.h"
+#include "blur_kernels.h"
+#include "buffer_pool.h"
+#include "cancel.h"
+#include "trace.h"
+
+namespace {
+
+const int kDefaultStripRows = 256;
+
+int stripBytesPerPixel(int format) {
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888:
+    case BLUR_FORMAT_BGRA8888: return 4;
+    case BLUR_FORMAT_RGB888: return 3;
+    case BLUR_FORMAT_GRAY8: return 1;
+    default: return 0; // NV21 chroma rows would need their own halo
+    }
+}
+
+bool pixelateMode(int mode) { return mode == 1 || mode == 4; }
+
+// How far (in rows) one application of the blur carries a wrong pixel.
+int reachOf(int mode, int strength) {
+    if (pixelateMode(mode)) return std::max(1, strength) - 1;
+    if (mode == 3) return std::min(std::max(strength, 1), blurcore::kMaxBoxRadius);
+    int radii[3];
+    const int passes = blurcore::boxPassRadii(mode, strength, radii);
+    int reach = 0;
+    for (int i = 0; i < passes; ++i) reach += radii[i];
+    return reach;
+}
+
+// Rects clamped to the image, like blur_apply_regions_ex does
+std::vector<BlurRect> clampRects(const BlurRect* rects, int count, int width, int height) {
+    std::vector<BlurRect> out;
+    for (int i = 0; i < count; ++i) {
+        const BlurRect& r = rects[i];
+        if (r.w <= 0 || r.h <= 0) continue;
+        const int x0 = std::min(std::max(r.x, 0), width - 1), y0 = std::min(std::max(r.y, 0), height - 1);
+        const int x1 = std::min(std::max(r.x + r.w - 1, 0), width - 1);
+        const int y1 = std::min(std::max(r.y + r.h - 1, 0), height - 1);
+        out.push_back({x0, y0, x1 - x0 + 1, y1 - y0 + 1});
+    }
+    return out;
+}
+
+bool anyOverlap(const std::vector<BlurRect>& rects) {
+    for (size_t i = 0; i < rects.size(); ++i)
+        for (size_t j = i + 1; j < rects.size(); ++j) {
+            const BlurRect& a = rects[i];
+            const BlurRect& b = rects[j];
+            if (a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h) return true;
+        }
+    return false;
+}
+
+// Modes 0-2 blur overlapping rects one after another, so a wrong pixel can
+// travel through every rect in turn; modes 3 and 4 read the source only.
+int haloOf(const std::vector<BlurRect>& rects, int mode, int strength, int height) {
+    const int64_t reach = reachOf(mode, strength);
+    const int64_t chain = (mode <= 2 && anyOverlap(rects)) ? static_cast<int64_t>(rects.size()) : 1;
+    return static_cast<int>(std::min<int64_t>(reach * chain, height));
+}
+
+} // namespace
+
+extern "C" int blur_strip_halo(int height, const BlurRect* rects, int rect_count, int mode, int strength) {
+    if (height <= 0 || rect_count < 0 || (rect_count > 0 && !rects) || mode < 0 || mode > 4) return -1;
+    return haloOf(clampRects(rects, rect_count, 1 << 30, height), mode, strength, height);
+}
+
+extern "C" int blur_apply_strips(BlurContext* ctx, int width, int height, int format,
+                                 const BlurRect* rects, int rect_count, int mode, int strength,
+                                 int strip_rows, BlurStripReadFn read, BlurStripWriteFn write, void* user) {
+    const int bpp = stripBytesPerPixel(format);
+    if (bpp == 0 || width <= 0 || height <= 0 || !read || !write) return -1;
+    if (rect_count < 0 || (rect_count > 0 && !rects)) return -1;
+    if (mode < 0 || mode > 4) return -2;
+    if (strip_rows <= 0) strip_rows = kDefaultStripRows;
+    strip_rows = std::min(strip_rows, height);
+    blurcore::CancelScope cancelScope(ctx); // one request across all strips
+
+    const std::vector<BlurRect> clamped = clampRects(rects, rect_count, width, height);
+    const int halo = haloOf(clamped, mode, strength, height);
+    const int block = std::max(1, strength);
+    const size_t stride = static_cast<size_t>(width) * bpp;
+
+    // Rows [top, top + rows) of the source are in `buffer`. Blurring works in
+    // place, so the source rows the next strip shares are kept in `carry`.
+    const int capacity = std::min(height, strip_rows + 2 * halo);
+    blurcore::PooledBuffer buffer = blurcore::acquireBuffer(stride * capacity);
+    blurcore::PooledBuffer carry = blurcore::acquireBuffer(stride * std::max(1, std::min(height, 2 * halo)));
+    if (!buffer || !carry) return -3;
+
+    // One context for every strip, so the blur scratch is allocated once
+    std::unique_ptr<BlurContext, void (*)(BlurContext*)> owned(nullptr, blur_context_destroy);
+    if (!ctx) {
+        owned.reset(blur_context_create());
+        if (!owned) return -3;
+        ctx = owned.get();
+    }
+    std::vector<BlurRect> parts;
+    int top = 0, rows = 0;
+    for (int y0 = 0; y0 < height; y0 += strip_rows) {
+        const int y1 = std::min(y0 + strip_rows, height);
+        const int needTop = std::max(0, y0 - halo);
+        const int needEnd = std::min(height, y1 + halo);
+
+        // Keep the overlap with the previous buffer, read only new rows
+        const int keep = rows > 0 ? std::max(0, top + rows - needTop) : 0;
+        if (keep > 0) std::memcpy(buffer.data(), carry.data(), stride * keep);
+        top = needTop;
+        rows = keep;
+        if (needEnd > top + rows) {
+            blurcore::StageScope stage(BLUR_STAGE_COPY_IN, static_cast<int64_t>(stride) * (needEnd - top - rows));
+            const int rc = read(user, top + rows, needEnd - top - rows, buffer.data() + stride * rows,
+                                static_cast<int>(stride));
+            if (rc != 0) return rc;
+            rows = needEnd - top;
+        }
+
+        // Source rows the next strip needs again, saved before the blur
+        const int nextTop = std::max(0, y1 - halo);
+        const int carried = y1 < height ? top + rows - nextTop : 0;
+        if (carried > 0) std::memcpy(carry.data(), buffer.data() + stride * (nextTop - top), stride * carried);
+
+        // Each rect's part inside the buffer. Pixelate blocks stay on the
+        // rect's own grid: a part starts and ends on a block boundary unless
+        // that is the rect's real edge.
+        parts.clear();
+        for (const BlurRect& r : clamped) {
+            int p0 = std::max(r.y, top), p1 = std::min(r.y + r.h, top + rows);
+            if (pixelateMode(mode)) {
+                if (p0 > r.y) p0 = r.y + (p0 - r.y + block - 1) / block * block;
+                if (p1 < r.y + r.h) p1 = r.y + (p1 - r.y) / block * block;
+            }
+            if (p1 > p0) parts.push_back({r.x, p0 - top, r.w, p1 - p0});
+        }
+        if (!parts.empty()) {
+            const int rc = blur_apply_regions_ex(ctx, buffer.data(), width, rows, static_cast<int>(stride), format,
+                                                 parts.data(), static_cast<int>(parts.size()), mode, strength);
+            if (rc != 0) return rc;
+        }
+
+        blurcore::StageScope stage(BLUR_STAGE_COPY_OUT, static_cast<int64_t>(stride) * (y1 - y0));
+        const int rc = write(user, y0, y1 - y0, buffer.data() + stride * (y0 - top), static_cast<int>(stride));
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
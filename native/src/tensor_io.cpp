@@ -0,0 +1,99 @@
+// Glue between images and segmentation model tensors. Both directions are a
+// single bilinear pass with the format conversion folded in, so no resized
+// or converted intermediate image is ever made.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "blur.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Half-pixel-centre bilinear tap along one axis: src = (dst + 0.5) * n / m - 0.5
+struct Tap {
+    int i0, i1;
+    float f; // weight of i1
+};
+
+inline Tap tapFor(int dst, int dstSize, int srcSize) {
+    float pos = (dst + 0.5f) * srcSize / dstSize - 0.5f;
+    if (pos < 0) pos = 0;
+    Tap t;
+    t.i0 = std::min(static_cast<int>(pos), srcSize - 1);
+    t.i1 = std::min(t.i0 + 1, srcSize - 1);
+    t.f = pos - t.i0;
+    return t;
+}
+
+} // namespace
+
+extern "C" int blur_image_to_tensor(const uint8_t* pixels, int width, int height, int stride, int format,
+                                    float* tensor, int tensor_width, int tensor_height,
+                                    float scale, float bias) {
+    int bpp, red, blue;
+    switch (format) {
+    case BLUR_FORMAT_RGBA8888: bpp = 4; red = 0; blue = 2; break;
+    case BLUR_FORMAT_BGRA8888: bpp = 4; red = 2; blue = 0; break;
+    case BLUR_FORMAT_RGB888: bpp = 3; red = 0; blue = 2; break;
+    default: return -1;
+    }
+    if (!pixels || !tensor || width <= 0 || height <= 0 || tensor_width <= 0 || tensor_height <= 0) return -1;
+    if (stride == 0) stride = width * bpp;
+    if (stride < width * bpp) return -1;
+
+    for (int ty = 0; ty < tensor_height; ++ty) {
+        const Tap y = tapFor(ty, tensor_height, height);
+        const uint8_t* r0 = pixels + static_cast<ptrdiff_t>(y.i0) * stride;
+        const uint8_t* r1 = pixels + static_cast<ptrdiff_t>(y.i1) * stride;
+        float* out = tensor + static_cast<size_t>(ty) * tensor_width * 3;
+        for (int tx = 0; tx < tensor_width; ++tx, out += 3) {
+            const Tap x = tapFor(tx, tensor_width, width);
+            const uint8_t* p00 = r0 + x.i0 * bpp;
+            const uint8_t* p01 = r0 + x.i1 * bpp;
+            const uint8_t* p10 = r1 + x.i0 * bpp;
+            const uint8_t* p11 = r1 + x.i1 * bpp;
+            const int order[3] = {red, 1, blue};
+            for (int c = 0; c < 3; ++c) {
+                const int k = order[c];
+                const float top = p00[k] + (p01[k] - p00[k]) * x.f;
+                const float bottom = p10[k] + (p11[k] - p10[k]) * x.f;
+                out[c] = (top + (bottom - top) * y.f) * scale + bias;
+            }
+        }
+    }
+    return 0;
+}
+
+extern "C" int blur_tensor_to_mask(const float* scores, int tensor_width, int tensor_height,
+                                   int channels, int channel,
+                                   uint8_t* mask, int width, int height, int mask_stride) {
+    if (!scores || !mask || tensor_width <= 0 || tensor_height <= 0 || width <= 0 || height <= 0) return -1;
+    if (channels <= 0 || channel < 0 || channel >= channels) return -1;
+    if (mask_stride == 0) mask_stride = width;
+    if (mask_stride < width) return -1;
+
+    // Output can be full photo size, so split it into row bands
+    const int bands = std::max(1, std::min(height / 32, 4 * blurcore::configuredThreadCount()));
+    const struct {
+        const float* scores; int tw, th, channels, channel;
+        uint8_t* mask; int width, height, stride, bands;
+    } job = {scores, tensor_width, tensor_height, channels, channel, mask, width, height, mask_stride, bands};
+    blurcore::parallelFor(bands, [&job](int b) {
+        const int yBegin = static_cast<int>(static_cast<int64_t>(job.height) * b / job.bands);
+        const int yEnd = static_cast<int>(static_cast<int64_t>(job.height) * (b + 1) / job.bands);
+        for (int yy = yBegin; yy < yEnd; ++yy) {
+            const Tap y = tapFor(yy, job.height, job.th);
+            const float* r0 = job.scores + static_cast<size_t>(y.i0) * job.tw * job.channels + job.channel;
+            const float* r1 = job.scores + static_cast<size_t>(y.i1) * job.tw * job.channels + job.channel;
+            uint8_t* out = job.mask + static_cast<ptrdiff_t>(yy) * job.stride;
+            for (int xx = 0; xx < job.width; ++xx) {
+                const Tap x = tapFor(xx, job.width, job.tw);
+                const float top = r0[x.i0 * job.channels] + (r0[x.i1 * job.channels] - r0[x.i0 * job.channels]) * x.f;
+                const float bottom = r1[x.i0 * job.channels] + (r1[x.i1 * job.channels] - r1[x.i0 * job.channels]) * x.f;
+                const float v = (top + (bottom - top) * y.f) * 255.0f + 0.5f;
+                out[xx] = static_cast<uint8_t>(v <= 0 ? 0 : (v >= 255 ? 255 : v));
+            }
+        }
+    });
+    return 0;
+}
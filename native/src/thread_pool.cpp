@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include "blur.h"
+#include "thread_pool.h"
+
+namespace blurcore {
+
+ThreadPool::ThreadPool(size_t num_threads) : queue_(std::make_shared<Queue>()) {
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(workerLoop, queue_);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(queue_->mutex);
+        queue_->stop = true;
+    }
+    queue_->condition.notify_all();
+    for (std::thread& worker : workers_) {
+        // Dropping the last reference from one of our own tasks: that worker
+        // exits on its own once the task returns.
+        if (worker.get_id() == std::this_thread::get_id()) {
+            worker.detach();
+        } else {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(std::shared_ptr<Queue> queue) {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queue->mutex);
+            queue->condition.wait(lock, [&] { return queue->stop || !queue->tasks.empty(); });
+            if (queue->stop && queue->tasks.empty()) return;
+            task = std::move(queue->tasks.front());
+            queue->tasks.pop();
+        }
+        task();
+    }
+}
+
+bool ThreadPool::post(std::function<void()> task) {
+    {
+        std::unique_lock<std::mutex> lock(queue_->mutex);
+        if (queue_->stop) return false;
+        queue_->tasks.emplace(std::move(task));
+    }
+    queue_->condition.notify_one();
+    return true;
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& fn, size_t max_helpers) {
+    if (count <= 0) return;
+    if (count == 1 || workers_.empty() || max_helpers == 0) {
+        for (int i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    // Indices are claimed from a shared counter by the caller and by helper
+    // tasks. Helpers that start after every index is claimed never touch fn,
+    // so fn only has to outlive this call.
+    struct State {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    const std::function<void(int)>* body = &fn;
+
+    auto run = [state, body, count]() {
+        int finished = 0;
+        for (int i = state->next.fetch_add(1); i < count; i = state->next.fetch_add(1)) {
+            (*body)(i);
+            ++finished;
+        }
+        if (finished > 0 && state->done.fetch_add(finished) + finished == count) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->cv.notify_all();
+        }
+    };
+
+    const size_t helpers = std::min({static_cast<size_t>(count - 1), workers_.size(), max_helpers});
+    for (size_t i = 0; i < helpers; ++i) post(run);
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done.load() == count; });
+}
+
+static std::mutex g_pool_mutex;
+static std::shared_ptr<ThreadPool> g_pool;
+static int g_requested_threads = 0; // <= 0: one per performance core
+static const int kMaxThreadCount = 256; // more would only spawn idle workers
+static std::atomic<int> g_thread_cap{0};
+static thread_local int t_thread_count = 0; // > 0: ScopedThreadCount in effect
+
+int performanceCoreCount(const std::vector<long>& speeds) {
+    const int all = static_cast<int>(speeds.size());
+    if (all == 0) return 0;
+    const long fastest = *std::max_element(speeds.begin(), speeds.end());
+    const int fast = static_cast<int>(
+        std::count_if(speeds.begin(), speeds.end(), [&](long v) { return v * 5 >= fastest * 4; }));
+    return fast >= 2 ? fast : all;
+}
+
+#ifdef __linux__
+// One value per core from /sys/devices/system/cpu/cpuN/<name>; empty if any
+// core lacks it
+static std::vector<long> readCpuValues(int cpus, const char* name) {
+    std::vector<long> values;
+    for (int cpu = 0; cpu < cpus; ++cpu) {
+        char path[96];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, name);
+        FILE* file = std::fopen(path, "r");
+        if (!file) return {};
+        long value = 0;
+        const bool ok = std::fscanf(file, "%ld", &value) == 1 && value > 0;
+        std::fclose(file);
+        if (!ok) return {};
+        values.push_back(value);
+    }
+    return values;
+}
+#endif
+
+// The kernel's cpu_capacity (big.LITTLE and other hybrid parts) when it is
+// exposed, else cpuinfo_max_freq. All cores when neither is readable.
+static int detectPerformanceCores() {
+    const unsigned hw = std::thread::hardware_concurrency();
+    const int all = hw > 0 ? static_cast<int>(hw) : 1;
+#ifdef __linux__
+    std::vector<long> speeds = readCpuValues(all, "cpu_capacity");
+    if (speeds.empty()) speeds = readCpuValues(all, "cpufreq/cpuinfo_max_freq");
+    return speeds.empty() ? all : performanceCoreCount(speeds);
+#else
+    return all;
+#endif
+}
+
+static int resolveThreadCount(int requested) {
+    if (requested > 0) return requested;
+    static const int cores = detectPerformanceCores();
+    return cores;
+}
+
+std::shared_ptr<ThreadPool> sharedThreadPool() {
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    const int threads = resolveThreadCount(g_requested_threads);
+    if (threads <= 1) return nullptr;
+    if (!g_pool) {
+        // The calling thread always works too, so spawn one fewer worker.
+        g_pool = std::make_shared<ThreadPool>(threads - 1);
+    }
+    return g_pool;
+}
+
+int configuredThreadCount() {
+    int threads;
+    {
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        threads = resolveThreadCount(g_requested_threads);
+    }
+    const int limit = t_thread_count > 0 ? t_thread_count : g_thread_cap.load(std::memory_order_relaxed);
+    return limit > 0 ? std::min(threads, limit) : threads;
+}
+
+void setThreadCap(int threads) {
+    g_thread_cap.store(std::max(0, threads), std::memory_order_relaxed);
+}
+
+ScopedThreadCount::ScopedThreadCount(int threads) : previous_(t_thread_count) {
+    t_thread_count = std::max(1, threads);
+}
+
+ScopedThreadCount::~ScopedThreadCount() {
+    t_thread_count = previous_;
+}
+
+void parallelFor(int count, const std::function<void(int)>& fn) {
+    const int threads = configuredThreadCount();
+    std::shared_ptr<ThreadPool> pool = threads > 1 ? sharedThreadPool() : nullptr;
+    if (!pool) {
+        for (int i = 0; i < count; ++i) fn(i);
+        return;
+    }
+    pool->parallelFor(count, fn, static_cast<size_t>(threads - 1));
+}
+
+} // namespace blurcore
+
+extern "C" int blur_set_thread_count(int threads) {
+    if (threads > blurcore::kMaxThreadCount) return -1;
+    std::shared_ptr<blurcore::ThreadPool> old;
+    {
+        std::lock_guard<std::mutex> lock(blurcore::g_pool_mutex);
+        if (blurcore::resolveThreadCount(threads) == blurcore::resolveThreadCount(blurcore::g_requested_threads)) {
+            blurcore::g_requested_threads = threads;
+            return 0;
+        }
+        blurcore::g_requested_threads = threads;
+        // Calls already running keep their reference; the old workers exit
+        // once the last of them returns.
+        old = std::move(blurcore::g_pool);
+    }
+    return 0;
+}
+
+extern "C" int blur_get_thread_count(void) {
+    return blurcore::configuredThreadCount();
+}
+
+extern "C" int64_t blur_warm_up(void) {
+    static std::once_flag once;
+    static int64_t elapsed = 0;
+    std::call_once(once, [] {
+        const auto start = std::chrono::steady_clock::now();
+        blur_get_simd_level();
+        blurcore::sharedThreadPool(); // spawns the workers
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    });
+    return elapsed;
+}
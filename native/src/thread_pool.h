@@ -0,0 +1,101 @@
+// Shared worker pool for the portable blur core and the platform engines.
+// Persistent threads are created once and reused for every call; the thread
+// count is controlled through blur_set_thread_count().
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <queue>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+namespace blurcore {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    template<class F, class... Args>
+    auto enqueue(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+        using return_type = decltype(f(args...));
+
+        auto task = std::make_shared<std::packaged_task<return_type()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        );
+
+        std::future<return_type> res = task->get_future();
+        if (!post([task]() { (*task)(); })) return std::future<return_type>();
+        return res;
+    }
+
+    // Queue a fire-and-forget task. returns false if the pool is stopping.
+    bool post(std::function<void()> task);
+
+    // Run fn(i) for every i in [0, count). The calling thread takes part, so
+    // this is safe to call from inside a pool task and never deadlocks. At
+    // most max_helpers workers join in.
+    void parallelFor(int count, const std::function<void(int)>& fn, size_t max_helpers = SIZE_MAX);
+
+private:
+    // Owned jointly by the pool and its workers, so a worker can safely
+    // finish its loop even if the pool is destroyed from inside a task.
+    struct Queue {
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stop = false;
+    };
+
+    static void workerLoop(std::shared_ptr<Queue> queue);
+
+    std::shared_ptr<Queue> queue_;
+    std::vector<std::thread> workers_;
+};
+
+// Process-wide pool sized by blur_set_thread_count(). Returns nullptr when
+// the core is configured to run single-threaded.
+std::shared_ptr<ThreadPool> sharedThreadPool();
+
+// Performance cores among per-core speeds (cpu_capacity or
+// cpuinfo_max_freq): those within 20% of the fastest. Cores further below
+// form an efficiency cluster; small differences such as favored-core turbo
+// on x86 do not. returns speeds.size() when that would leave fewer than two.
+int performanceCoreCount(const std::vector<long>& speeds);
+
+// Total number of threads (workers + caller) the core will use on this
+// thread, after the cap and any ScopedThreadCount.
+int configuredThreadCount();
+
+// Process-wide ceiling on the threads a parallelFor may use (0 lifts it).
+// The pool keeps its workers; calls just enlist fewer of them. The governor
+// lowers it under thermal or battery pressure.
+void setThreadCap(int threads);
+
+// Runs this thread's parallelFor calls on exactly `threads` threads (never
+// more than blur_set_thread_count resolved to), ignoring the cap, until it
+// goes out of scope. Pool workers are not affected.
+class ScopedThreadCount {
+public:
+    explicit ScopedThreadCount(int threads);
+    ~ScopedThreadCount();
+
+    ScopedThreadCount(const ScopedThreadCount&) = delete;
+    ScopedThreadCount& operator=(const ScopedThreadCount&) = delete;
+
+private:
+    int previous_;
+};
+
+// parallelFor on the shared pool, or inline when running single-threaded.
+void parallelFor(int count, const std::function<void(int)>& fn);
+
+} // namespace blurcore
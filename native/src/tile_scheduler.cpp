@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "tile_scheduler.h"
+#include "thread_pool.h"
+
+namespace blurcore {
+
+namespace {
+
+const int kDefaultTile = 256;
+
+// A worker's remaining tiles [begin, end), packed so the owner taking from
+// the front and a thief taking from the back agree through one CAS.
+struct alignas(64) Run {
+    std::atomic<uint64_t> bits{0};
+
+    static uint64_t pack(uint32_t begin, uint32_t end) { return static_cast<uint64_t>(begin) << 32 | end; }
+    static uint32_t begin(uint64_t v) { return static_cast<uint32_t>(v >> 32); }
+    static uint32_t end(uint64_t v) { return static_cast<uint32_t>(v); }
+};
+
+struct Layout {
+    int tileWidth, tileHeight, tilesX, tilesY;
+};
+
+Layout layoutOf(const TileGrid& grid) {
+    Layout l;
+    l.tileWidth = grid.tileWidth > 0 ? grid.tileWidth : kDefaultTile;
+    l.tileHeight = grid.tileHeight > 0 ? grid.tileHeight : kDefaultTile;
+    l.tilesX = grid.width > 0 ? (grid.width + l.tileWidth - 1) / l.tileWidth : 0;
+    l.tilesY = grid.height > 0 ? (grid.height + l.tileHeight - 1) / l.tileHeight : 0;
+    return l;
+}
+
+Tile tileAt(const TileGrid& grid, const Layout& l, int index) {
+    const int halo = std::max(grid.halo, 0);
+    Tile t;
+    t.index = index;
+    t.x0 = index % l.tilesX * l.tileWidth;
+    t.y0 = index / l.tilesX * l.tileHeight;
+    t.x1 = std::min(t.x0 + l.tileWidth, grid.width);
+    t.y1 = std::min(t.y0 + l.tileHeight, grid.height);
+    t.hx0 = std::max(t.x0 - halo, 0);
+    t.hy0 = std::max(t.y0 - halo, 0);
+    t.hx1 = std::min(t.x1 + halo, grid.width);
+    t.hy1 = std::min(t.y1 + halo, grid.height);
+    return t;
+}
+
+// Take the front tile of our own run; -1 once it is empty.
+int popOwn(Run& run) {
+    uint64_t v = run.bits.load();
+    while (Run::begin(v) < Run::end(v)) {
+        if (run.bits.compare_exchange_weak(v, Run::pack(Run::begin(v) + 1, Run::end(v)))) {
+            return static_cast<int>(Run::begin(v));
+        }
+    }
+    return -1;
+}
+
+// Move the back half of the longest other run into ours (which is empty).
+bool steal(Run* runs, int workers, int self) {
+    for (;;) {
+        int victim = -1;
+        uint32_t longest = 0;
+        uint64_t seen = 0;
+        for (int w = 0; w < workers; ++w) {
+            if (w == self) continue;
+            const uint64_t v = runs[w].bits.load();
+            const uint32_t left = Run::end(v) > Run::begin(v) ? Run::end(v) - Run::begin(v) : 0;
+            if (left > longest) {
+                longest = left;
+                victim = w;
+                seen = v;
+            }
+        }
+        if (victim < 0) return false;
+        const uint32_t take = (longest + 1) / 2;
+        const uint32_t end = Run::end(seen);
+        if (runs[victim].bits.compare_exchange_strong(seen, Run::pack(Run::begin(seen), end - take))) {
+            // Nobody steals from an empty run, so a plain store is safe
+            runs[self].bits.store(Run::pack(end - take, end));
+            return true;
+        }
+    }
+}
+
+} // namespace
+
+int tileWorkerCount(const TileGrid& grid) {
+    const Layout l = layoutOf(grid);
+    const int tiles = l.tilesX * l.tilesY;
+    return std::max(1, std::min(configuredThreadCount(), tiles));
+}
+
+void forEachTile(const TileGrid& grid, const std::function<void(const Tile&, int worker)>& fn) {
+    const Layout l = layoutOf(grid);
+    const int tiles = l.tilesX * l.tilesY;
+    if (tiles <= 0) return;
+    const int workers = tileWorkerCount(grid);
+    if (workers == 1) {
+        for (int i = 0; i < tiles; ++i) fn(tileAt(grid, l, i), 0);
+        return;
+    }
+
+    // Neighbouring tiles start on the same worker for locality
+    std::unique_ptr<Run[]> runs(new Run[workers]);
+    for (int w = 0; w < workers; ++w) {
+        runs[w].bits.store(Run::pack(static_cast<uint32_t>(static_cast<int64_t>(tiles) * w / workers),
+                                     static_cast<uint32_t>(static_cast<int64_t>(tiles) * (w + 1) / workers)));
+    }
+    struct Job {
+        const TileGrid& grid;
+        const Layout& layout;
+        const std::function<void(const Tile&, int)>& fn;
+        Run* runs;
+        int workers;
+    } job = {grid, l, fn, runs.get(), workers};
+
+    // A worker index may run late on a thread that already finished another
+    // one; it then simply steals whatever is left.
+    parallelFor(workers, [&job](int w) {
+        do {
+            for (int i = popOwn(job.runs[w]); i >= 0; i = popOwn(job.runs[w])) {
+                job.fn(tileAt(job.grid, job.layout, i), w);
+            }
+        } while (steal(job.runs, job.workers, w));
+    });
+}
+
+} // namespace blurcore
@@ -0,0 +1,33 @@
+// 2D tile scheduler on the shared worker pool. The image is cut into a grid
+// of tiles; each tile also carries its halo, the extra border an operation
+// has to read around the tile to produce it exactly (its blur radius,
+// structuring element, ...). Tiles are dealt out to workers in contiguous
+// runs, and a worker that runs out steals half of the longest remaining
+// run, so tiles of very different cost (mask-skipped ones return at once)
+// still keep every core busy.
+#pragma once
+#include <functional>
+
+namespace blurcore {
+
+struct Tile {
+    int index;          // row-major position in the grid
+    int x0, y0, x1, y1; // pixels the tile produces, exclusive end
+    int hx0, hy0, hx1, hy1; // plus the halo, clipped to the image
+};
+
+struct TileGrid {
+    int width, height;
+    int tileWidth, tileHeight; // <= 0: 256
+    int halo;
+};
+
+// Number of distinct worker ids forEachTile can pass for this grid.
+int tileWorkerCount(const TileGrid& grid);
+
+// Run fn(tile, worker) once for every tile. worker is in
+// [0, tileWorkerCount(grid)) and no two calls with the same worker overlap,
+// so it can index per-worker scratch. Returns once every tile is done.
+void forEachTile(const TileGrid& grid, const std::function<void(const Tile&, int worker)>& fn);
+
+} // namespace blurcore
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "blur.h"
+#include "buffer_pool.h"
+#include "session.h"
+#include "trace.h"
+
+#if defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__ANDROID__)
+#include <android/trace.h>
+#elif defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__APPLE__)
+#include <os/signpost.h>
+#endif
+
+namespace blurcore {
+
+std::atomic<bool> g_statsEnabled{true};
+
+namespace {
+
+const char* const kStageNames[BLUR_STAGE_COUNT] = {
+    "copy_in", "blur_h", "blur_v", "pixelate", "integral", "blend", "copy_out", "mask",
+};
+
+// Log-linear buckets: four per power of two, so a percentile read from a
+// bucket midpoint is within about 12% of the true value. Values below 4 ns
+// get a bucket each.
+const int kSubBits = 2;
+const int kBuckets = 64 << kSubBits;
+
+int bucketOf(int64_t ns) {
+    if (ns < (1 << kSubBits)) return static_cast<int>(std::max<int64_t>(ns, 0));
+    int msb = 63;
+    while (!(static_cast<uint64_t>(ns) >> msb)) --msb;
+    const int sub = static_cast<int>((static_cast<uint64_t>(ns) >> (msb - kSubBits)) & ((1 << kSubBits) - 1));
+    return (msb << kSubBits) | sub;
+}
+
+int64_t bucketMid(int bucket) {
+    if (bucket < (1 << kSubBits)) return bucket;
+    const int msb = bucket >> kSubBits;
+    const int64_t width = static_cast<int64_t>(1) << (msb - kSubBits);
+    const int64_t low = ((1 << kSubBits) + (bucket & ((1 << kSubBits) - 1))) * width;
+    return low + width / 2;
+}
+
+struct StageHistogram {
+    std::atomic<int64_t> count{0};
+    std::atomic<int64_t> totalNs{0};
+    std::atomic<int64_t> maxNs{0};
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> buckets[kBuckets] = {};
+};
+
+StageHistogram g_stages[BLUR_STAGE_COUNT];
+
+// Pool counters are cumulative; reset moves the baseline instead
+std::atomic<int64_t> g_poolHitsBase{0};
+std::atomic<int64_t> g_poolMissesBase{0};
+std::atomic<int64_t> g_layerHitsBase{0};
+std::atomic<int64_t> g_layerMissesBase{0};
+std::atomic<int64_t> g_layerInterpolatedBase{0};
+
+int64_t percentile(const int64_t* counts, int64_t total, int64_t maxNs, double q) {
+    if (total == 0) return 0;
+    const int64_t rank = std::max<int64_t>(1, static_cast<int64_t>(q * total + 0.5));
+    int64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += counts[b];
+        if (seen >= rank) return std::min(bucketMid(b), maxNs);
+    }
+    return maxNs;
+}
+
+#if defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__APPLE__)
+os_log_t traceLog() {
+    static os_log_t log = os_log_create("com.example.blurapp", "blurcore");
+    return log;
+}
+
+// Signpost names must be string literals
+#define BLUR_SIGNPOST_STAGES(call, log, id, stage)                   \
+    switch (stage) {                                                  \
+    case BLUR_STAGE_COPY_IN: call(log, id, "copy_in"); break;         \
+    case BLUR_STAGE_BLUR_H: call(log, id, "blur_h"); break;           \
+    case BLUR_STAGE_BLUR_V: call(log, id, "blur_v"); break;           \
+    case BLUR_STAGE_PIXELATE: call(log, id, "pixelate"); break;       \
+    case BLUR_STAGE_INTEGRAL: call(log, id, "integral"); break;       \
+    case BLUR_STAGE_BLEND: call(log, id, "blend"); break;             \
+    case BLUR_STAGE_COPY_OUT: call(log, id, "copy_out"); break;       \
+    default: call(log, id, "mask"); break;                            \
+    }
+#endif
+
+} // namespace
+
+int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void recordStage(int stage, int64_t ns, int64_t bytes) {
+    if (stage < 0 || stage >= BLUR_STAGE_COUNT) return;
+    StageHistogram& h = g_stages[stage];
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    if (bytes) h.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    h.buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    int64_t seen = h.maxNs.load(std::memory_order_relaxed);
+    while (ns > seen && !h.maxNs.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t beginTraceSection(int stage) {
+#if defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__ANDROID__)
+    ATrace_beginSection(blur_stage_name(stage));
+    return 0;
+#elif defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__APPLE__)
+    os_log_t log = traceLog();
+    if (!os_signpost_enabled(log)) return 0;
+    const os_signpost_id_t id = os_signpost_id_generate(log);
+    BLUR_SIGNPOST_STAGES(os_signpost_interval_begin, log, id, stage)
+    return id;
+#else
+    (void)stage;
+    return 0;
+#endif
+}
+
+void endTraceSection(int stage, uint64_t id) {
+#if defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__ANDROID__)
+    (void)stage;
+    (void)id;
+    ATrace_endSection();
+#elif defined(BLUR_ENABLE_PLATFORM_TRACE) && defined(__APPLE__)
+    if (id == 0) return;
+    BLUR_SIGNPOST_STAGES(os_signpost_interval_end, traceLog(), id, stage)
+#else
+    (void)stage;
+    (void)id;
+#endif
+}
+
+void appendf(std::string& out, const char* fmt, ...) {
+    char piece[256];
+    va_list args;
+    va_start(args, fmt);
+    const int n = std::vsnprintf(piece, sizeof(piece), fmt, args);
+    va_end(args);
+    if (n > 0) out.append(piece, std::min<size_t>(static_cast<size_t>(n), sizeof(piece) - 1));
+}
+
+} // namespace blurcore
+
+extern "C" const char* blur_stage_name(int stage) {
+    return stage >= 0 && stage < BLUR_STAGE_COUNT ? blurcore::kStageNames[stage] : nullptr;
+}
+
+extern "C" int blur_stats_enable(int enabled) {
+    return blurcore::g_statsEnabled.exchange(enabled != 0) ? 1 : 0;
+}
+
+extern "C" void blur_stats_reset(void) {
+    for (blurcore::StageHistogram& h : blurcore::g_stages) {
+        h.count.store(0);
+        h.totalNs.store(0);
+        h.maxNs.store(0);
+        h.bytes.store(0);
+        for (std::atomic<int64_t>& b : h.buckets) b.store(0);
+    }
+    const blurcore::BufferPoolStats pool = blurcore::bufferPoolStats();
+    blurcore::g_poolHitsBase.store(pool.hits);
+    blurcore::g_poolMissesBase.store(pool.misses);
+    const blurcore::LayerCacheStats layers = blurcore::layerCacheStats();
+    blurcore::g_layerHitsBase.store(layers.hits);
+    blurcore::g_layerMissesBase.store(layers.misses);
+    blurcore::g_layerInterpolatedBase.store(layers.interpolated);
+}
+
+extern "C" int blur_stats_read(BlurStats* out) {
+    if (!out) return -1;
+    std::memset(out, 0, sizeof(*out));
+    int64_t counts[blurcore::kBuckets];
+    for (int s = 0; s < BLUR_STAGE_COUNT; ++s) {
+        const blurcore::StageHistogram& h = blurcore::g_stages[s];
+        BlurStageStats& st = out->stages[s];
+        int64_t total = 0;
+        for (int b = 0; b < blurcore::kBuckets; ++b) {
+            counts[b] = h.buckets[b].load(std::memory_order_relaxed);
+            total += counts[b];
+        }
+        st.count = total;
+        st.total_ns = h.totalNs.load(std::memory_order_relaxed);
+        st.max_ns = h.maxNs.load(std::memory_order_relaxed);
+        st.bytes = h.bytes.load(std::memory_order_relaxed);
+        st.p50_ns = blurcore::percentile(counts, total, st.max_ns, 0.50);
+        st.p90_ns = blurcore::percentile(counts, total, st.max_ns, 0.90);
+        st.p99_ns = blurcore::percentile(counts, total, st.max_ns, 0.99);
+    }
+    const blurcore::BufferPoolStats pool = blurcore::bufferPoolStats();
+    out->pool_hits = pool.hits - blurcore::g_poolHitsBase.load();
+    out->pool_misses = pool.misses - blurcore::g_poolMissesBase.load();
+    out->pool_idle_bytes = pool.pooledBytes;
+    out->pool_in_use_bytes = pool.inUseBytes;
+    const blurcore::LayerCacheStats layers = blurcore::layerCacheStats();
+    out->layer_cache_hits = layers.hits - blurcore::g_layerHitsBase.load();
+    out->layer_cache_misses = layers.misses - blurcore::g_layerMissesBase.load();
+    out->layer_cache_interpolated = layers.interpolated - blurcore::g_layerInterpolatedBase.load();
+    out->layer_cache_bytes = layers.bytes;
+    out->layer_cache_limit_bytes = layers.limitBytes;
+    out->layer_cache_layers = layers.layers;
+    return 0;
+}
+
+extern "C" int blur_stats_json(char* buf, int capacity) {
+    BlurStats stats;
+    blur_stats_read(&stats);
+    std::string json = "{\"stages\":{";
+    for (int s = 0; s < BLUR_STAGE_COUNT; ++s) {
+        const BlurStageStats& st = stats.stages[s];
+        blurcore::appendf(json,
+                          "%s\"%s\":{\"count\":%" PRId64 ",\"total_ns\":%" PRId64 ",\"max_ns\":%" PRId64
+                          ",\"p50_ns\":%" PRId64 ",\"p90_ns\":%" PRId64 ",\"p99_ns\":%" PRId64
+                          ",\"bytes\":%" PRId64 "}",
+                          s ? "," : "", blur_stage_name(s), st.count, st.total_ns, st.max_ns,
+                          st.p50_ns, st.p90_ns, st.p99_ns, st.bytes);
+    }
+    const int64_t lookups = stats.pool_hits + stats.pool_misses;
+    blurcore::appendf(json,
+                      "},\"pool\":{\"hits\":%" PRId64 ",\"misses\":%" PRId64 ",\"hit_rate\":%.4f"
+                      ",\"idle_bytes\":%" PRId64 ",\"in_use_bytes\":%" PRId64 "}",
+                      stats.pool_hits, stats.pool_misses,
+                      lookups ? static_cast<double>(stats.pool_hits) / lookups : 0.0,
+                      stats.pool_idle_bytes, stats.pool_in_use_bytes);
+    blurcore::appendf(json,
+                      ",\"layer_cache\":{\"hits\":%" PRId64 ",\"misses\":%" PRId64 ",\"interpolated\":%" PRId64
+                      ",\"bytes\":%" PRId64 ",\"limit_bytes\":%" PRId64 ",\"layers\":%" PRId64 "}}",
+                      stats.layer_cache_hits, stats.layer_cache_misses, stats.layer_cache_interpolated,
+                      stats.layer_cache_bytes, stats.layer_cache_limit_bytes, stats.layer_cache_layers);
+
+    if (buf && capacity > 0) {
+        const size_t n = std::min(json.size(), static_cast<size_t>(capacity - 1));
+        std::memcpy(buf, json.data(), n);
+        buf[n] = '\0';
+    }
+    return static_cast<int>(json.size());
+}
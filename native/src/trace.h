@@ -0,0 +1,51 @@
+// Hot-path instrumentation. A StageScope times one stage of a call (a whole
+// pass, not a row) into a per-stage histogram and, when the build enables
+// platform tracing, opens an ATrace section on Android or an os_signpost
+// interval on Apple platforms so the stage shows up in system traces.
+// Recording is a few relaxed atomic adds; blur_stats_enable(0) turns the
+// histograms off entirely.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "blur.h"
+
+namespace blurcore {
+
+extern std::atomic<bool> g_statsEnabled;
+
+int64_t monotonicNs();
+
+void recordStage(int stage, int64_t ns, int64_t bytes);
+
+// printf-append to out, for the JSON reports (up to 255 bytes per call)
+void appendf(std::string& out, const char* fmt, ...);
+
+// Platform trace sections; no-ops unless built with BLUR_ENABLE_PLATFORM_TRACE
+uint64_t beginTraceSection(int stage);
+void endTraceSection(int stage, uint64_t id);
+
+class StageScope {
+public:
+    explicit StageScope(int stage, int64_t bytes = 0) : stage_(stage), bytes_(bytes) {
+        traceId_ = beginTraceSection(stage);
+        if (g_statsEnabled.load(std::memory_order_relaxed)) start_ = monotonicNs();
+    }
+    ~StageScope() {
+        if (start_ >= 0) recordStage(stage_, monotonicNs() - start_, bytes_);
+        endTraceSection(stage_, traceId_);
+    }
+    StageScope(const StageScope&) = delete;
+    StageScope& operator=(const StageScope&) = delete;
+
+    // For copies whose size is only known once they are done
+    void addBytes(int64_t bytes) { bytes_ += bytes; }
+
+private:
+    int stage_;
+    int64_t bytes_;
+    int64_t start_ = -1;
+    uint64_t traceId_ = 0;
+};
+
+} // namespace blurcore
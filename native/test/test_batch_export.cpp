@@ -0,0 +1,181 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// Batch pipeline with in-memory "codecs": results match a direct blur,
+// progress arrives in order, failures stay per image, the in-flight limits
+// hold, and cancel stops the job early without leaking decoded images.
+namespace {
+
+const int W = 48, H = 32;
+
+std::vector<uint8_t> source(int index) {
+    std::vector<uint8_t> px(W * H * 4);
+    for (size_t i = 0; i < px.size(); ++i) px[i] = static_cast<uint8_t>((i * 7 + index * 31) ^ (i >> 5));
+    return px;
+}
+
+struct Job {
+    std::atomic<int> inFlight{0};
+    std::atomic<int> maxInFlight{0};
+    std::atomic<int> decoded{0};
+    std::atomic<int> released{0};
+    std::mutex mutex;
+    std::vector<int> order;
+    int encoded = 0;
+    int mismatches = 0;
+    int cancelAfter = -1;
+    BlurBatch* batch = nullptr;
+    bool useDetect = false;
+};
+
+int decode(void* user, int, const char* path, BlurBatchImage* image) {
+    Job* job = static_cast<Job*>(user);
+    if (std::strcmp(path, "bad") == 0) return -7;
+    std::vector<uint8_t>* px = new std::vector<uint8_t>(source(std::atoi(path)));
+    image->pixels = px->data();
+    image->width = W;
+    image->height = H;
+    image->stride = W * 4;
+    image->format = BLUR_FORMAT_RGBA8888;
+    image->opaque = px;
+    const int now = job->inFlight.fetch_add(1) + 1;
+    int seen = job->maxInFlight.load();
+    while (now > seen && !job->maxInFlight.compare_exchange_weak(seen, now)) {}
+    job->decoded.fetch_add(1);
+    return 0;
+}
+
+int detect(void*, int, const BlurBatchImage* image, BlurRect* rects, int max_rects) {
+    if (max_rects < 1) return -1;
+    rects[0] = {0, 0, image->width / 2, image->height};
+    return 1;
+}
+
+int encode(void* user, int index, const BlurBatchImage* image) {
+    Job* job = static_cast<Job*>(user);
+    std::vector<uint8_t> expected = source(index);
+    const BlurRect rect = job->useDetect ? BlurRect{0, 0, W / 2, H} : BlurRect{4, 4, 20, 12};
+    blur_apply_regions(expected.data(), W, H, &rect, 1, 2, 3);
+    std::lock_guard<std::mutex> lock(job->mutex);
+    ++job->encoded;
+    if (std::memcmp(expected.data(), image->pixels, expected.size()) != 0) ++job->mismatches;
+    return 0;
+}
+
+void release(void* user, int, BlurBatchImage* image) {
+    Job* job = static_cast<Job*>(user);
+    delete static_cast<std::vector<uint8_t>*>(image->opaque);
+    job->inFlight.fetch_sub(1);
+    job->released.fetch_add(1);
+}
+
+void progress(void* user, int index, int, int done, int) {
+    Job* job = static_cast<Job*>(user);
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->order.push_back(index);
+    if (done == job->cancelAfter) blur_batch_cancel(job->batch);
+}
+
+} // namespace
+
+int main() {
+    blur_set_thread_count(4);
+    const BlurBatchCallbacks callbacks = {decode, detect, encode, release, progress, nullptr};
+
+    // Detected rects, one undecodable file, at most 2 images in flight
+    {
+        Job job;
+        job.useDetect = true;
+        std::vector<std::string> names = {"0", "1", "2", "bad", "4", "5", "6", "7"};
+        std::vector<const char*> paths;
+        for (const std::string& n : names) paths.push_back(n.c_str());
+        BlurBatchCallbacks cb = callbacks;
+        cb.user = &job;
+        const BlurBatchSpec spec = {2, 3, nullptr, 0, 2, 0};
+        BlurBatch* batch = blur_batch_start(paths.data(), static_cast<int>(paths.size()), &spec, &cb);
+        if (!batch) {
+            std::cerr << "batch did not start\n";
+            return 1;
+        }
+        const int rc = blur_batch_wait(batch);
+        int done = 0, failed = 0;
+        const int finished = blur_batch_progress(batch, &done, &failed);
+        blur_batch_destroy(batch);
+        if (rc != -7 || finished != 1 || done != 8 || failed != 1) {
+            std::cerr << "unexpected result " << rc << " done " << done << " failed " << failed << "\n";
+            return 2;
+        }
+        if (job.encoded != 7 || job.mismatches != 0) {
+            std::cerr << "encoded " << job.encoded << " images, " << job.mismatches << " mismatched\n";
+            return 3;
+        }
+        for (int i = 0; i < 8; ++i)
+            if (job.order[i] != i) {
+                std::cerr << "progress out of order\n";
+                return 4;
+            }
+        if (job.maxInFlight.load() > 2 || job.released.load() != job.decoded.load()) {
+            std::cerr << "in-flight limit broken or images leaked\n";
+            return 5;
+        }
+    }
+
+    // Fixed rects, a byte budget of one image, cancelled from progress
+    {
+        Job job;
+        job.cancelAfter = 3;
+        std::vector<std::string> names;
+        for (int i = 0; i < 20; ++i) names.push_back(std::to_string(i));
+        std::vector<const char*> paths;
+        for (const std::string& n : names) paths.push_back(n.c_str());
+        BlurBatchCallbacks cb = callbacks;
+        cb.detect = nullptr;
+        cb.user = &job;
+        const BlurRect rect = {4, 4, 20, 12};
+        const BlurBatchSpec spec = {2, 3, &rect, 1, 8, static_cast<int64_t>(W) * H * 4};
+        {
+            // progress may run before start returns
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.batch = blur_batch_start(paths.data(), static_cast<int>(paths.size()), &spec, &cb);
+        }
+        if (!job.batch) {
+            std::cerr << "second batch did not start\n";
+            return 6;
+        }
+        const int rc = blur_batch_wait(job.batch);
+        blur_batch_destroy(job.batch);
+        if (rc != -5 || job.encoded < 3 || job.encoded >= 20 || job.mismatches != 0) {
+            std::cerr << "cancel result " << rc << " after " << job.encoded << " images\n";
+            return 7;
+        }
+        if (job.maxInFlight.load() != 1 || job.released.load() != job.decoded.load()) {
+            std::cerr << "byte budget broken or images leaked\n";
+            return 8;
+        }
+    }
+
+    const char* one[] = {"0"};
+    const BlurBatchSpec spec = {2, 3, nullptr, 0, 0, 0};
+    BlurBatchCallbacks noEncode = callbacks;
+    noEncode.encode = nullptr;
+    const BlurBatchSpec badMode = {9, 3, nullptr, 0, 0, 0};
+    if (blur_batch_start(nullptr, 1, &spec, &callbacks) || blur_batch_start(one, 0, &spec, &callbacks) ||
+        blur_batch_start(one, 1, &spec, &noEncode) || blur_batch_start(one, 1, &badMode, &callbacks)) {
+        std::cerr << "bad arguments accepted\n";
+        return 9;
+    }
+    if (blur_batch_progress(nullptr, nullptr, nullptr) != -1 || blur_batch_wait(nullptr) != -1) {
+        std::cerr << "null batch accepted\n";
+        return 10;
+    }
+
+    std::cout << "batch export tests passed\n";
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "../include/blur.h"
+
+// Count every heap allocation in the process so we can check that a warmed
+// up BlurContext does none.
+static long g_allocations = 0;
+
+void* operator new(std::size_t n) {
+    ++g_allocations;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t n) {
+    ++g_allocations;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    ++g_allocations;
+    return std::malloc(n ? n : 1);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    ++g_allocations;
+    return std::malloc(n ? n : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    // The shared pool's bookkeeping allocates; the guarantee is for the
+    // blur itself.
+    blur_set_thread_count(1);
+
+    const int W = 96, H = 64;
+    std::srand(5);
+    std::vector<uint8_t> src(W * H * 4);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+
+    const BlurRect rects[] = {
+        {0, 0, 40, 30},
+        {20, 10, 50, 40}, // overlaps the first: separate batch
+        {60, 40, 36, 24},
+    };
+
+    BlurContext* ctx = blur_context_create();
+    if (!ctx) {
+        std::cerr << "blur_context_create failed\n";
+        return 1;
+    }
+
+    for (int mode = 0; mode <= 4; ++mode) {
+        std::vector<uint8_t> expected = src;
+        if (blur_apply_regions(expected.data(), W, H, rects, 3, mode, 5) != 0) {
+            std::cerr << "blur_apply_regions failed (mode " << mode << ")\n";
+            return 2;
+        }
+
+        std::vector<uint8_t> warm = src, actual = src;
+        if (blur_apply_regions_ctx(ctx, warm.data(), W, H, rects, 3, mode, 5) != 0) {
+            std::cerr << "blur_apply_regions_ctx failed (mode " << mode << ")\n";
+            return 3;
+        }
+
+        const long before = g_allocations;
+        const int rc = blur_apply_regions_ctx(ctx, actual.data(), W, H, rects, 3, mode, 5);
+        const long allocated = g_allocations - before;
+        if (rc != 0) {
+            std::cerr << "blur_apply_regions_ctx failed (mode " << mode << ")\n";
+            return 3;
+        }
+        if (allocated != 0) {
+            std::cerr << "warm context allocated " << allocated << " times (mode " << mode << ")\n";
+            return 4;
+        }
+        if (warm != expected || actual != expected) {
+            std::cerr << "context output differs from blur_apply_regions (mode " << mode << ")\n";
+            return 5;
+        }
+    }
+
+    if (blur_context_scratch_bytes(ctx) == 0) {
+        std::cerr << "context holds no scratch after a box blur\n";
+        return 6;
+    }
+    blur_context_destroy(ctx);
+
+    if (blur_apply_regions_ctx(nullptr, src.data(), W, H, rects, 3, 0, 5) != -1) {
+        std::cerr << "NULL context must be rejected\n";
+        return 7;
+    }
+
+    std::cout << "Native blur context test OK" << std::endl;
+    return 0;
+}
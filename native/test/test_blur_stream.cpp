@@ -0,0 +1,168 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// Keyframe cadence, tile reuse on a still or panning scene, scene cuts and
+// that every frame matches blur_apply_masked with the mask in use.
+struct Detector {
+    int calls = 0;
+    int cx = 0; // foreground disc centre, follows the "camera"
+    int cy = 0;
+};
+
+static int detectDisc(void* user, const uint8_t*, int width, int height, int, int,
+                      uint8_t* mask, int mask_stride) {
+    Detector* d = static_cast<Detector*>(user);
+    ++d->calls;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x) {
+            const int dx = x - d->cx, dy = y - d->cy;
+            mask[y * mask_stride + x] = dx * dx + dy * dy < 40 * 40 ? 255 : 0;
+        }
+    return 0;
+}
+
+// A textured scene viewed through a window starting at (ox, oy)
+static std::vector<uint8_t> frameAt(const std::vector<uint8_t>& world, int WW, int W, int H, int ox, int oy) {
+    std::vector<uint8_t> f(W * H * 4);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+            for (int c = 0; c < 4; ++c) f[(y * W + x) * 4 + c] = world[((y + oy) * WW + x + ox) * 4 + c];
+    return f;
+}
+
+int main() {
+    const int W = 320, H = 192, WW = 400, WH = 260;
+    std::srand(5);
+    std::vector<uint8_t> world(WW * WH * 4);
+    for (int y = 0; y < WH; ++y)
+        for (int x = 0; x < WW; ++x)
+            for (int c = 0; c < 4; ++c)
+                world[(y * WW + x) * 4 + c] = static_cast<uint8_t>(((x / 6 + y / 9) % 7) * 30 + (std::rand() & 7));
+
+    const BlurStreamConfig config = {4, 40, 3, 255, 2, 0, 6};
+    BlurStream* stream = blur_stream_create(W, H, BLUR_FORMAT_RGBA8888, &config);
+    if (!stream) return 1;
+    Detector det;
+    det.cx = 160;
+    det.cy = 96;
+
+    BlurStreamStats st;
+    const BlurStreamConfig bad = {4, 40, 3, 255, 1, 0, 6};
+    if (blur_stream_create(W, H, BLUR_FORMAT_RGBA8888, &bad) || blur_stream_create(W, H, BLUR_FORMAT_NV21, &config)) {
+        std::cerr << "bad stream config accepted\n";
+        return 2;
+    }
+
+    // The mask the detector draws for a given disc centre, for references
+    auto expectedFor = [&](const std::vector<uint8_t>& src, int cx, int cy) {
+        Detector ref;
+        ref.cx = cx;
+        ref.cy = cy;
+        std::vector<uint8_t> mask(W * H), out = src;
+        detectDisc(&ref, nullptr, W, H, 0, 0, mask.data(), W);
+        blur_apply_masked(nullptr, out.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 2, 0, 6);
+        return out;
+    };
+
+    // Still camera: frame 0 is a keyframe with every tile blurred, the next
+    // ones reuse everything until the interval forces a keyframe
+    const std::vector<uint8_t> still = frameAt(world, WW, W, H, 20, 20);
+    const std::vector<uint8_t> stillExpected = expectedFor(still, 160, 96);
+    for (int i = 0; i < 5; ++i) {
+        std::vector<uint8_t> f = still;
+        if (blur_stream_process(stream, f.data(), 0, detectDisc, &det) != 0) return 3;
+        blur_stream_stats(stream, &st);
+        if (f != stillExpected) {
+            std::cerr << "still frame " << i << " differs from blur_apply_masked\n";
+            return 4;
+        }
+        const bool key = i == 0 || i == 4;
+        if (st.keyframe != key || (i > 0 && st.tiles_blurred != 0) || (i == 0 && st.tiles_blurred != st.tiles_total)) {
+            std::cerr << "frame " << i << ": keyframe " << st.keyframe << ", " << st.tiles_blurred << "/"
+                      << st.tiles_total << " tiles blurred\n";
+            return 5;
+        }
+    }
+    if (det.calls != 2) {
+        std::cerr << "detector ran " << det.calls << " times\n";
+        return 6;
+    }
+
+    // Pan 8 px right: the motion estimate moves the mask and the previous
+    // output with the scene, and only the edge columns are redone, without
+    // calling the detector
+    std::vector<uint8_t> panned = frameAt(world, WW, W, H, 12, 20);
+    if (blur_stream_process(stream, panned.data(), 0, detectDisc, &det) != 0) return 7;
+    blur_stream_stats(stream, &st);
+    if (st.keyframe || st.motion_x != 8 || st.motion_y != 0 || st.tiles_blurred == 0 ||
+        st.tiles_blurred > 2 * H / 64) {
+        std::cerr << "pan: keyframe " << st.keyframe << ", motion " << st.motion_x << "," << st.motion_y << ", "
+                  << st.tiles_blurred << "/" << st.tiles_total << " tiles blurred\n";
+        return 8;
+    }
+    if (panned != expectedFor(frameAt(world, WW, W, H, 12, 20), 168, 96)) {
+        std::cerr << "panned frame does not follow the mask\n";
+        return 9;
+    }
+
+    // A local change only re-blurs the tiles around it
+    std::vector<uint8_t> local = frameAt(world, WW, W, H, 12, 20);
+    for (int y = 10; y < 30; ++y)
+        for (int x = 10; x < 30; ++x) local[(y * W + x) * 4] = 255;
+    if (blur_stream_process(stream, local.data(), 0, detectDisc, &det) != 0) return 10;
+    blur_stream_stats(stream, &st);
+    if (st.keyframe || st.tiles_blurred == 0 || st.tiles_blurred > 4) {
+        std::cerr << "local change re-blurred " << st.tiles_blurred << " tiles\n";
+        return 11;
+    }
+
+    // A diagonal pan that also undoes the local change still matches a
+    // fresh blur of the whole frame
+    std::vector<uint8_t> diagonal = frameAt(world, WW, W, H, 4, 28);
+    if (blur_stream_process(stream, diagonal.data(), 0, detectDisc, &det) != 0) return 18;
+    blur_stream_stats(stream, &st);
+    if (st.keyframe || st.motion_x != 8 || st.motion_y != -8 || st.tiles_blurred == st.tiles_total ||
+        diagonal != expectedFor(frameAt(world, WW, W, H, 4, 28), 176, 88)) {
+        std::cerr << "diagonal pan: motion " << st.motion_x << "," << st.motion_y << ", " << st.tiles_blurred
+                  << " tiles blurred\n";
+        return 19;
+    }
+
+    // A different scene forces a keyframe
+    std::vector<uint8_t> cut(W * H * 4, 255);
+    if (blur_stream_process(stream, cut.data(), 0, detectDisc, &det) != 0) return 12;
+    blur_stream_stats(stream, &st);
+    if (!st.keyframe) {
+        std::cerr << "scene cut did not trigger the detector\n";
+        return 13;
+    }
+
+    // With smoothing a keyframe only nudges the carried mask, but after a
+    // scene cut the stale mask must not bleed into the new scene
+    const BlurStreamConfig smooth = {4, 40, 3, 64, 2, 0, 6};
+    BlurStream* smoothed = blur_stream_create(W, H, BLUR_FORMAT_RGBA8888, &smooth);
+    if (!smoothed) return 14;
+    det.cx = 60;
+    det.cy = 60;
+    std::vector<uint8_t> before = still;
+    if (blur_stream_process(smoothed, before.data(), 0, detectDisc, &det) != 0) return 15;
+    det.cx = 240;
+    det.cy = 120;
+    std::vector<uint8_t> newScene = still;
+    for (uint8_t& v : newScene) v = static_cast<uint8_t>(255 - v);
+    const std::vector<uint8_t> cutExpected = expectedFor(newScene, 240, 120);
+    if (blur_stream_process(smoothed, newScene.data(), 0, detectDisc, &det) != 0) return 16;
+    blur_stream_stats(smoothed, &st);
+    if (!st.keyframe || newScene != cutExpected) {
+        std::cerr << "scene cut blended the previous mask\n";
+        return 17;
+    }
+    blur_stream_destroy(smoothed);
+
+    blur_stream_destroy(stream);
+    std::cout << "Native blur stream test OK" << std::endl;
+    return 0;
+}
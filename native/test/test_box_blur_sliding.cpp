@@ -0,0 +1,84 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include "../include/blur.h"
+
+// Reference: direct (2r+1)-tap separable box blur, clamped to the rect edges.
+// This is the original implementation the sliding-window path must match.
+static int clampi(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+static void naiveBoxBlur(std::vector<uint8_t>& p, int W, int H, int rad, const BlurRect& r) {
+    const int rx = std::max(1, rad), ry = rx;
+    const int x0 = clampi(r.x, 0, W - 1);
+    const int y0 = clampi(r.y, 0, H - 1);
+    const int x1 = clampi(r.x + r.w - 1, 0, W - 1);
+    const int y1 = clampi(r.y + r.h - 1, 0, H - 1);
+    const int w = x1 - x0 + 1;
+    const int h = y1 - y0 + 1;
+    if (w <= 0 || h <= 0) return;
+
+    std::vector<uint8_t> tmp(static_cast<size_t>(w) * h * 4), horiz(tmp.size());
+    for (int yy = 0; yy < h; ++yy)
+        std::copy(&p[((y0 + yy) * W + x0) * 4], &p[((y0 + yy) * W + x0) * 4] + w * 4, &tmp[yy * w * 4]);
+
+    for (int yy = 0; yy < h; ++yy)
+        for (int xx = 0; xx < w; ++xx)
+            for (int c = 0; c < 4; ++c) {
+                int sum = 0, cnt = 0;
+                for (int k = -rx; k <= rx; ++k) { sum += tmp[(yy * w + clampi(xx + k, 0, w - 1)) * 4 + c]; ++cnt; }
+                horiz[(yy * w + xx) * 4 + c] = static_cast<uint8_t>(sum / cnt);
+            }
+
+    for (int yy = 0; yy < h; ++yy)
+        for (int xx = 0; xx < w; ++xx)
+            for (int c = 0; c < 4; ++c) {
+                int sum = 0, cnt = 0;
+                for (int k = -ry; k <= ry; ++k) { sum += horiz[(clampi(yy + k, 0, h - 1) * w + xx) * 4 + c]; ++cnt; }
+                tmp[(yy * w + xx) * 4 + c] = static_cast<uint8_t>(sum / cnt);
+            }
+
+    for (int yy = 0; yy < h; ++yy)
+        std::copy(&tmp[yy * w * 4], &tmp[yy * w * 4] + w * 4, &p[((y0 + yy) * W + x0) * 4]);
+}
+
+int main() {
+    const int W = 61, H = 47;
+    std::srand(1234);
+    std::vector<uint8_t> src(W * H * 4);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+
+    const BlurRect rects[] = {
+        {0, 0, W, H},          // full frame
+        {5, 7, 20, 13},        // interior
+        {-10, -4, 30, 25},     // clipped top-left
+        {50, 40, 40, 40},      // clipped bottom-right
+        {30, 10, 1, 1},        // single pixel
+        {12, 3, 3, 40},        // narrow column
+    };
+    const int radii[] = {1, 2, 5, 17, 64};
+
+    for (const BlurRect& r : rects) {
+        for (int rad : radii) {
+            std::vector<uint8_t> expected = src, actual = src;
+            naiveBoxBlur(expected, W, H, rad, r);
+            int rc = blur_apply_regions(actual.data(), W, H, &r, 1, 0, rad);
+            if (rc != 0) {
+                std::cerr << "blur_apply_regions returned " << rc << "\n";
+                return 2;
+            }
+            for (size_t i = 0; i < expected.size(); ++i) {
+                if (expected[i] != actual[i]) {
+                    std::cerr << "Mismatch at byte " << i << " (rect " << r.x << "," << r.y << ","
+                              << r.w << "x" << r.h << ", radius " << rad << "): expected "
+                              << int(expected[i]) << " got " << int(actual[i]) << "\n";
+                    return 3;
+                }
+            }
+        }
+    }
+
+    std::cout << "Native sliding-window box blur test OK\n";
+    return 0;
+}
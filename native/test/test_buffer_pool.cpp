@@ -0,0 +1,119 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "../include/blur.h"
+#include "../src/buffer_pool.h"
+
+// Buffer pool: size classes never hand a big buffer to a small request,
+// released buffers are reused, trim and the pool limit give memory back,
+// and concurrent threads never share a live buffer.
+int main() {
+    blur_memory_trim(0);
+
+    // Power-of-two classes, 64-byte alignment, reuse within a class
+    {
+        blurcore::PooledBuffer a = blurcore::acquireBuffer(5000);
+        if (!a || a.size() != 5000 || a.capacity() != 8192 || reinterpret_cast<uintptr_t>(a.data()) % 64 != 0) {
+            std::cerr << "wrong class or alignment\n";
+            return 1;
+        }
+        const uint8_t* first = a.data();
+        a.reset();
+        blurcore::PooledBuffer b = blurcore::acquireBuffer(8000);
+        if (b.data() != first) {
+            std::cerr << "released buffer not reused\n";
+            return 2;
+        }
+    }
+
+    // A large idle buffer is not handed to a small request
+    {
+        blurcore::PooledBuffer big = blurcore::acquireBuffer(16u << 20);
+        const uint8_t* bigData = big.data();
+        big.reset();
+        blurcore::PooledBuffer small = blurcore::acquireBuffer(1u << 20);
+        if (!small || small.data() == bigData || small.capacity() != (1u << 20)) {
+            std::cerr << "small request took a large block\n";
+            return 3;
+        }
+        int64_t pooled = 0, inUse = 0;
+        blur_memory_stats(&pooled, &inUse);
+        if (inUse != (1 << 20) || pooled < (16 << 20)) {
+            std::cerr << "stats " << pooled << " pooled, " << inUse << " in use\n";
+            return 4;
+        }
+    }
+
+    // Trim frees idle memory; the limit frees buffers released beyond it
+    {
+        const int64_t freed = blur_memory_trim(0);
+        int64_t pooled = -1, inUse = -1;
+        blur_memory_stats(&pooled, &inUse);
+        if (freed < (16 << 20) || pooled != 0 || inUse != 0) {
+            std::cerr << "trim freed " << freed << ", " << pooled << " still pooled\n";
+            return 5;
+        }
+        blur_memory_set_pool_limit(2 << 20);
+        { blurcore::PooledBuffer b = blurcore::acquireBuffer(4u << 20); }
+        blur_memory_stats(&pooled, nullptr);
+        if (pooled != 0) {
+            std::cerr << "buffer kept beyond the pool limit\n";
+            return 6;
+        }
+        blur_memory_set_pool_limit(0);
+    }
+
+    // Threads hammering the pool never see each other's live buffers
+    {
+        std::atomic<bool> bad{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([t, &bad] {
+                uint32_t seed = 12345u + t;
+                std::vector<blurcore::PooledBuffer> live;
+                for (int i = 0; i < 20000; ++i) {
+                    seed = seed * 1664525u + 1013904223u;
+                    if (live.size() < 8 && (seed >> 28) < 10) {
+                        blurcore::PooledBuffer b = blurcore::acquireBuffer(1000 + (seed >> 8) % 300000);
+                        if (!b) continue;
+                        std::memset(b.data(), t + 1, b.size());
+                        live.push_back(std::move(b));
+                    } else if (!live.empty()) {
+                        blurcore::PooledBuffer& b = live[seed % live.size()];
+                        for (size_t k = 0; k < b.size(); k += 997)
+                            if (b.data()[k] != t + 1) bad.store(true);
+                        b = std::move(live.back());
+                        live.pop_back();
+                    }
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+        int64_t inUse = -1;
+        blur_memory_stats(nullptr, &inUse);
+        if (bad.load() || inUse != 0) {
+            std::cerr << "buffers shared between threads or leaked (" << inUse << " in use)\n";
+            return 7;
+        }
+    }
+
+    // The core draws its scratch from the pool
+    {
+        blur_memory_trim(0);
+        std::vector<uint8_t> img(64 * 64 * 4, 100);
+        const BlurRect r = {0, 0, 64, 64};
+        blur_apply_regions(img.data(), 64, 64, &r, 1, 2, 4);
+        int64_t pooled = 0;
+        blur_memory_stats(&pooled, nullptr);
+        if (pooled == 0) {
+            std::cerr << "blur scratch did not return to the pool\n";
+            return 8;
+        }
+    }
+
+    std::cout << "buffer pool tests passed\n";
+    return 0;
+}
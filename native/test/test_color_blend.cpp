@@ -0,0 +1,145 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// blur_blend_colorspace against straightforward double-precision blends.
+static double decode(int v) {
+    const double c = v / 255.0;
+    return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+static double encode(double l) {
+    l = std::min(std::max(l, 0.0), 1.0);
+    return 255.0 * (l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055);
+}
+
+static void oklab(const double* rgb, double* lab) {
+    const double l = std::cbrt(0.4122214708 * rgb[0] + 0.5363325363 * rgb[1] + 0.0514459929 * rgb[2]);
+    const double m = std::cbrt(0.2119034982 * rgb[0] + 0.6806995451 * rgb[1] + 0.1073969566 * rgb[2]);
+    const double s = std::cbrt(0.0883024619 * rgb[0] + 0.2817188376 * rgb[1] + 0.6299787005 * rgb[2]);
+    lab[0] = 0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s;
+    lab[1] = 1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s;
+    lab[2] = 0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s;
+}
+
+static void fromOklab(const double* lab, double* rgb) {
+    const double l = std::pow(lab[0] + 0.3963377774 * lab[1] + 0.2158037573 * lab[2], 3);
+    const double m = std::pow(lab[0] - 0.1055613458 * lab[1] - 0.0638541728 * lab[2], 3);
+    const double s = std::pow(lab[0] - 0.0894841775 * lab[1] - 1.2914855480 * lab[2], 3);
+    rgb[0] = 4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s;
+    rgb[1] = -1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s;
+    rgb[2] = -0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s;
+}
+
+int main() {
+    const int W = 67, H = 41, n = W * H;
+    std::srand(21);
+    std::vector<uint8_t> under(n * 4), over(n * 4), mask(n);
+    for (auto& v : under) v = static_cast<uint8_t>(std::rand() & 0xFF);
+    for (auto& v : over) v = static_cast<uint8_t>(std::rand() & 0xFF);
+    for (int i = 0; i < n; ++i) {
+        const int r = std::rand() % 4;
+        mask[i] = static_cast<uint8_t>(r == 0 ? 0 : (r == 1 ? 255 : std::rand() & 0xFF));
+    }
+
+    const int spaces[] = {BLUR_BLEND_SRGB, BLUR_BLEND_LINEAR, BLUR_BLEND_OKLAB, BLUR_BLEND_HSV};
+    for (int space : spaces) {
+        std::vector<uint8_t> out = under;
+        if (blur_blend_colorspace(out.data(), over.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, space) != 0) {
+            std::cerr << "space " << space << " failed\n";
+            return 1;
+        }
+        for (int i = 0; i < n; ++i) {
+            const int m = mask[i];
+            for (int c = 0; c < 4; ++c) {
+                const int j = i * 4 + c;
+                const int alphaBlend = (over[j] * m + under[j] * (255 - m) + 127) / 255;
+                int want = -1;
+                if (m == 0) want = under[j];
+                else if (m == 255) want = over[j];
+                else if (space == BLUR_BLEND_SRGB || c == 3) want = alphaBlend;
+                if (want >= 0 && out[j] != want) {
+                    std::cerr << "space " << space << " pixel " << i << " channel " << c << ": " << int(out[j])
+                              << " vs " << want << "\n";
+                    return 2;
+                }
+            }
+            if (m == 0 || m == 255 || space == BLUR_BLEND_SRGB || space == BLUR_BLEND_HSV) continue;
+
+            // Linear light and Oklab within a step of the exact mix
+            const double a = m / 255.0;
+            double lu[3], lo[3], mix[3];
+            for (int c = 0; c < 3; ++c) {
+                lu[c] = decode(under[i * 4 + c]);
+                lo[c] = decode(over[i * 4 + c]);
+            }
+            if (space == BLUR_BLEND_LINEAR) {
+                for (int c = 0; c < 3; ++c) mix[c] = lu[c] + (lo[c] - lu[c]) * a;
+            } else {
+                double pu[3], po[3], pm[3];
+                oklab(lu, pu);
+                oklab(lo, po);
+                for (int c = 0; c < 3; ++c) pm[c] = pu[c] + (po[c] - pu[c]) * a;
+                fromOklab(pm, mix);
+            }
+            for (int c = 0; c < 3; ++c) {
+                if (std::fabs(out[i * 4 + c] - encode(mix[c])) > 1.0) {
+                    std::cerr << "space " << space << " pixel " << i << " channel " << c << ": " << int(out[i * 4 + c])
+                              << " vs " << encode(mix[c]) << "\n";
+                    return 3;
+                }
+            }
+        }
+    }
+
+    // Spot checks: a half-and-half black/white edge keeps its brightness in
+    // linear light, and red meets blue through magenta, not green
+    {
+        uint8_t px[8] = {0, 0, 0, 255, 255, 0, 0, 255};
+        const uint8_t top[8] = {255, 255, 255, 255, 0, 0, 255, 255};
+        const uint8_t half[1] = {128};
+        blur_blend_colorspace(px, top, 1, 1, 0, BLUR_FORMAT_RGBA8888, half, 0, BLUR_BLEND_LINEAR);
+        if (px[0] < 187 || px[0] > 189) {
+            std::cerr << "linear midpoint " << int(px[0]) << "\n";
+            return 4;
+        }
+        blur_blend_colorspace(px + 4, top + 4, 1, 1, 0, BLUR_FORMAT_RGBA8888, half, 0, BLUR_BLEND_HSV);
+        if (px[4] < 250 || px[5] != 0 || px[6] != 255) {
+            std::cerr << "hsv red/blue midpoint " << int(px[4]) << "," << int(px[5]) << "," << int(px[6]) << "\n";
+            return 5;
+        }
+    }
+
+    // BGRA is RGBA with red and blue swapped
+    {
+        std::vector<uint8_t> rgba = under, bgra = under, overBgra = over;
+        for (int i = 0; i < n; ++i) {
+            std::swap(bgra[i * 4], bgra[i * 4 + 2]);
+            std::swap(overBgra[i * 4], overBgra[i * 4 + 2]);
+        }
+        blur_blend_colorspace(rgba.data(), over.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, BLUR_BLEND_OKLAB);
+        blur_blend_colorspace(bgra.data(), overBgra.data(), W, H, 0, BLUR_FORMAT_BGRA8888, mask.data(), 0, BLUR_BLEND_OKLAB);
+        for (int i = 0; i < n; ++i) std::swap(bgra[i * 4], bgra[i * 4 + 2]);
+        if (bgra != rgba) {
+            std::cerr << "BGRA blend differs from RGBA\n";
+            return 6;
+        }
+    }
+
+    // Bad arguments
+    std::vector<uint8_t> out = under;
+    if (blur_blend_colorspace(nullptr, over.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 0) != -1 ||
+        blur_blend_colorspace(out.data(), over.data(), W, H, 3, BLUR_FORMAT_RGBA8888, mask.data(), 0, 0) != -1 ||
+        blur_blend_colorspace(out.data(), over.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 7) != -2 ||
+        blur_blend_colorspace(out.data(), over.data(), W, H, 0, BLUR_FORMAT_NV21, mask.data(), 0, 0) != -2 ||
+        out != under) {
+        std::cerr << "bad arguments not rejected\n";
+        return 7;
+    }
+
+    std::cout << "color blend tests passed\n";
+    return 0;
+}
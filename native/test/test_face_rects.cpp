@@ -0,0 +1,95 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "../include/blur.h"
+
+// Face decoding on synthetic BlazeFace outputs: anchor placement, score
+// threshold, NMS of duplicate boxes, padding, merging and the rect limit.
+namespace {
+
+const int kStride = 16;
+
+// Anchor of a cell: 16x16 grid with 2 anchors per cell, then 8x8 with 6
+int anchor16(int x, int y) { return (y * 16 + x) * 2; }
+int anchor8(int x, int y) { return 512 + (y * 8 + x) * 6; }
+
+void setBox(std::vector<float>& reg, std::vector<float>& scores, int anchor, float size, float logit) {
+    float* r = &reg[static_cast<size_t>(anchor) * kStride];
+    r[0] = 0; r[1] = 0; r[2] = size; r[3] = size;
+    scores[anchor] = logit;
+}
+
+bool same(const BlurRect& r, int x, int y, int w, int h) {
+    return r.x == x && r.y == y && r.w == w && r.h == h;
+}
+
+} // namespace
+
+int main() {
+    const int n = blur_face_anchor_count();
+    if (n != 896) {
+        std::cerr << "unexpected anchor count " << n << "\n";
+        return 1;
+    }
+    std::vector<float> reg(static_cast<size_t>(n) * kStride, 0.0f);
+    std::vector<float> scores(n, -10.0f);
+
+    // Face 1 at cell (4, 4) of the fine grid, seen by both anchors; face 2 on
+    // the coarse grid; a weak box that must not pass the threshold
+    setBox(reg, scores, anchor16(4, 4), 16, 3.0f);
+    setBox(reg, scores, anchor16(4, 4) + 1, 16, 2.0f);
+    setBox(reg, scores, anchor8(6, 6), 32, 4.0f);
+    setBox(reg, scores, anchor16(12, 2), 16, -3.0f);
+
+    BlurRect rects[8];
+    int count = blur_decode_faces(reg.data(), kStride, scores.data(), 256, 256, 0.5f, 0.3f, 0.0f, rects, 8);
+    if (count != 2) {
+        std::cerr << "expected 2 faces, got " << count << "\n";
+        return 2;
+    }
+    // Highest score first: face 2 spans 0.6875-0.9375, face 1 0.21875-0.34375
+    if (!same(rects[0], 176, 176, 64, 64) || !same(rects[1], 56, 56, 32, 32)) {
+        std::cerr << "wrong face rects\n";
+        return 3;
+    }
+
+    // A neighbour of face 1 that only overlaps it once both are padded
+    setBox(reg, scores, anchor16(6, 4), 16, 3.0f);
+    count = blur_decode_faces(reg.data(), kStride, scores.data(), 256, 256, 0.5f, 0.3f, 0.0f, rects, 8);
+    if (count != 3) {
+        std::cerr << "expected 3 separate faces, got " << count << "\n";
+        return 4;
+    }
+    count = blur_decode_faces(reg.data(), kStride, scores.data(), 256, 256, 0.5f, 0.3f, 0.25f, rects, 8);
+    if (count != 2 || !same(rects[0], 160, 160, 96, 96) || !same(rects[1], 48, 48, 80, 48)) {
+        std::cerr << "padded faces not merged\n";
+        return 5;
+    }
+
+    // Padding is clamped to the image; a short buffer keeps the best face
+    count = blur_decode_faces(reg.data(), kStride, scores.data(), 256, 256, 0.5f, 0.3f, 1.0f, rects, 1);
+    if (count != 1 || rects[0].x < 0 || rects[0].x + rects[0].w > 256 || rects[0].y + rects[0].h > 256) {
+        std::cerr << "limit or clamping wrong\n";
+        return 6;
+    }
+
+    // Non-square images scale each axis separately
+    std::fill(scores.begin(), scores.end(), -10.0f);
+    setBox(reg, scores, anchor16(4, 4), 16, 3.0f);
+    count = blur_decode_faces(reg.data(), kStride, scores.data(), 512, 128, 0.5f, 0.3f, 0.0f, rects, 8);
+    if (count != 1 || !same(rects[0], 112, 28, 64, 16)) {
+        std::cerr << "non-square scaling wrong\n";
+        return 7;
+    }
+
+    if (blur_decode_faces(nullptr, kStride, scores.data(), 256, 256, 0.5f, 0.3f, 0, rects, 8) != -1 ||
+        blur_decode_faces(reg.data(), 2, scores.data(), 256, 256, 0.5f, 0.3f, 0, rects, 8) != -1 ||
+        blur_decode_faces(reg.data(), kStride, scores.data(), 256, 256, 0.5f, 0.3f, 0, rects, 0) != -1) {
+        std::cerr << "bad arguments accepted\n";
+        return 8;
+    }
+
+    std::cout << "face rect tests passed\n";
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "../include/blur.h"
+
+// Mode 2 should approximate a true Gaussian: blurring a hard vertical edge
+// must give (close to) the normal CDF profile 255 * Phi((x - edge) / sigma).
+int main() {
+    const int W = 240, H = 16, edge = 120;
+    const int sigmas[] = {2, 5, 12};
+    const int tol = 8; // per-pass truncation plus the box approximation error
+
+    for (int sigma : sigmas) {
+        std::vector<uint8_t> pixels(W * H * 4);
+        for (int y = 0; y < H; ++y) {
+            for (int x = 0; x < W; ++x) {
+                const uint8_t v = x < edge ? 0 : 255;
+                uint8_t* p = &pixels[(y * W + x) * 4];
+                p[0] = v; p[1] = v; p[2] = v; p[3] = 255;
+            }
+        }
+
+        BlurRect r;
+        r.x = 0; r.y = 0; r.w = W; r.h = H;
+        int rc = blur_apply_regions(pixels.data(), W, H, &r, 1, 2, sigma);
+        if (rc != 0) {
+            std::cerr << "blur_apply_regions returned " << rc << "\n";
+            return 2;
+        }
+
+        const int y = H / 2;
+        int prev = -1;
+        for (int x = 0; x < W; ++x) {
+            const int got = pixels[(y * W + x) * 4];
+            const double t = (x + 0.5 - edge) / sigma;
+            const int want = static_cast<int>(std::lround(255.0 * 0.5 * std::erfc(-t / std::sqrt(2.0))));
+            if (std::abs(got - want) > tol) {
+                std::cerr << "sigma " << sigma << ": x=" << x << " expected ~" << want << " got " << got << "\n";
+                return 3;
+            }
+            if (got < prev) {
+                std::cerr << "sigma " << sigma << ": profile not monotonic at x=" << x << "\n";
+                return 4;
+            }
+            prev = got;
+            if (pixels[(y * W + x) * 4 + 3] != 255) {
+                std::cerr << "sigma " << sigma << ": alpha changed at x=" << x << "\n";
+                return 5;
+            }
+        }
+    }
+
+    std::cout << "Native gaussian blur test OK\n";
+    return 0;
+}
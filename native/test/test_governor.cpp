@@ -0,0 +1,139 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// Backend governor: calibration is measured once and then read back from
+// its cache file, routed calls match blur_apply_regions_ex bit for bit on
+// whatever backend they land, and pressure caps threads, keeps severe
+// pressure on one CPU thread and shrinks the preview level.
+static std::string governorJson() {
+    std::string json(static_cast<size_t>(blur_governor_json(nullptr, 0)) + 1, '\0');
+    json.resize(static_cast<size_t>(blur_governor_json(&json[0], static_cast<int>(json.size()))));
+    return json;
+}
+
+static bool has(const std::string& json, const char* text) {
+    return json.find(text) != std::string::npos;
+}
+
+int main() {
+    const char* cache = "governor_cache.txt";
+    std::remove(cache);
+    blur_set_thread_count(4);
+
+    // Uncalibrated: the worker pool, no estimate
+    BlurRoute route = {};
+    if (blur_governor_route(640, 480, BLUR_FORMAT_RGBA8888, 2, 6, &route) != 0 ||
+        route.backend != BLUR_BACKEND_THREADED || route.threads != 4 || route.estimate_ns != -1 ||
+        !has(governorJson(), "\"calibrated\":false")) {
+        std::cerr << "uncalibrated route should be the worker pool\n";
+        return 1;
+    }
+
+    if (blur_governor_calibrate(cache) != 0 || !has(governorJson(), "\"source\":\"benchmark\"")) {
+        std::cerr << "calibration failed\n";
+        return 2;
+    }
+    const int sides[] = {64, 400, 1200};
+    std::vector<BlurRoute> measured;
+    for (int side : sides) {
+        for (int strength : {3, 30}) {
+            if (blur_governor_route(side, side, BLUR_FORMAT_RGBA8888, 2, strength, &route) != 0 ||
+                route.estimate_ns <= 0 || route.backend < 0 || route.backend >= BLUR_BACKEND_COUNT ||
+                (route.backend == BLUR_BACKEND_GPU && !blur_gpu_available())) {
+                std::cerr << "bad route for " << side << "px, strength " << strength << "\n";
+                return 3;
+            }
+            measured.push_back(route);
+        }
+    }
+
+    // The second run reads the file and routes the same way
+    if (blur_governor_calibrate(cache) != 0 || !has(governorJson(), "\"source\":\"cache\"")) {
+        std::cerr << "cached calibration not used\n";
+        return 4;
+    }
+    size_t i = 0;
+    for (int side : sides) {
+        for (int strength : {3, 30}) {
+            blur_governor_route(side, side, BLUR_FORMAT_RGBA8888, 2, strength, &route);
+            if (route.backend != measured[i].backend || route.estimate_ns != measured[i].estimate_ns) {
+                std::cerr << "cached table routes differently\n";
+                return 5;
+            }
+            ++i;
+        }
+    }
+
+    // A damaged file is measured again rather than trusted
+    FILE* file = std::fopen(cache, "w");
+    std::fputs("blurcore-governor 1 garbage", file);
+    std::fclose(file);
+    if (blur_governor_calibrate(cache) != 0 || !has(governorJson(), "\"source\":\"benchmark\"")) {
+        std::cerr << "damaged cache accepted\n";
+        return 6;
+    }
+    if (blur_governor_calibrate("no/such/dir/governor.txt") != -8 || !has(governorJson(), "\"calibrated\":true")) {
+        std::cerr << "unsaved calibration not reported\n";
+        return 7;
+    }
+
+    // Routed calls give exactly the direct result, with and without pressure
+    const int W = 211, H = 157;
+    std::srand(11);
+    std::vector<uint8_t> src(W * H * 4);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+    const BlurRect rects[] = {{5, 5, 90, 70}, {80, 60, 120, 90}, {-10, 100, 40, 80}};
+    for (int pressure : {BLUR_PRESSURE_NONE, BLUR_PRESSURE_SEVERE}) {
+        blur_governor_set_pressure(pressure);
+        for (int format : {BLUR_FORMAT_RGBA8888, BLUR_FORMAT_RGB888}) {
+            for (int mode = 0; mode <= 4; ++mode) {
+                const int strength = mode == 1 || mode == 4 ? 7 : 9;
+                std::vector<uint8_t> expected = src, routed = src;
+                blur_apply_regions_ex(nullptr, expected.data(), W, H, 0, format, rects, 3, mode, strength);
+                if (blur_governor_apply(nullptr, routed.data(), W, H, 0, format, rects, 3, mode, strength, &route) != 0 ||
+                    routed != expected) {
+                    std::cerr << "routed blur differs (format " << format << ", mode " << mode << ", backend "
+                              << route.backend << ")\n";
+                    return 8;
+                }
+                if (pressure == BLUR_PRESSURE_SEVERE && (route.threads != 1 || route.backend == BLUR_BACKEND_GPU)) {
+                    std::cerr << "severe pressure left the single CPU thread\n";
+                    return 9;
+                }
+            }
+        }
+    }
+
+    // Pressure: threads, preview scale and pyramid level follow it
+    BlurPyramid* pyramid = blur_pyramid_create(src.data(), W, H, 0, 3); // 106x79, 53x40, 27x20
+    blur_governor_set_pressure(BLUR_PRESSURE_NONE);
+    const int fullLevel = blur_pyramid_level_for(pyramid, 50, 30);
+    blur_governor_set_pressure(BLUR_PRESSURE_MODERATE);
+    const bool moderate = blur_get_thread_count() == 2 && blur_governor_preview_scale() == 0.75f;
+    blur_governor_set_pressure(BLUR_PRESSURE_SEVERE);
+    const bool severe = blur_get_thread_count() == 1 && blur_governor_preview_scale() == 0.5f &&
+                        blur_governor_pressure() == BLUR_PRESSURE_SEVERE &&
+                        blur_pyramid_level_for(pyramid, 50, 30) == 3 && fullLevel == 2;
+    blur_governor_set_pressure(BLUR_PRESSURE_NONE);
+    blur_pyramid_destroy(pyramid);
+    if (!moderate || !severe || blur_get_thread_count() != 4 || blur_governor_preview_scale() != 1.0f) {
+        std::cerr << "pressure not applied or not lifted\n";
+        return 10;
+    }
+
+    if (blur_governor_set_pressure(3) != -1 || blur_governor_route(0, 10, 0, 2, 6, &route) != -1 ||
+        blur_governor_route(10, 10, 0, 2, 6, nullptr) != -1 ||
+        blur_governor_apply(nullptr, nullptr, W, H, 0, 0, rects, 1, 2, 6, nullptr) != -1) {
+        std::cerr << "bad arguments accepted\n";
+        return 11;
+    }
+
+    std::remove(cache);
+    std::cout << "governor tests passed\n";
+    return 0;
+}
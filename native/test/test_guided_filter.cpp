@@ -0,0 +1,137 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// blur_mask_refine_guided against a direct full-resolution guided filter
+// (He et al.) in double precision, plus the edge-snapping it is used for.
+static std::vector<double> boxMean(const std::vector<double>& v, int W, int H, int r) {
+    std::vector<double> out(W * H);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x) {
+            double s = 0.0;
+            int n = 0;
+            for (int j = std::max(y - r, 0); j <= std::min(y + r, H - 1); ++j)
+                for (int i = std::max(x - r, 0); i <= std::min(x + r, W - 1); ++i) {
+                    s += v[j * W + i];
+                    ++n;
+                }
+            out[y * W + x] = s / n;
+        }
+    return out;
+}
+
+// Grey guide only: a = cov(I, p) / (var(I) + eps), b = mean(p) - a mean(I)
+static std::vector<double> guided(const std::vector<uint8_t>& guide, const std::vector<uint8_t>& mask, int W, int H,
+                                  int r, double eps) {
+    std::vector<double> I(W * H), p(W * H), II(W * H), Ip(W * H);
+    for (int i = 0; i < W * H; ++i) {
+        I[i] = guide[i] / 255.0;
+        p[i] = mask[i] / 255.0;
+        II[i] = I[i] * I[i];
+        Ip[i] = I[i] * p[i];
+    }
+    const std::vector<double> mI = boxMean(I, W, H, r), mp = boxMean(p, W, H, r);
+    const std::vector<double> mII = boxMean(II, W, H, r), mIp = boxMean(Ip, W, H, r);
+    std::vector<double> a(W * H), b(W * H);
+    for (int i = 0; i < W * H; ++i) {
+        a[i] = (mIp[i] - mI[i] * mp[i]) / (mII[i] - mI[i] * mI[i] + eps);
+        b[i] = mp[i] - a[i] * mI[i];
+    }
+    const std::vector<double> ma = boxMean(a, W, H, r), mb = boxMean(b, W, H, r);
+    std::vector<double> q(W * H);
+    for (int i = 0; i < W * H; ++i) q[i] = 255.0 * std::min(std::max(ma[i] * I[i] + mb[i], 0.0), 1.0);
+    return q;
+}
+
+int main() {
+    const int W = 48, H = 40, n = W * H;
+    std::srand(5);
+
+    // A guide with a vertical edge at x = 24 and some texture; a mask that
+    // overshoots the edge by two pixels and is noisy, with corner pixels
+    // so the filtered box is the whole frame
+    std::vector<uint8_t> guide(n), mask(n, 0);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x) {
+            guide[y * W + x] = static_cast<uint8_t>((x < 24 ? 200 : 40) + std::rand() % 12);
+            if (x < 26 && y > 4 && y < 36 && std::rand() % 8) mask[y * W + x] = 255;
+        }
+    mask[0] = mask[n - 1] = 255;
+
+    {
+        const std::vector<double> want = guided(guide, mask, W, H, 3, 1e-3);
+        std::vector<uint8_t> out = mask;
+        if (blur_mask_refine_guided(out.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 3, 1e-3f) != 0) {
+            std::cerr << "refine failed\n";
+            return 1;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (std::fabs(out[i] - want[i]) > 1.0) {
+                std::cerr << "pixel " << i << ": " << int(out[i]) << " vs " << want[i] << "\n";
+                return 2;
+            }
+        }
+    }
+
+    // Colour guide, larger radius (the subsampled path): where a plain
+    // smoothing would ramp across the overshoot, the result steps down at
+    // the guide's edge
+    {
+        std::vector<uint8_t> rgba(n * 4);
+        for (int i = 0; i < n; ++i) {
+            const bool left = i % W < 24;
+            rgba[i * 4] = static_cast<uint8_t>(left ? 210 : 30);
+            rgba[i * 4 + 1] = static_cast<uint8_t>(left ? 120 : 90);
+            rgba[i * 4 + 2] = static_cast<uint8_t>(left ? 40 : 160);
+            rgba[i * 4 + 3] = 255;
+        }
+        std::vector<uint8_t> out = mask;
+        if (blur_mask_refine_guided(out.data(), W, H, 0, rgba.data(), 0, BLUR_FORMAT_RGBA8888, 8, 1e-4f) != 0) {
+            return 3;
+        }
+        for (int y = 14; y < 26; ++y) {
+            const uint8_t* row = &out[y * W];
+            if (row[12] < 180 || row[23] - row[24] < 100 || row[24] > 100) {
+                std::cerr << "row " << y << ": inside " << int(row[12]) << ", edge " << int(row[23]) << " -> "
+                          << int(row[24]) << "\n";
+                return 4;
+            }
+        }
+
+        // BGRA reads the same colours swapped
+        std::vector<uint8_t> bgra = rgba, swapped = mask;
+        for (int i = 0; i < n; ++i) std::swap(bgra[i * 4], bgra[i * 4 + 2]);
+        blur_mask_refine_guided(swapped.data(), W, H, 0, bgra.data(), 0, BLUR_FORMAT_BGRA8888, 8, 1e-4f);
+        if (swapped != out) {
+            std::cerr << "BGRA guide differs from RGBA\n";
+            return 5;
+        }
+    }
+
+    // An empty mask stays empty; bad arguments are rejected untouched
+    {
+        std::vector<uint8_t> none(n, 0), out = mask;
+        if (blur_mask_refine_guided(none.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 4, 1e-3f) != 0 ||
+            none != std::vector<uint8_t>(n, 0)) {
+            std::cerr << "empty mask changed\n";
+            return 6;
+        }
+        if (blur_mask_refine_guided(nullptr, W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 4, 1e-3f) != -1 ||
+            blur_mask_refine_guided(out.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 0, 1e-3f) != -1 ||
+            blur_mask_refine_guided(out.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 4, 0.0f) != -1 ||
+            blur_mask_refine_guided(out.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 4, NAN) != -1 ||
+            blur_mask_refine_guided(out.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_GRAY8, 4, INFINITY) != -1 ||
+            blur_mask_refine_guided(out.data(), W, H, W - 1, guide.data(), 0, BLUR_FORMAT_GRAY8, 4, 1e-3f) != -1 ||
+            blur_mask_refine_guided(out.data(), W, H, 0, guide.data(), 0, BLUR_FORMAT_NV21, 4, 1e-3f) != -2 ||
+            out != mask) {
+            std::cerr << "bad arguments not rejected\n";
+            return 7;
+        }
+    }
+
+    std::cout << "guided filter tests passed\n";
+    return 0;
+}
@@ -0,0 +1,284 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+#include "../src/cancel.h"
+
+// Asynchronous jobs: results match the synchronous calls, previews overtake
+// queued exports, cancelled and superseded jobs report -5 and stop, and
+// closing a session waits for its jobs.
+namespace {
+
+struct Log {
+    std::mutex mutex;
+    std::vector<int64_t> order;
+    std::vector<int> status;
+};
+
+void record(void* user, int64_t job, int status) {
+    Log* log = static_cast<Log*>(user);
+    std::lock_guard<std::mutex> lock(log->mutex);
+    log->order.push_back(job);
+    log->status.push_back(status);
+}
+
+int statusOf(Log& log, int64_t job) {
+    std::lock_guard<std::mutex> lock(log.mutex);
+    for (size_t i = 0; i < log.order.size(); ++i) {
+        if (log.order[i] == job) return log.status[i];
+    }
+    return 1; // not reported
+}
+
+BlurJobSpec regions(std::vector<uint8_t>& px, int w, int h, int mode, int strength) {
+    BlurJobSpec spec = {};
+    spec.kind = BLUR_JOB_REGIONS;
+    spec.pixels = px.data();
+    spec.width = w;
+    spec.height = h;
+    spec.format = BLUR_FORMAT_RGBA8888;
+    spec.mode = mode;
+    spec.strength = strength;
+    return spec;
+}
+
+int runAll() {
+    const int W = 97, H = 61;
+    std::srand(17);
+    std::vector<uint8_t> src(W * H * 4), mask(W * H);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+    for (int i = 0; i < W * H; ++i) mask[i] = static_cast<uint8_t>((i % W) * 255 / W);
+
+    // A large frame whose blur takes long enough to be caught running
+    const int BW = 2400, BH = 1800;
+    std::vector<uint8_t> big(static_cast<size_t>(BW) * BH * 4, 0x80);
+
+    // Same pixels as the synchronous calls; rects are copied at submit
+    {
+        Log log;
+        std::vector<uint8_t> a = src, b = src, wantA = src, wantB = src;
+        const BlurRect rects[] = {{5, 6, 40, 30}, {50, 20, 40, 35}};
+        blur_apply_regions_ex(nullptr, wantA.data(), W, H, 0, BLUR_FORMAT_RGBA8888, rects, 2, 1, 7);
+        blur_apply_masked(nullptr, wantB.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 2, 0, 8);
+
+        BlurRect copy[2] = {rects[0], rects[1]};
+        BlurJobSpec specA = regions(a, W, H, 1, 7);
+        specA.rects = copy;
+        specA.rect_count = 2;
+        const int64_t ja = blur_job_submit(&specA, record, &log);
+        copy[0] = copy[1] = BlurRect{0, 0, 0, 0};
+
+        BlurJobSpec specB = regions(b, W, H, 2, 0);
+        specB.kind = BLUR_JOB_MASKED;
+        specB.mask = mask.data();
+        specB.fg_strength = 0;
+        specB.bg_strength = 8;
+        const int64_t jb = blur_job_submit(&specB, record, &log);
+        if (ja <= 0 || jb <= 0 || ja == jb) {
+            std::cerr << "submit failed\n";
+            return 1;
+        }
+        blur_job_wait(ja);
+        blur_job_wait(jb);
+        if (statusOf(log, ja) != 0 || statusOf(log, jb) != 0 || a != wantA || b != wantB) {
+            std::cerr << "job results differ from the synchronous calls\n";
+            return 2;
+        }
+        if (blur_job_wait(ja) != -1 || blur_job_cancel(ja) != -1) {
+            std::cerr << "finished job still known\n";
+            return 3;
+        }
+    }
+
+    // Cancelling a job, queued or running, reports -5
+    {
+        Log log;
+        BlurJobSpec spec = regions(big, BW, BH, 2, 60);
+        const int64_t running = blur_job_submit(&spec, record, &log);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (blur_job_cancel(running) != 0) {
+            std::cerr << "large job finished before it could be cancelled\n";
+            return 4;
+        }
+        blur_job_wait(running);
+
+        // Session jobs queue behind each other, so the second is still waiting
+        BlurSession* s = blur_session_open(big.data(), BW, BH, 0, BLUR_FORMAT_RGBA8888);
+        BlurJobSpec render = {};
+        render.session = s;
+        render.kind = BLUR_JOB_SESSION_BLURRED;
+        render.mode = 2;
+        render.strength = 60;
+        const int64_t first = blur_job_submit(&render, record, &log);
+        const int64_t queued = blur_job_submit(&render, record, &log);
+        blur_job_cancel(queued);
+        blur_job_cancel(first);
+        blur_job_wait(queued);
+        blur_job_wait(first);
+        blur_session_close(s);
+        if (statusOf(log, running) != -5 || statusOf(log, first) != -5 || statusOf(log, queued) != -5) {
+            std::cerr << "cancelled jobs reported " << statusOf(log, running) << ", " << statusOf(log, first) << ", "
+                      << statusOf(log, queued) << "\n";
+            return 5;
+        }
+    }
+
+    // A new job with the same tag supersedes the old one
+    {
+        Log log;
+        // No rects blur the whole frame, as in a batch spec
+        std::vector<uint8_t> small = src, want = src;
+        const BlurRect all = {0, 0, W, H};
+        blur_apply_regions_ex(nullptr, want.data(), W, H, 0, BLUR_FORMAT_RGBA8888, &all, 1, 1, 5);
+        BlurJobSpec first = regions(big, BW, BH, 2, 60);
+        first.tag = 7;
+        BlurJobSpec second = regions(small, W, H, 1, 5);
+        second.tag = 7;
+        const int64_t j1 = blur_job_submit(&first, record, &log);
+        const int64_t j2 = blur_job_submit(&second, record, &log);
+        blur_job_wait(j1);
+        blur_job_wait(j2);
+        if (statusOf(log, j1) != -5 || statusOf(log, j2) != 0 || small != want) {
+            std::cerr << "tag did not supersede: " << statusOf(log, j1) << ", " << statusOf(log, j2) << "\n";
+            return 6;
+        }
+        if (blur_job_cancel_tag(7) != 0 || blur_job_cancel_tag(0) != 0) {
+            std::cerr << "finished tag still cancellable\n";
+            return 7;
+        }
+    }
+
+    // Jobs on one session run one at a time, previews first; closing the
+    // session waits for the rest
+    {
+        Log log;
+        BlurSession* s = blur_session_open(big.data(), BW, BH, 0, BLUR_FORMAT_RGBA8888);
+        BlurJobSpec spec = {};
+        spec.session = s;
+        spec.kind = BLUR_JOB_SESSION_BLURRED;
+        spec.mode = 2;
+        spec.strength = 40;
+        spec.priority = BLUR_JOB_PREVIEW;
+        const int64_t p1 = blur_job_submit(&spec, record, &log);
+        spec.priority = BLUR_JOB_EXPORT;
+        spec.strength = 41;
+        const int64_t e = blur_job_submit(&spec, record, &log);
+        spec.priority = BLUR_JOB_PREVIEW;
+        spec.strength = 42;
+        const int64_t p2 = blur_job_submit(&spec, record, &log);
+        const bool firstStillRunning = statusOf(log, p1) == 1;
+        blur_job_wait(e);
+        blur_session_close(s); // nothing left, returns at once
+        std::lock_guard<std::mutex> lock(log.mutex);
+        if (log.order.size() != 3 || (firstStillRunning && (log.order[0] != p1 || log.order[1] != p2))) {
+            std::cerr << "session jobs ran out of order\n";
+            return 8;
+        }
+        for (int status : log.status) {
+            if (status != 0) {
+                std::cerr << "session job failed: " << status << "\n";
+                return 9;
+            }
+        }
+    }
+    {
+        Log log;
+        BlurSession* s = blur_session_open(big.data(), BW, BH, 0, BLUR_FORMAT_RGBA8888);
+        BlurJobSpec spec = {};
+        spec.session = s;
+        spec.kind = BLUR_JOB_SESSION_BLURRED;
+        spec.mode = 2;
+        spec.strength = 60;
+        blur_job_submit(&spec, record, &log);
+        blur_job_submit(&spec, record, &log);
+        blur_session_close(s);
+        std::lock_guard<std::mutex> lock(log.mutex);
+        if (log.order.size() != 2) {
+            std::cerr << "session closed with " << 2 - log.order.size() << " jobs unfinished\n";
+            return 10;
+        }
+    }
+
+    // A cancel landing between the two layer blurs of a masked job sticks:
+    // the runner holds a CancelScope on the job's context, so the next blur
+    // stops at once instead of clearing the request and running to the end
+    {
+        BlurContext* ctx = blur_context_create();
+        std::vector<uint8_t> px = src;
+        const BlurRect all = {0, 0, W, H};
+        int rc = 0;
+        std::vector<uint8_t> afterFirst;
+        {
+            blurcore::CancelScope job(ctx);
+            rc = blur_apply_regions_ex(ctx, px.data(), W, H, 0, BLUR_FORMAT_RGBA8888, &all, 1, 2, 4);
+            afterFirst = px;
+            blur_context_cancel(ctx);
+            if (rc == 0) rc = blur_apply_regions_ex(ctx, px.data(), W, H, 0, BLUR_FORMAT_RGBA8888, &all, 1, 2, 8);
+            if (rc == -5) {
+                rc = blur_apply_masked(ctx, px.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 2, 4, 8);
+            }
+        }
+        // Outside any scope a new call starts fresh
+        blur_context_cancel(ctx);
+        std::vector<uint8_t> fresh = src;
+        const int freshRc = blur_apply_masked(ctx, fresh.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 2,
+                                              4, 8);
+        blur_context_destroy(ctx);
+        if (rc != -5 || px != afterFirst || freshRc != 0) {
+            std::cerr << "cancel between layer blurs lost (" << rc << ", " << freshRc << ")\n";
+            return 13;
+        }
+    }
+
+    // Bad arguments
+    {
+        std::vector<uint8_t> small = src;
+        BlurJobSpec spec = regions(small, W, H, 1, 5);
+        BlurJobSpec noMask = spec;
+        noMask.kind = BLUR_JOB_MASKED;
+        BlurJobSpec badKind = spec;
+        badKind.kind = 9;
+        BlurJobSpec noSession = spec;
+        noSession.kind = BLUR_JOB_SESSION_MASKED;
+        BlurJobSpec badRects = spec;
+        badRects.rect_count = 2;
+        if (blur_job_submit(nullptr, nullptr, nullptr) != -1 || blur_job_submit(&noMask, nullptr, nullptr) != -1 ||
+            blur_job_submit(&badKind, nullptr, nullptr) != -1 || blur_job_submit(&noSession, nullptr, nullptr) != -1 ||
+            blur_job_submit(&badRects, nullptr, nullptr) != -1 || blur_job_cancel(12345678) != -1 ||
+            blur_job_wait(-4) != -1) {
+            std::cerr << "bad arguments not rejected\n";
+            return 11;
+        }
+        // Invalid blur arguments surface through the callback
+        Log log;
+        spec.width = 0;
+        const int64_t j = blur_job_submit(&spec, record, &log);
+        blur_job_wait(j);
+        if (statusOf(log, j) != -1) {
+            std::cerr << "blur error not reported: " << statusOf(log, j) << "\n";
+            return 12;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    // Runners on the worker pool, and on threads of their own without one
+    for (int threads : {4, 1}) {
+        blur_set_thread_count(threads);
+        if (const int rc = runAll()) {
+            std::cerr << "with " << threads << " threads\n";
+            return rc;
+        }
+    }
+    std::cout << "job tests passed\n";
+    return 0;
+}
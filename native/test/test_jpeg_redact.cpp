@@ -0,0 +1,253 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include "../include/blur.h"
+#ifdef BLUR_ENABLE_JPEG
+#include <jpeglib.h>
+#endif
+
+// DCT-domain JPEG redaction: blocks away from the rects must come out bit
+// for bit, the rects must match a pixel-domain blur up to requantization,
+// only the bands holding rects may be decoded, and metadata other than the
+// ICC profile is dropped unless asked for.
+#ifdef BLUR_ENABLE_JPEG
+namespace {
+
+// Named after the binary (set in main): the plain and sanitized builds of
+// this test share a build directory and may run in parallel
+const char* kInput = nullptr;
+const char* kOutput = nullptr;
+const char* kJunk = nullptr;
+
+bool writeJpeg(const char* path, const std::vector<uint8_t>& pixels, int w, int h, int comps) {
+    FILE* file = std::fopen(path, "wb");
+    if (!file) return false;
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, file);
+    cinfo.image_width = w;
+    cinfo.image_height = h;
+    cinfo.input_components = comps;
+    cinfo.in_color_space = comps == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    const uint8_t icc[] = "ICC_PROFILE\0\1\1fake";
+    jpeg_write_marker(&cinfo, JPEG_APP0 + 2, icc, sizeof(icc));
+    const char exif[] = "Exif\0\0GPS here";
+    jpeg_write_marker(&cinfo, JPEG_APP0 + 1, reinterpret_cast<const JOCTET*>(exif), sizeof(exif));
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<uint8_t*>(pixels.data()) + static_cast<size_t>(cinfo.next_scanline) * w * comps;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    std::fclose(file);
+    return true;
+}
+
+struct Decoded {
+    std::vector<std::vector<JCOEF>> blocks; // per component, row-major blocks of 64
+    std::vector<int> widthInBlocks;
+    std::vector<uint8_t> pixels;
+    std::vector<int> markers;
+};
+
+bool readJpeg(const char* path, Decoded* out) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) return false;
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    for (int m = 0; m < 16; ++m) jpeg_save_markers(&cinfo, JPEG_APP0 + m, 0xFFFF);
+    jpeg_read_header(&cinfo, TRUE);
+    for (jpeg_saved_marker_ptr m = cinfo.marker_list; m; m = m->next) out->markers.push_back(m->marker);
+    jvirt_barray_ptr* coefs = jpeg_read_coefficients(&cinfo);
+    for (int c = 0; c < cinfo.num_components; ++c) {
+        const jpeg_component_info& comp = cinfo.comp_info[c];
+        std::vector<JCOEF> all;
+        for (JDIMENSION by = 0; by < comp.height_in_blocks; ++by) {
+            JBLOCKARRAY row = (*cinfo.mem->access_virt_barray)(reinterpret_cast<j_common_ptr>(&cinfo), coefs[c],
+                                                              by, 1, FALSE);
+            for (JDIMENSION bx = 0; bx < comp.width_in_blocks; ++bx) all.insert(all.end(), row[0][bx], row[0][bx] + 64);
+        }
+        out->blocks.push_back(all);
+        out->widthInBlocks.push_back(static_cast<int>(comp.width_in_blocks));
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    std::rewind(file);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_read_header(&cinfo, TRUE);
+    jpeg_start_decompress(&cinfo);
+    const size_t rowBytes = static_cast<size_t>(cinfo.output_width) * cinfo.output_components;
+    out->pixels.resize(rowBytes * cinfo.output_height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = out->pixels.data() + rowBytes * cinfo.output_scanline;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    std::fclose(file);
+    return true;
+}
+
+// Mean absolute difference over a rect
+double meanDiff(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int w, int comps, const BlurRect& r) {
+    double sum = 0;
+    for (int y = r.y; y < r.y + r.h; ++y)
+        for (int x = r.x * comps; x < (r.x + r.w) * comps; ++x)
+            sum += std::abs(a[static_cast<size_t>(y) * w * comps + x] - b[static_cast<size_t>(y) * w * comps + x]);
+    return sum / (static_cast<double>(r.w) * r.h * comps);
+}
+
+int checkImage(int comps) {
+    const int W = 301, H = 203;
+    std::vector<uint8_t> image(static_cast<size_t>(W) * H * comps);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+            for (int c = 0; c < comps; ++c)
+                image[(static_cast<size_t>(y) * W + x) * comps + c] =
+                    static_cast<uint8_t>(((x / 3 + y / 5) % 2 ? 200 : 40) + c * 5 + (x * y) % 13);
+    if (!writeJpeg(kInput, image, W, H, comps)) return 10;
+    Decoded source;
+    if (!readJpeg(kInput, &source)) return 11;
+
+    const BlurRect rect = {97, 61, 40, 30};
+    for (int mode : {0, 1, 2, 3, 4}) {
+        BlurJpegStats stats = {};
+        const int rc = blur_jpeg_redact(kInput, kOutput, &rect, 1, mode, 6, 0, &stats);
+        if (rc != 0) {
+            std::cerr << "redact failed (" << rc << ") for mode " << mode << "\n";
+            return 12;
+        }
+        Decoded result;
+        if (!readJpeg(kOutput, &result)) return 13;
+
+        // 16x16 cells for 4:2:0 colour, 8x8 for grey; only those under the
+        // rect may change
+        const int cell = comps == 1 ? 8 : 16;
+        for (size_t c = 0; c < source.blocks.size(); ++c) {
+            const int blockPx = comps == 1 || c == 0 ? 8 : 16;
+            const int bw = source.widthInBlocks[c];
+            for (size_t b = 0; b < source.blocks[c].size() / 64; ++b) {
+                const int x = static_cast<int>(b % bw) * blockPx, y = static_cast<int>(b / bw) * blockPx;
+                const bool touched = x + blockPx > rect.x / cell * cell && x < (rect.x + rect.w + cell - 1) / cell * cell &&
+                                     y + blockPx > rect.y / cell * cell && y < (rect.y + rect.h + cell - 1) / cell * cell;
+                if (!touched && !std::equal(source.blocks[c].begin() + b * 64, source.blocks[c].begin() + b * 64 + 64,
+                                            result.blocks[c].begin() + b * 64)) {
+                    std::cerr << "block outside the rect changed (mode " << mode << ")\n";
+                    return 14;
+                }
+            }
+        }
+
+        // Pixel-domain reference from the decoded source
+        std::vector<uint8_t> expected = source.pixels;
+        blur_apply_regions_ex(nullptr, expected.data(), W, H, 0, comps == 1 ? BLUR_FORMAT_GRAY8 : BLUR_FORMAT_RGB888,
+                              &rect, 1, mode, 6);
+        const double error = meanDiff(expected, result.pixels, W, comps, rect);
+        const double change = meanDiff(source.pixels, result.pixels, W, comps, rect);
+        if (error > 4.0 || change < 20.0) {
+            std::cerr << "rect not blurred like the reference: error " << error << ", change " << change
+                      << " (mode " << mode << ")\n";
+            return 15;
+        }
+
+        // Rect rows plus alignment (and the mode 3 halo) only
+        const int maxRows = (mode == 3 ? 2 * 6 : 0) + rect.h + 2 * cell;
+        const int64_t cells = ((rect.w + cell - 1) / cell + 1) * ((rect.h + cell - 1) / cell + 1);
+        if (stats.rows_decoded > maxRows || stats.blocks_rewritten > cells * (comps == 1 ? 1 : 6) ||
+            stats.blocks_rewritten == 0 || stats.blocks_total <= stats.blocks_rewritten) {
+            std::cerr << "decoded too much: " << stats.rows_decoded << " rows, " << stats.blocks_rewritten
+                      << " blocks\n";
+            return 16;
+        }
+    }
+
+    // Metadata: ICC always, EXIF only on request
+    Decoded plain, full;
+    if (blur_jpeg_redact(kInput, kOutput, &rect, 1, 2, 6, 0, nullptr) != 0 || !readJpeg(kOutput, &plain) ||
+        blur_jpeg_redact(kInput, kOutput, &rect, 1, 2, 6, BLUR_JPEG_COPY_METADATA, nullptr) != 0 ||
+        !readJpeg(kOutput, &full)) {
+        return 17;
+    }
+    auto has = [](const Decoded& d, int marker) {
+        return std::find(d.markers.begin(), d.markers.end(), marker) != d.markers.end();
+    };
+    if (!has(plain, JPEG_APP0 + 2) || has(plain, JPEG_APP0 + 1) || !has(full, JPEG_APP0 + 1)) {
+        std::cerr << "metadata not filtered\n";
+        return 18;
+    }
+
+    // No rects: a lossless copy that decodes nothing
+    BlurJpegStats stats = {};
+    Decoded copy;
+    if (blur_jpeg_redact(kInput, kOutput, nullptr, 0, 2, 6, 0, &stats) != 0 || !readJpeg(kOutput, &copy) ||
+        copy.blocks != source.blocks || stats.rows_decoded != 0 || stats.blocks_rewritten != 0) {
+        std::cerr << "empty redaction was not a copy\n";
+        return 19;
+    }
+    return 0;
+}
+
+} // namespace
+#endif
+
+int main(int argc, char** argv) {
+    std::string name = argc > 0 ? argv[0] : "jpeg_redact";
+    name = name.substr(name.find_last_of("/\\") + 1);
+    if (!blur_jpeg_available()) {
+        if (blur_jpeg_redact("in.jpg", "out.jpg", nullptr, 0, 2, 6, 0, nullptr) != -6) {
+            std::cerr << "unavailable backend did not report -6\n";
+            return 1;
+        }
+        std::cout << "jpeg redaction not built; skipped\n";
+        return 0;
+    }
+#ifdef BLUR_ENABLE_JPEG
+    const std::string input = name + "_in.jpg", output = name + "_out.jpg", junkPath = name + "_junk.jpg";
+    kInput = input.c_str();
+    kOutput = output.c_str();
+    kJunk = junkPath.c_str();
+    for (int comps : {3, 1}) {
+        const int rc = checkImage(comps);
+        if (rc != 0) return rc;
+    }
+
+    const BlurRect rect = {0, 0, 8, 8};
+    if (blur_jpeg_redact(nullptr, kOutput, &rect, 1, 2, 6, 0, nullptr) != -1 ||
+        blur_jpeg_redact(kInput, kOutput, &rect, 1, 9, 6, 0, nullptr) != -2 ||
+        blur_jpeg_redact("missing.jpg", kOutput, &rect, 1, 2, 6, 0, nullptr) != -7 ||
+        blur_jpeg_redact(kInput, "no/such/dir/out.jpg", &rect, 1, 2, 6, 0, nullptr) != -8) {
+        std::cerr << "bad arguments accepted\n";
+        return 2;
+    }
+
+    // Not a JPEG: fails without leaving the output behind
+    FILE* junk = std::fopen(kJunk, "wb");
+    std::fputs("not a jpeg", junk);
+    std::fclose(junk);
+    std::remove(kOutput);
+    if (blur_jpeg_redact(kJunk, kOutput, &rect, 1, 2, 6, 0, nullptr) != -7 ||
+        std::fopen(kOutput, "rb") != nullptr) {
+        std::cerr << "corrupt input not rejected\n";
+        return 3;
+    }
+    std::remove(kJunk);
+    std::remove(kInput);
+#endif
+    std::cout << "jpeg redaction tests passed\n";
+    return 0;
+}
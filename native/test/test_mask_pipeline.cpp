@@ -0,0 +1,205 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// blur_mask_process works on the non-zero bounding box only; every step
+// must still match the same operation done naively over the whole frame.
+static int clampi(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+static std::vector<uint8_t> morphRef(const std::vector<uint8_t>& m, int W, int H, int r, bool dilate) {
+    std::vector<uint8_t> out(m.size());
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x) {
+            int v = dilate ? 0 : 255;
+            for (int dy = -r; dy <= r; ++dy)
+                for (int dx = -r; dx <= r; ++dx) {
+                    const int s = m[clampi(y + dy, 0, H - 1) * W + clampi(x + dx, 0, W - 1)];
+                    v = dilate ? (s > v ? s : v) : (s < v ? s : v);
+                }
+            out[y * W + x] = static_cast<uint8_t>(v);
+        }
+    return out;
+}
+
+// Brute-force feathering by exact distance to the nearest opposite pixel
+static std::vector<uint8_t> featherRef(const std::vector<uint8_t>& m, int W, int H, int inner, int outer) {
+    std::vector<uint8_t> out(m.size());
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x) {
+            const bool in = m[y * W + x] > 127;
+            double best = 1e30;
+            for (int v = 0; v < H; ++v)
+                for (int u = 0; u < W; ++u) {
+                    if ((m[v * W + u] > 127) == in) continue;
+                    const double d2 = double(u - x) * (u - x) + double(v - y) * (v - y);
+                    if (d2 < best) best = d2;
+                }
+            const double d = std::sqrt(best);
+            double a = in ? (inner > 0 && d < inner ? d / inner : 1.0) : (outer > 0 && d < outer ? 1.0 - d / outer : 0.0);
+            out[y * W + x] = static_cast<uint8_t>(std::lround(a * 255.0));
+        }
+    return out;
+}
+
+static bool same(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, const char* what, int tolerance = 0) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::abs(a[i] - b[i]) > tolerance) {
+            std::cerr << what << " mismatch at " << i << ": " << int(a[i]) << " vs " << int(b[i]) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    const int W = 97, H = 61;
+    std::srand(5);
+
+    // A few blobs, one touching the right edge, one tiny, plus speckle
+    std::vector<uint8_t> mask(W * H, 0);
+    for (int y = 10; y < 35; ++y)
+        for (int x = 30; x < 60; ++x) mask[y * W + x] = 255;
+    for (int y = 40; y < 55; ++y)
+        for (int x = 85; x < W; ++x) mask[y * W + x] = 255;
+    for (int y = 50; y < 52; ++y)
+        for (int x = 10; x < 12; ++x) mask[y * W + x] = 200;
+    for (int i = 0; i < 40; ++i) mask[(12 + std::rand() % 30) * W + 25 + std::rand() % 40] = std::rand() & 0xFF;
+
+    struct MorphCase { int op, r; };
+    const MorphCase morphCases[] = {
+        {BLUR_MASK_DILATE, 1}, {BLUR_MASK_DILATE, 4}, {BLUR_MASK_ERODE, 2},
+        {BLUR_MASK_OPEN, 3}, {BLUR_MASK_CLOSE, 2}, {BLUR_MASK_CLOSE, 7}, {BLUR_MASK_GRADIENT, 1},
+    };
+    for (const MorphCase& c : morphCases) {
+        std::vector<uint8_t> expected;
+        switch (c.op) {
+        case BLUR_MASK_DILATE: expected = morphRef(mask, W, H, c.r, true); break;
+        case BLUR_MASK_ERODE: expected = morphRef(mask, W, H, c.r, false); break;
+        case BLUR_MASK_OPEN: expected = morphRef(morphRef(mask, W, H, c.r, false), W, H, c.r, true); break;
+        case BLUR_MASK_CLOSE: expected = morphRef(morphRef(mask, W, H, c.r, true), W, H, c.r, false); break;
+        default: {
+            const std::vector<uint8_t> d = morphRef(mask, W, H, c.r, true), e = morphRef(mask, W, H, c.r, false);
+            expected.resize(mask.size());
+            for (size_t i = 0; i < mask.size(); ++i) expected[i] = static_cast<uint8_t>(d[i] - e[i]);
+        }
+        }
+        std::vector<uint8_t> actual = mask;
+        const BlurMaskStep step = {c.op, c.r, 0};
+        if (blur_mask_process(nullptr, actual.data(), W, H, 0, &step, 1) != 0) {
+            std::cerr << "op " << c.op << " failed\n";
+            return 1;
+        }
+        if (!same(actual, expected, "morphology")) {
+            std::cerr << "  op " << c.op << " radius " << c.r << "\n";
+            return 2;
+        }
+    }
+
+    // Small blob removal keeps soft pixels and diagonal links
+    {
+        std::vector<uint8_t> m(W * H, 0);
+        for (int i = 0; i < 12; ++i) m[(5 + i) * W + 5 + i] = 255; // diagonal line, 12 px
+        for (int y = 30; y < 33; ++y)
+            for (int x = 40; x < 43; ++x) m[y * W + x] = 255;      // 9 px
+        m[50 * W + 70] = 100;                                      // soft, not foreground
+        std::vector<uint8_t> expected = m;
+        for (int y = 30; y < 33; ++y)
+            for (int x = 40; x < 43; ++x) expected[y * W + x] = 0;
+        const BlurMaskStep step = {BLUR_MASK_REMOVE_SMALL, 0, 10};
+        if (blur_mask_process(nullptr, m.data(), W, H, 0, &step, 1) != 0 || !same(m, expected, "remove small")) return 3;
+    }
+
+    // Band-limited smoothing equals a full-frame gaussian
+    for (int sigma : {1, 3, 8}) {
+        std::vector<uint8_t> expected = mask;
+        const BlurRect all = {0, 0, W, H};
+        blur_apply_regions_ex(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_GRAY8, &all, 1, 2, sigma);
+        std::vector<uint8_t> actual = mask;
+        const BlurMaskStep step = {BLUR_MASK_SMOOTH, sigma, 0};
+        if (blur_mask_process(nullptr, actual.data(), W, H, 0, &step, 1) != 0 || !same(actual, expected, "smooth")) {
+            std::cerr << "  sigma " << sigma << "\n";
+            return 4;
+        }
+    }
+
+    // Feathering by exact Euclidean distance (float rounding may move a
+    // value by one)
+    {
+        std::vector<uint8_t> expected = featherRef(mask, W, H, 4, 9);
+        std::vector<uint8_t> actual = mask;
+        const BlurMaskStep step = {BLUR_MASK_FEATHER, 4, 9};
+        if (blur_mask_process(nullptr, actual.data(), W, H, 0, &step, 1) != 0 || !same(actual, expected, "feather", 1)) {
+            return 5;
+        }
+    }
+
+    // A whole pipeline on a strided mask leaves the row padding alone and
+    // matches the steps run one call at a time
+    {
+        const int stride = W + 13;
+        std::vector<uint8_t> strided(stride * H, 0x5A);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x) strided[y * stride + x] = mask[y * W + x];
+        const BlurMaskStep steps[] = {
+            {BLUR_MASK_CLOSE, 2, 0}, {BLUR_MASK_REMOVE_SMALL, 0, 20}, {BLUR_MASK_THRESHOLD, 0, 127},
+            {BLUR_MASK_SMOOTH, 2, 0}, {BLUR_MASK_FEATHER, 3, 6},
+        };
+        if (blur_mask_process(nullptr, strided.data(), W, H, stride, steps, 5) != 0) return 6;
+        std::vector<uint8_t> expected = mask;
+        for (const BlurMaskStep& s : steps) blur_mask_process(nullptr, expected.data(), W, H, 0, &s, 1);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < stride; ++x) {
+                const uint8_t want = x < W ? expected[y * W + x] : 0x5A;
+                if (strided[y * stride + x] != want) {
+                    std::cerr << "pipeline mismatch at " << x << "," << y << "\n";
+                    return 7;
+                }
+            }
+    }
+
+    // Thresholding, and an empty mask stays empty through every step
+    {
+        std::vector<uint8_t> m = mask;
+        const BlurMaskStep step = {BLUR_MASK_THRESHOLD, 0, 150};
+        blur_mask_process(nullptr, m.data(), W, H, 0, &step, 1);
+        for (size_t i = 0; i < m.size(); ++i) {
+            if (m[i] != (mask[i] > 150 ? 255 : 0)) {
+                std::cerr << "threshold mismatch at " << i << "\n";
+                return 8;
+            }
+        }
+        std::vector<uint8_t> empty(W * H, 0);
+        const BlurMaskStep all[] = {
+            {BLUR_MASK_DILATE, 3, 0}, {BLUR_MASK_SMOOTH, 4, 0}, {BLUR_MASK_FEATHER, 2, 5}, {BLUR_MASK_THRESHOLD, 0, 0},
+        };
+        if (blur_mask_process(nullptr, empty.data(), W, H, 0, all, 4) != 0 || empty != std::vector<uint8_t>(W * H, 0)) {
+            std::cerr << "empty mask changed\n";
+            return 9;
+        }
+    }
+
+    // Bad arguments leave the mask untouched
+    {
+        std::vector<uint8_t> m = mask;
+        const BlurMaskStep good = {BLUR_MASK_DILATE, 2, 0};
+        const BlurMaskStep badRadius[] = {good, {BLUR_MASK_ERODE, -1, 0}};
+        const BlurMaskStep badOp[] = {good, {42, 1, 0}};
+        const BlurMaskStep badLevel = {BLUR_MASK_THRESHOLD, 0, 256};
+        if (blur_mask_process(nullptr, nullptr, W, H, 0, &good, 1) != -1 ||
+            blur_mask_process(nullptr, m.data(), W, H, W - 1, &good, 1) != -1 ||
+            blur_mask_process(nullptr, m.data(), W, H, 0, nullptr, 1) != -1 ||
+            blur_mask_process(nullptr, m.data(), W, H, 0, badRadius, 2) != -1 ||
+            blur_mask_process(nullptr, m.data(), W, H, 0, &badLevel, 1) != -1 ||
+            blur_mask_process(nullptr, m.data(), W, H, 0, badOp, 2) != -2 || m != mask) {
+            std::cerr << "bad arguments not rejected\n";
+            return 10;
+        }
+        if (blur_mask_process(nullptr, m.data(), W, H, 0, nullptr, 0) != 0 || m != mask) return 11;
+    }
+
+    std::cout << "mask pipeline tests passed\n";
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include "../include/blur.h"
+#include "../src/thread_pool.h"
+
+// Banded, multi-threaded blur must match the single-threaded result exactly,
+// and overlapping rects must still behave as if applied one after another.
+static std::vector<uint8_t> applySequentially(const std::vector<uint8_t>& src, int W, int H,
+                                              const std::vector<BlurRect>& rects, int mode, int strength) {
+    std::vector<uint8_t> out = src;
+    blur_set_thread_count(1);
+    for (const BlurRect& r : rects) blur_apply_regions(out.data(), W, H, &r, 1, mode, strength);
+    return out;
+}
+
+int main() {
+    const int W = 301, H = 219;
+    std::srand(7);
+    std::vector<uint8_t> src(W * H * 4);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+
+    const std::vector<std::vector<BlurRect>> rectSets = {
+        {{0, 0, W, H}},
+        {{10, 10, 80, 60}, {150, 20, 100, 150}, {20, 120, 90, 90}},          // disjoint
+        {{10, 10, 120, 120}, {60, 60, 120, 120}, {100, 0, 50, 219}},         // overlapping chain
+        {{-20, -20, 60, 60}, {280, 200, 60, 60}, {0, 0, 0, 5}},               // clipped + empty
+    };
+    const int threadCounts[] = {2, 3, 8};
+    const int modes[] = {0, 1, 2};
+
+    for (const auto& rects : rectSets) {
+        for (int mode : modes) {
+            const int strength = mode == 1 ? 9 : 6;
+            const std::vector<uint8_t> expected = applySequentially(src, W, H, rects, mode, strength);
+            for (int threads : threadCounts) {
+                if (blur_set_thread_count(threads) != 0 || blur_get_thread_count() != threads) {
+                    std::cerr << "blur_set_thread_count(" << threads << ") not applied\n";
+                    return 2;
+                }
+                std::vector<uint8_t> actual = src;
+                int rc = blur_apply_regions(actual.data(), W, H, rects.data(),
+                                            static_cast<int>(rects.size()), mode, strength);
+                if (rc != 0) {
+                    std::cerr << "blur_apply_regions returned " << rc << "\n";
+                    return 3;
+                }
+                if (actual != expected) {
+                    std::cerr << "Mismatch with " << threads << " threads (mode " << mode << ", "
+                              << rects.size() << " rects)\n";
+                    return 4;
+                }
+            }
+        }
+    }
+
+    // Default: between one thread and one per hardware thread
+    blur_set_thread_count(0);
+    const int defaultThreads = blur_get_thread_count();
+    if (defaultThreads < 1 || (std::thread::hardware_concurrency() > 0 &&
+                               defaultThreads > static_cast<int>(std::thread::hardware_concurrency()))) {
+        std::cerr << "unexpected default thread count " << defaultThreads << "\n";
+        return 5;
+    }
+    if (blur_set_thread_count(1 << 30) != -1 || blur_get_thread_count() != defaultThreads) {
+        std::cerr << "absurd thread count accepted\n";
+        return 8;
+    }
+
+    // Performance cores: only a real frequency/capacity gap splits clusters
+    using blurcore::performanceCoreCount;
+    if (performanceCoreCount({1024, 1024, 1024, 1024, 446, 446, 446, 446}) != 4 ||  // big.LITTLE capacity
+        performanceCoreCount({3200, 2800, 2800, 2800, 2000, 2000, 2000, 2000}) != 4 || // prime + big + little
+        performanceCoreCount({5000, 5000, 4900, 4800, 4800, 4800, 4800, 4800}) != 8 || // favored-core turbo
+        performanceCoreCount({3000, 3000, 3000, 3000}) != 4 ||
+        performanceCoreCount({3000, 2000, 2000, 2000}) != 4) {                          // one fast core: keep all
+        std::cerr << "performance cores misclassified\n";
+        return 7;
+    }
+
+    // Warm-up runs once however many threads race for it
+    std::vector<int64_t> warmUps(4, -1);
+    std::vector<std::thread> racers;
+    for (size_t i = 0; i < warmUps.size(); ++i) racers.emplace_back([&warmUps, i] { warmUps[i] = blur_warm_up(); });
+    for (std::thread& t : racers) t.join();
+    for (int64_t ns : warmUps) {
+        if (ns < 0 || ns != warmUps[0] || blur_warm_up() != ns) {
+            std::cerr << "blur_warm_up did not run exactly once\n";
+            return 6;
+        }
+    }
+
+    std::cout << "Native parallel blur test OK (default threads " << blur_get_thread_count() << ")\n";
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include "../include/blur.h"
+
+// Channels are blurred independently, so every format must match the RGBA
+// path on the same channel data: BGRA and padded rows byte-for-byte, RGB,
+// gray and NV21 channel-for-channel. Row padding must never be touched.
+static const int W = 45, H = 31;
+
+static std::vector<uint8_t> randomBytes(size_t n, unsigned seed) {
+    std::srand(seed);
+    std::vector<uint8_t> v(n);
+    for (auto& b : v) b = static_cast<uint8_t>(std::rand() & 0xFF);
+    return v;
+}
+
+// Widen a packed plane of `ch` channels to RGBA (missing channels zero).
+static std::vector<uint8_t> toRgba(const std::vector<uint8_t>& src, int w, int h, int ch) {
+    std::vector<uint8_t> out(w * h * 4, 0);
+    for (int i = 0; i < w * h; ++i) {
+        for (int c = 0; c < ch; ++c) out[i * 4 + c] = src[i * ch + c];
+    }
+    return out;
+}
+
+static bool sameChannels(const uint8_t* plane, int stride, const std::vector<uint8_t>& rgba,
+                         int w, int h, int ch) {
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            for (int c = 0; c < ch; ++c) {
+                if (plane[y * stride + x * ch + c] != rgba[(y * w + x) * 4 + c]) return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int rgbaReference(std::vector<uint8_t>& rgba, int w, int h, BlurRect r, int mode, int strength) {
+    return blur_apply_regions(rgba.data(), w, h, &r, 1, mode, strength);
+}
+
+int main() {
+    const BlurRect rects[] = {{0, 0, W, H}, {4, 3, 25, 19}, {-5, 20, 20, 20}};
+    const int strengths[] = {2, 5, 12, 40}; // 40: windows wider than the rects
+
+    for (int mode = 0; mode <= 4; ++mode) {
+        for (const BlurRect& r : rects) {
+            for (int strength : strengths) {
+                // BGRA with padded rows vs packed RGBA
+                const std::vector<uint8_t> rgbaSrc = randomBytes(W * H * 4, 7);
+                std::vector<uint8_t> expected = rgbaSrc;
+                if (rgbaReference(expected, W, H, r, mode, strength) != 0) return 1;
+
+                const int stride = W * 4 + 12;
+                std::vector<uint8_t> padded(stride * H, 0xA5);
+                for (int y = 0; y < H; ++y) {
+                    for (int i = 0; i < W * 4; i += 4) {
+                        const uint8_t* s = &rgbaSrc[y * W * 4 + i];
+                        uint8_t* d = &padded[y * stride + i];
+                        d[0] = s[2]; d[1] = s[1]; d[2] = s[0]; d[3] = s[3];
+                    }
+                }
+                if (blur_apply_regions_ex(nullptr, padded.data(), W, H, stride, BLUR_FORMAT_BGRA8888,
+                                          &r, 1, mode, strength) != 0) return 1;
+                for (int y = 0; y < H; ++y) {
+                    for (int i = 0; i < stride; ++i) {
+                        const uint8_t got = padded[y * stride + i];
+                        if (i >= W * 4) {
+                            if (got != 0xA5) {
+                                std::cerr << "row padding was written (mode " << mode << ")\n";
+                                return 2;
+                            }
+                            continue;
+                        }
+                        const int c = i % 4;
+                        const int swapped = c == 3 ? 3 : 2 - c;
+                        if (got != expected[y * W * 4 + (i - c) + swapped]) {
+                            std::cerr << "BGRA differs from RGBA (mode " << mode << ", strength "
+                                      << strength << ")\n";
+                            return 3;
+                        }
+                    }
+                }
+
+                // RGB and gray, packed
+                const int channels[] = {3, 1};
+                const int formats[] = {BLUR_FORMAT_RGB888, BLUR_FORMAT_GRAY8};
+                for (int f = 0; f < 2; ++f) {
+                    const int ch = channels[f];
+                    std::vector<uint8_t> plane = randomBytes(W * H * ch, 11 + f);
+                    std::vector<uint8_t> ref = toRgba(plane, W, H, ch);
+                    if (rgbaReference(ref, W, H, r, mode, strength) != 0) return 1;
+                    if (blur_apply_regions_ex(nullptr, plane.data(), W, H, 0, formats[f],
+                                              &r, 1, mode, strength) != 0) return 1;
+                    if (!sameChannels(plane.data(), W * ch, ref, W, H, ch)) {
+                        std::cerr << ch << "-channel format differs from RGBA (mode " << mode
+                                  << ", strength " << strength << ")\n";
+                        return 4;
+                    }
+                }
+
+                // NV21 with padded rows: luma at full size, VU at half size
+                const int cw = (W + 1) / 2, chh = (H + 1) / 2;
+                const int ystride = W + 3;
+                std::vector<uint8_t> frame = randomBytes(ystride * (H + chh), 13);
+                std::vector<uint8_t> luma(W * H), vu(cw * chh * 2);
+                for (int y = 0; y < H; ++y) {
+                    for (int x = 0; x < W; ++x) luma[y * W + x] = frame[y * ystride + x];
+                }
+                for (int y = 0; y < chh; ++y) {
+                    for (int x = 0; x < cw * 2; ++x) vu[y * cw * 2 + x] = frame[(H + y) * ystride + x];
+                }
+                std::vector<uint8_t> lumaRef = toRgba(luma, W, H, 1);
+                std::vector<uint8_t> vuRef = toRgba(vu, cw, chh, 2);
+                if (rgbaReference(lumaRef, W, H, r, mode, strength) != 0) return 1;
+
+                const int x0 = r.x < 0 ? 0 : r.x, y0 = r.y < 0 ? 0 : r.y;
+                const int x1 = std::min(r.x + r.w - 1, W - 1), y1 = std::min(r.y + r.h - 1, H - 1);
+                const BlurRect cr = {x0 / 2, y0 / 2, x1 / 2 - x0 / 2 + 1, y1 / 2 - y0 / 2 + 1};
+                if (rgbaReference(vuRef, cw, chh, cr, mode, (strength + 1) / 2) != 0) return 1;
+
+                if (blur_apply_regions_ex(nullptr, frame.data(), W, H, ystride, BLUR_FORMAT_NV21,
+                                          &r, 1, mode, strength) != 0) return 1;
+                if (!sameChannels(frame.data(), ystride, lumaRef, W, H, 1) ||
+                    !sameChannels(frame.data() + ystride * H, ystride, vuRef, cw, chh, 2)) {
+                    std::cerr << "NV21 differs from RGBA (mode " << mode << ", strength "
+                              << strength << ")\n";
+                    return 5;
+                }
+            }
+        }
+    }
+
+    uint8_t px[16] = {0};
+    const BlurRect one = {0, 0, 2, 2};
+    if (blur_apply_regions_ex(nullptr, px, 2, 2, 7, BLUR_FORMAT_RGBA8888, &one, 1, 0, 1) != -1 ||
+        blur_apply_regions_ex(nullptr, px, 2, 2, 0, 99, &one, 1, 0, 1) != -1) {
+        std::cerr << "bad stride/format must be rejected\n";
+        return 6;
+    }
+
+    // Odd-width NV21 with a tight stride has no room for the last VU pair:
+    // rejected before the luma plane is touched
+    std::vector<uint8_t> nv21 = randomBytes(5 * (4 + 2), 17);
+    const std::vector<uint8_t> before = nv21;
+    const BlurRect all = {0, 0, 5, 4};
+    if (blur_apply_regions_ex(nullptr, nv21.data(), 5, 4, 5, BLUR_FORMAT_NV21, &all, 1, 0, 2) != -1 ||
+        nv21 != before) {
+        std::cerr << "rejected NV21 frame was modified\n";
+        return 7;
+    }
+
+    std::cout << "Native pixel format test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// blur_composite_poisson must land close to the exact solution of the same
+// discrete problem, and pasting an image onto a brightness-shifted copy of
+// itself must come out seamless.
+static std::vector<double> exactCorrection(const std::vector<uint8_t>& dst, const std::vector<uint8_t>& src,
+                                           const std::vector<uint8_t>& mask, int W, int H, int bpp, int c) {
+    std::vector<double> u(W * H);
+    for (int i = 0; i < W * H; ++i) u[i] = mask[i] ? 0.0 : double(dst[i * bpp + c]) - src[i * bpp + c];
+    // Over-relaxed Gauss-Seidel until it stops moving
+    for (int it = 0; it < 20000; ++it) {
+        double change = 0.0;
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x) {
+                if (!mask[y * W + x]) continue;
+                double s = 0.0;
+                int n = 0;
+                if (x > 0) { s += u[y * W + x - 1]; ++n; }
+                if (x + 1 < W) { s += u[y * W + x + 1]; ++n; }
+                if (y > 0) { s += u[(y - 1) * W + x]; ++n; }
+                if (y + 1 < H) { s += u[(y + 1) * W + x]; ++n; }
+                const double next = u[y * W + x] + 1.9 * (s / n - u[y * W + x]);
+                change = std::max(change, std::fabs(next - u[y * W + x]));
+                u[y * W + x] = next;
+            }
+        if (change < 1e-6) break;
+    }
+    return u;
+}
+
+int main() {
+    const int W = 90, H = 70, bpp = 4;
+    std::srand(11);
+
+    // Smooth but distinct images, and a blob that touches the left edge
+    std::vector<uint8_t> dst(W * H * bpp), src(W * H * bpp), mask(W * H, 0);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x) {
+            for (int c = 0; c < bpp; ++c) {
+                dst[(y * W + x) * bpp + c] = static_cast<uint8_t>(40 + (x * (c + 1) + y * 2) % 150);
+                src[(y * W + x) * bpp + c] = static_cast<uint8_t>(60 + (x * 3 + y * (c + 2)) % 120 + std::rand() % 8);
+            }
+            const int dx = x - 35, dy = y - 30;
+            if (dx * dx + 2 * dy * dy < 700 || (x < 12 && y > 40 && y < 60)) mask[y * W + x] = 255;
+        }
+
+    // Close to the exact solve, including where the mask meets the frame
+    {
+        std::vector<uint8_t> out = dst;
+        if (blur_composite_poisson(out.data(), src.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 0) != 0) {
+            std::cerr << "composite failed\n";
+            return 1;
+        }
+        for (int c = 0; c < 3; ++c) {
+            const std::vector<double> u = exactCorrection(dst, src, mask, W, H, bpp, c);
+            for (int i = 0; i < W * H; ++i) {
+                const int j = i * bpp + c;
+                const double want = mask[i] ? std::min(std::max(src[j] + u[i], 0.0), 255.0) : dst[j];
+                if (std::fabs(out[j] - want) > 1.5) {
+                    std::cerr << "channel " << c << " pixel " << i << ": " << int(out[j]) << " vs " << want << "\n";
+                    return 2;
+                }
+            }
+        }
+        for (int i = 0; i < W * H; ++i) {
+            if (out[i * bpp + 3] != dst[i * bpp + 3]) {
+                std::cerr << "alpha changed at " << i << "\n";
+                return 3;
+            }
+        }
+    }
+
+    // The same picture, brighter, pastes back invisibly; a soft-edged mask
+    // and strided rows leave everything else alone
+    {
+        const int stride = W * 3 + 7;
+        std::vector<uint8_t> base(stride * H, 0x33), shifted(stride * H, 0x44), soft(W * H, 0);
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W * 3; ++x) {
+                base[y * stride + x] = dst[(y * W) * bpp + (x / 3) * bpp + x % 3];
+                shifted[y * stride + x] = static_cast<uint8_t>(base[y * stride + x] + 50);
+            }
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x) {
+                const double d = std::sqrt(double(x - 50) * (x - 50) + double(y - 35) * (y - 35));
+                soft[y * W + x] = static_cast<uint8_t>(d < 15 ? 255 : (d > 25 ? 0 : 255 * (25 - d) / 10));
+            }
+        std::vector<uint8_t> out = base;
+        if (blur_composite_poisson(out.data(), shifted.data(), W, H, stride, BLUR_FORMAT_RGB888, soft.data(), 0, 0) != 0) {
+            return 4;
+        }
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < stride; ++x) {
+                const int i = y * stride + x;
+                const bool inside = x < W * 3 && soft[y * W + x / 3];
+                if (inside ? std::abs(out[i] - base[i]) > 1 : out[i] != base[i]) {
+                    std::cerr << "seam at " << x << "," << y << ": " << int(out[i]) << " vs " << int(base[i]) << "\n";
+                    return 5;
+                }
+            }
+    }
+
+    // An empty mask is a no-op; bad arguments are rejected
+    {
+        std::vector<uint8_t> out = dst, none(W * H, 0);
+        if (blur_composite_poisson(out.data(), src.data(), W, H, 0, BLUR_FORMAT_RGBA8888, none.data(), 0, 0) != 0 ||
+            out != dst) {
+            std::cerr << "empty mask changed the image\n";
+            return 6;
+        }
+        if (blur_composite_poisson(nullptr, src.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 0) != -1 ||
+            blur_composite_poisson(out.data(), src.data(), W, H, W * 4 - 1, BLUR_FORMAT_RGBA8888, mask.data(), 0, 0) != -1 ||
+            blur_composite_poisson(out.data(), src.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, -1) != -1 ||
+            blur_composite_poisson(out.data(), src.data(), W, H, 0, BLUR_FORMAT_NV21, mask.data(), 0, 0) != -2) {
+            std::cerr << "bad arguments not rejected\n";
+            return 7;
+        }
+    }
+
+    std::cout << "poisson tests passed\n";
+    return 0;
+}
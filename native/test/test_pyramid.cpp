@@ -0,0 +1,90 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// Level sizes and selection, the 2x2 downsample, preview scaling of rects
+// and strength, and that a cancelled context recovers on the next call.
+int main() {
+    const int W = 101, H = 64;
+    std::srand(3);
+    std::vector<uint8_t> src(W * H * 4);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+
+    BlurPyramid* p = blur_pyramid_create(src.data(), W, H, 0, 3);
+    if (!p || blur_pyramid_levels(p) != 3) {
+        std::cerr << "expected three levels\n";
+        return 1;
+    }
+
+    const int expectW[] = {101, 51, 26, 13}, expectH[] = {64, 32, 16, 8};
+    for (int l = 0; l <= 3; ++l) {
+        int w = 0, h = 0;
+        if (blur_pyramid_level_size(p, l, &w, &h) != 0 || w != expectW[l] || h != expectH[l]) {
+            std::cerr << "level " << l << " is " << w << "x" << h << "\n";
+            return 2;
+        }
+    }
+    if (blur_pyramid_level_for(p, 40, 20) != 1 || blur_pyramid_level_for(p, 26, 16) != 2 ||
+        blur_pyramid_level_for(p, 5, 5) != 3 || blur_pyramid_level_for(p, 200, 10) != 0) {
+        std::cerr << "wrong level picked for viewport\n";
+        return 3;
+    }
+
+    // Level 1 pixel (10, 7) is the rounded mean of its 2x2 source block,
+    // and the odd last column averages with itself
+    std::vector<uint8_t> l1(51 * 32 * 4);
+    blur_pyramid_preview(p, nullptr, 1, l1.data(), 0, nullptr, 0, 0, 0);
+    for (int c = 0; c < 4; ++c) {
+        const int x = 20, y = 14;
+        const int sum = src[(y * W + x) * 4 + c] + src[(y * W + x + 1) * 4 + c] +
+                        src[((y + 1) * W + x) * 4 + c] + src[((y + 1) * W + x + 1) * 4 + c];
+        const int edge = src[(y * W + 100) * 4 + c] * 2 + src[((y + 1) * W + 100) * 4 + c] * 2;
+        if (l1[(7 * 51 + 10) * 4 + c] != (sum + 2) / 4 || l1[(7 * 51 + 50) * 4 + c] != (edge + 2) / 4) {
+            std::cerr << "downsample mismatch\n";
+            return 4;
+        }
+    }
+
+    // A preview at level 2 equals blurring the level copy with rects and
+    // strength scaled by 4 (rects grown outwards, strength rounded)
+    const BlurRect rect = {10, 9, 41, 30};
+    for (int mode = 0; mode <= 2; ++mode) {
+        std::vector<uint8_t> level(26 * 16 * 4), preview(26 * 16 * 4);
+        blur_pyramid_preview(p, nullptr, 2, level.data(), 0, nullptr, 0, 0, 0);
+        const BlurRect scaled = {2, 2, 13 - 2, 10 - 2};
+        blur_apply_regions(level.data(), 26, 16, &scaled, 1, mode, 3); // (10 + 2) / 4
+        if (blur_pyramid_preview(p, nullptr, 2, preview.data(), 0, &rect, 1, mode, 10) != 0 || preview != level) {
+            std::cerr << "preview does not match scaled blur (mode " << mode << ")\n";
+            return 5;
+        }
+    }
+    if (blur_pyramid_preview(p, nullptr, 4, l1.data(), 0, &rect, 1, 0, 1) != -1) return 6;
+    blur_pyramid_destroy(p);
+
+    // Cancel a large blur from another thread; whether it lands in time or
+    // not, the context must be usable again afterwards
+    BlurContext* ctx = blur_context_create();
+    std::vector<uint8_t> big(1024 * 1024 * 4, 128);
+    const BlurRect all = {0, 0, 1024, 1024};
+    int rc = 0;
+    std::thread worker([&] { rc = blur_apply_regions_ctx(ctx, big.data(), 1024, 1024, &all, 1, 2, 30); });
+    blur_context_cancel(ctx);
+    worker.join();
+    if (rc != 0 && rc != -5) {
+        std::cerr << "unexpected status " << rc << " from a cancelled call\n";
+        return 7;
+    }
+    std::vector<uint8_t> small(16 * 16 * 4, 9);
+    const BlurRect s16 = {0, 0, 16, 16};
+    if (blur_apply_regions_ctx(ctx, small.data(), 16, 16, &s16, 1, 0, 2) != 0) {
+        std::cerr << "context still cancelled on the next call\n";
+        return 8;
+    }
+    blur_context_destroy(ctx);
+
+    std::cout << "Native pyramid test OK" << std::endl;
+    return 0;
+}
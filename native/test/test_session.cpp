@@ -0,0 +1,221 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include "../include/blur.h"
+
+// A session renders exactly what the one-shot calls produce on a copy of
+// the original, caches the layers it blurred, and keeps the cache within
+// its limit across sessions.
+int main() {
+    const int W = 181, H = 133, stride = W * 4 + 12;
+    const int64_t frame = static_cast<int64_t>(W) * H * 4;
+    std::srand(3);
+    std::vector<uint8_t> src(static_cast<size_t>(stride) * H);
+    for (auto& v : src) v = static_cast<uint8_t>(std::rand() & 0xFF);
+    std::vector<uint8_t> packed(static_cast<size_t>(frame));
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W * 4; ++x) packed[y * W * 4 + x] = src[y * stride + x];
+
+    std::vector<uint8_t> mask(W * H);
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x) {
+            const int dx = x - 90, dy = y - 60, d2 = dx * dx + dy * dy;
+            mask[y * W + x] = static_cast<uint8_t>(d2 < 900 ? 255 : (d2 > 1600 ? 0 : 255 - (d2 - 900) * 255 / 700));
+        }
+
+    BlurSession* s = blur_session_open(src.data(), W, H, stride, BLUR_FORMAT_RGBA8888);
+    int w = 0, h = 0;
+    if (!s || blur_session_size(s, &w, &h) != 0 || w != W || h != H) {
+        std::cerr << "open failed\n";
+        return 1;
+    }
+    const int id = blur_session_add_mask(s, mask.data(), 0);
+    if (id <= 0 || !blur_session_mask(s, id) || blur_session_mask(s, id + 1)) {
+        std::cerr << "add mask failed\n";
+        return 2;
+    }
+
+    // Masked render, twice: the second reuses both layers
+    std::vector<uint8_t> expected = packed;
+    blur_apply_masked(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 2, 2, 9);
+    for (int pass = 0; pass < 2; ++pass) {
+        if (blur_session_render_masked(s, id, 2, 2, 9) != 0 ||
+            std::vector<uint8_t>(blur_session_result(s), blur_session_result(s) + frame) != expected) {
+            std::cerr << "masked render mismatch (pass " << pass << ")\n";
+            return 3;
+        }
+        if (blur_session_cache_bytes() != 2 * frame) {
+            std::cerr << "expected two cached layers, have " << blur_session_cache_bytes() << " bytes\n";
+            return 4;
+        }
+    }
+
+    // Region render, and export into a strided buffer
+    const BlurRect rects[] = {{10, 12, 50, 40}, {100, 70, 60, 50}};
+    expected = packed;
+    blur_apply_regions_ex(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, rects, 2, 1, 6);
+    std::vector<uint8_t> out(static_cast<size_t>(stride) * H, 0xEE);
+    if (blur_session_render_regions(s, rects, 2, 1, 6) != 0 || blur_session_export(s, out.data(), stride) != 0) {
+        std::cerr << "region render failed\n";
+        return 5;
+    }
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < stride; ++x) {
+            const uint8_t want = x < W * 4 ? expected[y * W * 4 + x] : 0xEE;
+            if (out[y * stride + x] != want) {
+                std::cerr << "export mismatch at " << x << "," << y << "\n";
+                return 6;
+            }
+        }
+
+    // A processed mask renders like the one-shot pipeline
+    const BlurMaskStep steps[] = {{BLUR_MASK_ERODE, 3, 0}, {BLUR_MASK_SMOOTH, 2, 0}};
+    std::vector<uint8_t> processed = mask;
+    blur_mask_process(nullptr, processed.data(), W, H, 0, steps, 2);
+    expected = packed;
+    blur_apply_masked(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, processed.data(), 0, 2, 0, 9);
+    if (blur_session_process_mask(s, id, steps, 2) != 0 || blur_session_render_masked(s, id, 2, 0, 9) != 0 ||
+        std::vector<uint8_t>(blur_session_result(s), blur_session_result(s) + frame) != expected) {
+        std::cerr << "processed mask render mismatch\n";
+        return 7;
+    }
+
+    // The cache limit holds across sessions, least recently used first
+    blur_session_set_cache_limit(3 * frame);
+    BlurSession* other = blur_session_open(packed.data(), W, H, 0, BLUR_FORMAT_RGBA8888);
+    const int otherMask = blur_session_add_mask(other, nullptr, 0);
+    for (int bg = 3; bg < 9; ++bg) {
+        if (blur_session_render_masked(other, otherMask, 0, 0, bg) != 0 || blur_session_cache_bytes() > 3 * frame) {
+            std::cerr << "cache over its limit: " << blur_session_cache_bytes() << "\n";
+            return 8;
+        }
+    }
+    // An empty mask shows the background layer everywhere
+    expected = packed;
+    const BlurRect all = {0, 0, W, H};
+    blur_apply_regions_ex(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, &all, 1, 0, 8);
+    if (std::vector<uint8_t>(blur_session_result(other), blur_session_result(other) + frame) != expected) {
+        std::cerr << "empty mask render mismatch\n";
+        return 9;
+    }
+
+    // Trimming drops layers; renders rebuild them
+    if (blur_session_trim(0) != 3 * frame || blur_session_cache_bytes() != 0 ||
+        blur_session_render_masked(s, id, 2, 0, 8) != 0 || blur_session_cache_bytes() != frame) {
+        std::cerr << "trim failed\n";
+        return 10;
+    }
+    blur_session_close(s);
+    if (blur_session_cache_bytes() != 0) {
+        std::cerr << "close left layers behind\n";
+        return 11;
+    }
+
+    // Painting re-blends only the tiles it touched: an edit that is not
+    // reported stays invisible until it is marked
+    const float stroke[] = {20.5f, 30.0f, 70.0f, 45.5f, 150.0f, 20.0f};
+    uint8_t* live = blur_session_mask(other, otherMask);
+    if (blur_session_render_masked(other, otherMask, 2, 0, 7) != 0 ||
+        blur_session_paint_mask(other, otherMask, stroke, 3, 6.5f, 0) != 0 ||
+        blur_session_paint_mask(other, otherMask, stroke + 2, 1, 3.0f, 1) != 0) {
+        std::cerr << "paint failed\n";
+        return 12;
+    }
+    live[(H - 1) * W + W - 1] = 255;
+    expected = packed;
+    std::vector<uint8_t> painted(live, live + W * H);
+    painted[(H - 1) * W + W - 1] = 0;
+    blur_apply_masked(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, painted.data(), 0, 2, 0, 7);
+    if (blur_session_render_masked(other, otherMask, 2, 0, 7) != 0 ||
+        std::vector<uint8_t>(blur_session_result(other), blur_session_result(other) + frame) != expected) {
+        std::cerr << "incremental render mismatch\n";
+        return 13;
+    }
+    const BlurRect corner = {W - 1, H - 1, 1, 1};
+    expected = packed;
+    blur_apply_masked(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, live, 0, 2, 0, 7);
+    if (blur_session_mark_mask_dirty(other, otherMask, &corner) != 0 ||
+        blur_session_render_masked(other, otherMask, 2, 0, 7) != 0 ||
+        std::vector<uint8_t>(blur_session_result(other), blur_session_result(other) + frame) != expected) {
+        std::cerr << "marked edit not rendered\n";
+        return 14;
+    }
+    // New parameters render the whole frame again
+    expected = packed;
+    blur_apply_masked(nullptr, expected.data(), W, H, 0, BLUR_FORMAT_RGBA8888, live, 0, 2, 3, 7);
+    if (blur_session_render_masked(other, otherMask, 2, 3, 7) != 0 ||
+        std::vector<uint8_t>(blur_session_result(other), blur_session_result(other) + frame) != expected) {
+        std::cerr << "full render after parameter change mismatch\n";
+        return 15;
+    }
+
+    // Slider renders: exact layers are reused, in-between strengths blend
+    // the two cached ladder levels around them
+    auto blurred = [&](int strength) {
+        std::vector<uint8_t> v = packed;
+        blur_apply_regions_ex(nullptr, v.data(), W, H, 0, BLUR_FORMAT_RGBA8888, &all, 1, 2, strength);
+        return v;
+    };
+    auto result = [&]() { return std::vector<uint8_t>(blur_session_result(other), blur_session_result(other) + frame); };
+    blur_stats_reset();
+    const std::vector<uint8_t> at10 = blurred(10), at12 = blurred(12), at14 = blurred(14);
+    if (blur_session_render_blurred(other, 2, 10, 0) != 0 || result() != at10 ||
+        blur_session_render_blurred(other, 2, 10, BLUR_SESSION_INTERPOLATE) != 0 || result() != at10 ||
+        blur_session_render_blurred(other, 2, 13, BLUR_SESSION_INTERPOLATE) != 0) {
+        std::cerr << "blurred render failed\n";
+        return 16;
+    }
+    expected.resize(static_cast<size_t>(frame));
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const uint32_t v = at12[i] * 127u + at14[i] * 128u + 128u;
+        expected[i] = static_cast<uint8_t>((v + (v >> 8)) >> 8);
+    }
+    if (result() != expected || blur_session_render_blurred(other, 2, 13, BLUR_SESSION_INTERPOLATE) != 0 ||
+        result() != expected) {
+        std::cerr << "interpolated render mismatch\n";
+        return 17;
+    }
+    BlurStats stats;
+    blur_stats_read(&stats);
+    if (stats.layer_cache_misses != 3 || stats.layer_cache_hits != 3 || stats.layer_cache_interpolated != 2 ||
+        stats.layer_cache_bytes != 3 * frame || stats.layer_cache_limit_bytes != 3 * frame ||
+        stats.layer_cache_layers != 3) {
+        std::cerr << "layer cache stats: " << stats.layer_cache_hits << " hits, " << stats.layer_cache_misses
+                  << " misses, " << stats.layer_cache_interpolated << " interpolated, "
+                  << stats.layer_cache_layers << " layers\n";
+        return 18;
+    }
+
+    // The strength ladder stays defined up to INT_MAX, where both bracketing
+    // layers saturate to the same blur
+    if (blur_session_render_blurred(other, 0, INT_MAX, BLUR_SESSION_INTERPOLATE) != 0) return 20;
+    const std::vector<uint8_t> interpolated = result();
+    if (blur_session_render_blurred(other, 0, INT_MAX, 0) != 0 || result() != interpolated) {
+        std::cerr << "interpolated render at INT_MAX failed\n";
+        return 21;
+    }
+
+    // Bad arguments
+    const float nanStroke[] = {10.0f, NAN, 20.0f, 20.0f};
+    if (blur_session_open(nullptr, W, H, 0, BLUR_FORMAT_RGBA8888) ||
+        blur_session_open(packed.data(), W, H, 0, BLUR_FORMAT_NV21) ||
+        blur_session_render_masked(other, otherMask + 1, 2, 0, 4) != -1 ||
+        blur_session_render_masked(other, otherMask, 1, 0, 4) != -2 ||
+        blur_session_paint_mask(other, otherMask, stroke, 3, NAN, 0) != -1 ||
+        blur_session_paint_mask(other, otherMask, nanStroke, 2, 3.0f, 0) != -1 ||
+        blur_session_add_mask(other, mask.data(), W - 1) != -1 || blur_session_remove_mask(other, otherMask) != 0 ||
+        blur_session_remove_mask(other, otherMask) != -1 || blur_session_export(other, nullptr, 0) != -1 ||
+        blur_session_paint_mask(other, otherMask, stroke, 3, 0.0f, 0) != -1 ||
+        blur_session_render_blurred(other, 2, 4, 2) != -1) {
+        std::cerr << "bad arguments not rejected\n";
+        return 19;
+    }
+    blur_session_close(other);
+    blur_session_set_cache_limit(0);
+
+    std::cout << "session tests passed\n";
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "../include/blur.h"
+
+// Instrumentation: each pass lands in its own stage histogram, percentiles
+// are ordered and bounded by the max, copy stages count bytes, and the
+// JSON export carries the same numbers.
+int main() {
+    blur_stats_reset();
+
+    const int w = 256, h = 256;
+    std::vector<uint8_t> img(static_cast<size_t>(w) * h * 4);
+    for (size_t i = 0; i < img.size(); ++i) img[i] = static_cast<uint8_t>(i * 31);
+    const BlurRect all = {0, 0, w, h};
+    for (int i = 0; i < 20; ++i) blur_apply_regions(img.data(), w, h, &all, 1, 2, 4);
+    blur_apply_regions(img.data(), w, h, &all, 1, 1, 8);
+    blur_apply_regions(img.data(), w, h, &all, 1, 3, 5);
+
+    std::vector<uint8_t> mask(static_cast<size_t>(w) * h, 0);
+    for (int y = 0; y < h; ++y)
+        for (int x = w / 3; x < w; ++x) mask[static_cast<size_t>(y) * w + x] = x < w / 2 ? 128 : 255;
+    blur_apply_masked(nullptr, img.data(), w, h, 0, BLUR_FORMAT_RGBA8888, mask.data(), 0, 2, 2, 8);
+
+    BlurStats stats;
+    if (blur_stats_read(&stats) != 0 || blur_stats_read(nullptr) != -1) {
+        std::cerr << "stats read\n";
+        return 1;
+    }
+    // 20 gaussian calls plus the masked layers
+    const BlurStageStats& hpass = stats.stages[BLUR_STAGE_BLUR_H];
+    if (hpass.count < 20 || stats.stages[BLUR_STAGE_BLUR_V].count != hpass.count) {
+        std::cerr << "box passes: " << hpass.count << " h, " << stats.stages[BLUR_STAGE_BLUR_V].count << " v\n";
+        return 2;
+    }
+    if (hpass.total_ns <= 0 || hpass.p50_ns <= 0 || hpass.p50_ns > hpass.p90_ns ||
+        hpass.p90_ns > hpass.p99_ns || hpass.p99_ns > hpass.max_ns) {
+        std::cerr << "percentiles " << hpass.p50_ns << " " << hpass.p90_ns << " " << hpass.p99_ns
+                  << " max " << hpass.max_ns << "\n";
+        return 3;
+    }
+    if (stats.stages[BLUR_STAGE_PIXELATE].count != 1 || stats.stages[BLUR_STAGE_INTEGRAL].count != 1 ||
+        stats.stages[BLUR_STAGE_BLEND].count != 1) {
+        std::cerr << "pixelate/integral/blend stages not recorded once\n";
+        return 4;
+    }
+    if (stats.stages[BLUR_STAGE_COPY_IN].bytes <= 0 || stats.stages[BLUR_STAGE_COPY_OUT].bytes <= 0) {
+        std::cerr << "copy bytes not counted\n";
+        return 5;
+    }
+    if (stats.pool_hits + stats.pool_misses <= 0) {
+        std::cerr << "pool lookups not counted\n";
+        return 6;
+    }
+
+    const int len = blur_stats_json(nullptr, 0);
+    std::string json(static_cast<size_t>(len) + 1, '\0');
+    if (len <= 0 || blur_stats_json(&json[0], len + 1) != len) {
+        std::cerr << "json length\n";
+        return 7;
+    }
+    json.resize(static_cast<size_t>(len));
+    const std::string hcount = "\"blur_h\":{\"count\":" + std::to_string(hpass.count) + ",";
+    if (json.front() != '{' || json.back() != '}' || json.find(hcount) == std::string::npos ||
+        json.find("\"hit_rate\":") == std::string::npos) {
+        std::cerr << "json: " << json << "\n";
+        return 8;
+    }
+    char small[8];
+    if (blur_stats_json(small, sizeof(small)) != len || small[7] != '\0') {
+        std::cerr << "json truncation\n";
+        return 9;
+    }
+
+    // Disabled stats record nothing; reset clears everything
+    blur_stats_enable(0);
+    blur_apply_regions(img.data(), w, h, &all, 1, 0, 3);
+    blur_stats_read(&stats);
+    if (stats.stages[BLUR_STAGE_BLUR_H].count != hpass.count) {
+        std::cerr << "recorded while disabled\n";
+        return 10;
+    }
+    if (blur_stats_enable(1) != 0) {
+        std::cerr << "enable did not return the previous setting\n";
+        return 11;
+    }
+    blur_stats_reset();
+    blur_stats_read(&stats);
+    for (int s = 0; s < BLUR_STAGE_COUNT; ++s) {
+        if (stats.stages[s].count != 0 || stats.stages[s].max_ns != 0 || !blur_stage_name(s)) {
+            std::cerr << "stage " << s << " not reset\n";
+            return 12;
+        }
+    }
+    if (stats.pool_hits != 0 || stats.pool_misses != 0 || blur_stage_name(BLUR_STAGE_COUNT)) {
+        std::cerr << "pool counters not reset\n";
+        return 13;
+    }
+
+    std::cout << "stats tests passed\n";
+    return 0;
+}
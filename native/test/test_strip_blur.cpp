@@ -0,0 +1,118 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "../include/blur.h"
+
+// Strip-wise blur against the whole-image blur: every mode and format,
+// strips far smaller than the radius, rects crossing and overlapping strip
+// edges; reads must be sequential and aborting callbacks must propagate.
+namespace {
+
+struct Source {
+    const std::vector<uint8_t>* image;
+    std::vector<uint8_t>* output;
+    size_t rowBytes;
+    int nextRead = 0;
+    int nextWrite = 0;
+    int maxRows = 0; // largest single read
+    bool ordered = true;
+    int failAt = -1;
+};
+
+int readRows(void* user, int y, int rows, uint8_t* dst, int stride) {
+    Source* s = static_cast<Source*>(user);
+    if (y != s->nextRead) s->ordered = false;
+    s->nextRead = y + rows;
+    s->maxRows = std::max(s->maxRows, rows);
+    if (s->failAt >= 0 && y + rows > s->failAt) return -9;
+    for (int r = 0; r < rows; ++r) std::memcpy(dst + static_cast<size_t>(r) * stride,
+                                               s->image->data() + (y + r) * s->rowBytes, s->rowBytes);
+    return 0;
+}
+
+int writeRows(void* user, int y, int rows, const uint8_t* src, int stride) {
+    Source* s = static_cast<Source*>(user);
+    if (y != s->nextWrite) s->ordered = false;
+    s->nextWrite = y + rows;
+    for (int r = 0; r < rows; ++r) std::memcpy(s->output->data() + (y + r) * s->rowBytes,
+                                               src + static_cast<size_t>(r) * stride, s->rowBytes);
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    const int W = 37, H = 203;
+    const struct { int format, bpp; } formats[] = {
+        {BLUR_FORMAT_RGBA8888, 4}, {BLUR_FORMAT_RGB888, 3}, {BLUR_FORMAT_GRAY8, 1}};
+    const BlurRect rects[] = {{3, 10, 20, 90}, {10, 60, 25, 120}, {0, 150, 37, 53}};
+    const int strips[] = {1, 7, 64, 500};
+
+    for (const auto& f : formats) {
+        std::vector<uint8_t> image(static_cast<size_t>(W) * H * f.bpp);
+        for (size_t i = 0; i < image.size(); ++i) image[i] = static_cast<uint8_t>((i * 131) ^ (i / 97) * 7);
+
+        for (int mode = 0; mode <= 4; ++mode) {
+            for (int strength : {2, 5, 9}) {
+                for (int rectCount : {1, 3}) {
+                    // rects 0 and 1 overlap, so 3 rects also exercise the longer halo
+                    const BlurRect* rs = rectCount == 1 ? &rects[2] : rects;
+                    std::vector<uint8_t> expected = image;
+                    if (blur_apply_regions_ex(nullptr, expected.data(), W, H, 0, f.format, rs, rectCount,
+                                              mode, strength) != 0) {
+                        std::cerr << "reference blur failed\n";
+                        return 1;
+                    }
+                    for (int stripRows : strips) {
+                        std::vector<uint8_t> output(image.size());
+                        Source src = {&image, &output, static_cast<size_t>(W) * f.bpp};
+                        const int rc = blur_apply_strips(nullptr, W, H, f.format, rs, rectCount, mode, strength,
+                                                         stripRows, readRows, writeRows, &src);
+                        if (rc != 0 || !src.ordered || src.nextRead != H || src.nextWrite != H) {
+                            std::cerr << "strip call failed (" << rc << ") for mode " << mode << "\n";
+                            return 2;
+                        }
+                        if (output != expected) {
+                            std::cerr << "seam: format " << f.format << " mode " << mode << " strength "
+                                      << strength << " rects " << rectCount << " strip " << stripRows << "\n";
+                            return 3;
+                        }
+                        const int halo = blur_strip_halo(H, rs, rectCount, mode, strength);
+                        if (stripRows < H && src.maxRows > std::min(H, stripRows + 2 * halo)) {
+                            std::cerr << "read more rows than one strip needs\n";
+                            return 4;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Halo: gaussian reach, pixelate block - 1, multiplied by overlapping rects
+    if (blur_strip_halo(H, &rects[2], 1, 1, 8) != 7 || blur_strip_halo(H, &rects[2], 1, 3, 6) != 6 ||
+        blur_strip_halo(H, rects, 2, 0, 4) != 8 || blur_strip_halo(H, rects, 2, 3, 4) != 4) {
+        std::cerr << "unexpected halo\n";
+        return 5;
+    }
+
+    // A failing read aborts with its status
+    std::vector<uint8_t> image(static_cast<size_t>(W) * H * 4), output(image.size());
+    Source failing = {&image, &output, static_cast<size_t>(W) * 4};
+    failing.failAt = 100;
+    if (blur_apply_strips(nullptr, W, H, BLUR_FORMAT_RGBA8888, rects, 1, 2, 3, 16, readRows, writeRows,
+                          &failing) != -9) {
+        std::cerr << "read failure not propagated\n";
+        return 6;
+    }
+    if (blur_apply_strips(nullptr, W, H, BLUR_FORMAT_NV21, rects, 1, 2, 3, 16, readRows, writeRows, &failing) != -1 ||
+        blur_apply_strips(nullptr, W, H, BLUR_FORMAT_RGBA8888, rects, 1, 7, 3, 16, readRows, writeRows,
+                          &failing) != -2) {
+        std::cerr << "bad arguments accepted\n";
+        return 7;
+    }
+
+    std::cout << "strip blur tests passed\n";
+    return 0;
+}
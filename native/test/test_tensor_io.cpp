@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include "../include/blur.h"
+
+// Image -> tensor and tensor -> mask: identity at equal size, channel order
+// per format, normalization, bilinear midpoints and bad arguments.
+int main() {
+    const int W = 4, H = 2;
+    std::vector<uint8_t> rgba(W * H * 4);
+    for (int i = 0; i < W * H; ++i) {
+        rgba[i * 4 + 0] = static_cast<uint8_t>(10 * i);
+        rgba[i * 4 + 1] = static_cast<uint8_t>(100 + i);
+        rgba[i * 4 + 2] = static_cast<uint8_t>(200 - i);
+        rgba[i * 4 + 3] = 255;
+    }
+
+    // Same size: a straight conversion, alpha dropped
+    std::vector<float> t(W * H * 3);
+    if (blur_image_to_tensor(rgba.data(), W, H, 0, BLUR_FORMAT_RGBA8888, t.data(), W, H, 1.0f / 255, 0) != 0) return 1;
+    for (int i = 0; i < W * H; ++i)
+        for (int c = 0; c < 3; ++c)
+            if (std::fabs(t[i * 3 + c] - rgba[i * 4 + c] / 255.0f) > 1e-6f) {
+                std::cerr << "identity conversion mismatch at " << i << "\n";
+                return 2;
+            }
+
+    // BGRA swaps red and blue back into RGB order; [-1, 1] normalization
+    std::vector<uint8_t> bgra = rgba;
+    for (int i = 0; i < W * H; ++i) std::swap(bgra[i * 4], bgra[i * 4 + 2]);
+    std::vector<float> tb(W * H * 3);
+    blur_image_to_tensor(bgra.data(), W, H, 0, BLUR_FORMAT_BGRA8888, tb.data(), W, H, 2.0f / 255, -1.0f);
+    for (size_t i = 0; i < t.size(); ++i)
+        if (std::fabs(tb[i] - (t[i] * 2 - 1)) > 1e-5f) {
+            std::cerr << "BGRA conversion mismatch at " << i << "\n";
+            return 3;
+        }
+
+    // 2x downscale lands exactly between source pixels
+    std::vector<float> half(2 * 1 * 3);
+    blur_image_to_tensor(rgba.data(), W, H, 0, BLUR_FORMAT_RGBA8888, half.data(), 2, 1, 1.0f, 0);
+    const float expectRed = (0 + 10 + 40 + 50) / 4.0f;
+    if (std::fabs(half[0] - expectRed) > 1e-4f) {
+        std::cerr << "downscale expected " << expectRed << " got " << half[0] << "\n";
+        return 4;
+    }
+
+    // Mask: second channel of a two-class tensor, upscaled 2x with padding
+    const float scores[] = {0, 0, 1, 1, 0, 0.5f, 1, 0.25f}; // 2x2, channel last
+    const int MW = 4, MH = 4, stride = 6;
+    std::vector<uint8_t> mask(stride * MH, 0xCD);
+    if (blur_tensor_to_mask(scores, 2, 2, 2, 1, mask.data(), MW, MH, stride) != 0) return 5;
+    // Corners equal the nearest score; the padding is untouched
+    if (mask[0] != 0 || mask[3] != 255 || mask[3 * stride] != 128 || mask[3 * stride + 3] != 64 ||
+        mask[4] != 0xCD) {
+        std::cerr << "mask corners " << int(mask[0]) << " " << int(mask[3]) << " " << int(mask[3 * stride]) << " "
+                  << int(mask[3 * stride + 3]) << "\n";
+        return 6;
+    }
+    // Between a 0 and a 1 score, a quarter of the way in
+    if (mask[1] != 64) {
+        std::cerr << "mask midpoint " << int(mask[1]) << "\n";
+        return 7;
+    }
+
+    if (blur_image_to_tensor(rgba.data(), W, H, 0, BLUR_FORMAT_GRAY8, t.data(), W, H, 1, 0) != -1) return 8;
+    if (blur_tensor_to_mask(scores, 2, 2, 2, 2, mask.data(), MW, MH, 0) != -1) return 9;
+
+    std::cout << "Native tensor io test OK" << std::endl;
+    return 0;
+}
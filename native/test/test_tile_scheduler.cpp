@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <set>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+#include "../include/blur.h"
+#include "../src/tile_scheduler.h"
+
+// Tile scheduler: every pixel is produced exactly once, halos are clipped
+// to the image, a neighbourhood filter run tile by tile has no seams, and
+// slow tiles get stolen by idle workers.
+namespace {
+
+// 5x5 mean with the window clipped to the image, out of place
+void meanFilter(const std::vector<uint8_t>& src, std::vector<uint8_t>& dst, int W,
+                int x0, int y0, int x1, int y1, int bx0, int by0, int bx1, int by1) {
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x) {
+            int sum = 0, n = 0;
+            for (int dy = -2; dy <= 2; ++dy)
+                for (int dx = -2; dx <= 2; ++dx) {
+                    const int sx = x + dx, sy = y + dy;
+                    if (sx < bx0 || sx >= bx1 || sy < by0 || sy >= by1) continue;
+                    sum += src[sy * W + sx];
+                    ++n;
+                }
+            dst[y * W + x] = static_cast<uint8_t>(sum / n);
+        }
+}
+
+} // namespace
+
+int main() {
+    blur_set_thread_count(4);
+    const int W = 203, H = 97;
+
+    // Coverage, halo clipping, worker ids
+    {
+        const blurcore::TileGrid grid = {W, H, 32, 24, 5};
+        const int workers = blurcore::tileWorkerCount(grid);
+        std::vector<std::atomic<int>> covered(W * H);
+        std::vector<std::atomic<int>> busy(workers);
+        std::atomic<bool> bad{false};
+        std::atomic<int> count{0};
+        blurcore::forEachTile(grid, [&](const blurcore::Tile& t, int worker) {
+            if (worker < 0 || worker >= workers || busy[worker].fetch_add(1) != 0) bad.store(true);
+            if (t.hx0 != std::max(t.x0 - 5, 0) || t.hy0 != std::max(t.y0 - 5, 0) ||
+                t.hx1 != std::min(t.x1 + 5, W) || t.hy1 != std::min(t.y1 + 5, H) ||
+                t.index != t.y0 / 24 * 7 + t.x0 / 32) {
+                bad.store(true);
+            }
+            for (int y = t.y0; y < t.y1; ++y)
+                for (int x = t.x0; x < t.x1; ++x) covered[y * W + x].fetch_add(1);
+            count.fetch_add(1);
+            busy[worker].fetch_sub(1);
+        });
+        for (const auto& c : covered)
+            if (c.load() != 1) bad.store(true);
+        if (bad.load() || count.load() != 7 * 5 || workers != 4) {
+            std::cerr << "tiles missed, repeated or misplaced (" << count.load() << " tiles)\n";
+            return 1;
+        }
+    }
+
+    // A neighbourhood filter through tiles with a halo matches the whole image
+    {
+        std::vector<uint8_t> src(W * H), whole(W * H), tiled(W * H);
+        for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>((i * 37) ^ (i / 11));
+        meanFilter(src, whole, W, 0, 0, W, H, 0, 0, W, H);
+        const blurcore::TileGrid grid = {W, H, 16, 16, 2};
+        blurcore::forEachTile(grid, [&](const blurcore::Tile& t, int) {
+            // Only the halo region may be read, as if it were a copy
+            meanFilter(src, tiled, W, t.x0, t.y0, t.x1, t.y1, t.hx0, t.hy0, t.hx1, t.hy1);
+        });
+        if (tiled != whole) {
+            std::cerr << "seams between tiles\n";
+            return 2;
+        }
+    }
+
+    // The first worker's tiles are slow; the others must steal them
+    {
+        const blurcore::TileGrid grid = {256, 256, 32, 32, 0};
+        std::mutex mutex;
+        std::set<int> slowWorkers;
+        blurcore::forEachTile(grid, [&](const blurcore::Tile& t, int worker) {
+            if (t.index >= 16) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+            std::lock_guard<std::mutex> lock(mutex);
+            slowWorkers.insert(worker);
+        });
+        if (slowWorkers.size() < 2) {
+            std::cerr << "slow tiles were not stolen\n";
+            return 3;
+        }
+    }
+
+    // Degenerate grids
+    int calls = 0;
+    blurcore::forEachTile({0, 10, 0, 0, 0}, [&](const blurcore::Tile&, int) { ++calls; });
+    blur_set_thread_count(1);
+    blurcore::forEachTile({10, 10, 0, 0, 3}, [&](const blurcore::Tile& t, int worker) {
+        if (worker == 0 && t.x1 == 10 && t.y1 == 10 && t.hx0 == 0) ++calls;
+    });
+    if (calls != 1) {
+        std::cerr << "degenerate grid handled wrongly\n";
+        return 4;
+    }
+
+    std::cout << "tile scheduler tests passed\n";
+    return 0;
+}
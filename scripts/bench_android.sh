@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+# Build blurcore_bench for an Android device with the NDK, run it over adb
+# and pull the JSON results back.
+#
+# Usage: scripts/bench_android.sh [out.json] [bench args...]
+#   ANDROID_NDK_HOME  NDK root (required)
+#   ABI               arm64-v8a (default) or armeabi-v7a, x86_64
+#
+# Compare against a stored baseline on the host afterwards, or pass
+# --baseline=/data/local/tmp/<file> after pushing one.
+set -euo pipefail
+
+: "${ANDROID_NDK_HOME:?set ANDROID_NDK_HOME to the NDK root}"
+ABI="${ABI:-arm64-v8a}"
+OUT="${1:-bench_${ABI}.json}"
+shift || true
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD="$ROOT/native/_bench_android_$ABI"
+DEVICE_DIR=/data/local/tmp
+
+cmake -S "$ROOT/native" -B "$BUILD" \
+    -DCMAKE_TOOLCHAIN_FILE="$ANDROID_NDK_HOME/build/cmake/android.toolchain.cmake" \
+    -DANDROID_ABI="$ABI" -DANDROID_PLATFORM=android-26 -DCMAKE_BUILD_TYPE=Release
+cmake --build "$BUILD" --target blurcore_bench -j
+
+adb push "$BUILD/blurcore_bench" "$DEVICE_DIR/blurcore_bench" >/dev/null
+adb shell chmod 755 "$DEVICE_DIR/blurcore_bench"
+# Exit status 2 means a baseline regression; still pull the results
+status=0
+adb shell "$DEVICE_DIR/blurcore_bench" --json="$DEVICE_DIR/blurcore_bench.json" "$@" || status=$?
+adb pull "$DEVICE_DIR/blurcore_bench.json" "$OUT" >/dev/null
+echo "results written to $OUT"
+exit $status